@@ -0,0 +1,249 @@
+#include "aho_corasick.h"
+#include <string.h>
+
+// Trie node; node 0 is the root
+typedef struct {
+    guint32 first_child;   // Build-time child list (0 = none; the root is never a child)
+    guint32 next_sibling;
+    guint32 fail;          // Longest proper suffix of this node's string that is also in the trie
+    guint32 dict_link;     // Nearest node on the failure chain that ends a pattern, 0 if none
+    guint32 pattern;       // First pattern ending here + 1, 0 if none
+    guint32 edge_start;    // Compiled, byte-sorted outgoing edges
+    guint32 edge_count;
+    guint8 byte;           // Byte on the edge from the parent
+} AcNode;
+
+typedef struct {
+    size_t length;
+    guint32 next_same;     // Next pattern with identical bytes + 1, 0 if none
+} AcPattern;
+
+struct AhoCorasick {
+    GArray *nodes;         // AcNode
+    GArray *patterns;      // AcPattern
+    guint8 *edge_bytes;
+    guint32 *edge_targets;
+    guint32 root_next[256]; // Dense transitions out of the root
+    guint8 fold[256];       // Input byte mapping (identity or ASCII lowercase)
+    bool built;
+};
+
+static inline AcNode *node_at(const AhoCorasick *ac, guint32 index) {
+    return &g_array_index(ac->nodes, AcNode, index);
+}
+
+// Build-time child lookup through the sibling list
+static guint32 find_child(const AhoCorasick *ac, guint32 node, guint8 byte) {
+    for (guint32 child = node_at(ac, node)->first_child; child != 0; child = node_at(ac, child)->next_sibling) {
+        if (node_at(ac, child)->byte == byte) return child;
+    }
+    return 0;
+}
+
+// Scan-time transition lookup on the compiled edges
+static inline guint32 find_edge(const AhoCorasick *ac, const AcNode *node, guint8 byte) {
+    const guint8 *bytes = ac->edge_bytes + node->edge_start;
+    guint32 count = node->edge_count;
+
+    if (count <= 8) {
+        for (guint32 i = 0; i < count; i++) {
+            if (bytes[i] == byte) return ac->edge_targets[node->edge_start + i];
+        }
+        return 0;
+    }
+
+    guint32 lo = 0, hi = count;
+    while (lo < hi) {
+        guint32 mid = (lo + hi) / 2;
+        if (bytes[mid] < byte) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < count && bytes[lo] == byte) ? ac->edge_targets[node->edge_start + lo] : 0;
+}
+
+// Function to create an empty automaton
+AhoCorasick* aho_corasick_new(bool ascii_case_insensitive) {
+    AhoCorasick *ac = g_new0(AhoCorasick, 1);
+    ac->nodes = g_array_new(FALSE, TRUE, sizeof(AcNode));
+    ac->patterns = g_array_new(FALSE, TRUE, sizeof(AcPattern));
+
+    AcNode root = { 0 };
+    g_array_append_val(ac->nodes, root);
+
+    for (int i = 0; i < 256; i++) {
+        ac->fold[i] = (ascii_case_insensitive && i >= 'A' && i <= 'Z') ? (guint8)(i + 32) : (guint8)i;
+    }
+
+    return ac;
+}
+
+// Function to add a pattern
+guint aho_corasick_add_pattern(AhoCorasick *ac, const guint8 *pattern, size_t len) {
+    g_return_val_if_fail(!ac->built, G_MAXUINT);
+
+    guint32 node = 0;
+    for (size_t i = 0; i < len; i++) {
+        guint8 byte = ac->fold[pattern[i]];
+        guint32 child = find_child(ac, node, byte);
+
+        if (child == 0) {
+            AcNode fresh = { 0 };
+            fresh.byte = byte;
+            fresh.next_sibling = node_at(ac, node)->first_child;
+            child = ac->nodes->len;
+            g_array_append_val(ac->nodes, fresh);
+            node_at(ac, node)->first_child = child;
+        }
+        node = child;
+    }
+
+    guint id = ac->patterns->len;
+    AcPattern entry = { len, 0 };
+
+    // Patterns with identical bytes share a terminal node and are chained
+    AcNode *terminal = node_at(ac, node);
+    if (len > 0) {
+        entry.next_same = terminal->pattern;
+        terminal->pattern = id + 1;
+    }
+
+    g_array_append_val(ac->patterns, entry);
+    return id;
+}
+
+// Orders (byte, target) pairs by byte
+static int compare_edge_bytes(const void *a, const void *b) {
+    return (int)((const guint32 *)a)[0] - (int)((const guint32 *)b)[0];
+}
+
+// Function to compute the failure links
+void aho_corasick_build(AhoCorasick *ac) {
+    if (ac->built) return;
+    ac->built = true;
+
+    guint32 node_count = ac->nodes->len;
+    guint32 *queue = g_new(guint32, node_count);
+    guint32 head = 0, tail = 0;
+
+    // Breadth-first order guarantees that failure targets (shallower nodes) are done first
+    queue[tail++] = 0;
+    while (head < tail) {
+        guint32 u = queue[head++];
+
+        for (guint32 v = node_at(ac, u)->first_child; v != 0; v = node_at(ac, v)->next_sibling) {
+            guint8 byte = node_at(ac, v)->byte;
+            guint32 fail = 0;
+
+            if (u != 0) {
+                guint32 f = node_at(ac, u)->fail;
+                while (true) {
+                    guint32 next = find_child(ac, f, byte);
+                    if (next != 0) {
+                        fail = next;
+                        break;
+                    }
+                    if (f == 0) break;
+                    f = node_at(ac, f)->fail;
+                }
+            }
+
+            AcNode *fail_node = node_at(ac, fail);
+            AcNode *child = node_at(ac, v);
+            child->fail = fail;
+            child->dict_link = fail_node->pattern != 0 ? fail : fail_node->dict_link;
+            queue[tail++] = v;
+        }
+    }
+    g_free(queue);
+
+    // Compile the child lists into contiguous byte-sorted edge arrays
+    ac->edge_bytes = g_new(guint8, MAX(node_count, 1));
+    ac->edge_targets = g_new(guint32, MAX(node_count, 1));
+    guint32 edge_total = 0;
+    guint32 pairs[256][2];
+
+    for (guint32 n = 0; n < node_count; n++) {
+        guint32 count = 0;
+        for (guint32 child = node_at(ac, n)->first_child; child != 0; child = node_at(ac, child)->next_sibling) {
+            pairs[count][0] = node_at(ac, child)->byte;
+            pairs[count][1] = child;
+            count++;
+        }
+        qsort(pairs, count, sizeof(pairs[0]), compare_edge_bytes);
+
+        AcNode *node = node_at(ac, n);
+        node->edge_start = edge_total;
+        node->edge_count = count;
+        for (guint32 i = 0; i < count; i++) {
+            ac->edge_bytes[edge_total] = (guint8)pairs[i][0];
+            ac->edge_targets[edge_total] = pairs[i][1];
+            edge_total++;
+        }
+    }
+
+    memset(ac->root_next, 0, sizeof(ac->root_next));
+    for (guint32 child = node_at(ac, 0)->first_child; child != 0; child = node_at(ac, child)->next_sibling) {
+        ac->root_next[node_at(ac, child)->byte] = child;
+    }
+}
+
+// Function to get the number of patterns
+guint aho_corasick_pattern_count(const AhoCorasick *ac) {
+    return ac->patterns->len;
+}
+
+// Function to get the length of one pattern
+size_t aho_corasick_pattern_length(const AhoCorasick *ac, guint pattern_id) {
+    g_return_val_if_fail(pattern_id < ac->patterns->len, 0);
+    return g_array_index(ac->patterns, AcPattern, pattern_id).length;
+}
+
+// Function to scan a buffer, reporting matches to func
+guint aho_corasick_scan(const AhoCorasick *ac, guint state, const guint8 *data, size_t len,
+                        size_t base_offset, AhoCorasickMatchFunc func, gpointer user_data) {
+    g_return_val_if_fail(ac->built, state);
+
+    const AcNode *nodes = (const AcNode *)(void *)ac->nodes->data;
+
+    for (size_t i = 0; i < len; i++) {
+        guint8 byte = ac->fold[data[i]];
+
+        while (true) {
+            if (state == 0) {
+                state = ac->root_next[byte];
+                break;
+            }
+            guint32 next = find_edge(ac, &nodes[state], byte);
+            if (next != 0) {
+                state = next;
+                break;
+            }
+            state = nodes[state].fail;
+        }
+
+        // Report every pattern ending here: this node, then its dictionary suffix chain
+        guint32 out = nodes[state].pattern != 0 ? state : nodes[state].dict_link;
+        while (out != 0) {
+            for (guint32 id = nodes[out].pattern; id != 0;
+                 id = g_array_index(ac->patterns, AcPattern, id - 1).next_same) {
+                if (!func(id - 1, base_offset + i + 1, user_data)) {
+                    return state;
+                }
+            }
+            out = nodes[out].dict_link;
+        }
+    }
+
+    return state;
+}
+
+// Function to free an automaton
+void aho_corasick_free(AhoCorasick *ac) {
+    if (ac == NULL) return;
+
+    g_array_free(ac->nodes, TRUE);
+    g_array_free(ac->patterns, TRUE);
+    g_free(ac->edge_bytes);
+    g_free(ac->edge_targets);
+    g_free(ac);
+}
@@ -0,0 +1,39 @@
+#ifndef AHO_CORASICK_H
+#define AHO_CORASICK_H
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Multi-pattern byte matcher (Aho-Corasick automaton)
+// Add all patterns, call aho_corasick_build() once, then scan any number of buffers.
+// A built automaton is read-only and can be shared between threads.
+typedef struct AhoCorasick AhoCorasick;
+
+// Called for every match; end is the offset just past the match. Return false to stop scanning.
+typedef bool (*AhoCorasickMatchFunc)(guint pattern_id, size_t end, gpointer user_data);
+
+// Function to create an empty automaton
+// With ascii_case_insensitive set, ASCII letters match regardless of case.
+AhoCorasick* aho_corasick_new(bool ascii_case_insensitive);
+
+// Function to add a pattern; returns its id (ids are assigned 0, 1, 2, ... in insertion order)
+guint aho_corasick_add_pattern(AhoCorasick *ac, const guint8 *pattern, size_t len);
+
+// Function to compute the failure links; no patterns can be added afterwards
+void aho_corasick_build(AhoCorasick *ac);
+
+// Function to get the number of patterns and the length of one pattern
+guint aho_corasick_pattern_count(const AhoCorasick *ac);
+size_t aho_corasick_pattern_length(const AhoCorasick *ac, guint pattern_id);
+
+// Function to scan a buffer, reporting matches to func
+// state carries the automaton position across consecutive chunks of one stream (start with 0);
+// base_offset is added to reported end offsets. Returns the state to pass with the next chunk.
+guint aho_corasick_scan(const AhoCorasick *ac, guint state, const guint8 *data, size_t len,
+                        size_t base_offset, AhoCorasickMatchFunc func, gpointer user_data);
+
+// Function to free an automaton
+void aho_corasick_free(AhoCorasick *ac);
+
+#endif /* AHO_CORASICK_H */
@@ -0,0 +1,818 @@
+#include "ai_client.h"
+#include "common.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <curl/curl.h>
+#include "json_stream.h"
+
+// Default models used when none is configured
+#define DEFAULT_OPENAI_MODEL "gpt-3.5-turbo"
+#define DEFAULT_GEMINI_MODEL "gemini-2.0-flash"
+
+// Number of recent latencies kept per provider for the p95 estimate
+#define LATENCY_WINDOW 64
+// Minimum number of samples before the p95 estimate is trusted
+#define LATENCY_MIN_SAMPLES 8
+// Hedge delay used until enough samples are collected, and its bounds
+#define HEDGE_DEFAULT_DELAY_MS 4000
+#define HEDGE_MIN_DELAY_MS 500
+#define HEDGE_MAX_DELAY_MS 20000
+
+// Consecutive failures that open a provider's circuit breaker, and how long it stays open
+#define BREAKER_FAILURE_THRESHOLD 3
+#define BREAKER_COOLDOWN_MS 30000
+
+// Times a rate-limited (429) request is sent again, after the wait the server's Retry-After asks
+// for (or a doubling one without it), capped so a request isn't held for long
+#define RATE_LIMIT_RETRIES 2
+#define RATE_LIMIT_DEFAULT_WAIT_MS 1000
+#define RATE_LIMIT_MAX_WAIT_MS 10000
+// A wait checks this often whether the request was cancelled
+#define RATE_LIMIT_POLL_MS 50
+
+// Smallest segment budget worth sending, even with a very large prompt overhead
+#define MIN_SEGMENT_TOKENS 256
+
+// Request body buffers that grew beyond this are released instead of kept for reuse
+#define MAX_RETAINED_BODY_BYTES (4 * 1024 * 1024)
+
+// API endpoints; HEX2TEXT_OPENAI_BASE_URL / HEX2TEXT_GEMINI_BASE_URL replace the base URL,
+// e.g. to run against the local mock server
+#define OPENAI_BASE_URL "https://api.openai.com"
+#define GEMINI_BASE_URL "https://generativelanguage.googleapis.com"
+
+// Instructions sent ahead of every prompt
+#define SYSTEM_INSTRUCTIONS "You are a specialized format translator. Provide only the translation and a brief byte-by-byte breakdown. Preserve any control code structures or formatting (things like <|, etc). Be concise and focus only on the translation task."
+
+// Approximate context windows of known model families, most specific prefix first
+static const struct {
+    const char *prefix;
+    size_t context_tokens;
+} model_contexts[] = {
+    { "gpt-3.5-turbo", 16385 },
+    { "gpt-4o", 128000 },
+    { "gpt-4.1", 1000000 },
+    { "gpt-4-turbo", 128000 },
+    { "gpt-4", 8192 },
+    { "gpt-5", 400000 },
+    { "o1", 128000 },
+    { "o3", 200000 },
+    { "o4", 200000 },
+    { "gemini-1.0", 32768 },
+    { "gemini-pro", 32768 },
+    { "gemini", 1000000 },
+};
+
+// Context window assumed for unknown models
+#define DEFAULT_CONTEXT_TOKENS 8192
+
+// List prices of known model families in US dollars per million input tokens,
+// most specific prefix first; only used for the estimate shown before sending
+static const struct {
+    const char *prefix;
+    double usd_per_million;
+} model_input_prices[] = {
+    { "gpt-3.5-turbo", 0.50 },
+    { "gpt-4o-mini", 0.15 },
+    { "gpt-4o", 2.50 },
+    { "gpt-4.1-nano", 0.10 },
+    { "gpt-4.1-mini", 0.40 },
+    { "gpt-4.1", 2.00 },
+    { "gpt-4-turbo", 10.00 },
+    { "gpt-4", 30.00 },
+    { "gemini-1.5-flash", 0.075 },
+    { "gemini-1.5-pro", 1.25 },
+    { "gemini-2.0-flash-lite", 0.075 },
+    { "gemini-2.0-flash", 0.10 },
+    { "gemini-2.5-flash", 0.30 },
+    { "gemini-2.5-pro", 1.25 },
+};
+
+// Struct for curl response data
+struct MemoryStruct {
+    char *memory;
+    size_t size;
+};
+
+// Per-provider health tracking (latency history and circuit breaker)
+typedef struct {
+    gint64 latencies_ms[LATENCY_WINDOW];
+    guint latency_count;
+    guint latency_next;
+    guint consecutive_failures;
+    gint64 open_until; // Monotonic time until which the breaker is open, 0 when closed
+    bool probe_in_flight; // Half-open: the one request let through hasn't finished yet
+} ProviderHealth;
+
+static ProviderHealth provider_health[2];
+static GMutex provider_health_mutex;
+
+// Per-thread request body buffer, reused across requests
+static void free_body_buffer(gpointer data) {
+    g_string_free(data, TRUE);
+}
+
+static GPrivate body_buffer_key = G_PRIVATE_INIT(free_body_buffer);
+
+static GString* get_body_buffer(void) {
+    GString *buffer = g_private_get(&body_buffer_key);
+    if (buffer == NULL) {
+        buffer = g_string_sized_new(4096);
+        g_private_set(&body_buffer_key, buffer);
+    }
+    return buffer;
+}
+
+// Release the thread's body buffer if an unusually large prompt made it grow
+static void trim_body_buffer(void) {
+    GString *buffer = g_private_get(&body_buffer_key);
+    if (buffer != NULL && buffer->allocated_len > MAX_RETAINED_BODY_BYTES) {
+        g_private_replace(&body_buffer_key, NULL);
+    }
+}
+
+// Callback function for curl to feed received data straight into the response parser
+static size_t parse_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    JsonPullParser *parser = userp;
+
+    // Keep receiving even after a syntax error; the result is checked once the transfer ends
+    json_pull_parser_feed(parser, contents, realsize);
+    return realsize;
+}
+
+// Callback function for curl to write received data
+static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    struct MemoryStruct *mem = (struct MemoryStruct *)userp;
+
+    // Use g_realloc for consistency with the rest of the codebase
+    char *ptr = g_realloc(mem->memory, mem->size + realsize + 1);
+    if (!ptr) {
+        fprintf(stderr, "Not enough memory (g_realloc returned NULL)\n");
+        return 0;
+    }
+
+    mem->memory = ptr;
+    memcpy(&(mem->memory[mem->size]), contents, realsize);
+    mem->size += realsize;
+    mem->memory[mem->size] = 0;
+
+    return realsize;
+}
+
+// Curl progress callback used to abort a transfer that lost a hedge race
+static int cancel_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                           curl_off_t ultotal, curl_off_t ulnow) {
+    const gint *cancelled = clientp;
+    return (cancelled != NULL && g_atomic_int_get(cancelled)) ? 1 : 0;
+}
+
+// curl_global_init is not thread-safe, so run it exactly once before any request thread
+static gpointer init_curl_once(gpointer unused) {
+    curl_global_init(CURL_GLOBAL_ALL);
+    return NULL;
+}
+
+static void ensure_curl_initialized(void) {
+    static GOnce curl_once = G_ONCE_INIT;
+    g_once(&curl_once, init_curl_once, NULL);
+}
+
+static const char *provider_name(AIProvider provider) {
+    return provider == OPENAI ? "OpenAI" : "Gemini";
+}
+
+static const char *api_base_url(AIProvider provider) {
+    const char *url = g_getenv(provider == OPENAI ? "HEX2TEXT_OPENAI_BASE_URL" : "HEX2TEXT_GEMINI_BASE_URL");
+    if (url != NULL && *url != '\0') return url;
+    return provider == OPENAI ? OPENAI_BASE_URL : GEMINI_BASE_URL;
+}
+
+// Record the outcome of a finished request for the latency estimate and the circuit breaker
+static void record_request_result(AIProvider provider, bool ok, gint64 latency_ms) {
+    g_mutex_lock(&provider_health_mutex);
+    ProviderHealth *health = &provider_health[provider];
+
+    if (ok) {
+        health->latencies_ms[health->latency_next] = latency_ms;
+        health->latency_next = (health->latency_next + 1) % LATENCY_WINDOW;
+        if (health->latency_count < LATENCY_WINDOW) health->latency_count++;
+        health->consecutive_failures = 0;
+        health->open_until = 0;
+    } else {
+        health->consecutive_failures++;
+        if (health->consecutive_failures >= BREAKER_FAILURE_THRESHOLD) {
+            // Open (or re-open after a failed half-open probe)
+            health->open_until = g_get_monotonic_time() + BREAKER_COOLDOWN_MS * G_TIME_SPAN_MILLISECOND;
+            fprintf(stderr, "DEBUG: Circuit breaker opened for %s after %u failures\n",
+                    provider_name(provider), health->consecutive_failures);
+        }
+    }
+
+    // Any result answers a half-open probe: success closed the breaker, failure re-opened it
+    health->probe_in_flight = false;
+    g_mutex_unlock(&provider_health_mutex);
+}
+
+// Function to let a request through a provider's circuit breaker
+// Once the cooldown has passed the breaker is half-open: one request is let through as a probe
+// (probe is set) and the rest are turned away until its result is recorded; a single further
+// failure re-opens it.
+static bool admit_request(AIProvider provider, bool *probe) {
+    g_mutex_lock(&provider_health_mutex);
+    ProviderHealth *health = &provider_health[provider];
+    bool admitted;
+    *probe = false;
+
+    if (health->open_until == 0) {
+        admitted = true;
+    } else if (health->open_until > g_get_monotonic_time() || health->probe_in_flight) {
+        admitted = false;
+    } else {
+        health->probe_in_flight = true;
+        *probe = true;
+        admitted = true;
+    }
+
+    g_mutex_unlock(&provider_health_mutex);
+    return admitted;
+}
+
+// Function to give back a probe whose transfer was cancelled, so the next request probes instead
+static void release_probe(AIProvider provider) {
+    g_mutex_lock(&provider_health_mutex);
+    provider_health[provider].probe_in_flight = false;
+    g_mutex_unlock(&provider_health_mutex);
+}
+
+// Function to check whether a provider's circuit breaker currently lets requests through
+bool ai_client_provider_available(AIProvider provider) {
+    g_mutex_lock(&provider_health_mutex);
+    const ProviderHealth *health = &provider_health[provider];
+    bool available = health->open_until <= g_get_monotonic_time() && !health->probe_in_flight;
+    g_mutex_unlock(&provider_health_mutex);
+    return available;
+}
+
+// Function to get the reply given when the breaker turns a request away
+static char* unavailable_error(AIProvider provider) {
+    return g_strdup_printf("Error: %s is unavailable after repeated failures; try again shortly.",
+                           provider_name(provider));
+}
+
+static int compare_gint64(const void *a, const void *b) {
+    gint64 x = *(const gint64 *)a;
+    gint64 y = *(const gint64 *)b;
+    return (x > y) - (x < y);
+}
+
+// Delay before hedging: the provider's p95 latency over recent successful requests
+static gint64 hedge_delay_ms(AIProvider provider) {
+    gint64 samples[LATENCY_WINDOW];
+    guint count;
+
+    g_mutex_lock(&provider_health_mutex);
+    count = provider_health[provider].latency_count;
+    memcpy(samples, provider_health[provider].latencies_ms, count * sizeof(gint64));
+    g_mutex_unlock(&provider_health_mutex);
+
+    if (count < LATENCY_MIN_SAMPLES) {
+        return HEDGE_DEFAULT_DELAY_MS;
+    }
+
+    qsort(samples, count, sizeof(gint64), compare_gint64);
+    gint64 p95 = samples[(count * 95 + 99) / 100 - 1];
+    return CLAMP(p95, HEDGE_MIN_DELAY_MS, HEDGE_MAX_DELAY_MS);
+}
+
+// Perform the HTTP request for one provider
+// cancelled may point to a flag that aborts the transfer when set from another thread.
+// retry_after_ms is set when the provider rate-limited the request: to the wait its Retry-After
+// header asks for, or -1 without one; otherwise to 0.
+static char* perform_request(const AIBackend *backend, const char *prompt, const gint *cancelled, bool *ok,
+                             gint64 *retry_after_ms) {
+    *ok = false;
+    *retry_after_ms = 0;
+
+    if (backend->api_key == NULL || strlen(backend->api_key) < 10) {
+        return g_strdup_printf("Error: No valid %s API key found. Please set it in AI Settings.",
+                               provider_name(backend->provider));
+    }
+
+    ensure_curl_initialized();
+
+    CURL *curl;
+    CURLcode res;
+    JsonPullParser *parser = json_pull_parser_new();
+    guint content_watch = 0;
+    char *translation = NULL;
+
+    curl = curl_easy_init();
+
+    if (curl) {
+        struct curl_slist *headers = NULL;
+        char url[512];
+
+        // Write the request body directly, escaping the prompt into the reusable buffer
+        GString *body = get_body_buffer();
+        JsonWriter writer;
+        json_writer_init(&writer, body);
+        json_writer_begin_object(&writer);
+
+        if (backend->provider == OPENAI) {
+            json_writer_key(&writer, "messages");
+            json_writer_begin_array(&writer);
+
+            // Add system message
+            json_writer_begin_object(&writer);
+            json_writer_key(&writer, "role");
+            json_writer_string(&writer, "system");
+            json_writer_key(&writer, "content");
+            json_writer_string(&writer, SYSTEM_INSTRUCTIONS);
+            json_writer_end_object(&writer);
+
+            // Add user message with prompt
+            json_writer_begin_object(&writer);
+            json_writer_key(&writer, "role");
+            json_writer_string(&writer, "user");
+            json_writer_key(&writer, "content");
+            json_writer_string(&writer, prompt);
+            json_writer_end_object(&writer);
+
+            json_writer_end_array(&writer);
+
+            // Use custom model if available, otherwise use default
+            json_writer_key(&writer, "model");
+            if (backend->model != NULL && strlen(backend->model) > 0) {
+                json_writer_string(&writer, backend->model);
+            } else {
+                json_writer_string(&writer, DEFAULT_OPENAI_MODEL);
+            }
+
+            json_writer_key(&writer, "temperature");
+            json_writer_double(&writer, 0.3);
+            json_writer_key(&writer, "max_tokens");
+            json_writer_int(&writer, AI_MAX_OUTPUT_TOKENS);
+
+            // Set up headers
+            char auth_header[256];
+            snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", backend->api_key);
+            headers = curl_slist_append(headers, auth_header);
+            headers = curl_slist_append(headers, "Content-Type: application/json");
+
+            snprintf(url, sizeof(url), "%s/v1/chat/completions", api_base_url(OPENAI));
+
+            content_watch = json_pull_parser_watch(parser, "choices[0].message.content");
+        } else {
+            json_writer_key(&writer, "contents");
+            json_writer_begin_array(&writer);
+
+            // Add system instructions
+            json_writer_begin_object(&writer);
+            json_writer_key(&writer, "parts");
+            json_writer_begin_array(&writer);
+            json_writer_begin_object(&writer);
+            json_writer_key(&writer, "text");
+            json_writer_string(&writer, SYSTEM_INSTRUCTIONS);
+            json_writer_end_object(&writer);
+            json_writer_end_array(&writer);
+            json_writer_key(&writer, "role");
+            json_writer_string(&writer, "system");
+            json_writer_end_object(&writer);
+
+            // Add user content part
+            json_writer_begin_object(&writer);
+            json_writer_key(&writer, "parts");
+            json_writer_begin_array(&writer);
+            json_writer_begin_object(&writer);
+            json_writer_key(&writer, "text");
+            json_writer_string(&writer, prompt);
+            json_writer_end_object(&writer);
+            json_writer_end_array(&writer);
+            json_writer_key(&writer, "role");
+            json_writer_string(&writer, "user");
+            json_writer_end_object(&writer);
+
+            json_writer_end_array(&writer);
+
+            // Add generation config
+            json_writer_key(&writer, "generationConfig");
+            json_writer_begin_object(&writer);
+            json_writer_key(&writer, "temperature");
+            json_writer_double(&writer, 0.3);
+            json_writer_key(&writer, "maxOutputTokens");
+            json_writer_int(&writer, AI_MAX_OUTPUT_TOKENS);
+            json_writer_end_object(&writer);
+
+            // Use custom model if available
+            const char *model_name = DEFAULT_GEMINI_MODEL;
+            if (backend->model != NULL && strlen(backend->model) > 0) {
+                model_name = backend->model;
+            }
+
+            snprintf(url, sizeof(url), "%s/v1beta/models/%s:generateContent?key=%s",
+                    api_base_url(GEMINI), model_name, backend->api_key);
+
+            headers = curl_slist_append(headers, "Content-Type: application/json");
+
+            // The answer may be split over several parts
+            content_watch = json_pull_parser_watch(parser, "candidates[0].content.parts[*].text");
+        }
+
+        json_writer_end_object(&writer);
+        guint error_watch = json_pull_parser_watch(parser, "error.message");
+
+        // Set up request
+        curl_easy_setopt(curl, CURLOPT_URL, url);
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body->str);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)body->len);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, parse_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)parser);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L); // Required when used from worker threads
+
+        if (cancelled != NULL) {
+            curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, cancel_callback);
+            curl_easy_setopt(curl, CURLOPT_XFERINFODATA, (void *)cancelled);
+            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        }
+
+        // Perform the request
+        res = curl_easy_perform(curl);
+
+        // Check for errors
+        if (res == CURLE_OK) {
+            long response_code = 0;
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+            if (response_code == 429) {
+                curl_off_t retry_after = 0;
+                *retry_after_ms = curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after) == CURLE_OK &&
+                                  retry_after > 0 ? (gint64)retry_after * 1000 : -1;
+            }
+
+            // The response was parsed while it arrived; only a complete document counts
+            if (json_pull_parser_finish(parser)) {
+                translation = json_pull_parser_steal(parser, content_watch);
+                *ok = (translation != NULL);
+
+                // Check for error message
+                if (translation == NULL && json_pull_parser_get(parser, error_watch) != NULL) {
+                    translation = g_strdup_printf("Error: %s", json_pull_parser_get(parser, error_watch));
+                }
+            }
+        } else if (res == CURLE_ABORTED_BY_CALLBACK) {
+            translation = g_strdup("Error: Request cancelled.");
+        } else {
+            translation = g_strdup_printf("Error: %s", curl_easy_strerror(res));
+        }
+
+        // Clean up
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
+        trim_body_buffer();
+    }
+
+    json_pull_parser_free(parser);
+
+    if (translation == NULL) {
+        translation = g_strdup_printf("Error: Failed to get translation from %s.", provider_name(backend->provider));
+    }
+
+    return translation;
+}
+
+// Function to wait before sending a rate-limited request again; false if cancelled meanwhile
+static bool wait_for_retry(gint64 wait_ms, const gint *cancelled) {
+    gint64 end = g_get_monotonic_time() + wait_ms * G_TIME_SPAN_MILLISECOND;
+    while (cancelled == NULL || !g_atomic_int_get(cancelled)) {
+        gint64 left = end - g_get_monotonic_time();
+        if (left <= 0) return true;
+        g_usleep(MIN(left, RATE_LIMIT_POLL_MS * G_TIME_SPAN_MILLISECOND));
+    }
+    return false;
+}
+
+// Perform the request, sending it again when the provider rate-limits it
+// latency_ms receives the time the last attempt took, so waiting doesn't count as slowness.
+static char* perform_request_with_retries(const AIBackend *backend, const char *prompt, const gint *cancelled,
+                                          bool *ok, gint64 *latency_ms) {
+    gint64 backoff_ms = RATE_LIMIT_DEFAULT_WAIT_MS;
+    for (guint attempt = 0; ; attempt++) {
+        gint64 retry_after_ms = 0;
+        gint64 start = g_get_monotonic_time();
+        char *response = perform_request(backend, prompt, cancelled, ok, &retry_after_ms);
+        *latency_ms = (g_get_monotonic_time() - start) / G_TIME_SPAN_MILLISECOND;
+        if (*ok || retry_after_ms == 0 || attempt == RATE_LIMIT_RETRIES) return response;
+
+        gint64 wait_ms = MIN(retry_after_ms > 0 ? retry_after_ms : backoff_ms, RATE_LIMIT_MAX_WAIT_MS);
+        backoff_ms *= 2;
+        fprintf(stderr, "DEBUG: %s rate limited, retrying in %" G_GINT64_FORMAT " ms\n",
+                provider_name(backend->provider), wait_ms);
+        if (!wait_for_retry(wait_ms, cancelled)) return response;
+        g_free(response);
+    }
+}
+
+// Function to send a prompt to a single provider
+char* ai_client_send(const AIBackend *backend, const char *prompt, bool *ok) {
+    bool success = false;
+    bool probe;
+    if (!admit_request(backend->provider, &probe)) {
+        if (ok != NULL) *ok = false;
+        return unavailable_error(backend->provider);
+    }
+
+    gint64 latency_ms = 0;
+    char *result = perform_request_with_retries(backend, prompt, NULL, &success, &latency_ms);
+    record_request_result(backend->provider, success, latency_ms);
+
+    if (ok != NULL) *ok = success;
+    return result;
+}
+
+// Shared state of one hedged request; owned jointly by the caller and every attempt thread
+typedef struct {
+    gint ref_count;
+    GMutex mutex;
+    GCond cond;
+    char *prompt;
+    gint cancelled;     // Set once a winner is known so the other transfer aborts
+    guint launched;
+    guint finished;
+    char *result;       // First successful response
+    char *last_error;   // Most recent error message, reported if nothing succeeds
+} HedgeState;
+
+// One attempt against a single backend; owns copies of the backend strings
+typedef struct {
+    HedgeState *state;
+    AIProvider provider;
+    char *api_key;
+    char *model;
+    bool probe;         // Let through a half-open breaker
+} HedgeAttempt;
+
+static void hedge_state_unref(HedgeState *state) {
+    if (!g_atomic_int_dec_and_test(&state->ref_count)) return;
+
+    g_mutex_clear(&state->mutex);
+    g_cond_clear(&state->cond);
+    g_free(state->prompt);
+    g_free(state->result);
+    g_free(state->last_error);
+    g_free(state);
+}
+
+static gpointer hedge_attempt_thread(gpointer user_data) {
+    HedgeAttempt *attempt = user_data;
+    HedgeState *state = attempt->state;
+    AIBackend backend = { attempt->provider, attempt->api_key, attempt->model };
+    bool ok = false;
+    gint64 latency_ms = 0;
+
+    char *response = perform_request_with_retries(&backend, state->prompt, &state->cancelled, &ok, &latency_ms);
+
+    // A transfer we aborted ourselves says nothing about the provider's health
+    bool was_cancelled = !ok && g_atomic_int_get(&state->cancelled);
+    if (!was_cancelled) {
+        record_request_result(attempt->provider, ok, latency_ms);
+    } else if (attempt->probe) {
+        release_probe(attempt->provider);
+    }
+
+    g_mutex_lock(&state->mutex);
+    if (ok && state->result == NULL) {
+        fprintf(stderr, "DEBUG: %s answered first after %" G_GINT64_FORMAT " ms\n",
+                provider_name(attempt->provider), latency_ms);
+        state->result = response;
+        response = NULL;
+        g_atomic_int_set(&state->cancelled, 1);
+    } else if (!ok && !was_cancelled) {
+        g_free(state->last_error);
+        state->last_error = response;
+        response = NULL;
+    }
+    state->finished++;
+    g_cond_broadcast(&state->cond);
+    g_mutex_unlock(&state->mutex);
+
+    g_free(response);
+    g_free(attempt->api_key);
+    g_free(attempt->model);
+    g_free(attempt);
+    hedge_state_unref(state);
+    return NULL;
+}
+
+// Start an attempt thread if the provider's breaker lets it through; must be called with
+// state->mutex held
+static bool launch_attempt(HedgeState *state, const AIBackend *backend) {
+    bool probe;
+    if (!admit_request(backend->provider, &probe)) {
+        if (state->last_error == NULL) state->last_error = unavailable_error(backend->provider);
+        return false;
+    }
+
+    HedgeAttempt *attempt = g_new0(HedgeAttempt, 1);
+    attempt->state = state;
+    attempt->probe = probe;
+    attempt->provider = backend->provider;
+    attempt->api_key = g_strdup(backend->api_key);
+    attempt->model = g_strdup(backend->model);
+
+    g_atomic_int_inc(&state->ref_count);
+    state->launched++;
+
+    fprintf(stderr, "DEBUG: Launching request to %s\n", provider_name(backend->provider));
+    GThread *thread = g_thread_new("ai-request", hedge_attempt_thread, attempt);
+    g_thread_unref(thread);
+    return true;
+}
+
+// Function to send a prompt with automatic failover and optional hedging
+char* ai_client_send_hedged(const AIBackend *primary, const AIBackend *secondary,
+                            bool hedge, const char *prompt, bool *ok) {
+    if (secondary == NULL || secondary->api_key == NULL || strlen(secondary->api_key) < 10) {
+        secondary = NULL;
+    }
+
+    // Route around a primary whose breaker is open
+    if (secondary != NULL && !ai_client_provider_available(primary->provider) &&
+        ai_client_provider_available(secondary->provider)) {
+        fprintf(stderr, "DEBUG: %s circuit open, routing to %s\n",
+                provider_name(primary->provider), provider_name(secondary->provider));
+        const AIBackend *tmp = primary;
+        primary = secondary;
+        secondary = tmp;
+    }
+
+    if (secondary == NULL) {
+        return ai_client_send(primary, prompt, ok);
+    }
+
+    HedgeState *state = g_new0(HedgeState, 1);
+    state->ref_count = 1;
+    g_mutex_init(&state->mutex);
+    g_cond_init(&state->cond);
+    state->prompt = g_strdup(prompt);
+
+    bool secondary_launched = false;
+    gint64 deadline = g_get_monotonic_time() + hedge_delay_ms(primary->provider) * G_TIME_SPAN_MILLISECOND;
+
+    g_mutex_lock(&state->mutex);
+    launch_attempt(state, primary);
+
+    while (state->result == NULL) {
+        if (state->finished == state->launched) {
+            // Everything launched so far failed (or was turned away): fail over if we still can
+            if (!secondary_launched) {
+                secondary_launched = true;
+                if (launch_attempt(state, secondary)) continue;
+            }
+            break;
+        }
+
+        if (hedge && !secondary_launched) {
+            if (!g_cond_wait_until(&state->cond, &state->mutex, deadline) && state->result == NULL) {
+                // Primary is slower than its p95: race the secondary against it
+                secondary_launched = launch_attempt(state, secondary);
+                if (!secondary_launched) hedge = false;
+            }
+        } else {
+            g_cond_wait(&state->cond, &state->mutex);
+        }
+    }
+
+    char *result;
+    bool success = state->result != NULL;
+    if (success) {
+        result = g_strdup(state->result);
+    } else if (state->last_error != NULL) {
+        result = g_strdup(state->last_error);
+    } else {
+        result = g_strdup("Error: Failed to get translation.");
+    }
+
+    // Abort whichever attempt is still running
+    g_atomic_int_set(&state->cancelled, 1);
+    g_mutex_unlock(&state->mutex);
+    hedge_state_unref(state);
+
+    if (ok != NULL) *ok = success;
+    return result;
+}
+
+// Function to get the input token budget for one segment of text sent to a model
+// A segment must fit the context window next to the prompt overhead and the response, and its
+// translation (plus breakdown) must fit in the response, which is capped at AI_MAX_OUTPUT_TOKENS.
+size_t ai_client_segment_budget(AIProvider provider, const char *model, size_t prompt_overhead_tokens) {
+    if (model == NULL || strlen(model) == 0) {
+        model = provider == OPENAI ? DEFAULT_OPENAI_MODEL : DEFAULT_GEMINI_MODEL;
+    }
+
+    size_t context_tokens = DEFAULT_CONTEXT_TOKENS;
+    for (size_t i = 0; i < G_N_ELEMENTS(model_contexts); i++) {
+        if (g_str_has_prefix(model, model_contexts[i].prefix)) {
+            context_tokens = model_contexts[i].context_tokens;
+            break;
+        }
+    }
+
+    size_t budget = AI_MAX_OUTPUT_TOKENS / 2;
+    size_t reserved = prompt_overhead_tokens + AI_MAX_OUTPUT_TOKENS;
+    if (context_tokens > reserved) {
+        budget = MIN(budget, context_tokens - reserved);
+    } else {
+        budget = 0;
+    }
+
+    return MAX(budget, MIN_SEGMENT_TOKENS);
+}
+
+// Function to estimate the input cost of a request in US dollars
+bool ai_client_estimate_cost(AIProvider provider, const char *model, size_t input_tokens, double *cost_usd) {
+    if (model == NULL || strlen(model) == 0) {
+        model = provider == OPENAI ? DEFAULT_OPENAI_MODEL : DEFAULT_GEMINI_MODEL;
+    }
+
+    for (size_t i = 0; i < G_N_ELEMENTS(model_input_prices); i++) {
+        if (g_str_has_prefix(model, model_input_prices[i].prefix)) {
+            if (cost_usd != NULL) *cost_usd = input_tokens * model_input_prices[i].usd_per_million / 1e6;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Function to check if an API key is valid
+bool check_api_key(AIProvider provider, const char *api_key) {
+    if (api_key == NULL || strlen(api_key) < 10) {
+        return false;
+    }
+
+    CURL *curl;
+    CURLcode res;
+    struct MemoryStruct chunk;
+    bool is_valid = false;
+
+    chunk.memory = g_malloc(1);  // will be grown as needed by g_realloc
+    chunk.size = 0;    // no data at this point
+
+    ensure_curl_initialized();
+    curl = curl_easy_init();
+
+    if (curl) {
+        struct curl_slist *headers = NULL;
+        char url[512];
+
+        if (provider == OPENAI) {
+            // OpenAI API endpoint for a simple models list request
+            snprintf(url, sizeof(url), "%s/v1/models", api_base_url(OPENAI));
+            curl_easy_setopt(curl, CURLOPT_URL, url);
+
+            // Set headers
+            char auth_header[256];
+            snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", api_key);
+            headers = curl_slist_append(headers, auth_header);
+            headers = curl_slist_append(headers, "Content-Type: application/json");
+        } else {
+            // Gemini API endpoint for a simple models list request
+            snprintf(url, sizeof(url), "%s/v1/models?key=%s", api_base_url(GEMINI), api_key);
+            curl_easy_setopt(curl, CURLOPT_URL, url);
+
+            // Set headers
+            headers = curl_slist_append(headers, "Content-Type: application/json");
+        }
+
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L); // 5 second timeout
+
+        // Perform the request
+        res = curl_easy_perform(curl);
+
+        // Check for errors
+        if (res == CURLE_OK) {
+            long response_code;
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+
+            // 200 OK means the API key is valid
+            if (response_code == 200) {
+                is_valid = true;
+            }
+        }
+
+        // Clean up
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
+    }
+
+    g_free(chunk.memory);
+
+    return is_valid;
+}
@@ -0,0 +1,46 @@
+#ifndef AI_CLIENT_H
+#define AI_CLIENT_H
+
+#include <stdbool.h>
+#include "common.h"
+
+// Maximum number of tokens requested for one response
+#define AI_MAX_OUTPUT_TOKENS 2048
+
+// Connection settings for one AI provider
+typedef struct {
+    AIProvider provider;
+    const char *api_key;
+    const char *model;
+} AIBackend;
+
+// Function to send a prompt to a single provider
+// Returns a newly allocated string holding either the response text or an "Error: ..." message;
+// ok (if not NULL) is set to true only when a response text was extracted. A provider whose
+// circuit breaker is open (or half-open with its probe still running) is not asked at all. A
+// rate-limited (429) request is sent again up to twice, after the wait its Retry-After asks for.
+char* ai_client_send(const AIBackend *backend, const char *prompt, bool *ok);
+
+// Function to send a prompt with automatic failover and optional hedging
+// The primary backend is used unless its circuit breaker is open. If it fails, the secondary
+// backend (may be NULL) is tried. With hedge set, the secondary is also started when the
+// primary has not answered within its p95 latency, and whichever answers first wins.
+char* ai_client_send_hedged(const AIBackend *primary, const AIBackend *secondary,
+                            bool hedge, const char *prompt, bool *ok);
+
+// Function to check whether a provider's circuit breaker currently lets requests through
+// A half-open breaker lets only one probe through; while it runs, the provider is unavailable.
+bool ai_client_provider_available(AIProvider provider);
+
+// Function to get the input token budget for one segment of text sent to a model
+// prompt_overhead_tokens is the size of the instructions and context sent along with each segment
+size_t ai_client_segment_budget(AIProvider provider, const char *model, size_t prompt_overhead_tokens);
+
+// Function to estimate the input cost of a request in US dollars
+// Returns false when no price is known for the model.
+bool ai_client_estimate_cost(AIProvider provider, const char *model, size_t input_tokens, double *cost_usd);
+
+// Function to check if an API key is valid
+bool check_api_key(AIProvider provider, const char *api_key);
+
+#endif /* AI_CLIENT_H */
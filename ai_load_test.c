@@ -0,0 +1,241 @@
+// Offline load test of the AI request pipeline
+// Translates a generated script of N dialogue blocks through ai_translator_translate(), the path
+// "Send to AI" takes: segmenting, translation memory, the job journal, control code placeholders,
+// failover and hedging. It runs against the local mock server (mock_ai_server.c) by default,
+// and reports throughput, latency percentiles and failures. The script is generated from a seed, so
+// runs against a mock with the same seed are reproducible; each run gets an empty journal and
+// translation memory of its own.
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ai_client.h"
+#include "ai_translator.h"
+
+// Read by the translator modules; main.c sets it in the app
+bool debug_mode = false;
+
+static gint blocks = 200;
+static gint concurrency = 4;
+static gint block_chars = 600;
+static gchar *provider_option = NULL;
+static gchar *base_url = NULL;
+static gboolean hedge = FALSE;
+static gboolean no_failover = FALSE;
+static gint64 seed = 1;
+static gboolean debug = FALSE;
+
+static GOptionEntry option_entries[] = {
+    { "blocks", 'n', 0, G_OPTION_ARG_INT, &blocks,
+      "Dialogue blocks in the script (default 200); it is split into requests as the app splits it", "N" },
+    { "concurrency", 'c', 0, G_OPTION_ARG_INT, &concurrency, "Requests in flight at once (default 4, as in the app)", "N" },
+    { "block-chars", 0, 0, G_OPTION_ARG_INT, &block_chars, "Approximate characters per block (default 600)", "N" },
+    { "provider", 'p', 0, G_OPTION_ARG_STRING, &provider_option, "Primary provider: openai (default) or gemini", "NAME" },
+    { "base-url", 'u', 0, G_OPTION_ARG_STRING, &base_url,
+      "Server for both providers (default http://127.0.0.1:8089, unless HEX2TEXT_*_BASE_URL is set)", "URL" },
+    { "hedge", 0, 0, G_OPTION_ARG_NONE, &hedge, "Hedge slow requests to the other provider", NULL },
+    { "no-failover", 0, 0, G_OPTION_ARG_NONE, &no_failover, "Don't fail over to the other provider", NULL },
+    { "seed", 0, 0, G_OPTION_ARG_INT64, &seed, "Seed for the generated script", "N" },
+    { "debug", 'd', 0, G_OPTION_ARG_NONE, &debug, "Print the translator's debug output", NULL },
+    { NULL }
+};
+
+// Words and control codes the generated dialogue is made of
+static const char *words[] = {
+    "the", "knight", "opened", "gate", "and", "found", "a", "potion", "of", "healing", "you",
+    "cannot", "carry", "more", "items", "castle", "north", "village", "merchant", "gold",
+};
+static const char *codes[] = { "<|n|>", "<|wait 30|>", "<|color red|>", "<|color white|>", "[NAME]", "{0}" };
+
+// Outcome of one request
+typedef struct {
+    gint64 latency_us;
+    bool ok;
+    char *error;
+} LoadSample;
+
+// Samples in the order requests finished; filled from the translator's worker threads
+typedef struct {
+    GMutex mutex;
+    GArray *samples;
+} LoadTest;
+
+static void generate_block(GRand *rand, GString *text) {
+    gsize start = text->len;
+    while ((gint)(text->len - start) < block_chars) {
+        guint r = g_rand_int_range(rand, 0, 100);
+        if (r < 6) {
+            g_string_append(text, codes[g_rand_int_range(rand, 0, G_N_ELEMENTS(codes))]);
+        } else if (r < 10) {
+            g_string_append(text, ".\n");
+        } else {
+            if (text->len > start && text->str[text->len - 1] != '\n') g_string_append_c(text, ' ');
+            g_string_append(text, words[g_rand_int_range(rand, 0, G_N_ELEMENTS(words))]);
+        }
+    }
+}
+
+// Called by the translator as each request finishes
+static void record_sample(guint index, bool ok, gint64 latency_us, const char *result, gpointer user_data) {
+    LoadTest *test = user_data;
+    LoadSample sample = { latency_us, ok, ok ? NULL : g_strdup(result) };
+
+    g_mutex_lock(&test->mutex);
+    g_array_append_val(test->samples, sample);
+    g_mutex_unlock(&test->mutex);
+}
+
+static int compare_gint64(const void *a, const void *b) {
+    gint64 x = *(const gint64 *)a;
+    gint64 y = *(const gint64 *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_ms(const gint64 *sorted, guint count, guint percent) {
+    if (count == 0) return 0;
+    guint index = (count * percent + 99) / 100;
+    return sorted[index > 0 ? index - 1 : 0] / 1000.0;
+}
+
+// Function to remove the config directory a run made, with the files the translator left in it
+static void remove_config_dir(const char *path) {
+    GDir *dir = g_dir_open(path, 0, NULL);
+    if (dir != NULL) {
+        const char *name;
+        while ((name = g_dir_read_name(dir)) != NULL) {
+            char *file = g_build_filename(path, name, NULL);
+            if (g_remove(file) != 0) fprintf(stderr, "ERROR: Could not remove %s\n", file);
+            g_free(file);
+        }
+        g_dir_close(dir);
+    }
+    if (g_rmdir(path) != 0) fprintf(stderr, "ERROR: Could not remove %s\n", path);
+}
+
+int main(int argc, char *argv[]) {
+    GError *error = NULL;
+    GOptionContext *context = g_option_context_new("- load test the AI pipeline against a mock server");
+    g_option_context_add_main_entries(context, option_entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        fprintf(stderr, "ERROR: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return 1;
+    }
+    g_option_context_free(context);
+    debug_mode = debug;
+
+    if (blocks <= 0 || concurrency <= 0) {
+        fprintf(stderr, "ERROR: --blocks and --concurrency must be positive\n");
+        return 1;
+    }
+
+    // Never hit the paid APIs by accident
+    const char *url = base_url != NULL ? base_url : "http://127.0.0.1:8089";
+    if (base_url != NULL || g_getenv("HEX2TEXT_OPENAI_BASE_URL") == NULL) {
+        g_setenv("HEX2TEXT_OPENAI_BASE_URL", url, TRUE);
+    }
+    if (base_url != NULL || g_getenv("HEX2TEXT_GEMINI_BASE_URL") == NULL) {
+        g_setenv("HEX2TEXT_GEMINI_BASE_URL", url, TRUE);
+    }
+
+    // Keep the run's journal and translation memory out of the user's, and start them empty
+    char *config_dir = NULL;
+    if (g_getenv("HEX2TEXT_CONFIG_DIR") == NULL) {
+        config_dir = g_dir_make_tmp("hex2text-load-XXXXXX", &error);
+        if (config_dir == NULL) {
+            fprintf(stderr, "ERROR: %s\n", error->message);
+            g_error_free(error);
+            return 1;
+        }
+        g_setenv("HEX2TEXT_CONFIG_DIR", config_dir, TRUE);
+    }
+
+    AIProvider primary_provider = provider_option != NULL && g_ascii_strcasecmp(provider_option, "gemini") == 0 ? GEMINI : OPENAI;
+    AIBackend primary = { primary_provider, "mock-key-0123456789",
+                          primary_provider == OPENAI ? "gpt-4o-mini" : "gemini-2.0-flash" };
+    AIBackend secondary = { primary_provider == OPENAI ? GEMINI : OPENAI, "mock-key-0123456789",
+                            primary_provider == OPENAI ? "gemini-2.0-flash" : "gpt-4o-mini" };
+
+    GRand *rand = g_rand_new_with_seed((guint32)seed);
+    GString *script = g_string_new(NULL);
+    for (gint i = 0; i < blocks; i++) {
+        if (i > 0) g_string_append(script, "\n\n");
+        generate_block(rand, script);
+    }
+    g_rand_free(rand);
+
+    fprintf(stderr, "Translating %d blocks (%d requests in flight, %s primary%s%s) with %s, state in %s\n",
+            blocks, concurrency, primary_provider == OPENAI ? "OpenAI" : "Gemini", hedge ? ", hedged" : "",
+            no_failover ? ", no failover" : "", g_getenv("HEX2TEXT_OPENAI_BASE_URL"), g_getenv("HEX2TEXT_CONFIG_DIR"));
+
+    LoadTest test;
+    g_mutex_init(&test.mutex);
+    test.samples = g_array_new(FALSE, FALSE, sizeof(LoadSample));
+    AITranslateOptions options = { (guint)concurrency, record_sample, &test };
+    guint requests = 0;
+    guint failed = 0;
+
+    gint64 start = g_get_monotonic_time();
+    char *translation = ai_translator_translate(script->str, encoding_type_to_string(HEX),
+                                                encoding_type_to_string(ASCII), &primary,
+                                                no_failover ? NULL : &secondary, hedge, &options,
+                                                &requests, &failed);
+    double wall_seconds = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+
+    // Summarise successes and group failures by message
+    guint count = test.samples->len;
+    gint64 *latencies = g_new(gint64, MAX(count, 1));
+    guint succeeded = 0;
+    GHashTable *errors = g_hash_table_new(g_str_hash, g_str_equal);
+    for (guint i = 0; i < count; i++) {
+        LoadSample *sample = &g_array_index(test.samples, LoadSample, i);
+        if (sample->ok) {
+            latencies[succeeded++] = sample->latency_us;
+        } else {
+            guint errors_seen = GPOINTER_TO_UINT(g_hash_table_lookup(errors, sample->error));
+            g_hash_table_insert(errors, sample->error, GUINT_TO_POINTER(errors_seen + 1));
+        }
+    }
+    qsort(latencies, succeeded, sizeof(gint64), compare_gint64);
+
+    printf("blocks       %d (%zu characters)\n", blocks, script->len);
+    printf("requests     %u\n", requests);
+    printf("succeeded    %u\n", succeeded);
+    printf("failed       %u\n", failed);
+    printf("wall time    %.2f s\n", wall_seconds);
+    printf("throughput   %.2f requests/s\n", wall_seconds > 0 ? succeeded / wall_seconds : 0);
+    printf("latency ms   p50 %.0f  p90 %.0f  p95 %.0f  p99 %.0f  max %.0f\n",
+           percentile_ms(latencies, succeeded, 50), percentile_ms(latencies, succeeded, 90),
+           percentile_ms(latencies, succeeded, 95), percentile_ms(latencies, succeeded, 99),
+           percentile_ms(latencies, succeeded, 100));
+    printf("breakers     OpenAI %s, Gemini %s\n",
+           ai_client_provider_available(OPENAI) ? "closed" : "open",
+           ai_client_provider_available(GEMINI) ? "closed" : "open");
+
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, errors);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        printf("error x%-4u %s\n", GPOINTER_TO_UINT(value), (const char *)key);
+    }
+
+    g_hash_table_destroy(errors);
+    g_free(latencies);
+    for (guint i = 0; i < count; i++) {
+        g_free(g_array_index(test.samples, LoadSample, i).error);
+    }
+    g_array_free(test.samples, TRUE);
+    g_mutex_clear(&test.mutex);
+    g_string_free(script, TRUE);
+    g_free(translation);
+
+    // A directory given in HEX2TEXT_CONFIG_DIR is kept, to look at or resume from
+    if (config_dir != NULL) {
+        remove_config_dir(config_dir);
+        g_free(config_dir);
+    }
+
+    return failed == 0 ? 0 : 2;
+}
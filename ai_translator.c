@@ -1,38 +1,19 @@
 #include "ai_translator.h"
+#include "ai_client.h"
+#include "segmenter.h"
+#include "glossary.h"
+#include "tokenizer.h"
+#include "translation_memory.h"
+#include "job_queue.h"
+#include "control_codes.h"
 #include "common.h"
 #include <gtk/gtk.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
-#include <curl/curl.h>
-#include <json-c/json.h>
 
-// Struct for curl response data
-struct MemoryStruct {
-    char *memory;
-    size_t size;
-};
-
-// Callback function for curl to write received data
-static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    struct MemoryStruct *mem = (struct MemoryStruct *)userp;
-
-    // Use g_realloc for consistency with the rest of the codebase
-    char *ptr = g_realloc(mem->memory, mem->size + realsize + 1);
-    if (!ptr) {
-        fprintf(stderr, "Not enough memory (g_realloc returned NULL)\n");
-        return 0;
-    }
-
-    mem->memory = ptr;
-    memcpy(&(mem->memory[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->memory[mem->size] = 0;
-
-    return realsize;
-}
+extern bool debug_mode;
 
 // Global variables for settings dialog
 static GtkWidget *ai_settings_dialog = NULL;
@@ -42,6 +23,7 @@ static GtkWidget *translate_to_entry = NULL;
 static GtkWidget *translate_from_entry = NULL;
 static GtkDropDown *provider_combo = NULL;
 static GtkWidget *custom_context_text_view = NULL;
+static GtkWidget *hedge_check_button = NULL;
 static GtkTextBuffer *custom_context_buffer = NULL;
 
 // Current settings
@@ -53,9 +35,25 @@ static char *openai_model = NULL;
 static char *gemini_model = NULL;
 static char *translate_to = NULL;
 static char *translate_from = NULL;
-
-// Config file paths (stored in user's home directory)
+static bool hedge_requests = false;
+static bool hedge_requests_loaded = false;
+static Glossary *glossary = NULL;
+static gint64 glossary_mtime = 0;
+static TranslationMemory *translation_memory = NULL;
+static JobQueue *job_queue = NULL;
+static ControlCodes *control_codes = NULL;
+static gint64 control_codes_mtime = -1;
+
+// Held while prompts are built, which the token estimate does off the main thread, and while the
+// settings they are built from change
+G_LOCK_DEFINE_STATIC(prompt_settings);
+
+// Config file paths (stored in user's home directory); HEX2TEXT_CONFIG_DIR replaces the
+// directory, e.g. to keep a load test's journal and translation memory apart
 static char *get_config_dir() {
+    const char *override = g_getenv("HEX2TEXT_CONFIG_DIR");
+    if (override != NULL && *override != '\0') return g_strdup(override);
+
     const char *home_dir = g_get_home_dir();
     return g_build_filename(home_dir, ".hex2text", NULL);
 }
@@ -109,6 +107,41 @@ static char *get_translate_from_path() {
     return path;
 }
 
+static char *get_hedge_requests_path() {
+    char *config_dir = get_config_dir();
+    char *path = g_build_filename(config_dir, "hedge_requests", NULL);
+    g_free(config_dir);
+    return path;
+}
+
+static char *get_glossary_path() {
+    char *config_dir = get_config_dir();
+    char *path = g_build_filename(config_dir, "glossary.tsv", NULL);
+    g_free(config_dir);
+    return path;
+}
+
+static char *get_translation_memory_path() {
+    char *config_dir = get_config_dir();
+    char *path = g_build_filename(config_dir, "translation_memory.tsv", NULL);
+    g_free(config_dir);
+    return path;
+}
+
+static char *get_control_codes_path() {
+    char *config_dir = get_config_dir();
+    char *path = g_build_filename(config_dir, "control_codes", NULL);
+    g_free(config_dir);
+    return path;
+}
+
+static char *get_job_queue_path() {
+    char *config_dir = get_config_dir();
+    char *path = g_build_filename(config_dir, "jobs.log", NULL);
+    g_free(config_dir);
+    return path;
+}
+
 // Ensure config directory exists
 static void ensure_config_dir() {
     char *config_dir = get_config_dir();
@@ -332,73 +365,75 @@ char* load_translate_from(void) {
     return language;
 }
 
-// Function to check if an API key is valid
-bool check_api_key(AIProvider provider, const char *api_key) {
-    if (api_key == NULL || strlen(api_key) < 10) {
-        return false;
-    }
+// Function to save the request hedging preference
+void save_hedge_requests(bool enabled) {
+    ensure_config_dir();
 
-    CURL *curl;
-    CURLcode res;
-    struct MemoryStruct chunk;
-    bool is_valid = false;
+    char *path = get_hedge_requests_path();
+    FILE *file = fopen(path, "w");
+    if (file) {
+        fprintf(file, "%d", enabled ? 1 : 0);
+        fclose(file);
+    }
 
-    chunk.memory = g_malloc(1);  // will be grown as needed by g_realloc
-    chunk.size = 0;    // no data at this point
+    g_free(path);
+}
 
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init();
+// Function to load the request hedging preference
+bool load_hedge_requests(void) {
+    char *path = get_hedge_requests_path();
+    bool enabled = false;
 
-    if (curl) {
-        struct curl_slist *headers = NULL;
+    FILE *file = fopen(path, "r");
+    if (file) {
+        int value = 0;
+        if (fscanf(file, "%d", &value) == 1) {
+            enabled = value != 0;
+        }
+        fclose(file);
+    }
 
-        if (provider == OPENAI) {
-            // OpenAI API endpoint for a simple models list request
-            curl_easy_setopt(curl, CURLOPT_URL, "https://api.openai.com/v1/models");
-
-            // Set headers
-            char auth_header[256];
-            snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", api_key);
-            headers = curl_slist_append(headers, auth_header);
-            headers = curl_slist_append(headers, "Content-Type: application/json");
-        } else {
-            // Gemini API endpoint for a simple models list request
-            char url[256];
-            snprintf(url, sizeof(url), "https://generativelanguage.googleapis.com/v1/models?key=%s", api_key);
-            curl_easy_setopt(curl, CURLOPT_URL, url);
+    g_free(path);
+    return enabled;
+}
 
-            // Set headers
-            headers = curl_slist_append(headers, "Content-Type: application/json");
-        }
+// Reload the glossary file if it changed since it was last loaded
+static void refresh_glossary(void) {
+    char *path = get_glossary_path();
+    struct stat st;
+    gint64 mtime = 0;
 
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L); // 5 second timeout
+    if (stat(path, &st) == 0) {
+        mtime = (gint64)st.st_mtime;
+    }
 
-        // Perform the request
-        res = curl_easy_perform(curl);
+    if (mtime != glossary_mtime) {
+        glossary_free(glossary);
+        glossary = mtime != 0 ? glossary_load(path) : NULL;
+        glossary_mtime = mtime;
+        fprintf(stderr, "DEBUG: Loaded glossary with %u entries\n", glossary_size(glossary));
+    }
 
-        // Check for errors
-        if (res == CURLE_OK) {
-            long response_code;
-            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+    g_free(path);
+}
 
-            // 200 OK means the API key is valid
-            if (response_code == 200) {
-                is_valid = true;
-            }
-        }
+// Reload the control code patterns when the file changes (built-in patterns if it's missing)
+static void refresh_control_codes(void) {
+    char *path = get_control_codes_path();
+    struct stat st;
+    gint64 mtime = 0;
 
-        // Clean up
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+    if (stat(path, &st) == 0) {
+        mtime = (gint64)st.st_mtime;
     }
 
-    curl_global_cleanup();
-    g_free(chunk.memory);
+    if (mtime != control_codes_mtime) {
+        control_codes_unref(control_codes);
+        control_codes = control_codes_load(mtime != 0 ? path : NULL);
+        control_codes_mtime = mtime;
+    }
 
-    return is_valid;
+    g_free(path);
 }
 
 // Function to create the prompt for AI translation
@@ -435,6 +470,15 @@ static char* create_translation_prompt(const char *text, const char *source_form
         g_string_append(prompt, custom_context);
     }
 
+    // Add only the glossary entries whose terms occur in this text
+    refresh_glossary();
+    char *glossary_terms = glossary_select_for_text(glossary, text);
+    if (glossary_terms != NULL) {
+        g_string_append(prompt, "\n\nGlossary (use these translations for terms that appear in the content):\n");
+        g_string_append(prompt, glossary_terms);
+        g_free(glossary_terms);
+    }
+
     g_string_append_printf(prompt, "\n\nSource format: %s", source_format);
     g_string_append_printf(prompt, "\nTarget format: %s", target_format);
 
@@ -454,267 +498,522 @@ static char* create_translation_prompt(const char *text, const char *source_form
     return result;
 }
 
-// Function to send text to OpenAI for translation
-static char* send_to_openai(const char *prompt) {
-    if (openai_api_key == NULL) {
-        openai_api_key = load_api_key(OPENAI);
-        if (openai_api_key == NULL || strlen(openai_api_key) < 10) {
-            return g_strdup("Error: No valid OpenAI API key found. Please set it in AI Settings.");
+// Heading that starts the part of an edit prompt holding the matched source and translation
+#define EDIT_PROMPT_PREVIOUS_SOURCE "\n\nPrevious source:\n"
+
+// Function to create a short prompt that adapts a translation memory match to new text
+static char* create_edit_prompt(const char *text, const TranslationMemoryMatch *match,
+                                const char *source_format, const char *target_format) {
+    GString *prompt = g_string_new(NULL);
+
+    g_string_append(prompt, "A previously translated source text changed slightly. ");
+    g_string_append(prompt, "Update the previous translation so it matches the new source text. ");
+    g_string_append(prompt, "Change only what differs, keep control codes and formatting, and reply with the updated translation only.");
+    g_string_append_printf(prompt, "\nTranslate to: %s", translate_to);
+
+    char *glossary_terms = glossary_select_for_text(glossary, text);
+    if (glossary_terms != NULL) {
+        g_string_append(prompt, "\n\nGlossary:\n");
+        g_string_append(prompt, glossary_terms);
+        g_free(glossary_terms);
+    }
+
+    g_string_append_printf(prompt, "\n\nSource format: %s", source_format);
+    g_string_append_printf(prompt, "\nTarget format: %s", target_format);
+
+    g_string_append_printf(prompt, EDIT_PROMPT_PREVIOUS_SOURCE "%s", match->source);
+    g_string_append_printf(prompt, "\n\nPrevious translation:\n%s", match->translation);
+    g_string_append_printf(prompt, "\n\nNew source:\n%s", text);
+
+    return g_string_free(prompt, FALSE);
+}
+
+// Load the model names, API keys and hedging preference if not already loaded
+static void ensure_request_settings_loaded(void) {
+    if (openai_model == NULL) {
+        fprintf(stderr, "DEBUG: Loading OpenAI model name\n");
+        openai_model = load_model_name(OPENAI);
+        if (openai_model == NULL || strlen(openai_model) == 0) {
+            fprintf(stderr, "DEBUG: Using default OpenAI model\n");
+            openai_model = g_strdup("gpt-3.5-turbo"); // Default model
+        } else {
+            fprintf(stderr, "DEBUG: Loaded OpenAI model: %s\n", openai_model);
         }
     }
 
-    CURL *curl;
-    CURLcode res;
-    struct MemoryStruct chunk;
-    char *translation = NULL;
+    if (gemini_model == NULL) {
+        fprintf(stderr, "DEBUG: Loading Gemini model name\n");
+        gemini_model = load_model_name(GEMINI);
+        if (gemini_model == NULL || strlen(gemini_model) == 0) {
+            fprintf(stderr, "DEBUG: Using default Gemini model\n");
+            gemini_model = g_strdup("gemini-2.0-flash"); // Default model
+        } else {
+            fprintf(stderr, "DEBUG: Loaded Gemini model: %s\n", gemini_model);
+        }
+    }
 
-    chunk.memory = g_malloc(1);  // will be grown as needed by g_realloc
-    chunk.size = 0;    // no data at this point
+    if (openai_api_key == NULL) openai_api_key = load_api_key(OPENAI);
+    if (gemini_api_key == NULL) gemini_api_key = load_api_key(GEMINI);
+    if (!hedge_requests_loaded) {
+        hedge_requests = load_hedge_requests();
+        hedge_requests_loaded = true;
+    }
 
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init();
+    if (translation_memory == NULL) {
+        ensure_config_dir();
+        char *path = get_translation_memory_path();
+        translation_memory = translation_memory_open(path);
+        g_free(path);
+    }
 
-    if (curl) {
-        // Create JSON payload
-        json_object *json_payload = json_object_new_object();
-        json_object *messages_array = json_object_new_array();
+    if (job_queue == NULL) {
+        ensure_config_dir();
+        char *path = get_job_queue_path();
+        job_queue = job_queue_open(path);
+        g_free(path);
+    }
+}
+
+// Journal key of a run: a digest of the input and of the prompt template it is sent with,
+// so changing the languages, formats or custom context starts a new run
+static char* create_run_key(const char *text, const char *prompt_template) {
+    GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA256);
+    g_checksum_update(checksum, (const guchar *)prompt_template, strlen(prompt_template) + 1);
+    g_checksum_update(checksum, (const guchar *)text, -1);
+    char *key = g_strdup(g_checksum_get_string(checksum));
+    g_checksum_free(checksum);
+    return key;
+}
 
-        // Add system message
-        json_object *system_message = json_object_new_object();
-        json_object_object_add(system_message, "role", json_object_new_string("system"));
-        json_object_object_add(system_message, "content", json_object_new_string("You are a specialized format translator. Provide only the translation and a brief byte-by-byte breakdown. Preserve any control code structures or formatting (things like <|, etc). Be concise and focus only on the translation task."));
-        json_object_array_add(messages_array, system_message);
+// Translation memory context of the current settings: a translation only fits another segment
+// when it is in the same language and formats (call after the prompt settings are loaded)
+static char* create_memory_context(const char *source_format, const char *target_format) {
+    return g_strdup_printf("%s\t%s\t%s", translate_to, source_format, target_format);
+}
 
-        // Add user message with prompt
-        json_object *user_message = json_object_new_object();
-        json_object_object_add(user_message, "role", json_object_new_string("user"));
-        json_object_object_add(user_message, "content", json_object_new_string(prompt));
-        json_object_array_add(messages_array, user_message);
+// Swap the control codes in a segment for placeholders registered in map, and explain them
+// Prompts end with their segment, and only that is compressed, together with the previous source and
+// translation of an edit prompt: the custom context, glossary and the rest of the template go as
+// written. compact_source (if not NULL) receives the segment as sent.
+static char* compress_prompt(ControlCodes *codes, PlaceholderMap *map, const char *prompt, const char *source,
+                             char **compact_source) {
+    if (!g_str_has_suffix(prompt, source)) {
+        if (compact_source != NULL) *compact_source = g_strdup(source);
+        return g_strdup(prompt);
+    }
 
-        // Add messages to payload
-        json_object_object_add(json_payload, "messages", messages_array);
+    size_t content_start = strlen(prompt) - strlen(source);
+    const char *previous = g_strstr_len(prompt, (gssize)content_start, EDIT_PROMPT_PREVIOUS_SOURCE);
+    size_t template_len = previous != NULL ? (size_t)(previous - prompt) : content_start;
 
-        // Use custom model if available, otherwise use default
-        if (openai_model != NULL && strlen(openai_model) > 0) {
-            json_object_object_add(json_payload, "model", json_object_new_string(openai_model));
-        } else {
-            json_object_object_add(json_payload, "model", json_object_new_string("gpt-3.5-turbo"));
+    // The previous source and translation share the segment's map, so a code has one tag throughout
+    char *compact_previous = NULL;
+    if (previous != NULL) {
+        char *previous_text = g_strndup(previous, content_start - template_len);
+        compact_previous = placeholder_map_compress(map, codes, previous_text);
+        g_free(previous_text);
+    }
+    char *compact = placeholder_map_compress(map, codes, source);
+
+    GString *explained = g_string_new(NULL);
+    if (placeholder_map_size(map) > 0) {
+        g_string_append(explained, "Tags like <1> in the content stand for control codes. "
+                                   "Copy each tag unchanged to the matching place in the translation.\n\n");
+    }
+    g_string_append_len(explained, prompt, (gssize)template_len);
+    if (compact_previous != NULL) {
+        g_string_append(explained, compact_previous);
+        g_free(compact_previous);
+    }
+    g_string_append(explained, compact);
+
+    if (compact_source != NULL) {
+        *compact_source = compact;
+    } else {
+        g_free(compact);
+    }
+    return g_string_free(explained, FALSE);
+}
+
+// Count the tokens of a segment's prompt as it will be sent
+static size_t count_prompt_tokens(ControlCodes *codes, Tokenizer *tokenizer, const char *prompt, const char *source) {
+    PlaceholderMap *map = placeholder_map_new();
+    char *compact = compress_prompt(codes, map, prompt, source, NULL);
+    size_t tokens = tokenizer_count(tokenizer, compact, -1);
+    g_free(compact);
+    placeholder_map_free(map);
+    return tokens;
+}
+
+// Token counter callback for segment_text_counted
+static size_t count_segment_tokens(const char *text, size_t len, gpointer user_data) {
+    return tokenizer_count(user_data, text, len);
+}
+
+// Maximum number of segment requests in flight at once
+#define MAX_PARALLEL_REQUESTS 4
+
+// Translation memory matches at least this similar are shown at once and sent as edit prompts
+#define TM_MIN_SIMILARITY 0.75
+
+// A translation request handed to worker threads
+// Long inputs are split into segments that are translated concurrently and reassembled in order.
+typedef struct {
+    gint ref_count;
+    GtkTextBuffer *ai_buffer;
+    GMutex mutex;
+    GPtrArray *sources;    // Source text per segment
+    GPtrArray *prompts;    // Prompt per segment, NULL when translation memory had an exact match
+    char **results;        // Translation per segment, NULL while pending
+    char **drafts;         // Close translation memory match shown while pending, or NULL
+    guint *draft_similarity; // Similarity of each draft in percent
+    guint requests;        // Number of segments that need a request
+    guint completed;
+    guint failed;          // Requests that ended in an error
+    char *run_key;         // Job journal key
+    char *memory_context;  // Settings translation memory entries are matched under
+    ControlCodes *control_codes; // Patterns swapped for placeholders in each request
+    guint run_id;          // Job journal run, 0 if not journaled
+    AIProvider primary_provider;
+    char *primary_key;
+    char *primary_model;
+    AIProvider secondary_provider;
+    char *secondary_key;
+    char *secondary_model;
+    bool hedge;
+    guint parallel_requests; // Requests in flight at once
+    AISegmentFunc segment_done; // Called as each request finishes, or NULL
+    gpointer segment_user_data;
+    bool finished;
+} TranslationJob;
+
+static TranslationJob *translation_job_ref(TranslationJob *job) {
+    g_atomic_int_inc(&job->ref_count);
+    return job;
+}
+
+static void translation_job_unref(TranslationJob *job) {
+    if (!g_atomic_int_dec_and_test(&job->ref_count)) return;
+
+    if (job->ai_buffer != NULL) g_object_unref(job->ai_buffer);
+    g_mutex_clear(&job->mutex);
+    for (guint i = 0; i < job->prompts->len; i++) {
+        g_free(job->results[i]);
+        g_free(job->drafts[i]);
+    }
+    g_free(job->results);
+    g_free(job->drafts);
+    g_free(job->draft_similarity);
+    g_ptr_array_unref(job->sources);
+    g_ptr_array_unref(job->prompts);
+    g_free(job->primary_key);
+    g_free(job->primary_model);
+    g_free(job->secondary_key);
+    g_free(job->secondary_model);
+    g_free(job->run_key);
+    g_free(job->memory_context);
+    control_codes_unref(job->control_codes);
+    g_free(job);
+}
+
+static TranslationJob* translation_job_alloc(GPtrArray *sources, GPtrArray *prompts) {
+    TranslationJob *job = g_new0(TranslationJob, 1);
+    job->ref_count = 1;
+    g_mutex_init(&job->mutex);
+    job->sources = sources;
+    job->prompts = prompts;
+    job->results = g_new0(char *, sources->len);
+    job->drafts = g_new0(char *, sources->len);
+    job->draft_similarity = g_new0(guint, sources->len);
+    job->control_codes = control_codes_ref(control_codes);
+    job->parallel_requests = MAX_PARALLEL_REQUESTS;
+    return job;
+}
+
+// Pick up an unfinished run from the job journal: only its missing segments are sent again
+static TranslationJob* translation_job_resume(JobQueueRun *run, Tokenizer *tokenizer, size_t *tokens) {
+    TranslationJob *job = translation_job_alloc(g_ptr_array_ref(run->sources), g_ptr_array_ref(run->prompts));
+    job->run_id = run->id;
+
+    for (guint i = 0; i < run->sources->len; i++) {
+        if (run->results[i] != NULL) {
+            job->results[i] = g_strdup(run->results[i]);
+            job->completed++;
+        } else if (g_ptr_array_index(run->prompts, i) != NULL) {
+            *tokens += count_prompt_tokens(job->control_codes, tokenizer, g_ptr_array_index(run->prompts, i),
+                                           g_ptr_array_index(run->sources, i));
+            job->requests++;
         }
+    }
+
+    fprintf(stderr, "DEBUG: Resuming translation run %u: %u of %u segments done, %u interrupted\n",
+            run->id, job->completed, run->sources->len, run->interrupted);
+    return job;
+}
 
-        json_object_object_add(json_payload, "temperature", json_object_new_double(0.3));
-        json_object_object_add(json_payload, "max_tokens", json_object_new_int(2048));
-
-        // Convert to string
-        const char *json_str = json_object_to_json_string(json_payload);
-
-        // Set up headers
-        struct curl_slist *headers = NULL;
-        char auth_header[256];
-        snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", openai_api_key);
-        headers = curl_slist_append(headers, auth_header);
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-
-        // Set up request
-        curl_easy_setopt(curl, CURLOPT_URL, "https://api.openai.com/v1/chat/completions");
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_str);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-
-        // Perform the request
-        res = curl_easy_perform(curl);
-
-        // Check for errors
-        if (res == CURLE_OK) {
-            // Parse the JSON response
-            json_object *json_response = json_tokener_parse(chunk.memory);
-            if (json_response != NULL) {
-                json_object *choices;
-                if (json_object_object_get_ex(json_response, "choices", &choices)) {
-                    json_object *first_choice = json_object_array_get_idx(choices, 0);
-                    if (first_choice != NULL) {
-                        json_object *message;
-                        if (json_object_object_get_ex(first_choice, "message", &message)) {
-                            json_object *content;
-                            if (json_object_object_get_ex(message, "content", &content)) {
-                                translation = g_strdup(json_object_get_string(content));
-                            }
-                        }
-                    }
-                }
-
-                // Check for error message
-                if (translation == NULL) {
-                    json_object *error;
-                    if (json_object_object_get_ex(json_response, "error", &error)) {
-                        json_object *message;
-                        if (json_object_object_get_ex(error, "message", &message)) {
-                            translation = g_strdup_printf("Error: %s", json_object_get_string(message));
-                        }
-                    }
-                }
-
-                json_object_put(json_response);
+// Split text into segments sized for the model and prepare one prompt per segment
+// Function to get the shared tokenizer for a model from the config directory
+static Tokenizer* get_tokenizer(const char *model) {
+    char *config_dir = get_config_dir();
+    Tokenizer *tokenizer = tokenizer_for_model(config_dir, model);
+    g_free(config_dir);
+    return tokenizer;
+}
+
+// Segments found in the translation memory are completed at once (exact match) or sent as a
+// short edit prompt (close match). An unfinished journaled run of the same input is resumed instead.
+// total_tokens (if not NULL) receives the tokens to be sent.
+static TranslationJob* translation_job_new(AIProvider provider, const char *model, const char *text,
+                                           const char *source_format, const char *target_format,
+                                           size_t *total_tokens) {
+    G_LOCK(prompt_settings);
+    Tokenizer *tokenizer = get_tokenizer(model);
+    refresh_control_codes();
+
+    char *empty_prompt = create_translation_prompt("", source_format, target_format);
+    char *run_key = create_run_key(text, empty_prompt);
+    char *memory_context = create_memory_context(source_format, target_format);
+
+    JobQueueRun *run = job_queue_find_run(job_queue, run_key);
+    if (run != NULL) {
+        size_t tokens = 0;
+        TranslationJob *job = translation_job_resume(run, tokenizer, &tokens);
+        job_queue_run_free(run);
+        job->run_key = run_key;
+        job->memory_context = memory_context;
+        g_free(empty_prompt);
+        G_UNLOCK(prompt_settings);
+
+        if (total_tokens != NULL) *total_tokens = tokens;
+        return job;
+    }
+
+    size_t overhead_tokens = tokenizer_count(tokenizer, empty_prompt, -1);
+    size_t budget = ai_client_segment_budget(provider, model, overhead_tokens);
+    g_free(empty_prompt);
+
+    GArray *segments = segment_text_counted(text, budget, tokenizer != NULL ? count_segment_tokens : NULL, tokenizer);
+
+    GPtrArray *sources = g_ptr_array_new_with_free_func(g_free);
+    for (guint i = 0; i < segments->len; i++) {
+        TextSegment *segment = &g_array_index(segments, TextSegment, i);
+        g_ptr_array_add(sources, g_strndup(text + segment->offset, segment->length));
+    }
+    if (sources->len == 0) {
+        g_ptr_array_add(sources, g_strdup(text));
+    }
+    g_array_free(segments, TRUE);
+
+    TranslationJob *job = translation_job_alloc(sources, g_ptr_array_new_full(sources->len, g_free));
+    job->run_key = run_key;
+    job->memory_context = memory_context;
+
+    size_t tokens = 0;
+    for (guint i = 0; i < sources->len; i++) {
+        const char *segment_str = g_ptr_array_index(sources, i);
+        TranslationMemoryMatch match = { 0 };
+        char *prompt = NULL;
+
+        if (translation_memory_lookup(translation_memory, memory_context, segment_str, TM_MIN_SIMILARITY, &match)) {
+            if (match.distance == 0) {
+                job->results[i] = g_strdup(match.translation);
+                job->completed++;
+            } else {
+                job->drafts[i] = g_strdup(match.translation);
+                job->draft_similarity[i] = (guint)(match.similarity * 100);
+                prompt = create_edit_prompt(segment_str, &match, source_format, target_format);
             }
+            translation_memory_match_clear(&match);
         } else {
-            translation = g_strdup_printf("Error: %s", curl_easy_strerror(res));
+            prompt = create_translation_prompt(segment_str, source_format, target_format);
         }
 
-        // Clean up
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        json_object_put(json_payload);
+        if (prompt != NULL) {
+            tokens += count_prompt_tokens(job->control_codes, tokenizer, prompt, segment_str);
+            job->requests++;
+        }
+        g_ptr_array_add(job->prompts, prompt);
     }
 
-    curl_global_cleanup();
-    g_free(chunk.memory);
-
-    if (translation == NULL) {
-        translation = g_strdup("Error: Failed to get translation from OpenAI.");
+    if (debug_mode) {
+        fprintf(stderr, "DEBUG: %u segments, %u requests, %zu tokens (%s, budget %zu tokens per segment)\n",
+                sources->len, job->requests, tokens,
+                tokenizer != NULL ? tokenizer_vocabulary_for_model(model) : "estimated", budget);
     }
+    G_UNLOCK(prompt_settings);
 
-    return translation;
+    if (total_tokens != NULL) *total_tokens = tokens;
+    return job;
+}
+
+// Append a segment's translation, ending it with the whitespace its source ended with
+// The segments cover the source with nothing between them, so the line breaks and spaces they
+// were cut at are put back as they were, whatever the reply ended with.
+static void append_segment(GString *text, const char *translation, const char *source) {
+    size_t len = strlen(translation);
+    while (len > 0 && g_ascii_isspace(translation[len - 1])) len--;
+    size_t source_end = strlen(source);
+    while (source_end > 0 && g_ascii_isspace(source[source_end - 1])) source_end--;
+
+    g_string_append_len(text, translation, (gssize)len);
+    g_string_append(text, source + source_end);
 }
 
-// Function to send text to Gemini for translation
-static char* send_to_gemini(const char *prompt) {
-    if (gemini_api_key == NULL) {
-        gemini_api_key = load_api_key(GEMINI);
-        if (gemini_api_key == NULL || strlen(gemini_api_key) < 10) {
-            return g_strdup("Error: No valid Gemini API key found. Please set it in AI Settings.");
+// Reassemble the segment translations in order; pending segments get a placeholder
+// Must be called with job->mutex held
+static char* assemble_translation(TranslationJob *job) {
+    guint total = job->prompts->len;
+    GString *text = g_string_new(NULL);
+
+    if (!job->finished && total > 1) {
+        g_string_append_printf(text, "Translating... %u of %u segments done\n\n", job->completed, total);
+    }
+
+    for (guint i = 0; i < total; i++) {
+        const char *source = g_ptr_array_index(job->sources, i);
+
+        if (job->results[i] != NULL) {
+            append_segment(text, job->results[i], source);
+        } else if (job->drafts[i] != NULL) {
+            char *draft = g_strdup_printf("[%u%% translation memory match, updating...]\n%s",
+                                          job->draft_similarity[i], job->drafts[i]);
+            append_segment(text, draft, source);
+            g_free(draft);
+        } else {
+            char *pending = g_strdup_printf("[Segment %u of %u pending...]", i + 1, total);
+            append_segment(text, pending, source);
+            g_free(pending);
         }
     }
 
-    CURL *curl;
-    CURLcode res;
-    struct MemoryStruct chunk;
-    char *translation = NULL;
-
-    chunk.memory = g_malloc(1);  // will be grown as needed by g_realloc
-    chunk.size = 0;    // no data at this point
-
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init();
-
-    if (curl) {
-        // Create JSON payload
-        json_object *json_payload = json_object_new_object();
-        json_object *contents_array = json_object_new_array();
-
-        // Add system instructions
-        json_object *system_content = json_object_new_object();
-        json_object *system_parts_array = json_object_new_array();
-        json_object *system_text_part = json_object_new_object();
-        json_object_object_add(system_text_part, "text", json_object_new_string("You are a specialized format translator. Provide only the translation and a brief byte-by-byte breakdown. Preserve any control code structures or formatting (things like <|, etc). Be concise and focus only on the translation task."));
-        json_object_array_add(system_parts_array, system_text_part);
-        json_object_object_add(system_content, "parts", system_parts_array);
-        json_object_object_add(system_content, "role", json_object_new_string("system"));
-        json_object_array_add(contents_array, system_content);
-
-        // Add user content part
-        json_object *user_content = json_object_new_object();
-        json_object *user_parts_array = json_object_new_array();
-        json_object *user_text_part = json_object_new_object();
-        json_object_object_add(user_text_part, "text", json_object_new_string(prompt));
-        json_object_array_add(user_parts_array, user_text_part);
-        json_object_object_add(user_content, "parts", user_parts_array);
-        json_object_object_add(user_content, "role", json_object_new_string("user"));
-        json_object_array_add(contents_array, user_content);
-
-        // Add contents to payload
-        json_object_object_add(json_payload, "contents", contents_array);
-
-        // Add generation config
-        json_object *gen_config = json_object_new_object();
-        json_object_object_add(gen_config, "temperature", json_object_new_double(0.3));
-        json_object_object_add(gen_config, "maxOutputTokens", json_object_new_int(2048));
-        json_object_object_add(json_payload, "generationConfig", gen_config);
-
-        // Convert to string
-        const char *json_str = json_object_to_json_string(json_payload);
-
-        // Set up URL with API key and model
-        char url[512];
-        const char *model_name = "gemini-2.0-flash";
-
-        // Use custom model if available
-        if (gemini_model != NULL && strlen(gemini_model) > 0) {
-            model_name = gemini_model;
+    return g_string_free(text, FALSE);
+}
+
+// Runs on the main thread whenever a segment finishes, and once more when all are done
+static gboolean show_translation_progress(gpointer user_data) {
+    TranslationJob *job = user_data;
+
+    g_mutex_lock(&job->mutex);
+    char *text = assemble_translation(job);
+    bool finished = job->finished;
+    g_mutex_unlock(&job->mutex);
+
+    gtk_text_buffer_set_text(job->ai_buffer, text, -1);
+    g_free(text);
+
+    if (finished) {
+        fprintf(stderr, "DEBUG: Translation of %u segments delivered\n", job->prompts->len);
+        g_object_set_data(G_OBJECT(job->ai_buffer), "translation_in_flight", NULL);
+    }
+
+    translation_job_unref(job);
+    return G_SOURCE_REMOVE;
+}
+
+// Thread pool worker: translate one segment (data is the 1-based segment index)
+static void translate_segment(gpointer data, gpointer user_data) {
+    TranslationJob *job = user_data;
+    guint index = GPOINTER_TO_UINT(data) - 1;
+
+    AIBackend primary = { job->primary_provider, job->primary_key, job->primary_model };
+    AIBackend secondary = { job->secondary_provider, job->secondary_key, job->secondary_model };
+
+    job_queue_mark_started(job_queue, job->run_id, index);
+
+    // Send control codes as short placeholders and put them back in the reply
+    const char *prompt = g_ptr_array_index(job->prompts, index);
+    gint64 start = g_get_monotonic_time();
+    PlaceholderMap *map = placeholder_map_new();
+    char *compact_source = NULL;
+    char *compact_prompt = compress_prompt(job->control_codes, map, prompt, g_ptr_array_index(job->sources, index),
+                                           &compact_source);
+
+    bool ok = false;
+    char *translation = ai_client_send_hedged(&primary, &secondary, job->hedge, compact_prompt, &ok);
+
+    if (ok && placeholder_map_size(map) > 0) {
+        if (placeholder_map_verify(map, compact_source, translation)) {
+            char *restored = placeholder_map_restore(map, translation);
+            g_free(translation);
+            translation = restored;
+        } else {
+            // A lost or mangled placeholder can't be restored; ask again with the codes spelled out
+            fprintf(stderr, "DEBUG: Segment %u reply lost control code placeholders, resending uncompressed\n", index + 1);
+            g_free(translation);
+            ok = false;
+            translation = ai_client_send_hedged(&primary, &secondary, job->hedge, prompt, &ok);
         }
+    }
+
+    g_free(compact_prompt);
+    g_free(compact_source);
+    placeholder_map_free(map);
+
+    // Journal and remember successful translations; if an edit request failed,
+    // the translation memory match is still better than nothing
+    if (ok) {
+        job_queue_mark_done(job_queue, job->run_id, index, translation);
+        translation_memory_add(translation_memory, job->memory_context, g_ptr_array_index(job->sources, index),
+                               translation);
+    } else if (job->drafts[index] != NULL) {
+        char *fallback = g_strdup_printf("%s\n[%u%% translation memory match, not updated: %s]",
+                                         job->drafts[index], job->draft_similarity[index], translation);
+        g_free(translation);
+        translation = fallback;
+    }
+
+    if (job->segment_done != NULL) {
+        job->segment_done(index, ok, g_get_monotonic_time() - start, translation, job->segment_user_data);
+    }
 
-        snprintf(url, sizeof(url), "https://generativelanguage.googleapis.com/v1beta/models/%s:generateContent?key=%s",
-                model_name, gemini_api_key);
-
-        // Set up headers
-        struct curl_slist *headers = NULL;
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-
-        // Set up request
-        curl_easy_setopt(curl, CURLOPT_URL, url);
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_str);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-
-        // Perform the request
-        res = curl_easy_perform(curl);
-
-        // Check for errors
-        if (res == CURLE_OK) {
-            // Parse the JSON response
-            json_object *json_response = json_tokener_parse(chunk.memory);
-            if (json_response != NULL) {
-                json_object *candidates;
-                if (json_object_object_get_ex(json_response, "candidates", &candidates)) {
-                    json_object *first_candidate = json_object_array_get_idx(candidates, 0);
-                    if (first_candidate != NULL) {
-                        json_object *content;
-                        if (json_object_object_get_ex(first_candidate, "content", &content)) {
-                            json_object *parts;
-                            if (json_object_object_get_ex(content, "parts", &parts)) {
-                                json_object *first_part = json_object_array_get_idx(parts, 0);
-                                if (first_part != NULL) {
-                                    json_object *text;
-                                    if (json_object_object_get_ex(first_part, "text", &text)) {
-                                        translation = g_strdup(json_object_get_string(text));
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-
-                // Check for error message
-                if (translation == NULL) {
-                    json_object *error;
-                    if (json_object_object_get_ex(json_response, "error", &error)) {
-                        json_object *message;
-                        if (json_object_object_get_ex(error, "message", &message)) {
-                            translation = g_strdup_printf("Error: %s", json_object_get_string(message));
-                        }
-                    }
-                }
-
-                json_object_put(json_response);
+    g_mutex_lock(&job->mutex);
+    job->results[index] = translation;
+    job->completed++;
+    if (!ok) job->failed++;
+    g_mutex_unlock(&job->mutex);
+
+    if (job->ai_buffer != NULL && job->prompts->len > 1) {
+        g_idle_add(show_translation_progress, translation_job_ref(job));
+    }
+}
+
+// Send every segment that needs a request, a few at a time, and wait for them all
+static void run_translation_job(TranslationJob *job) {
+    guint total = job->prompts->len;
+
+    // Segments answered from translation memory have no prompt
+    if (job->requests > 0) {
+        GThreadPool *pool = g_thread_pool_new(translate_segment, job, MIN(job->requests, job->parallel_requests), FALSE, NULL);
+        for (guint i = 0; i < total; i++) {
+            if (g_ptr_array_index(job->prompts, i) != NULL) {
+                g_thread_pool_push(pool, GUINT_TO_POINTER(i + 1), NULL);
             }
-        } else {
-            translation = g_strdup_printf("Error: %s", curl_easy_strerror(res));
         }
 
-        // Clean up
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        json_object_put(json_payload);
+        // Wait for every segment to finish
+        g_thread_pool_free(pool, FALSE, TRUE);
     }
 
-    curl_global_cleanup();
-    g_free(chunk.memory);
+    g_mutex_lock(&job->mutex);
+    job->finished = true;
+    guint failed = job->failed;
+    g_mutex_unlock(&job->mutex);
 
-    if (translation == NULL) {
-        translation = g_strdup("Error: Failed to get translation from Gemini.");
+    // Keep the run journaled while segments failed, so sending again only retries those
+    if (failed == 0) {
+        job_queue_finish_run(job_queue, job->run_id);
+    } else {
+        fprintf(stderr, "DEBUG: %u segments failed; run %u kept for resuming\n", failed, job->run_id);
     }
+}
 
-    return translation;
+static gpointer translation_thread(gpointer user_data) {
+    TranslationJob *job = user_data;
+    run_translation_job(job);
+
+    // Hand our reference over to the final update
+    g_idle_add(show_translation_progress, job);
+    return NULL;
 }
 
 // Function to send text to AI for translation
@@ -733,71 +1032,239 @@ void send_to_ai_translation(GtkWidget *parent_window, GtkTextBuffer *ai_buffer,
 
     fprintf(stderr, "DEBUG: ai_buffer=%p\n", ai_buffer);
 
-    // Load model names if not already loaded
-    if (openai_model == NULL) {
-        fprintf(stderr, "DEBUG: Loading OpenAI model name\n");
-        openai_model = load_model_name(OPENAI);
-        if (openai_model == NULL || strlen(openai_model) == 0) {
-            fprintf(stderr, "DEBUG: Using default OpenAI model\n");
-            openai_model = g_strdup("gpt-3.5-turbo"); // Default model
-        } else {
-            fprintf(stderr, "DEBUG: Loaded OpenAI model: %s\n", openai_model);
-        }
+    // Ignore repeated clicks while a translation for this view is still running
+    if (g_object_get_data(G_OBJECT(ai_buffer), "translation_in_flight") != NULL) {
+        fprintf(stderr, "DEBUG: Translation already in progress for this view\n");
+        return;
     }
 
-    if (gemini_model == NULL) {
-        fprintf(stderr, "DEBUG: Loading Gemini model name\n");
-        gemini_model = load_model_name(GEMINI);
-        if (gemini_model == NULL || strlen(gemini_model) == 0) {
-            fprintf(stderr, "DEBUG: Using default Gemini model\n");
-            gemini_model = g_strdup("gemini-2.0-flash"); // Default model
-        } else {
-            fprintf(stderr, "DEBUG: Loaded Gemini model: %s\n", gemini_model);
-        }
+    ensure_request_settings_loaded();
+
+    // Split long input into segments that fit the model's context and response limits
+    const char *primary_model = current_provider == OPENAI ? openai_model : gemini_model;
+    TranslationJob *job = translation_job_new(current_provider, primary_model, text, source_format, target_format, NULL);
+
+    // Journal the run before any request goes out, so an interrupted run resumes where it stopped
+    if (job->run_id == 0 && job->requests > 0) {
+        job->run_id = job_queue_add_run(job_queue, job->run_key, job->sources, job->prompts, job->results);
     }
 
-    // Create the prompt
-    fprintf(stderr, "DEBUG: Creating translation prompt\n");
-    char *prompt = create_translation_prompt(text, source_format, target_format);
-    fprintf(stderr, "DEBUG: Prompt created, length: %zu bytes\n", strlen(prompt));
-
-    // Set the AI translation view to "Loading..."
-    fprintf(stderr, "DEBUG: Setting 'Loading...' message\n");
-    gtk_text_buffer_set_text(ai_buffer, "Loading translation...", -1);
-
-    // Process GTK events to update the UI
-    fprintf(stderr, "DEBUG: Processing GTK events\n");
-    while (g_main_context_pending(NULL))
-        g_main_context_iteration(NULL, FALSE);
-
-    // Send to the appropriate AI provider
-    char *translation = NULL;
-    fprintf(stderr, "DEBUG: current_provider=%d (0=OpenAI, 1=Gemini)\n", current_provider);
-    if (current_provider == OPENAI) {
-        fprintf(stderr, "DEBUG: Sending to OpenAI\n");
-        translation = send_to_openai(prompt);
+    // Show translation memory matches right away, otherwise "Loading..."
+    bool has_drafts = false;
+    for (guint i = 0; i < job->prompts->len; i++) {
+        if (job->drafts[i] != NULL) has_drafts = true;
+    }
+    if (job->completed > 0 || has_drafts) {
+        char *preview = assemble_translation(job);
+        gtk_text_buffer_set_text(ai_buffer, preview, -1);
+        g_free(preview);
     } else {
-        fprintf(stderr, "DEBUG: Sending to Gemini\n");
-        translation = send_to_gemini(prompt);
+        fprintf(stderr, "DEBUG: Setting 'Loading...' message\n");
+        gtk_text_buffer_set_text(ai_buffer, "Loading translation...", -1);
+    }
+
+    // Run the requests on worker threads so a stalled provider doesn't freeze the UI.
+    // The other provider acts as failover (and as hedge, if enabled) when it has a key.
+    fprintf(stderr, "DEBUG: current_provider=%d (0=OpenAI, 1=Gemini), hedging=%d\n", current_provider, hedge_requests);
+    AIProvider secondary_provider = current_provider == OPENAI ? GEMINI : OPENAI;
+
+    job->ai_buffer = g_object_ref(ai_buffer);
+    job->primary_provider = current_provider;
+    job->primary_key = g_strdup(current_provider == OPENAI ? openai_api_key : gemini_api_key);
+    job->primary_model = g_strdup(primary_model);
+    job->secondary_provider = secondary_provider;
+    job->secondary_key = g_strdup(secondary_provider == OPENAI ? openai_api_key : gemini_api_key);
+    job->secondary_model = g_strdup(secondary_provider == OPENAI ? openai_model : gemini_model);
+    job->hedge = hedge_requests;
+
+    g_object_set_data(G_OBJECT(ai_buffer), "translation_in_flight", GINT_TO_POINTER(1));
+    GThread *thread = g_thread_new("ai-translation", translation_thread, job);
+    g_thread_unref(thread);
+
+    fprintf(stderr, "DEBUG: send_to_ai_translation() completed\n");
+}
+
+// Function to translate text as "Send to AI" does, waiting for the result
+char* ai_translator_translate(const char *text, const char *source_format, const char *target_format,
+                              const AIBackend *primary, const AIBackend *secondary, bool hedge,
+                              const AITranslateOptions *options, guint *requests, guint *failed) {
+    ensure_request_settings_loaded();
+    TranslationJob *job = translation_job_new(primary->provider, primary->model, text, source_format, target_format, NULL);
+
+    if (job->run_id == 0 && job->requests > 0) {
+        job->run_id = job_queue_add_run(job_queue, job->run_key, job->sources, job->prompts, job->results);
     }
 
-    fprintf(stderr, "DEBUG: Got translation response: %p\n", translation);
+    job->primary_provider = primary->provider;
+    job->primary_key = g_strdup(primary->api_key);
+    job->primary_model = g_strdup(primary->model);
+    if (secondary != NULL) {
+        job->secondary_provider = secondary->provider;
+        job->secondary_key = g_strdup(secondary->api_key);
+        job->secondary_model = g_strdup(secondary->model);
+    }
+    job->hedge = hedge;
+    if (options != NULL) {
+        if (options->parallel_requests > 0) job->parallel_requests = options->parallel_requests;
+        job->segment_done = options->segment_done;
+        job->segment_user_data = options->user_data;
+    }
+
+    run_translation_job(job);
+
+    if (requests != NULL) *requests = job->requests;
+    if (failed != NULL) *failed = job->failed;
+    g_mutex_lock(&job->mutex);
+    char *translation = assemble_translation(job);
+    g_mutex_unlock(&job->mutex);
+    translation_job_unref(job);
+    return translation;
+}
+
+
+
+// Delay before the estimate is recomputed after an edit
+#define TOKEN_ESTIMATE_DELAY_MS 300
+
+// Latest text waiting for a token estimate, and then the estimate worked out for it
+typedef struct {
+    GtkWidget *ai_translator_box;
+    AIProvider provider;
+    char *model;
+    char *text;
+    char *source_format;
+    char *target_format;
+    char *label_text;
+} EstimateRequest;
+
+static void estimate_request_free(gpointer data) {
+    EstimateRequest *request = data;
+    if (request->ai_translator_box != NULL) g_object_unref(request->ai_translator_box);
+    g_free(request->model);
+    g_free(request->text);
+    g_free(request->source_format);
+    g_free(request->target_format);
+    g_free(request->label_text);
+    g_free(request);
+}
+
+static gboolean show_token_estimate(gpointer user_data);
+
+// Worker thread: count the tokens of the prompts that would be sent, and describe them
+// Building the job looks up the journal and the translation memory and tokenizes every
+// segment, too slow to do between keystrokes on the main thread.
+static gpointer token_estimate_thread(gpointer user_data) {
+    EstimateRequest *request = user_data;
 
-    // Update the AI translation view
-    if (translation != NULL) {
-        fprintf(stderr, "DEBUG: Updating AI translation view with result\n");
-        gtk_text_buffer_set_text(ai_buffer, translation, -1);
+    const char *model = request->model;
+    size_t tokens = 0;
+    TranslationJob *job = translation_job_new(request->provider, model, request->text, request->source_format,
+                                              request->target_format, &tokens);
+
+    GString *estimate = g_string_new(NULL);
+    g_string_append_printf(estimate, "Estimate: %s%zu prompt tokens in %u request%s",
+                           get_tokenizer(model) != NULL ? "" : "~",
+                           tokens, job->requests, job->requests == 1 ? "" : "s");
+
+    double cost = 0;
+    if (ai_client_estimate_cost(request->provider, model, tokens, &cost)) {
+        g_string_append_printf(estimate, ", about $%.4f input with %s", cost, model);
+    }
+
+    if (job->run_id != 0) {
+        g_string_append_printf(estimate, "; resuming, %u of %u segments already translated",
+                                job->completed, job->sources->len);
+    } else if (job->completed > 0) {
+        g_string_append_printf(estimate, "; %u segment%s from translation memory",
+                                job->completed, job->completed == 1 ? "" : "s");
+    }
+
+    translation_job_unref(job);
+    request->label_text = g_string_free(estimate, FALSE);
+
+    g_idle_add(show_token_estimate, request);
+    return NULL;
+}
+
+// Function to start estimating the latest text, unless an estimate is already being worked out
+static void start_token_estimate(GtkWidget *ai_translator_box) {
+    if (g_object_get_data(G_OBJECT(ai_translator_box), "estimate_running") != NULL) return;
+
+    EstimateRequest *request = g_object_steal_data(G_OBJECT(ai_translator_box), "pending_estimate");
+    GtkWidget *label = g_object_get_data(G_OBJECT(ai_translator_box), "token_estimate_label");
+    if (request == NULL || label == NULL) {
+        if (request != NULL) estimate_request_free(request);
+        return;
+    }
+
+    if (strlen(request->text) == 0) {
+        gtk_label_set_text(GTK_LABEL(label), "");
+        estimate_request_free(request);
+        return;
+    }
+
+    // Settings are loaded here, as the worker only reads them
+    ensure_request_settings_loaded();
+    request->ai_translator_box = g_object_ref(ai_translator_box);
+    request->provider = current_provider;
+    request->model = g_strdup(current_provider == OPENAI ? openai_model : gemini_model);
+    g_object_set_data(G_OBJECT(ai_translator_box), "estimate_running", GINT_TO_POINTER(1));
+
+    GThread *thread = g_thread_new("ai-token-estimate", token_estimate_thread, request);
+    g_thread_unref(thread);
+}
+
+// Runs on the main thread with a finished estimate
+// An edit made while it was worked out left a newer request pending, so it is out of date:
+// it is dropped, and the newer text estimated instead.
+static gboolean show_token_estimate(gpointer user_data) {
+    EstimateRequest *request = user_data;
+    GtkWidget *ai_translator_box = request->ai_translator_box;
+    g_object_set_data(G_OBJECT(ai_translator_box), "estimate_running", NULL);
+
+    if (g_object_get_data(G_OBJECT(ai_translator_box), "pending_estimate") != NULL) {
+        // Unless the delay after the edit is still running; that starts it
+        if (g_object_get_data(G_OBJECT(ai_translator_box), "estimate_source_id") == NULL) {
+            start_token_estimate(ai_translator_box);
+        }
     } else {
-        fprintf(stderr, "DEBUG: Cannot update view: translation is NULL\n");
+        GtkWidget *label = g_object_get_data(G_OBJECT(ai_translator_box), "token_estimate_label");
+        if (label != NULL) gtk_label_set_text(GTK_LABEL(label), request->label_text);
     }
 
-    // Free memory
-    g_free(prompt);
-    g_free(translation);
-    fprintf(stderr, "DEBUG: send_to_ai_translation() completed\n");
+    estimate_request_free(request);
+    return G_SOURCE_REMOVE;
 }
 
+// Timeout callback: estimate the text of the last edit
+static gboolean compute_token_estimate(gpointer user_data) {
+    GtkWidget *ai_translator_box = user_data;
+    g_object_set_data(G_OBJECT(ai_translator_box), "estimate_source_id", NULL);
+    start_token_estimate(ai_translator_box);
+    return G_SOURCE_REMOVE;
+}
 
+// Function to update the prompt size and cost estimate shown in the AI translator UI
+void update_ai_token_estimate(GtkWidget *ai_translator_box, const char *text,
+                              const char *source_format, const char *target_format) {
+    if (ai_translator_box == NULL || text == NULL || source_format == NULL || target_format == NULL) {
+        return;
+    }
+
+    EstimateRequest *request = g_new0(EstimateRequest, 1);
+    request->text = g_strdup(text);
+    request->source_format = g_strdup(source_format);
+    request->target_format = g_strdup(target_format);
+    g_object_set_data_full(G_OBJECT(ai_translator_box), "pending_estimate", request, estimate_request_free);
+
+    // Only the last edit within the delay is counted
+    if (g_object_get_data(G_OBJECT(ai_translator_box), "estimate_source_id") == NULL) {
+        guint source_id = g_timeout_add_full(G_PRIORITY_DEFAULT_IDLE, TOKEN_ESTIMATE_DELAY_MS,
+                                             compute_token_estimate, g_object_ref(ai_translator_box),
+                                             g_object_unref);
+        g_object_set_data(G_OBJECT(ai_translator_box), "estimate_source_id", GUINT_TO_POINTER(source_id));
+    }
+}
 
 // Callback for the "Test API Key" button
 static void on_test_api_key_clicked(GtkButton *button, gpointer user_data) {
@@ -834,6 +1301,7 @@ static void on_ai_settings_save_clicked(GtkButton *button, gpointer user_data) {
 
     // Get the selected provider
     guint provider_index = gtk_drop_down_get_selected(provider_combo);
+    G_LOCK(prompt_settings);
     current_provider = (AIProvider)provider_index;
 
     // Save the API key
@@ -849,6 +1317,11 @@ static void on_ai_settings_save_clicked(GtkButton *button, gpointer user_data) {
     save_translate_to(translate_to_text);
     save_translate_from(translate_from_text);
 
+    // Save the hedging preference
+    hedge_requests = gtk_check_button_get_active(GTK_CHECK_BUTTON(hedge_check_button));
+    hedge_requests_loaded = true;
+    save_hedge_requests(hedge_requests);
+
     // Save the custom context
     GtkTextIter start, end;
     gtk_text_buffer_get_bounds(custom_context_buffer, &start, &end);
@@ -878,6 +1351,7 @@ static void on_ai_settings_save_clicked(GtkButton *button, gpointer user_data) {
 
     g_free(custom_context);
     custom_context = load_custom_context();
+    G_UNLOCK(prompt_settings);
 
     // Close the dialog
     gtk_window_destroy(GTK_WINDOW(ai_settings_dialog));
@@ -997,7 +1471,8 @@ void show_ai_settings_dialog(GtkWidget *parent_window) {
     gtk_box_append(GTK_BOX(help_box), context_label);
 
     GtkWidget *help_icon = gtk_image_new_from_icon_name("help-about-symbolic");
-    gtk_widget_set_tooltip_text(help_icon, "This is helpful if working on translating something for a specific context (game, program) or franchise.");
+    gtk_widget_set_tooltip_text(help_icon, "This is helpful if working on translating something for a specific context (game, program) or franchise. "
+        "Large term lists belong in ~/.hex2text/glossary.tsv (one \"term<TAB>translation\" per line): only the terms found in the text are sent.");
     gtk_box_append(GTK_BOX(help_box), help_icon);
 
     // Create the custom context text view
@@ -1009,12 +1484,14 @@ void show_ai_settings_dialog(GtkWidget *parent_window) {
     gtk_widget_set_vexpand(context_scroll, TRUE);
 
     // Load the custom context
+    G_LOCK(prompt_settings);
     if (custom_context == NULL) {
         custom_context = load_custom_context();
     }
     if (custom_context != NULL) {
         gtk_text_buffer_set_text(custom_context_buffer, custom_context, -1);
     }
+    G_UNLOCK(prompt_settings);
 
     // Add widgets to the content area
     gtk_box_append(GTK_BOX(content_area), provider_label);
@@ -1031,6 +1508,7 @@ void show_ai_settings_dialog(GtkWidget *parent_window) {
     translate_to_entry = gtk_entry_new();
 
     // Load the target language
+    G_LOCK(prompt_settings);
     if (translate_to == NULL) {
         translate_to = load_translate_to();
     }
@@ -1040,12 +1518,14 @@ void show_ai_settings_dialog(GtkWidget *parent_window) {
     } else {
         gtk_editable_set_text(GTK_EDITABLE(translate_to_entry), "English");
     }
+    G_UNLOCK(prompt_settings);
 
     GtkWidget *translate_from_label = gtk_label_new("Translate From (leave blank for auto-detect):");
     gtk_widget_set_halign(translate_from_label, GTK_ALIGN_START);
     translate_from_entry = gtk_entry_new();
 
     // Load the source language
+    G_LOCK(prompt_settings);
     if (translate_from == NULL) {
         translate_from = load_translate_from();
     }
@@ -1053,6 +1533,7 @@ void show_ai_settings_dialog(GtkWidget *parent_window) {
     if (translate_from != NULL && strlen(translate_from) > 0) {
         gtk_editable_set_text(GTK_EDITABLE(translate_from_entry), translate_from);
     }
+    G_UNLOCK(prompt_settings);
 
     // Add tooltips
     gtk_widget_set_tooltip_text(translate_to_entry,
@@ -1079,7 +1560,19 @@ void show_ai_settings_dialog(GtkWidget *parent_window) {
     gtk_box_append(GTK_BOX(api_key_box), test_button);
 
     gtk_box_append(GTK_BOX(content_area), api_key_box);
-    gtk_widget_set_margin_bottom(api_key_box, 10);
+    gtk_widget_set_margin_bottom(api_key_box, 5);
+
+    // Add hedging option
+    if (!hedge_requests_loaded) {
+        hedge_requests = load_hedge_requests();
+        hedge_requests_loaded = true;
+    }
+    hedge_check_button = gtk_check_button_new_with_label("Hedge slow requests with the other provider");
+    gtk_check_button_set_active(GTK_CHECK_BUTTON(hedge_check_button), hedge_requests);
+    gtk_widget_set_tooltip_text(hedge_check_button,
+        "If the selected provider is slower than usual, also send the request to the other provider (when it has an API key) and use whichever answers first. The other provider is always used as a fallback when the selected one fails.");
+    gtk_box_append(GTK_BOX(content_area), hedge_check_button);
+    gtk_widget_set_margin_bottom(hedge_check_button, 10);
 
     gtk_box_append(GTK_BOX(content_area), help_box);
     gtk_box_append(GTK_BOX(content_area), context_scroll);
@@ -1152,13 +1645,20 @@ GtkWidget* create_ai_translator_ui(GtkWidget *parent_window) {
     // Add the text view to the scroll window
     gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(ai_scroll), ai_translation_view);
 
+    // Create the prompt size estimate label
+    GtkWidget *token_estimate_label = gtk_label_new("");
+    gtk_widget_add_css_class(token_estimate_label, "dim-label");
+    gtk_widget_set_halign(token_estimate_label, GTK_ALIGN_CENTER);
+
     // Add widgets to the main box
     gtk_box_append(GTK_BOX(main_box), send_to_ai_button);
+    gtk_box_append(GTK_BOX(main_box), token_estimate_label);
     gtk_box_append(GTK_BOX(main_box), ai_scroll);
 
     // Store references as object data
     g_object_set_data(G_OBJECT(main_box), "ai_translation_buffer", ai_translation_buffer);
     g_object_set_data(G_OBJECT(main_box), "send_to_ai_button", send_to_ai_button);
+    g_object_set_data(G_OBJECT(main_box), "token_estimate_label", token_estimate_label);
 
     // Note: We don't connect the signal here - it will be connected in main.c
     // This avoids circular dependencies
@@ -1167,7 +1667,9 @@ GtkWidget* create_ai_translator_ui(GtkWidget *parent_window) {
     fprintf(stderr, "DEBUG: Loading API keys and context\n");
     if (openai_api_key == NULL) openai_api_key = load_api_key(OPENAI);
     if (gemini_api_key == NULL) gemini_api_key = load_api_key(GEMINI);
+    G_LOCK(prompt_settings);
     if (custom_context == NULL) custom_context = load_custom_context();
+    G_UNLOCK(prompt_settings);
 
     fprintf(stderr, "DEBUG: create_ai_translator_ui() completed, returning main_box=%p\n", main_box);
     return main_box;
@@ -4,6 +4,7 @@
 #include <gtk/gtk.h>
 #include <stdbool.h>
 #include "common.h"
+#include "ai_client.h"
 
 // Function to create the AI translator UI components
 // Returns a GtkWidget containing the AI translator UI
@@ -17,8 +18,30 @@ void show_ai_settings_dialog(GtkWidget *parent_window);
 void send_to_ai_translation(GtkWidget *parent_window, GtkTextBuffer *ai_buffer,
                            const char *text, const char *source_format, const char *target_format);
 
-// Function to check if an API key is valid
-bool check_api_key(AIProvider provider, const char *api_key);
+// Called from a worker thread as each segment's request finishes, with its reply or error
+typedef void (*AISegmentFunc)(guint index, bool ok, gint64 latency_us, const char *result, gpointer user_data);
+
+// Options of ai_translator_translate; zero for what "Send to AI" does
+typedef struct {
+    guint parallel_requests;    // Requests in flight at once
+    AISegmentFunc segment_done; // May be NULL
+    gpointer user_data;
+} AITranslateOptions;
+
+// Function to translate text the way "Send to AI" does (segments, translation memory, the job
+// journal, control code placeholders, failover and hedging) but wait for the result instead of
+// showing it, for tools without a window such as the load test. secondary and options may be
+// NULL. Returns the segment translations joined in order; requests and failed (may be NULL)
+// receive how many segments were sent and how many of those failed.
+char* ai_translator_translate(const char *text, const char *source_format, const char *target_format,
+                              const AIBackend *primary, const AIBackend *secondary, bool hedge,
+                              const AITranslateOptions *options, guint *requests, guint *failed);
+
+// Function to update the prompt size and cost estimate shown in the AI translator UI
+// The estimate is computed on a worker thread shortly after the last call, so this can be called
+// on every edit; an estimate finished after a newer call is dropped.
+void update_ai_token_estimate(GtkWidget *ai_translator_box, const char *text,
+                              const char *source_format, const char *target_format);
 
 // Function to save API keys securely
 void save_api_key(AIProvider provider, const char *api_key);
@@ -50,4 +73,10 @@ void save_translate_from(const char *language);
 // Function to load source language
 char* load_translate_from(void);
 
+// Function to save the request hedging preference
+void save_hedge_requests(bool enabled);
+
+// Function to load the request hedging preference
+bool load_hedge_requests(void);
+
 #endif /* AI_TRANSLATOR_H */
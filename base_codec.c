@@ -0,0 +1,441 @@
+#include "base_codec.h"
+#include <string.h>
+
+static const char base64_alphabets[2][65] = {
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_",
+};
+static const char base32_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+
+// Output is gathered in a buffer this size before it is appended
+#define CHUNK_SIZE 4096
+
+// Base64 characters for 12 bits at a time, so a group of three bytes is two lookups
+static char base64_pairs[2][4096][2];
+// Base64 values of each character, already shifted into their place in a group of four;
+// characters outside the alphabet have BASE64_INVALID set, so a group is checked once
+#define BASE64_INVALID 0x01000000u
+static guint32 base64_values[2][4][256];
+// Base32 values of each character (either case), or 0xFF
+static guint8 base32_values[256];
+
+static void init_tables(void) {
+    static gsize initialized = 0;
+    if (g_once_init_enter(&initialized)) {
+        for (int a = 0; a < 2; a++) {
+            for (int i = 0; i < 4096; i++) {
+                base64_pairs[a][i][0] = base64_alphabets[a][i >> 6];
+                base64_pairs[a][i][1] = base64_alphabets[a][i & 63];
+            }
+            for (int place = 0; place < 4; place++) {
+                for (int c = 0; c < 256; c++) base64_values[a][place][c] = BASE64_INVALID;
+                for (guint32 v = 0; v < 64; v++) {
+                    base64_values[a][place][(guint8)base64_alphabets[a][v]] = v << (18 - place * 6);
+                }
+            }
+        }
+        memset(base32_values, 0xFF, sizeof(base32_values));
+        for (guint8 v = 0; v < 32; v++) {
+            base32_values[(guint8)base32_alphabet[v]] = v;
+            base32_values[(guint8)g_ascii_tolower(base32_alphabet[v])] = v;
+        }
+        g_once_init_leave(&initialized, 1);
+    }
+}
+
+// Function to check whether an encoding is one of these formats
+bool base_codec_handles(EncodingType format) {
+    return format == BASE64 || format == BASE64URL || format == BASE32 || format == ASCII85;
+}
+
+// Bytes and characters in a whole group of each format
+static guint group_bytes(EncodingType format) {
+    switch (format) {
+        case BASE32: return 5;
+        case ASCII85: return 4;
+        default: return 3;
+    }
+}
+
+static guint group_chars(EncodingType format) {
+    switch (format) {
+        case BASE32: return 8;
+        case ASCII85: return 5;
+        default: return 4;
+    }
+}
+
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+// Function to write a whole group of bytes as text; returns the characters written
+static inline guint encode_group(EncodingType format, const guint8 *in, char *out) {
+    switch (format) {
+        case BASE32: {
+            guint64 v = (guint64)in[0] << 32 | (guint64)in[1] << 24 | (guint32)in[2] << 16 | (guint32)in[3] << 8 | in[4];
+            for (int i = 0; i < 8; i++) out[i] = base32_alphabet[(v >> (35 - i * 5)) & 31];
+            return 8;
+        }
+
+        case ASCII85: {
+            guint32 v = (guint32)in[0] << 24 | (guint32)in[1] << 16 | (guint32)in[2] << 8 | in[3];
+            if (v == 0) {
+                out[0] = 'z';
+                return 1;
+            }
+            for (int i = 4; i >= 0; i--) {
+                out[i] = (char)('!' + v % 85);
+                v /= 85;
+            }
+            return 5;
+        }
+
+        default: {
+            char (*pairs)[2] = base64_pairs[format == BASE64URL];
+            guint32 v = (guint32)in[0] << 16 | (guint32)in[1] << 8 | in[2];
+            memcpy(out, pairs[v >> 12], 2);
+            memcpy(out + 2, pairs[v & 0xFFF], 2);
+            return 4;
+        }
+    }
+}
+
+// Function to write the last n bytes, fewer than a group; returns the characters written
+// The bytes are padded with zeros and only the characters that carry them are kept, followed
+// by '=' up to a whole group where the format pads.
+static guint encode_tail(EncodingType format, const guint8 *in, guint n, char *out) {
+    guint8 group[5] = { 0 };
+    memcpy(group, in, n);
+    char chars[8];
+    guint used;
+
+    if (format == ASCII85) {
+        // 'z' stands for whole groups only
+        guint32 v = (guint32)group[0] << 24 | (guint32)group[1] << 16 | (guint32)group[2] << 8 | group[3];
+        for (int i = 4; i >= 0; i--) {
+            chars[i] = (char)('!' + v % 85);
+            v /= 85;
+        }
+        used = n + 1;
+    } else {
+        encode_group(format, group, chars);
+        used = format == BASE32 ? (n * 8 + 4) / 5 : n + 1;
+    }
+
+    guint total = format == BASE64 || format == BASE32 ? group_chars(format) : used;
+    memcpy(out, chars, used);
+    memset(out + used, '=', total - used);
+    return total;
+}
+
+// Function to encode whole groups while out has room; returns the bytes taken
+static inline size_t encode_groups_as(EncodingType format, const guint8 *data, size_t len,
+                                      char *out, size_t room, size_t *written) {
+    guint group = group_bytes(format);
+    size_t i = 0, used = 0;
+    for (; i + group <= len && used + 8 <= room; i += group) {
+        used += encode_group(format, data + i, out + used);
+    }
+    *written = used;
+    return i;
+}
+
+// Function to encode whole groups with a loop for each format, so the format's switch folds away
+static size_t encode_groups(EncodingType format, const guint8 *data, size_t len, char *out, size_t room, size_t *written) {
+    switch (format) {
+        case BASE32: return encode_groups_as(BASE32, data, len, out, room, written);
+        case ASCII85: return encode_groups_as(ASCII85, data, len, out, room, written);
+        case BASE64URL: return encode_groups_as(BASE64URL, data, len, out, room, written);
+        default: return encode_groups_as(BASE64, data, len, out, room, written);
+    }
+}
+
+// Function to start encoding in a format
+void base_codec_encoder_init(BaseCodecEncoder *encoder, EncodingType format) {
+    init_tables();
+    encoder->format = format;
+    encoder->pending_len = 0;
+}
+
+// Function to encode the next piece of data, appending the text to out
+void base_codec_encoder_feed(BaseCodecEncoder *encoder, const guint8 *data, size_t len, GString *out) {
+    guint group = group_bytes(encoder->format);
+    char buffer[CHUNK_SIZE];
+    size_t used = 0;
+    size_t i = 0;
+
+    // Complete the group the last piece left open
+    if (encoder->pending_len > 0) {
+        while (encoder->pending_len < group && i < len) encoder->pending[encoder->pending_len++] = data[i++];
+        if (encoder->pending_len < group) return;
+        used += encode_group(encoder->format, encoder->pending, buffer);
+        encoder->pending_len = 0;
+    }
+
+    while (len - i >= group) {
+        size_t written = 0;
+        i += encode_groups(encoder->format, data + i, len - i, buffer + used, sizeof(buffer) - used, &written);
+        g_string_append_len(out, buffer, (gssize)(used + written));
+        used = 0;
+    }
+    g_string_append_len(out, buffer, (gssize)used);
+
+    while (i < len) encoder->pending[encoder->pending_len++] = data[i++];
+}
+
+// Function to append the last, partial group (padded where the format pads)
+void base_codec_encoder_finish(BaseCodecEncoder *encoder, GString *out) {
+    if (encoder->pending_len == 0) return;
+
+    char buffer[8];
+    guint n = encode_tail(encoder->format, encoder->pending, encoder->pending_len, buffer);
+    g_string_append_len(out, buffer, n);
+    encoder->pending_len = 0;
+}
+
+// Function to decode a whole group of characters; returns the bytes written, or -1 if one of
+// the characters is not in the alphabet (or, for Ascii85, the group is out of range)
+static inline int decode_group(EncodingType format, const char *in, guint8 *out) {
+    switch (format) {
+        case BASE32: {
+            guint8 bits = 0;
+            guint64 v = 0;
+            for (int i = 0; i < 8; i++) {
+                guint8 d = base32_values[(guint8)in[i]];
+                bits |= d;
+                v = v << 5 | d;
+            }
+            if (bits & 0xE0) return -1;
+            out[0] = (guint8)(v >> 32);
+            out[1] = (guint8)(v >> 24);
+            out[2] = (guint8)(v >> 16);
+            out[3] = (guint8)(v >> 8);
+            out[4] = (guint8)v;
+            return 5;
+        }
+
+        case ASCII85: {
+            guint64 v = 0;
+            for (int i = 0; i < 5; i++) {
+                guint d = (guint)(guint8)in[i] - '!';
+                if (d >= 85) return -1;
+                v = v * 85 + d;
+            }
+            if (v > G_MAXUINT32) return -1;
+            out[0] = (guint8)(v >> 24);
+            out[1] = (guint8)(v >> 16);
+            out[2] = (guint8)(v >> 8);
+            out[3] = (guint8)v;
+            return 4;
+        }
+
+        default: {
+            guint32 (*values)[256] = base64_values[format == BASE64URL];
+            guint32 v = values[0][(guint8)in[0]] | values[1][(guint8)in[1]] |
+                        values[2][(guint8)in[2]] | values[3][(guint8)in[3]];
+            if (v & BASE64_INVALID) return -1;
+            out[0] = (guint8)(v >> 16);
+            out[1] = (guint8)(v >> 8);
+            out[2] = (guint8)v;
+            return 3;
+        }
+    }
+}
+
+// Function to decode whole groups until one doesn't decode or out is full; returns the
+// characters taken
+static inline size_t decode_groups_as(EncodingType format, const char *text, size_t len,
+                                      guint8 *out, size_t room, size_t *written) {
+    guint chars = group_chars(format);
+    size_t i = 0, used = 0;
+    while (i + chars <= len && used + 8 <= room) {
+        int n = decode_group(format, text + i, out + used);
+        if (n < 0) break;
+        used += (size_t)n;
+        i += chars;
+    }
+    *written = used;
+    return i;
+}
+
+// Function to decode whole groups with a loop for each format, so the format's switch folds away
+static size_t decode_groups(EncodingType format, const char *text, size_t len, guint8 *out, size_t room, size_t *written) {
+    switch (format) {
+        case BASE32: return decode_groups_as(BASE32, text, len, out, room, written);
+        case ASCII85: return decode_groups_as(ASCII85, text, len, out, room, written);
+        case BASE64URL: return decode_groups_as(BASE64URL, text, len, out, room, written);
+        default: return decode_groups_as(BASE64, text, len, out, room, written);
+    }
+}
+
+// Function to decode the last k characters, fewer than a group; returns the bytes written, or
+// -1 when k characters can't end the text
+static int decode_tail(EncodingType format, const char *in, guint k, guint8 *out) {
+    // Base32 groups end after whole bytes only
+    static const gint8 base32_tail_bytes[8] = { 0, -1, 1, -1, 2, 3, -1, 4 };
+    char group[8];
+    int bytes;
+
+    memcpy(group, in, k);
+    if (format == BASE32) {
+        bytes = base32_tail_bytes[k];
+    } else {
+        bytes = k >= 2 ? (int)k - 1 : -1;
+    }
+    if (bytes < 0) return -1;
+
+    // Ascii85 rounds up with the highest digit, the others pad with zero bits
+    memset(group + k, format == ASCII85 ? 'u' : 'A', group_chars(format) - k);
+    guint8 full[5];
+    if (decode_group(format, group, full) < 0) return -1;
+    memcpy(out, full, (size_t)bytes);
+    return bytes;
+}
+
+// Function to decode the characters pending as the last group
+static bool flush_tail(BaseCodecDecoder *decoder, guint8 *out, size_t *used) {
+    if (decoder->pending_len == 0) return true;
+
+    int n = decode_tail(decoder->format, decoder->pending, decoder->pending_len, out + *used);
+    if (n < 0) return false;
+    *used += (size_t)n;
+    decoder->pending_len = 0;
+    return true;
+}
+
+// Function to take one character the whole-group path didn't; returns false if it can't be there
+static bool decode_char(BaseCodecDecoder *decoder, char c, guint8 *out, size_t *used) {
+    if (decoder->expected != 0) {
+        if (c != decoder->expected) return false;
+        decoder->expected = 0;
+        return true;
+    }
+    if (is_space(c)) return true;
+
+    bool first = !decoder->started;
+    decoder->started = true;
+    if (decoder->ended) return c == '=' && decoder->format != ASCII85;
+
+    if (decoder->format == ASCII85) {
+        if (c == '<' && first) {
+            decoder->expected = '~';
+            return true;
+        }
+        if (c == '~') {
+            if (!flush_tail(decoder, out, used)) return false;
+            decoder->ended = true;
+            decoder->expected = '>';
+            return true;
+        }
+        if (c == 'z' && decoder->pending_len == 0) {
+            memset(out + *used, 0, 4);
+            *used += 4;
+            return true;
+        }
+    } else if (c == '=') {
+        // Padding ends the data
+        if (decoder->pending_len == 0 || !flush_tail(decoder, out, used)) return false;
+        decoder->ended = true;
+        return true;
+    }
+
+    decoder->pending[decoder->pending_len++] = c;
+    if (decoder->pending_len == group_chars(decoder->format)) {
+        int n = decode_group(decoder->format, decoder->pending, out + *used);
+        if (n < 0) return false;
+        *used += (size_t)n;
+        decoder->pending_len = 0;
+    }
+    return true;
+}
+
+// Function to start decoding text in a format
+void base_codec_decoder_init(BaseCodecDecoder *decoder, EncodingType format) {
+    init_tables();
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->format = format;
+}
+
+// Function to decode the next piece of text, appending the bytes to out
+bool base_codec_decoder_feed(BaseCodecDecoder *decoder, const char *text, size_t len, GByteArray *out) {
+    if (decoder->failed) return false;
+
+    EncodingType format = decoder->format;
+    guint chars = group_chars(format);
+    guint8 buffer[CHUNK_SIZE];
+    size_t used = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        if (used + 8 > sizeof(buffer)) {
+            g_byte_array_append(out, buffer, (guint)used);
+            used = 0;
+        }
+
+        // Whole groups are decoded straight from the text; anything else goes a character at a time
+        if (decoder->pending_len == 0 && decoder->expected == 0 && !decoder->ended && i + chars <= len) {
+            size_t written = 0;
+            size_t taken = decode_groups(format, text + i, len - i, buffer + used, sizeof(buffer) - used, &written);
+            if (taken > 0) {
+                used += written;
+                i += taken;
+                decoder->started = true;
+                continue;
+            }
+        }
+
+        if (!decode_char(decoder, text[i++], buffer, &used)) {
+            decoder->failed = true;
+            break;
+        }
+    }
+
+    g_byte_array_append(out, buffer, (guint)used);
+    return !decoder->failed;
+}
+
+// Function to decode the last, partial group
+bool base_codec_decoder_finish(BaseCodecDecoder *decoder, GByteArray *out) {
+    if (decoder->failed) return false;
+
+    guint8 buffer[8];
+    size_t used = 0;
+    // A delimiter cut off at the end is as bad as a group that can't end the text
+    if (decoder->expected != 0 || !flush_tail(decoder, buffer, &used)) {
+        decoder->failed = true;
+        return false;
+    }
+    g_byte_array_append(out, buffer, (guint)used);
+    return true;
+}
+
+// Function to encode data in one go
+char* base_codec_encode(const guint8 *data, size_t len, EncodingType format) {
+    if (!base_codec_handles(format)) return NULL;
+
+    GString *out = g_string_sized_new((len / group_bytes(format) + 1) * group_chars(format) + 1);
+    BaseCodecEncoder encoder;
+    base_codec_encoder_init(&encoder, format);
+    base_codec_encoder_feed(&encoder, data, len, out);
+    base_codec_encoder_finish(&encoder, out);
+    return g_string_free(out, FALSE);
+}
+
+// Function to decode text in one go
+guint8* base_codec_decode(const char *text, size_t len, EncodingType format, size_t *out_len) {
+    *out_len = 0;
+    if (!base_codec_handles(format)) return NULL;
+
+    GByteArray *out = g_byte_array_sized_new((guint)MIN(len / 4 * 3 + 8, G_MAXUINT));
+    BaseCodecDecoder decoder;
+    base_codec_decoder_init(&decoder, format);
+    if (!base_codec_decoder_feed(&decoder, text, len, out) || !base_codec_decoder_finish(&decoder, out)) {
+        g_byte_array_free(out, TRUE);
+        return NULL;
+    }
+
+    *out_len = out->len;
+    guint8 *data = g_byte_array_free(out, FALSE);
+    return data != NULL ? data : g_malloc(1);
+}
@@ -0,0 +1,60 @@
+#ifndef BASE_CODEC_H
+#define BASE_CODEC_H
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// Base64 (RFC 4648, padded), Base64url (unpadded), Base32 (RFC 4648, padded) and Ascii85 (btoa
+// style, 'z' for a group of zero bytes, no delimiters): bytes written as text, like hex.
+// Decoding skips whitespace, accepts missing padding, lower-case Base32 and Ascii85's "<~ ~>".
+
+// Function to check whether an encoding is one of these formats
+bool base_codec_handles(EncodingType format);
+
+// Streaming encoder; bytes fed in any pieces give the same text as encoding them in one go
+typedef struct {
+    EncodingType format;
+    guint8 pending[5];      // Bytes of a group not complete yet
+    guint pending_len;
+} BaseCodecEncoder;
+
+// Function to start encoding in a format
+void base_codec_encoder_init(BaseCodecEncoder *encoder, EncodingType format);
+
+// Function to encode the next piece of data, appending the text to out
+void base_codec_encoder_feed(BaseCodecEncoder *encoder, const guint8 *data, size_t len, GString *out);
+
+// Function to append the last, partial group (padded where the format pads)
+void base_codec_encoder_finish(BaseCodecEncoder *encoder, GString *out);
+
+// Streaming decoder; text may be split anywhere, even inside a group or delimiter
+typedef struct {
+    EncodingType format;
+    char pending[8];        // Characters of a group not complete yet
+    guint pending_len;
+    char expected;          // Ascii85: the second character of "<~" or "~>" that must come next
+    bool started;           // Anything other than whitespace was seen
+    bool ended;             // Padding or "~>" was seen; only whitespace (and padding) may follow
+    bool failed;
+} BaseCodecDecoder;
+
+// Function to start decoding text in a format
+void base_codec_decoder_init(BaseCodecDecoder *decoder, EncodingType format);
+
+// Function to decode the next piece of text, appending the bytes to out; returns false once the
+// text is not valid
+bool base_codec_decoder_feed(BaseCodecDecoder *decoder, const char *text, size_t len, GByteArray *out);
+
+// Function to decode the last, partial group; returns false if the text was not valid
+bool base_codec_decoder_finish(BaseCodecDecoder *decoder, GByteArray *out);
+
+// Function to encode data in one go; returns NULL for other encodings
+char* base_codec_encode(const guint8 *data, size_t len, EncodingType format);
+
+// Function to decode text in one go; returns NULL (with out_len 0) for text that is not valid
+// or for other encodings, otherwise the bytes (never NULL, even when there are none)
+guint8* base_codec_decode(const char *text, size_t len, EncodingType format, size_t *out_len);
+
+#endif /* BASE_CODEC_H */
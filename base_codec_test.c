@@ -0,0 +1,146 @@
+// Checks of the Base64, Base64url, Base32 and Ascii85 codecs: known vectors, Ascii85's 'z',
+// streaming in pieces of every size and round trips of every tail length
+// Exits with 1 and names the case on the first failure.
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include "base_codec.h"
+
+typedef struct {
+    const char *name;
+    EncodingType format;
+    const char *bytes;
+    size_t len;
+    const char *text;       // The bytes as written
+} CodecCase;
+
+static const CodecCase cases[] = {
+    { "Base64, empty", BASE64, "", 0, "" },
+    { "Base64, one byte", BASE64, "f", 1, "Zg==" },
+    { "Base64, two bytes", BASE64, "fo", 2, "Zm8=" },
+    { "Base64, whole group", BASE64, "foo", 3, "Zm9v" },
+    { "Base64, group and tail", BASE64, "foobar", 6, "Zm9vYmFy" },
+    { "Base64url, unpadded tail", BASE64URL, "\xFB\xFF", 2, "-_8" },
+    { "Base32, one byte", BASE32, "f", 1, "MY======" },
+    { "Base32, four bytes", BASE32, "foob", 4, "MZXW6YQ=" },
+    { "Base32, whole group and tail", BASE32, "foobar", 6, "MZXW6YTBOI======" },
+    { "Ascii85, zero group", ASCII85, "\0\0\0\0", 4, "z" },
+    { "Ascii85, zero group and zero tail", ASCII85, "\0\0\0\0\0", 5, "z!!" },
+    { "Ascii85, text", ASCII85, "Man ", 4, "9jqo^" },
+    { "Ascii85, one byte tail", ASCII85, "M", 1, "9`" },
+};
+
+static const EncodingType formats[] = { BASE64, BASE64URL, BASE32, ASCII85 };
+
+// Encode data in pieces of step bytes
+static char* encode_in_pieces(const guint8 *data, size_t len, EncodingType format, size_t step) {
+    BaseCodecEncoder encoder;
+    GString *out = g_string_new(NULL);
+    base_codec_encoder_init(&encoder, format);
+    for (size_t i = 0; i < len; i += step) {
+        base_codec_encoder_feed(&encoder, data + i, MIN(step, len - i), out);
+    }
+    base_codec_encoder_finish(&encoder, out);
+    return g_string_free(out, FALSE);
+}
+
+// Decode text in pieces of step characters; returns NULL for text that is not valid
+static GByteArray* decode_in_pieces(const char *text, EncodingType format, size_t step) {
+    BaseCodecDecoder decoder;
+    GByteArray *out = g_byte_array_new();
+    size_t len = strlen(text);
+    bool ok = true;
+    base_codec_decoder_init(&decoder, format);
+    for (size_t i = 0; ok && i < len; i += step) {
+        ok = base_codec_decoder_feed(&decoder, text + i, MIN(step, len - i), out);
+    }
+    if (ok) ok = base_codec_decoder_finish(&decoder, out);
+    if (!ok) {
+        g_byte_array_free(out, TRUE);
+        return NULL;
+    }
+    return out;
+}
+
+static bool check_case(const CodecCase *test) {
+    for (size_t step = 1; step <= 9; step++) {
+        char *text = encode_in_pieces((const guint8 *)test->bytes, test->len, test->format, step);
+        bool ok = strcmp(text, test->text) == 0;
+        if (!ok) fprintf(stderr, "FAIL: %s: encoded %s in pieces of %zu, expected %s\n", test->name, text, step, test->text);
+        g_free(text);
+        if (!ok) return false;
+
+        GByteArray *bytes = decode_in_pieces(test->text, test->format, step);
+        ok = bytes != NULL && bytes->len == test->len &&
+             (test->len == 0 || memcmp(bytes->data, test->bytes, test->len) == 0);
+        if (!ok) fprintf(stderr, "FAIL: %s: decoding in pieces of %zu gave other bytes\n", test->name, step);
+        if (bytes != NULL) g_byte_array_free(bytes, TRUE);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+// Every tail length, in one go and in pieces of every size up to a group and a half
+static bool check_round_trips(EncodingType format) {
+    guint8 data[32];
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = (guint8)(i * 73 + 11);
+    // A run of zeros for Ascii85's 'z', inside and at the end
+    memset(data + 8, 0, 8);
+
+    for (size_t len = 0; len <= sizeof(data); len++) {
+        char *text = base_codec_encode(data, len, format);
+        for (size_t step = 1; step <= 12; step++) {
+            char *pieces = encode_in_pieces(data, len, format, step);
+            GByteArray *bytes = decode_in_pieces(text, format, step);
+            bool ok = strcmp(pieces, text) == 0 && bytes != NULL && bytes->len == len &&
+                      (len == 0 || memcmp(bytes->data, data, len) == 0);
+            if (!ok) fprintf(stderr, "FAIL: format %d, %zu bytes in pieces of %zu: %s\n", format, len, step, text);
+            g_free(pieces);
+            if (bytes != NULL) g_byte_array_free(bytes, TRUE);
+            if (!ok) {
+                g_free(text);
+                return false;
+            }
+        }
+
+        size_t out_len = 0;
+        guint8 *decoded = base_codec_decode(text, strlen(text), format, &out_len);
+        bool ok = decoded != NULL && out_len == len && memcmp(decoded, data, len) == 0;
+        if (!ok) fprintf(stderr, "FAIL: format %d, %zu bytes decoded in one go: %s\n", format, len, text);
+        g_free(decoded);
+        g_free(text);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+int main(void) {
+    for (size_t i = 0; i < G_N_ELEMENTS(cases); i++) {
+        if (!check_case(&cases[i])) return 1;
+    }
+    for (size_t i = 0; i < G_N_ELEMENTS(formats); i++) {
+        if (!check_round_trips(formats[i])) return 1;
+    }
+
+    // Ascii85 read back with its delimiters around a 'z' group
+    size_t len = 0;
+    guint8 *data = base_codec_decode("<~z9jqo^~>", 10, ASCII85, &len);
+    bool ok = data != NULL && len == 8 && memcmp(data, "\0\0\0\0Man ", 8) == 0;
+    g_free(data);
+    if (!ok) {
+        fprintf(stderr, "FAIL: Ascii85 with delimiters\n");
+        return 1;
+    }
+
+    // 'z' only stands for a whole group, not inside one
+    data = base_codec_decode("9jz", 3, ASCII85, &len);
+    ok = data == NULL && len == 0;
+    g_free(data);
+    if (!ok) {
+        fprintf(stderr, "FAIL: Ascii85 'z' inside a group was accepted\n");
+        return 1;
+    }
+
+    printf("%zu base codec cases and round trips in %zu formats passed\n", G_N_ELEMENTS(cases), G_N_ELEMENTS(formats));
+    return 0;
+}
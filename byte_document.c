@@ -0,0 +1,56 @@
+#include "byte_document.h"
+
+struct ByteDocument {
+    gint ref_count;
+    GBytes *bytes;
+    guint64 generation;
+};
+
+// Function to create an empty document
+ByteDocument* byte_document_new(void) {
+    ByteDocument *document = g_new0(ByteDocument, 1);
+    document->ref_count = 1;
+    document->bytes = g_bytes_new(NULL, 0);
+    return document;
+}
+
+ByteDocument* byte_document_ref(ByteDocument *document) {
+    g_atomic_int_inc(&document->ref_count);
+    return document;
+}
+
+void byte_document_unref(ByteDocument *document) {
+    if (document == NULL || !g_atomic_int_dec_and_test(&document->ref_count)) return;
+    g_bytes_unref(document->bytes);
+    g_free(document);
+}
+
+// Function to replace the contents, taking ownership of data
+void byte_document_take(ByteDocument *document, guint8 *data, size_t len) {
+    GBytes *bytes = g_bytes_new_take(data, len);
+    byte_document_set_bytes(document, bytes);
+    g_bytes_unref(bytes);
+}
+
+// Function to replace the contents with a reference to bytes
+void byte_document_set_bytes(ByteDocument *document, GBytes *bytes) {
+    g_bytes_ref(bytes);
+    g_bytes_unref(document->bytes);
+    document->bytes = bytes;
+    document->generation++;
+}
+
+const guint8* byte_document_get_data(const ByteDocument *document, size_t *len) {
+    gsize size = 0;
+    const guint8 *data = g_bytes_get_data(document->bytes, &size);
+    if (len != NULL) *len = size;
+    return data;
+}
+
+GBytes* byte_document_get_bytes(const ByteDocument *document) {
+    return document->bytes;
+}
+
+guint64 byte_document_get_generation(const ByteDocument *document) {
+    return document->generation;
+}
@@ -0,0 +1,34 @@
+#ifndef BYTE_DOCUMENT_H
+#define BYTE_DOCUMENT_H
+
+#include <glib.h>
+#include <stddef.h>
+
+// The bytes a window shows, with both panes as renderings of them in their encodings
+// Contents are replaced whole and never changed in place: each version is an immutable GBytes
+// that workers can hold on to without a copy. The generation goes up with every replacement.
+typedef struct ByteDocument ByteDocument;
+
+// Function to create an empty document
+ByteDocument* byte_document_new(void);
+
+// Functions to take and drop references
+ByteDocument* byte_document_ref(ByteDocument *document);
+void byte_document_unref(ByteDocument *document);
+
+// Function to replace the contents, taking ownership of data (g_malloc'd; may be NULL if len is 0)
+void byte_document_take(ByteDocument *document, guint8 *data, size_t len);
+
+// Function to replace the contents with a reference to bytes
+void byte_document_set_bytes(ByteDocument *document, GBytes *bytes);
+
+// Function to get the contents; the pointer stays valid until the next replacement
+const guint8* byte_document_get_data(const ByteDocument *document, size_t *len);
+
+// Function to get the current contents (no reference is added; take one to keep them)
+GBytes* byte_document_get_bytes(const ByteDocument *document);
+
+// Function to get the generation of the contents, which changes with every replacement
+guint64 byte_document_get_generation(const ByteDocument *document);
+
+#endif /* BYTE_DOCUMENT_H */
@@ -0,0 +1,325 @@
+#include "byte_search.h"
+#include "aho_corasick.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Match starts per chunk; chunks are searched in parallel and their hits passed on in order
+#define SEARCH_CHUNK_BYTES (4 * 1024 * 1024)
+
+// Sixty-four bit masks for comparing eight bytes at a time
+#define HIGH_BITS 0x8080808080808080ULL
+#define LOW_BITS 0x7F7F7F7F7F7F7F7FULL
+#define ONE_BYTES 0x0101010101010101ULL
+
+typedef struct {
+    guint8 *bytes;
+    size_t len;
+} SearchPattern;
+
+struct ByteSearch {
+    GArray *patterns;        // SearchPattern
+    size_t max_len;
+    bool relative;           // Match byte differences instead of bytes (one pattern)
+    AhoCorasick *automaton;  // Built on the first run when there are several patterns
+};
+
+typedef struct SearchJob SearchJob;
+
+typedef struct {
+    SearchJob *job;
+    size_t start;    // First match start of the chunk
+    size_t limit;    // First match start of the next chunk
+    GArray *hits;    // SearchHit
+    bool done;
+} SearchChunk;
+
+struct SearchJob {
+    const ByteSearch *search;
+    const guint8 *data;
+    size_t len;
+    gint *cancel;
+    GMutex mutex;
+    GCond chunk_done;
+};
+
+// Aho-Corasick matches of one chunk
+typedef struct {
+    const ByteSearch *search;
+    size_t limit;
+    GArray *hits;
+} ChunkMatches;
+
+static GThreadPool *search_pool = NULL;
+
+static bool is_cancelled(gint *cancel) {
+    return cancel != NULL && g_atomic_int_get(cancel) != 0;
+}
+
+// Function to create an empty search
+ByteSearch* byte_search_new(void) {
+    ByteSearch *search = g_new0(ByteSearch, 1);
+    search->patterns = g_array_new(FALSE, FALSE, sizeof(SearchPattern));
+    return search;
+}
+
+// Function to create a relative search for one pattern of at least two bytes
+ByteSearch* byte_search_new_relative(void) {
+    ByteSearch *search = byte_search_new();
+    search->relative = true;
+    return search;
+}
+
+// Function to add a pattern (len > 0); returns its id (0, 1, 2, ... in insertion order)
+guint byte_search_add_pattern(ByteSearch *search, const guint8 *pattern, size_t len) {
+    g_return_val_if_fail(search->automaton == NULL && len > 0, 0);
+    g_return_val_if_fail(!search->relative || (search->patterns->len == 0 && len >= 2), 0);
+
+    SearchPattern entry = { g_memdup2(pattern, len), len };
+    g_array_append_val(search->patterns, entry);
+    search->max_len = MAX(search->max_len, len);
+    return search->patterns->len - 1;
+}
+
+guint byte_search_pattern_count(const ByteSearch *search) {
+    return search->patterns->len;
+}
+
+size_t byte_search_pattern_length(const ByteSearch *search, guint pattern_id) {
+    return g_array_index(search->patterns, SearchPattern, pattern_id).len;
+}
+
+// Function to find one pattern at match starts from..to-1
+// Eight candidate starts are tested at once: a start is kept only if both the first and the last
+// byte of the pattern are in place, and only those are compared in full.
+static void find_single(const guint8 *data, size_t len, size_t from, size_t to,
+                        const SearchPattern *pattern, GArray *hits) {
+    if (pattern->len > len) return;
+    to = MIN(to, len - pattern->len + 1);
+    const guint8 *bytes = pattern->bytes;
+    size_t i = from;
+
+    if (pattern->len == 1) {
+        while (i < to) {
+            const guint8 *found = memchr(data + i, bytes[0], to - i);
+            if (found == NULL) break;
+            SearchHit hit = { found - data, 0 };
+            g_array_append_val(hits, hit);
+            i = found - data + 1;
+        }
+        return;
+    }
+
+    guint64 first = ONE_BYTES * bytes[0];
+    guint64 last = ONE_BYTES * bytes[pattern->len - 1];
+    for (; i + 8 <= to; i += 8) {
+        guint64 head, tail;
+        memcpy(&head, data + i, sizeof(head));
+        memcpy(&tail, data + i + pattern->len - 1, sizeof(tail));
+
+        // Zero bytes of x mark candidates (the test can flag extra bytes, never miss one)
+        guint64 x = (head ^ first) | (tail ^ last);
+        guint64 candidates = (x - ONE_BYTES) & ~x & HIGH_BITS;
+        if (candidates == 0) continue;
+
+        for (guint k = 0; k < 8; k++) {
+            size_t pos = i + k;
+            if (data[pos] == bytes[0] && memcmp(data + pos + 1, bytes + 1, pattern->len - 1) == 0) {
+                SearchHit hit = { pos, 0 };
+                g_array_append_val(hits, hit);
+            }
+        }
+    }
+
+    for (; i < to; i++) {
+        if (data[i] == bytes[0] && memcmp(data + i + 1, bytes + 1, pattern->len - 1) == 0) {
+            SearchHit hit = { i, 0 };
+            g_array_append_val(hits, hit);
+        }
+    }
+}
+
+// Function to check the differences between successive bytes at pos against the pattern's
+static bool relative_match(const guint8 *data, size_t pos, const SearchPattern *pattern) {
+    for (size_t j = 1; j < pattern->len; j++) {
+        if ((guint8)(data[pos + j] - data[pos + j - 1]) != (guint8)(pattern->bytes[j] - pattern->bytes[j - 1])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Function to find a pattern's byte differences at match starts from..to-1, whatever the first byte
+// The differences of eight neighbouring byte pairs are computed at once, and only starts whose
+// first difference is right are checked in full.
+static void find_relative(const guint8 *data, size_t len, size_t from, size_t to,
+                          const SearchPattern *pattern, GArray *hits) {
+    if (pattern->len > len) return;
+    to = MIN(to, len - pattern->len + 1);
+    guint64 first = ONE_BYTES * (guint8)(pattern->bytes[1] - pattern->bytes[0]);
+    size_t i = from;
+
+    // The patterns are at least two bytes, so data[i + 8] is in range while i + 8 <= to
+    for (; i + 8 <= to; i += 8) {
+        guint64 x, y;
+        memcpy(&x, data + i, sizeof(x));
+        memcpy(&y, data + i + 1, sizeof(y));
+        x = GUINT64_FROM_LE(x);
+        y = GUINT64_FROM_LE(y);
+
+        // Byte-wise y - x without borrows between bytes, then an exact test for zero bytes
+        guint64 diff = ((y | HIGH_BITS) - (x & ~HIGH_BITS)) ^ ((y ^ ~x) & HIGH_BITS);
+        guint64 t = diff ^ first;
+        guint64 candidates = ~(((t & LOW_BITS) + LOW_BITS) | t | LOW_BITS);
+
+        if (candidates == 0) continue;
+
+        for (guint k = 0; k < 8; k++) {
+            if ((candidates >> (k * 8 + 7)) & 1 && relative_match(data, i + k, pattern)) {
+                SearchHit hit = { i + k, 0 };
+                g_array_append_val(hits, hit);
+            }
+        }
+    }
+
+    for (; i < to; i++) {
+        if (relative_match(data, i, pattern)) {
+            SearchHit hit = { i, 0 };
+            g_array_append_val(hits, hit);
+        }
+    }
+}
+
+static bool collect_match(guint pattern_id, size_t end, gpointer user_data) {
+    ChunkMatches *matches = user_data;
+    SearchHit hit = { end - byte_search_pattern_length(matches->search, pattern_id), pattern_id };
+    if (hit.offset < matches->limit) g_array_append_val(matches->hits, hit);
+    return true;
+}
+
+static int compare_hits(const void *a, const void *b) {
+    const SearchHit *x = a;
+    const SearchHit *y = b;
+    if (x->offset != y->offset) return x->offset < y->offset ? -1 : 1;
+    return (x->pattern > y->pattern) - (x->pattern < y->pattern);
+}
+
+// Function to find every pattern at match starts from..to-1
+static void search_range(const ByteSearch *search, const guint8 *data, size_t len, size_t from, size_t to,
+                         GArray *hits) {
+    if (search->relative) {
+        find_relative(data, len, from, to, &g_array_index(search->patterns, SearchPattern, 0), hits);
+        return;
+    }
+    if (search->automaton == NULL) {
+        find_single(data, len, from, to, &g_array_index(search->patterns, SearchPattern, 0), hits);
+        return;
+    }
+
+    // Matches starting in the range may end up to the longest pattern past it
+    size_t end = MIN(len, to + search->max_len - 1);
+    ChunkMatches matches = { search, to, hits };
+    aho_corasick_scan(search->automaton, 0, data + from, end - from, from, collect_match, &matches);
+
+    // Reported by end offset; patterns of different lengths come out of start order
+    qsort(hits->data, hits->len, sizeof(SearchHit), compare_hits);
+}
+
+// Thread pool worker: search one chunk
+static void run_search_chunk(gpointer data, gpointer user_data) {
+    SearchChunk *chunk = data;
+    SearchJob *job = chunk->job;
+
+    if (!is_cancelled(job->cancel)) {
+        search_range(job->search, job->data, job->len, chunk->start, chunk->limit, chunk->hits);
+    }
+
+    g_mutex_lock(&job->mutex);
+    chunk->done = true;
+    g_cond_broadcast(&job->chunk_done);
+    g_mutex_unlock(&job->mutex);
+}
+
+// Function to search chunks on the pool, passing their hits on in order as they finish
+static void search_parallel(const ByteSearch *search, const guint8 *data, size_t len,
+                            ByteSearchFunc func, gpointer user_data, gint *cancel) {
+    static gsize initialized = 0;
+    if (g_once_init_enter(&initialized)) {
+        search_pool = g_thread_pool_new(run_search_chunk, NULL, (gint)g_get_num_processors(), FALSE, NULL);
+        g_once_init_leave(&initialized, 1);
+    }
+
+    SearchJob job = { 0 };
+    job.search = search;
+    job.data = data;
+    job.len = len;
+    job.cancel = cancel;
+    g_mutex_init(&job.mutex);
+    g_cond_init(&job.chunk_done);
+
+    guint count = (guint)((len + SEARCH_CHUNK_BYTES - 1) / SEARCH_CHUNK_BYTES);
+    SearchChunk *chunks = g_new0(SearchChunk, count);
+    for (guint i = 0; i < count; i++) {
+        chunks[i].job = &job;
+        chunks[i].start = (size_t)i * SEARCH_CHUNK_BYTES;
+        chunks[i].limit = MIN(chunks[i].start + SEARCH_CHUNK_BYTES, len);
+        chunks[i].hits = g_array_new(FALSE, FALSE, sizeof(SearchHit));
+        g_thread_pool_push(search_pool, &chunks[i], NULL);
+    }
+
+    for (guint i = 0; i < count; i++) {
+        g_mutex_lock(&job.mutex);
+        while (!chunks[i].done) {
+            g_cond_wait(&job.chunk_done, &job.mutex);
+        }
+        g_mutex_unlock(&job.mutex);
+
+        if (!is_cancelled(cancel)) {
+            func((SearchHit *)chunks[i].hits->data, chunks[i].hits->len, chunks[i].limit, user_data);
+        }
+        g_array_free(chunks[i].hits, TRUE);
+    }
+
+    g_free(chunks);
+    g_mutex_clear(&job.mutex);
+    g_cond_clear(&job.chunk_done);
+}
+
+// Function to search data for every pattern, split over all cores
+void byte_search_run(ByteSearch *search, const guint8 *data, size_t len,
+                     ByteSearchFunc func, gpointer user_data, gint *cancel) {
+    if (search->patterns->len == 0) return;
+
+    if (search->patterns->len > 1 && search->automaton == NULL) {
+        search->automaton = aho_corasick_new(false);
+        for (guint i = 0; i < search->patterns->len; i++) {
+            const SearchPattern *pattern = &g_array_index(search->patterns, SearchPattern, i);
+            aho_corasick_add_pattern(search->automaton, pattern->bytes, pattern->len);
+        }
+        aho_corasick_build(search->automaton);
+    }
+
+    if (len > SEARCH_CHUNK_BYTES && g_get_num_processors() > 1) {
+        search_parallel(search, data, len, func, user_data, cancel);
+        return;
+    }
+
+    GArray *hits = g_array_new(FALSE, FALSE, sizeof(SearchHit));
+    for (size_t start = 0; start < len && !is_cancelled(cancel); start += SEARCH_CHUNK_BYTES) {
+        size_t limit = MIN(start + SEARCH_CHUNK_BYTES, len);
+        search_range(search, data, len, start, limit, hits);
+        func((SearchHit *)hits->data, hits->len, limit, user_data);
+        g_array_set_size(hits, 0);
+    }
+    g_array_free(hits, TRUE);
+}
+
+// Function to free a search
+void byte_search_free(ByteSearch *search) {
+    if (search == NULL) return;
+    for (guint i = 0; i < search->patterns->len; i++) {
+        g_free(g_array_index(search->patterns, SearchPattern, i).bytes);
+    }
+    g_array_free(search->patterns, TRUE);
+    aho_corasick_free(search->automaton);
+    g_free(search);
+}
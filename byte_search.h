@@ -0,0 +1,46 @@
+#ifndef BYTE_SEARCH_H
+#define BYTE_SEARCH_H
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Search of binary data for one or more byte patterns
+// A single pattern is found with a word-at-a-time first/last byte filter; several patterns go
+// through one Aho-Corasick pass. Every occurrence is reported, overlapping ones included.
+typedef struct ByteSearch ByteSearch;
+
+typedef struct {
+    gsize offset;    // Byte offset of the match
+    guint pattern;   // Pattern id
+} SearchHit;
+
+// Called from the searching thread with each batch of hits in offset order (count may be 0, to
+// report progress); scanned is how many bytes are done
+typedef void (*ByteSearchFunc)(const SearchHit *hits, guint count, gsize scanned, gpointer user_data);
+
+// Function to create an empty search
+ByteSearch* byte_search_new(void);
+
+// Function to create a relative search, for finding text in an unknown character set
+// It takes one pattern of at least two bytes, which matches wherever the differences between
+// successive bytes are the same as the pattern's (modulo 256), whatever the bytes themselves are.
+ByteSearch* byte_search_new_relative(void);
+
+// Function to add a pattern (len > 0); returns its id (0, 1, 2, ... in insertion order)
+guint byte_search_add_pattern(ByteSearch *search, const guint8 *pattern, size_t len);
+
+// Function to get the number of patterns and the length of one pattern
+guint byte_search_pattern_count(const ByteSearch *search);
+size_t byte_search_pattern_length(const ByteSearch *search, guint pattern_id);
+
+// Function to search data for every pattern, split over all cores
+// Blocks until the search is done or *cancel (may be NULL) becomes non-zero. No patterns can be
+// added afterwards.
+void byte_search_run(ByteSearch *search, const guint8 *data, size_t len,
+                     ByteSearchFunc func, gpointer user_data, gint *cancel);
+
+// Function to free a search
+void byte_search_free(ByteSearch *search);
+
+#endif /* BYTE_SEARCH_H */
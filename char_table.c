@@ -0,0 +1,515 @@
+#include "char_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern bool debug_mode;
+
+// Longest byte key an entry may have
+#define MAX_KEY_BYTES 8
+
+typedef enum {
+    ENTRY_TEXT,
+    ENTRY_END,      // End of string, followed by a line break
+    ENTRY_NEWLINE,
+    ENTRY_CONTROL   // Followed by parameter bytes
+} EntryKind;
+
+typedef struct {
+    guint8 key[MAX_KEY_BYTES];
+    guint8 key_len;
+    guint8 kind;
+    guint8 params;        // Parameter bytes after a control code
+    char closer;          // Bracket closing a control code with parameters
+    guint32 text_offset;  // Output in the text pool
+    guint32 text_len;
+} TableEntry;
+
+struct CharTable {
+    gint ref_count;
+    char *name;
+    GArray *entries;      // TableEntry
+    GString *text_pool;   // Output of every entry, back to back
+
+    // Decoding trie: consuming byte b in node n matches entry values[n * 256 + b] (if >= 0)
+    // and continues in node next[n * 256 + b] (if not 0; node 0 is the root)
+    guint32 *next;
+    gint32 *values;
+    guint node_count;
+    const TableEntry *single[256]; // Single-byte entries no longer key starts with, for the fast path
+    size_t max_output;             // Longest output of one token
+
+    // Encoding: entry output -> entry index, and "<label" -> control entry with parameters
+    GHashTable *by_text;
+    GHashTable *controls;
+    size_t max_text_len;
+};
+
+static GMutex active_mutex;
+static CharTable *active_table = NULL;
+
+static gint32 add_trie_node(CharTable *table) {
+    table->next = g_renew(guint32, table->next, (table->node_count + 1) * 256);
+    table->values = g_renew(gint32, table->values, (table->node_count + 1) * 256);
+    memset(table->next + table->node_count * 256, 0, 256 * sizeof(guint32));
+    for (guint b = 0; b < 256; b++) {
+        table->values[table->node_count * 256 + b] = -1;
+    }
+    return table->node_count++;
+}
+
+// Function to add an entry's key to the decoding trie (a later duplicate replaces an earlier one)
+static void add_to_trie(CharTable *table, const TableEntry *entry, gint32 index) {
+    guint32 node = 0;
+    for (guint i = 0; i + 1 < entry->key_len; i++) {
+        guint32 slot = node * 256 + entry->key[i];
+        if (table->next[slot] == 0) {
+            guint32 child = add_trie_node(table);
+            table->next[node * 256 + entry->key[i]] = child;
+        }
+        node = table->next[node * 256 + entry->key[i]];
+    }
+    table->values[node * 256 + entry->key[entry->key_len - 1]] = index;
+}
+
+// Function to parse the hex key of an entry; returns false if it isn't 1 to MAX_KEY_BYTES hex bytes
+static bool parse_key(const char *hex, size_t hex_len, TableEntry *entry) {
+    if (hex_len == 0 || hex_len % 2 != 0 || hex_len / 2 > MAX_KEY_BYTES) return false;
+
+    for (size_t i = 0; i < hex_len; i += 2) {
+        int high = g_ascii_xdigit_value(hex[i]);
+        int low = g_ascii_xdigit_value(hex[i + 1]);
+        if (high < 0 || low < 0) return false;
+        entry->key[i / 2] = (guint8)((high << 4) | low);
+    }
+    entry->key_len = hex_len / 2;
+    return true;
+}
+
+// Function to append entry text, turning "\n" into a line break
+static void append_entry_text(GString *pool, const char *text) {
+    for (const char *p = text; *p != '\0'; p++) {
+        if (p[0] == '\\' && p[1] == 'n') {
+            g_string_append_c(pool, '\n');
+            p++;
+        } else {
+            g_string_append_c(pool, *p);
+        }
+    }
+}
+
+// Function to parse one table line into an entry; returns false for lines that aren't entries
+static bool parse_line(CharTable *table, const char *line, TableEntry *entry) {
+    memset(entry, 0, sizeof(TableEntry));
+    entry->kind = ENTRY_TEXT;
+
+    if (*line == '/') {
+        entry->kind = ENTRY_END;
+        line++;
+    } else if (*line == '*') {
+        entry->kind = ENTRY_NEWLINE;
+        line++;
+    } else if (*line == '$') {
+        entry->kind = ENTRY_CONTROL;
+        line++;
+    }
+
+    const char *separator = strchr(line, '=');
+    const char *text = separator != NULL ? separator + 1 : "";
+    if (!parse_key(line, separator != NULL ? (size_t)(separator - line) : strlen(line), entry)) return false;
+    if (entry->kind == ENTRY_TEXT && (separator == NULL || *text == '\0')) return false;
+
+    entry->text_offset = table->text_pool->len;
+
+    if (entry->kind == ENTRY_CONTROL) {
+        // "label[,parameter count]"; labels are shown in angle brackets unless already bracketed
+        char *label = g_strdup(text);
+        char *comma = strrchr(label, ',');
+        if (comma != NULL && comma[1] != '\0' && strspn(comma + 1, "0123456789") == strlen(comma + 1)) {
+            entry->params = (guint8)MIN(atoi(comma + 1), 16);
+            *comma = '\0';
+        }
+
+        size_t label_len = strlen(label);
+        bool bracketed = label_len >= 2 && ((label[0] == '<' && label[label_len - 1] == '>') ||
+                                            (label[0] == '[' && label[label_len - 1] == ']'));
+        if (label_len == 0) {
+            g_string_append_printf(table->text_pool, "<$%02X", entry->key[0]);
+            for (guint i = 1; i < entry->key_len; i++) {
+                g_string_append_printf(table->text_pool, "%02X", entry->key[i]);
+            }
+            entry->closer = '>';
+        } else if (bracketed) {
+            g_string_append_len(table->text_pool, label, label_len - 1);
+            entry->closer = label[label_len - 1];
+        } else {
+            g_string_append_c(table->text_pool, '<');
+            g_string_append(table->text_pool, label);
+            entry->closer = '>';
+        }
+        // Without parameters the closing bracket is part of the output
+        if (entry->params == 0) {
+            g_string_append_c(table->text_pool, entry->closer);
+        }
+        g_free(label);
+    } else {
+        append_entry_text(table->text_pool, text);
+        if (entry->kind != ENTRY_TEXT) g_string_append_c(table->text_pool, '\n');
+    }
+
+    entry->text_len = table->text_pool->len - entry->text_offset;
+    return true;
+}
+
+// Function to parse a table from a string; on failure returns NULL and sets error (may be NULL)
+CharTable* char_table_new_from_string(const char *contents, const char *name, char **error) {
+    if (contents == NULL) {
+        if (error) *error = g_strdup("No table contents");
+        return NULL;
+    }
+
+    CharTable *table = g_new0(CharTable, 1);
+    table->ref_count = 1;
+    table->name = g_strdup(name != NULL ? name : "table");
+    table->entries = g_array_new(FALSE, FALSE, sizeof(TableEntry));
+    table->text_pool = g_string_new(NULL);
+    table->by_text = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    table->controls = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    add_trie_node(table);
+
+    guint skipped = 0;
+    gchar **lines = g_strsplit(contents, "\n", -1);
+    for (guint i = 0; lines[i] != NULL; i++) {
+        char *line = lines[i];
+        size_t line_len = strlen(line);
+        if (line_len > 0 && line[line_len - 1] == '\r') line[--line_len] = '\0';
+
+        // Entry text is kept verbatim ("20= " maps to a space), so only blank lines are skipped
+        if (*line == '\0' || *line == '#' || *line == ';') continue;
+
+        TableEntry entry;
+        if (!parse_line(table, line, &entry)) {
+            skipped++;
+            continue;
+        }
+        g_array_append_val(table->entries, entry);
+    }
+    g_strfreev(lines);
+
+    if (table->entries->len == 0) {
+        if (error) *error = g_strdup_printf("%s has no table entries", table->name);
+        char_table_unref(table);
+        return NULL;
+    }
+
+    // Build the trie and the encoding maps; for encoding, the first entry producing a text wins
+    for (guint i = 0; i < table->entries->len; i++) {
+        TableEntry *entry = &g_array_index(table->entries, TableEntry, i);
+        add_to_trie(table, entry, (gint32)i);
+
+        char *text = g_strndup(table->text_pool->str + entry->text_offset, entry->text_len);
+        GHashTable *map = entry->params > 0 ? table->controls : table->by_text;
+        if (g_hash_table_contains(map, text)) {
+            g_free(text);
+        } else {
+            g_hash_table_insert(map, text, GUINT_TO_POINTER(i));
+            if (entry->params == 0) table->max_text_len = MAX(table->max_text_len, entry->text_len);
+        }
+    }
+
+    // Tokens: entry text plus up to 16 parameters (" XX") and a bracket, or "<$XX>"
+    TableEntry *entries = (TableEntry *)table->entries->data;
+    table->max_output = 5;
+    for (guint i = 0; i < table->entries->len; i++) {
+        table->max_output = MAX(table->max_output, entries[i].text_len + 3 * entries[i].params + 1);
+    }
+    for (guint b = 0; b < 256; b++) {
+        gint32 index = table->values[b];
+        if (index >= 0 && table->next[b] == 0 && entries[index].params == 0) {
+            table->single[b] = &entries[index];
+        }
+    }
+    // Eight-byte copies of short entries may read past the end of the pool
+    g_string_append_len(table->text_pool, "\0\0\0\0\0\0\0\0", 8);
+
+    if (debug_mode) {
+        if (skipped > 0) {
+            fprintf(stderr, "DEBUG: %s: skipped %u lines that are not table entries\n", table->name, skipped);
+        }
+        fprintf(stderr, "DEBUG: Loaded table %s: %u entries, %u trie nodes\n",
+                table->name, table->entries->len, table->node_count);
+    }
+    return table;
+}
+
+// Function to load a table file; on failure returns NULL and sets error (may be NULL)
+CharTable* char_table_load(const char *path, char **error) {
+    gchar *contents = NULL;
+    gsize length = 0;
+    GError *file_error = NULL;
+
+    if (!g_file_get_contents(path, &contents, &length, &file_error)) {
+        if (error) *error = g_strdup(file_error->message);
+        g_error_free(file_error);
+        return NULL;
+    }
+
+    // Tables are UTF-8 (possibly with a byte order mark) or, for older Japanese tools, Shift-JIS
+    const char *text = contents;
+    gchar *converted = NULL;
+    if (length >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0) {
+        text += 3;
+        length -= 3;
+    }
+    if (!g_utf8_validate(text, length, NULL)) {
+        converted = g_convert(text, length, "UTF-8", "CP932", NULL, NULL, NULL);
+        if (converted == NULL) {
+            if (error) *error = g_strdup("The table is neither UTF-8 nor Shift-JIS text");
+            g_free(contents);
+            return NULL;
+        }
+        text = converted;
+    }
+
+    char *name = g_path_get_basename(path);
+    CharTable *table = char_table_new_from_string(text, name, error);
+    g_free(name);
+    g_free(converted);
+    g_free(contents);
+    return table;
+}
+
+// Functions to take and drop references (tables are shared with worker threads)
+CharTable* char_table_ref(CharTable *table) {
+    g_atomic_int_inc(&table->ref_count);
+    return table;
+}
+
+void char_table_unref(CharTable *table) {
+    if (table == NULL || !g_atomic_int_dec_and_test(&table->ref_count)) return;
+
+    g_hash_table_destroy(table->by_text);
+    g_hash_table_destroy(table->controls);
+    g_free(table->next);
+    g_free(table->values);
+    g_string_free(table->text_pool, TRUE);
+    g_array_free(table->entries, TRUE);
+    g_free(table->name);
+    g_free(table);
+}
+
+// Function to get the table name (the file name) and its number of entries
+const char* char_table_get_name(const CharTable *table) {
+    return table->name;
+}
+
+guint char_table_size(const CharTable *table) {
+    return table->entries->len;
+}
+
+// Function to decode bytes to UTF-8 text; unmapped bytes are counted in invalid (may be NULL)
+char* char_table_decode(const CharTable *table, const guint8 *data, size_t len, size_t *invalid) {
+    static const char hex_digits[] = "0123456789ABCDEF";
+    const TableEntry *entries = (const TableEntry *)table->entries->data;
+    const char *pool = table->text_pool->str;
+    size_t invalid_count = 0;
+
+    // Room for the longest token is ensured before each one, plus slack for eight-byte copies
+    size_t capacity = len * 2 + table->max_output + 16;
+    char *result = g_malloc(capacity);
+    size_t out = 0;
+
+    size_t i = 0;
+    while (i < len) {
+        if (out + table->max_output + 8 > capacity) {
+            capacity = capacity * 2 + table->max_output;
+            result = g_realloc(result, capacity);
+        }
+
+        // Fast path: a single-byte entry that no longer key starts with
+        const TableEntry *entry = table->single[data[i]];
+        if (entry != NULL) {
+            if (entry->text_len <= 8) {
+                memcpy(result + out, pool + entry->text_offset, 8);
+            } else {
+                memcpy(result + out, pool + entry->text_offset, entry->text_len);
+            }
+            out += entry->text_len;
+            i++;
+            continue;
+        }
+
+        // Longest match: walk the trie as far as the data goes, remembering the last entry passed
+        guint32 node = 0;
+        gint32 match = -1;
+        size_t match_end = i;
+        for (size_t j = i; j < len; ) {
+            guint32 slot = node * 256 + data[j++];
+            if (table->values[slot] >= 0) {
+                match = table->values[slot];
+                match_end = j;
+            }
+            node = table->next[slot];
+            if (node == 0) break;
+        }
+
+        if (match < 0) {
+            char unmapped[5] = { '<', '$', hex_digits[data[i] >> 4], hex_digits[data[i] & 0xF], '>' };
+            memcpy(result + out, unmapped, sizeof(unmapped));
+            out += sizeof(unmapped);
+            invalid_count++;
+            i++;
+            continue;
+        }
+
+        entry = &entries[match];
+        memcpy(result + out, pool + entry->text_offset, entry->text_len);
+        out += entry->text_len;
+        i = match_end;
+
+        if (entry->params > 0) {
+            for (guint p = 0; p < entry->params && i < len; p++, i++) {
+                result[out++] = ' ';
+                result[out++] = hex_digits[data[i] >> 4];
+                result[out++] = hex_digits[data[i] & 0xF];
+            }
+            result[out++] = entry->closer;
+        }
+    }
+
+    result[out] = '\0';
+    if (invalid != NULL) *invalid = invalid_count;
+    return result;
+}
+
+// Function to parse "<$XX>" or a control code with parameters at text; returns the characters used
+static size_t encode_bracketed(const CharTable *table, const char *text, GByteArray *output) {
+    char closer = text[0] == '<' ? '>' : ']';
+    const char *end = strchr(text, closer);
+    if (end == NULL || end - text > 64) return 0;
+
+    // Unmapped byte written by the decoder
+    if (text[0] == '<' && text[1] == '$' && end - text == 4 &&
+        g_ascii_isxdigit(text[2]) && g_ascii_isxdigit(text[3])) {
+        guint8 byte = (guint8)((g_ascii_xdigit_value(text[2]) << 4) | g_ascii_xdigit_value(text[3]));
+        g_byte_array_append(output, &byte, 1);
+        return 5;
+    }
+
+    gchar *inner = g_strndup(text, end - text);
+    gchar **words = g_strsplit(inner, " ", -1);
+    g_free(inner);
+
+    size_t used = 0;
+    gpointer index;
+    if (words[0] != NULL && g_hash_table_lookup_extended(table->controls, words[0], NULL, &index)) {
+        const TableEntry *entry = &g_array_index(table->entries, TableEntry, GPOINTER_TO_UINT(index));
+        guint8 params[16];
+        guint count = 0;
+        bool valid = entry->closer == closer;
+
+        for (guint i = 1; valid && words[i] != NULL; i++) {
+            if (count >= entry->params || strlen(words[i]) != 2 ||
+                !g_ascii_isxdigit(words[i][0]) || !g_ascii_isxdigit(words[i][1])) {
+                valid = false;
+                break;
+            }
+            params[count++] = (guint8)((g_ascii_xdigit_value(words[i][0]) << 4) | g_ascii_xdigit_value(words[i][1]));
+        }
+
+        if (valid && count == entry->params) {
+            g_byte_array_append(output, entry->key, entry->key_len);
+            g_byte_array_append(output, params, count);
+            used = end - text + 1;
+        }
+    }
+
+    g_strfreev(words);
+    return used;
+}
+
+// Function to measure the token at the start of data: its key and any parameter bytes
+size_t char_table_match(const CharTable *table, const guint8 *data, size_t len) {
+    if (len == 0) return 0;
+    if (table->single[data[0]] != NULL) return 1;
+
+    guint32 node = 0;
+    gint32 match = -1;
+    size_t match_end = 0;
+    for (size_t j = 0; j < len; ) {
+        guint32 slot = node * 256 + data[j++];
+        if (table->values[slot] >= 0) {
+            match = table->values[slot];
+            match_end = j;
+        }
+        node = table->next[slot];
+        if (node == 0) break;
+    }
+    if (match < 0) return 0;
+
+    const TableEntry *entry = &g_array_index(table->entries, TableEntry, match);
+    return MIN(match_end + entry->params, len);
+}
+
+// Function to encode UTF-8 text to bytes; text no entry produces is skipped and counted in unmapped
+guint8* char_table_encode(const CharTable *table, const char *text, size_t *out_len, size_t *unmapped) {
+    GByteArray *output = g_byte_array_sized_new(strlen(text) + 1);
+    size_t unmapped_count = 0;
+    size_t text_len = strlen(text);
+    char *candidate = g_malloc(table->max_text_len + 1);
+
+    size_t i = 0;
+    while (i < text_len) {
+        // Longest entry text starting here
+        size_t longest = MIN(table->max_text_len, text_len - i);
+        size_t used = 0;
+        for (size_t length = longest; length > 0; length--) {
+            // Only try lengths that end on a character boundary
+            if (i + length < text_len && (text[i + length] & 0xC0) == 0x80) continue;
+
+            memcpy(candidate, text + i, length);
+            candidate[length] = '\0';
+            gpointer index;
+            if (g_hash_table_lookup_extended(table->by_text, candidate, NULL, &index)) {
+                const TableEntry *entry = &g_array_index(table->entries, TableEntry, GPOINTER_TO_UINT(index));
+                g_byte_array_append(output, entry->key, entry->key_len);
+                used = length;
+                break;
+            }
+        }
+
+        if (used == 0 && (text[i] == '<' || text[i] == '[')) {
+            used = encode_bracketed(table, text + i, output);
+        }
+
+        if (used == 0) {
+            // Nothing produces this character
+            unmapped_count++;
+            used = g_utf8_next_char(text + i) - (text + i);
+        }
+        i += used;
+    }
+
+    g_free(candidate);
+    if (unmapped != NULL) *unmapped = unmapped_count;
+    *out_len = output->len;
+    return g_byte_array_free(output, FALSE);
+}
+
+// Function to set the table used by the "Table" encoding (takes a reference; NULL clears it)
+void char_table_set_active(CharTable *table) {
+    g_mutex_lock(&active_mutex);
+    CharTable *previous = active_table;
+    active_table = table != NULL ? char_table_ref(table) : NULL;
+    g_mutex_unlock(&active_mutex);
+
+    char_table_unref(previous);
+}
+
+// Function to get a reference to the table used by the "Table" encoding, or NULL if none is loaded
+CharTable* char_table_get_active(void) {
+    g_mutex_lock(&active_mutex);
+    CharTable *table = active_table != NULL ? char_table_ref(active_table) : NULL;
+    g_mutex_unlock(&active_mutex);
+    return table;
+}
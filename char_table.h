@@ -0,0 +1,48 @@
+#ifndef CHAR_TABLE_H
+#define CHAR_TABLE_H
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Thingy-style character table (.tbl) used by ROM translation tools
+// One entry per line, "XX=text" with one or more hex bytes as the key (longest match wins):
+//   8140=　       multi-byte entries
+//   /FF=<END>     end of string: the text is followed by a line break
+//   *FE           line break
+//   $F5=<wait>,1  control code followed by one parameter byte, shown as "<wait 1E>"
+// Blank lines and lines starting with '#' or ';' are ignored; "@" table ids and "!" table switches
+// are not supported and skipped. Files may be UTF-8 or Shift-JIS. Unmapped bytes are shown as "<$XX>".
+typedef struct CharTable CharTable;
+
+// Function to parse a table from a string; on failure returns NULL and sets error (may be NULL)
+CharTable* char_table_new_from_string(const char *contents, const char *name, char **error);
+
+// Function to load a table file; on failure returns NULL and sets error (may be NULL)
+CharTable* char_table_load(const char *path, char **error);
+
+// Functions to take and drop references (tables are shared with worker threads)
+CharTable* char_table_ref(CharTable *table);
+void char_table_unref(CharTable *table);
+
+// Function to get the table name (the file name) and its number of entries
+const char* char_table_get_name(const CharTable *table);
+guint char_table_size(const CharTable *table);
+
+// Function to decode bytes to UTF-8 text; unmapped bytes are counted in invalid (may be NULL)
+char* char_table_decode(const CharTable *table, const guint8 *data, size_t len, size_t *invalid);
+
+// Function to measure the token at the start of data (its key plus any control parameters, as
+// decoding would consume it); returns 0 if no entry matches
+size_t char_table_match(const CharTable *table, const guint8 *data, size_t len);
+
+// Function to encode UTF-8 text to bytes; text no entry produces is skipped and counted in unmapped
+guint8* char_table_encode(const CharTable *table, const char *text, size_t *out_len, size_t *unmapped);
+
+// Function to set the table used by the "Table" encoding (takes a reference; NULL clears it)
+void char_table_set_active(CharTable *table);
+
+// Function to get a reference to the table used by the "Table" encoding, or NULL if none is loaded
+CharTable* char_table_get_active(void);
+
+#endif /* CHAR_TABLE_H */
@@ -0,0 +1,80 @@
+// Checks of the character table's trie: the longest key wins, a walk that runs off a longer key
+// falls back to the last entry it passed, and control codes take their parameter bytes
+// Exits with 1 and names the case on the first failure.
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include "char_table.h"
+
+// Read by char_table.c; main.c sets it in the app
+bool debug_mode = false;
+
+// Keys nested three deep, a two-byte key whose first byte is no entry, and an end and a control code
+static const char table_text[] =
+    "41=a\n"
+    "4142=b\n"
+    "414243=c\n"
+    "42=e\n"
+    "8081=d\n"
+    "/FF=<END>\n"
+    "$F5=<wait>,1\n";
+
+typedef struct {
+    const char *name;
+    const char *bytes;
+    size_t len;
+    const char *text;       // The bytes decoded
+    size_t invalid;         // Bytes no entry matched
+    size_t match;           // Bytes char_table_match takes at the start
+} TrieCase;
+
+static const TrieCase cases[] = {
+    { "longest of three nested keys", "\x41\x42\x43", 3, "c", 0, 3 },
+    { "walk off the longest key", "\x41\x42\x44", 3, "b<$44>", 1, 2 },
+    { "walk off after one byte", "\x41\x41\x42", 3, "ab", 0, 1 },
+    { "longest key twice", "\x41\x42\x43\x41\x42\x43", 6, "cc", 0, 3 },
+    { "key at the end of the data", "\x42\x41\x42", 3, "eb", 0, 1 },
+    { "cut off before the longest key ends", "\x41\x42", 2, "b", 0, 2 },
+    { "two-byte key", "\x80\x81", 2, "d", 0, 2 },
+    { "first byte of a key alone", "\x80\x82", 2, "<$80><$82>", 2, 0 },
+    { "end of string", "\xFF\x41", 2, "<END>\na", 0, 1 },
+    { "control code with its parameter", "\xF5\x1E\x41", 3, "<wait 1E>a", 0, 2 },
+    { "control code cut off before its parameter", "\xF5", 1, "<wait>", 0, 1 },
+};
+
+int main(void) {
+    char *error = NULL;
+    CharTable *table = char_table_new_from_string(table_text, "test.tbl", &error);
+    if (table == NULL) {
+        fprintf(stderr, "FAIL: parsing the table: %s\n", error);
+        return 1;
+    }
+
+    for (size_t i = 0; i < G_N_ELEMENTS(cases); i++) {
+        const TrieCase *test = &cases[i];
+        size_t invalid = 0;
+        char *text = char_table_decode(table, (const guint8 *)test->bytes, test->len, &invalid);
+        size_t match = char_table_match(table, (const guint8 *)test->bytes, test->len);
+        bool ok = strcmp(text, test->text) == 0 && invalid == test->invalid && match == test->match;
+        if (!ok) {
+            fprintf(stderr, "FAIL: %s: decoded to %s (%zu invalid), match %zu; expected %s (%zu invalid), match %zu\n",
+                    test->name, text, invalid, match, test->text, test->invalid, test->match);
+        }
+        g_free(text);
+        if (!ok) return 1;
+    }
+
+    // Encoding takes the longest entry text, and reads back unmapped bytes and control codes
+    size_t len = 0, unmapped = 0;
+    guint8 *bytes = char_table_encode(table, "cd<wait 1E><$44>e", &len, &unmapped);
+    bool ok = len == 9 && unmapped == 0 && memcmp(bytes, "\x41\x42\x43\x80\x81\xF5\x1E\x44\x42", len) == 0;
+    g_free(bytes);
+    if (!ok) {
+        fprintf(stderr, "FAIL: encoding gave %zu bytes (%zu unmapped)\n", len, unmapped);
+        return 1;
+    }
+
+    char_table_unref(table);
+    printf("%zu character table cases passed\n", G_N_ELEMENTS(cases));
+    return 0;
+}
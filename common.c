@@ -5,7 +5,9 @@ const char* encoding_type_to_string(EncodingType type) {
     static const char* encoding_names[] = {
         "Hex", "ASCII", "UTF-8", "UTF-16LE", "UTF-16BE",
         "UTF-32LE", "UTF-32BE", "ISO-8859-1", "ISO-8859-15",
-        "Shift-JIS", "EUC-JP", "KOI8-R"
+        "Shift-JIS", "EUC-JP", "KOI8-R", "Table",
+        "Base64", "Base64url", "Base32", "Ascii85",
+        "C String", "JSON String", "URL Encoded"
     };
     
     if (type >= 0 && type < sizeof(encoding_names)/sizeof(encoding_names[0])) {
@@ -14,3 +16,9 @@ const char* encoding_type_to_string(EncodingType type) {
     
     return "Unknown";
 }
+
+// Function to check whether a format writes bytes out as text instead of decoding them
+bool encoding_is_byte_format(EncodingType type) {
+    return type == HEX || type == BASE64 || type == BASE64URL || type == BASE32 || type == ASCII85 ||
+           type == C_STRING || type == JSON_STRING || type == URL_ENCODED;
+}
@@ -17,7 +17,15 @@ typedef enum {
     ISO8859_15,
     SHIFT_JIS,
     EUC_JP,
-    KOI8_R
+    KOI8_R,
+    TABLE_FILE, // Custom character table loaded from a .tbl file
+    BASE64,     // Bytes written as text, like HEX
+    BASE64URL,
+    BASE32,
+    ASCII85,
+    C_STRING,   // Escaped text: C string literals, JSON strings, URL percent-encoding
+    JSON_STRING,
+    URL_ENCODED
 } EncodingType;
 
 // AI Provider types - moved from ai_translator.h
@@ -39,7 +47,27 @@ struct WindowData {
     GtkWidget *ai_translator_box;
     GtkTextBuffer *ai_translation_buffer;
     GtkWidget *send_to_ai_button;
+    GtkWidget *encoding_preview_box;
     bool is_updating; // Flag to prevent recursive updates
+    struct ByteDocument *document; // The bytes both views show, each in its own encoding
+    GtkTextBuffer *unparsed_buffer; // View whose text didn't convert to bytes, or NULL
+    GtkDropDown *top_layout_dropdown;    // Hex as plain text or as hexdump rows
+    GtkDropDown *bottom_layout_dropdown;
+    GtkWidget *top_stack;          // Shows the text view, or the hexdump view
+    GtkWidget *bottom_stack;
+    GtkWidget *top_dump_view;
+    GtkWidget *bottom_dump_view;
+    bool top_text_stale;           // The view shows hexdump rows, so its text wasn't rendered
+    bool bottom_text_stale;
+    struct RenderCache *render_cache; // Recent renderings of the document, by encoding
+    bool bottom_stats_valid;       // bottom_chars and bottom_bytes describe the bottom text
+    size_t bottom_chars;
+    size_t bottom_bytes;
+    struct EncodingDetector *encoding_detector; // Guesses the encoding of hex input
+    GBytes *detected_bytes;        // Document contents the detector has seen, so only appended bytes are fed
+    char *detected_summary;        // "Detected: ..." for the top counter, or NULL
+    bool bottom_encoding_chosen;   // The user picked the bottom encoding; don't auto-select it
+    bool auto_selecting;           // The bottom encoding is being set by detection
 };
 
 // Define the WindowData type
@@ -48,4 +76,8 @@ typedef struct WindowData WindowData;
 // Format name conversion utility
 const char* encoding_type_to_string(EncodingType type);
 
+// Function to check whether a format writes bytes out as text (hex, Base64, ...) instead of
+// decoding them as characters
+bool encoding_is_byte_format(EncodingType type);
+
 #endif /* COMMON_H */
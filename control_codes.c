@@ -0,0 +1,238 @@
+#include "control_codes.h"
+#include <stdio.h>
+#include <string.h>
+
+// Placeholders look like "<12>": few tokens, and models keep tag-like text intact
+#define PLACEHOLDER_PATTERN "<([0-9]+)>"
+
+// Used when there is no pattern file: <|...|> codes, then the bracketed codes the segmenter
+// also recognises, kept short so ordinary bracketed prose isn't swallowed
+static const char *default_patterns[] = {
+    "<\\|[^\\n]*?\\|>",
+    "<[^<>\\s][^<>\\n]{0,31}>",
+    "\\[[^\\[\\]\\s][^\\[\\]\\n]{0,31}\\]",
+    "\\{[^{}\\s][^{}\\n]{0,31}\\}",
+    NULL
+};
+
+struct ControlCodes {
+    gint ref_count;
+    GRegex *regex;       // All patterns as one alternation, placeholder syntax first
+};
+
+struct PlaceholderMap {
+    GPtrArray *codes;    // Placeholder number - 1 -> code
+    GHashTable *numbers; // Code -> placeholder number
+};
+
+static GRegex *placeholder_regex(void) {
+    static GRegex *regex = NULL;
+    static gsize initialized = 0;
+
+    if (g_once_init_enter(&initialized)) {
+        regex = g_regex_new(PLACEHOLDER_PATTERN, G_REGEX_OPTIMIZE, 0, NULL);
+        g_once_init_leave(&initialized, 1);
+    }
+    return regex;
+}
+
+// Add a pattern to the alternation if it compiles on its own
+static bool append_pattern(GString *alternation, const char *pattern, const char *source) {
+    GError *error = NULL;
+    GRegex *regex = g_regex_new(pattern, 0, 0, &error);
+    if (regex == NULL) {
+        fprintf(stderr, "ERROR: Skipping control code pattern '%s' in %s: %s\n", pattern, source, error->message);
+        g_error_free(error);
+        return false;
+    }
+    g_regex_unref(regex);
+
+    g_string_append_printf(alternation, "|(?:%s)", pattern);
+    return true;
+}
+
+// Function to load the pattern file
+ControlCodes* control_codes_load(const char *path) {
+    GString *alternation = g_string_new("(?:" PLACEHOLDER_PATTERN ")");
+    guint patterns = 0;
+
+    char *contents = NULL;
+    if (path != NULL && g_file_get_contents(path, &contents, NULL, NULL)) {
+        gchar **lines = g_strsplit(contents, "\n", -1);
+        for (guint i = 0; lines[i] != NULL; i++) {
+            char *line = g_strstrip(lines[i]);
+            if (*line == '\0' || *line == '#') continue;
+            if (append_pattern(alternation, line, path)) patterns++;
+        }
+        g_strfreev(lines);
+        g_free(contents);
+    } else {
+        for (guint i = 0; default_patterns[i] != NULL; i++) {
+            if (append_pattern(alternation, default_patterns[i], "defaults")) patterns++;
+        }
+    }
+
+    ControlCodes *codes = NULL;
+    if (patterns > 0) {
+        GError *error = NULL;
+        GRegex *regex = g_regex_new(alternation->str, G_REGEX_OPTIMIZE, 0, &error);
+        if (regex != NULL) {
+            codes = g_new0(ControlCodes, 1);
+            codes->ref_count = 1;
+            codes->regex = regex;
+        } else {
+            fprintf(stderr, "ERROR: Could not compile control code patterns: %s\n", error->message);
+            g_error_free(error);
+        }
+    }
+
+    fprintf(stderr, "DEBUG: Loaded %u control code patterns\n", codes != NULL ? patterns : 0);
+    g_string_free(alternation, TRUE);
+    return codes;
+}
+
+ControlCodes* control_codes_ref(ControlCodes *codes) {
+    if (codes != NULL) g_atomic_int_inc(&codes->ref_count);
+    return codes;
+}
+
+void control_codes_unref(ControlCodes *codes) {
+    if (codes == NULL || !g_atomic_int_dec_and_test(&codes->ref_count)) return;
+
+    g_regex_unref(codes->regex);
+    g_free(codes);
+}
+
+// Function to create an empty placeholder map
+PlaceholderMap* placeholder_map_new(void) {
+    PlaceholderMap *map = g_new0(PlaceholderMap, 1);
+    map->codes = g_ptr_array_new_with_free_func(g_free);
+    map->numbers = g_hash_table_new(g_str_hash, g_str_equal);
+    return map;
+}
+
+// Function to get the number of distinct codes in a map
+guint placeholder_map_size(const PlaceholderMap *map) {
+    return map != NULL ? map->codes->len : 0;
+}
+
+// Function to replace the control codes in text with placeholders
+char* placeholder_map_compress(PlaceholderMap *map, const ControlCodes *codes, const char *text) {
+    if (codes == NULL) return g_strdup(text);
+
+    GString *out = g_string_sized_new(strlen(text));
+    GMatchInfo *match_info = NULL;
+    gint copied = 0;
+
+    g_regex_match(codes->regex, text, 0, &match_info);
+    while (g_match_info_matches(match_info)) {
+        gint start = 0, end = 0;
+        g_match_info_fetch_pos(match_info, 0, &start, &end);
+        if (end > start) {
+            g_string_append_len(out, text + copied, start - copied);
+
+            char *code = g_strndup(text + start, end - start);
+            guint number = GPOINTER_TO_UINT(g_hash_table_lookup(map->numbers, code));
+            if (number == 0) {
+                g_ptr_array_add(map->codes, code);
+                number = map->codes->len;
+                g_hash_table_insert(map->numbers, code, GUINT_TO_POINTER(number));
+            } else {
+                g_free(code);
+            }
+
+            g_string_append_printf(out, "<%u>", number);
+            copied = end;
+        }
+        g_match_info_next(match_info, NULL);
+    }
+    g_match_info_free(match_info);
+
+    g_string_append(out, text + copied);
+    return g_string_free(out, FALSE);
+}
+
+// Count the placeholders of text per number; returns false on a number not in map
+static bool count_placeholders(const PlaceholderMap *map, const char *text, guint *counts) {
+    GMatchInfo *match_info = NULL;
+    bool known = true;
+
+    g_regex_match(placeholder_regex(), text, 0, &match_info);
+    while (g_match_info_matches(match_info)) {
+        char *digits = g_match_info_fetch(match_info, 1);
+        guint64 number = g_ascii_strtoull(digits, NULL, 10);
+        g_free(digits);
+
+        if (number == 0 || number > map->codes->len) {
+            known = false;
+            break;
+        }
+        counts[number - 1]++;
+        g_match_info_next(match_info, NULL);
+    }
+    g_match_info_free(match_info);
+
+    return known;
+}
+
+// Function to check that response kept the placeholders of compact_text
+bool placeholder_map_verify(const PlaceholderMap *map, const char *compact_text, const char *response) {
+    guint n = map->codes->len;
+    if (n == 0) return true;
+
+    guint *expected = g_new0(guint, n);
+    guint *returned = g_new0(guint, n);
+    bool ok = count_placeholders(map, compact_text, expected) && count_placeholders(map, response, returned);
+
+    for (guint i = 0; ok && i < n; i++) {
+        if (returned[i] < expected[i]) {
+            fprintf(stderr, "DEBUG: Placeholder <%u> for '%s' came back %u of %u times\n",
+                    i + 1, (const char *)g_ptr_array_index(map->codes, i), returned[i], expected[i]);
+            ok = false;
+        }
+    }
+
+    g_free(expected);
+    g_free(returned);
+    return ok;
+}
+
+// Function to put the codes back in place of their placeholders
+char* placeholder_map_restore(const PlaceholderMap *map, const char *text) {
+    if (map == NULL || map->codes->len == 0) return g_strdup(text);
+
+    GString *out = g_string_sized_new(strlen(text));
+    GMatchInfo *match_info = NULL;
+    gint copied = 0;
+
+    g_regex_match(placeholder_regex(), text, 0, &match_info);
+    while (g_match_info_matches(match_info)) {
+        gint start = 0, end = 0;
+        g_match_info_fetch_pos(match_info, 0, &start, &end);
+
+        char *digits = g_match_info_fetch(match_info, 1);
+        guint64 number = g_ascii_strtoull(digits, NULL, 10);
+        g_free(digits);
+
+        // Unknown numbers are left as they are
+        if (number > 0 && number <= map->codes->len) {
+            g_string_append_len(out, text + copied, start - copied);
+            g_string_append(out, g_ptr_array_index(map->codes, number - 1));
+            copied = end;
+        }
+        g_match_info_next(match_info, NULL);
+    }
+    g_match_info_free(match_info);
+
+    g_string_append(out, text + copied);
+    return g_string_free(out, FALSE);
+}
+
+// Function to free a placeholder map
+void placeholder_map_free(PlaceholderMap *map) {
+    if (map == NULL) return;
+
+    g_hash_table_destroy(map->numbers);
+    g_ptr_array_unref(map->codes);
+    g_free(map);
+}
@@ -0,0 +1,46 @@
+#ifndef CONTROL_CODES_H
+#define CONTROL_CODES_H
+
+#include <glib.h>
+#include <stdbool.h>
+
+// Control-code placeholders for AI prompts
+// Control codes (e.g. "<|wait 30|>" or "[NAME]") cost several tokens each and the model has to
+// copy them back verbatim. Before sending, every recognised code is swapped for a short
+// numbered placeholder such as "<3>"; the response is checked for the placeholders and the
+// codes are put back. Pattern file format: one regular expression per line;
+// blank lines and lines starting with '#' are ignored.
+typedef struct ControlCodes ControlCodes;
+
+// Codes and placeholders of one request (identical codes share a placeholder)
+typedef struct PlaceholderMap PlaceholderMap;
+
+// Function to load the pattern file; the built-in patterns are used if it is missing
+// Invalid patterns are skipped. Returns NULL if no pattern is usable.
+ControlCodes* control_codes_load(const char *path);
+
+// Function to add and drop references (an instance is shared with worker threads)
+ControlCodes* control_codes_ref(ControlCodes *codes);
+void control_codes_unref(ControlCodes *codes);
+
+// Function to create an empty placeholder map
+PlaceholderMap* placeholder_map_new(void);
+
+// Function to get the number of distinct codes in a map
+guint placeholder_map_size(const PlaceholderMap *map);
+
+// Function to replace the control codes in text with placeholders, adding new codes to map
+// Text that already looks like a placeholder is treated as a code so it survives the round trip.
+char* placeholder_map_compress(PlaceholderMap *map, const ControlCodes *codes, const char *text);
+
+// Function to check that response kept the placeholders of compact_text
+// Every placeholder must appear at least as often as in compact_text, and none may be unknown to map.
+bool placeholder_map_verify(const PlaceholderMap *map, const char *compact_text, const char *response);
+
+// Function to put the codes back in place of their placeholders
+char* placeholder_map_restore(const PlaceholderMap *map, const char *text);
+
+// Function to free a placeholder map
+void placeholder_map_free(PlaceholderMap *map);
+
+#endif /* CONTROL_CODES_H */
@@ -0,0 +1,560 @@
+#include "encoding_detect.h"
+#include <string.h>
+
+// Scores are "good bytes minus twice the bad bytes" over all bytes seen. NUL bytes are neutral
+// (padding and terminators are normal in dumps), so they only dilute every candidate alike.
+#define BAD_PENALTY 2
+
+// Per code unit values of the UTF-16/UTF-32 classification, in bytes of UTF-16 credit
+#define WIDE_GOOD 2
+#define WIDE_HALF 1
+#define WIDE_NEUTRAL 0
+#define WIDE_BAD (-2 * BAD_PENALTY)
+#define WIDE_HIGH_SURROGATE 100
+#define WIDE_LOW_SURROGATE 101
+
+// Multi-byte state machines are tables of transitions; points are tenths of a byte
+#define POINT 10
+#define BAD_POINTS (-BAD_PENALTY * POINT)
+
+// Large inputs are sampled: the first blocks are scored in full, then one block in every stride
+#define SAMPLE_BLOCK 4096
+#define SAMPLE_FULL_BLOCKS 16
+#define SAMPLE_STRIDE 8
+
+// Sixty-four bit mask of the high bit of every byte, for skipping ASCII eight bytes at a time
+#define ASCII_MASK 0x8080808080808080ULL
+
+typedef struct {
+    guint8 next;
+    gint8 points;
+} Transition;
+
+// UTF-8 states, named by sequence length and bytes still expected
+enum {
+    UTF8_ACCEPT,
+    UTF8_2_1,
+    UTF8_3_2, UTF8_3_2_E0, UTF8_3_2_ED, UTF8_3_1,
+    UTF8_4_3, UTF8_4_3_F0, UTF8_4_3_F4, UTF8_4_2, UTF8_4_1,
+    UTF8_STATES
+};
+
+// Shift-JIS states: idle, or after a lead byte of a given kind
+enum {
+    SJIS_IDLE,
+    SJIS_LEAD_KANA,   // 0x81-0x84: punctuation, kana, Greek, Cyrillic
+    SJIS_LEAD_NEC,    // 0x85-0x87: NEC special characters
+    SJIS_LEAD_KANJI,  // 0x88-0x9F, 0xE0-0xEA
+    SJIS_LEAD_VENDOR, // 0xEB-0xFC: vendor and user-defined area
+    SJIS_STATES
+};
+
+// EUC-JP states: idle, after a two-byte lead of a given kind, after 0x8E, or inside 0x8F sequences
+enum {
+    EUC_IDLE,
+    EUC_LEAD_KANA,   // 0xA1, 0xA4, 0xA5: punctuation, kana
+    EUC_LEAD_SYMBOL, // 0xA2-0xA8 otherwise: symbols, Greek, Cyrillic
+    EUC_LEAD_KANJI,  // 0xB0-0xF4
+    EUC_LEAD_OTHER,  // Unassigned rows
+    EUC_HALFWIDTH,
+    EUC_3_2,
+    EUC_3_1,
+    EUC_STATES
+};
+
+// Running UTF-16 and UTF-32 scores, kept in locals while a chunk is fed
+typedef struct {
+    gint64 utf16_score[2];
+    bool utf16_high_pending[2];
+    gint64 utf32_score[2];
+} WideScores;
+
+struct EncodingDetector {
+    guint64 bytes_seen;
+    guint64 total;             // Bytes scored, at most all of bytes_seen
+    bool skipped;              // A block was skipped since the last scored one
+    guint64 histogram[4][256]; // Four interleaved histograms, merged when ranking
+    guint8 head[4];            // First bytes, for the byte order mark
+    guint head_len;
+
+    // Multi-byte state machines and their points so far
+    guint8 utf8_state;
+    guint8 sjis_state;
+    guint8 euc_state;
+    gint64 utf8_points;
+    gint64 sjis_points;
+    gint64 euc_points;
+
+    // UTF-16 and UTF-32 unit scores, little endian first
+    WideScores wide;
+    guint8 carry[4]; // Bytes of an incomplete four-byte group
+    guint carry_len;
+};
+
+// UTF-16 code unit classes, and the byte state machines
+static gint8 wide_class[65536];
+static Transition utf8_table[UTF8_STATES][256];
+static Transition sjis_table[SJIS_STATES][256];
+static Transition euc_table[EUC_STATES][256];
+
+// Tie-break order when scores are equal, e.g. for plain ASCII text
+static const struct {
+    EncodingType encoding;
+    double factor;
+} candidates[ENCODING_DETECT_CANDIDATES] = {
+    { UTF8, 1.0 },
+    { ASCII, 0.99 },
+    { ISO8859_1, 0.98 },
+    { ISO8859_15, 0.97 },
+    { KOI8_R, 0.96 },
+    { SHIFT_JIS, 0.95 },
+    { EUC_JP, 0.94 },
+    { UTF16LE, 0.93 },
+    { UTF16BE, 0.925 },
+    { UTF32LE, 0.92 },
+    { UTF32BE, 0.915 },
+};
+
+// Function to classify a UTF-16 code unit
+static gint8 classify_utf16_unit(guint16 unit) {
+    guint8 high = unit >> 8;
+    guint8 low = unit & 0xFF;
+
+    if (high == 0x00) {
+        if (low == 0x00) return WIDE_NEUTRAL;
+        if (low == '\t' || low == '\n' || low == '\r') return WIDE_GOOD;
+        if (low < 0x20 || (low >= 0x7F && low <= 0x9F)) return WIDE_BAD;
+        return WIDE_GOOD;
+    }
+    if (high <= 0x06) return WIDE_GOOD;                // Latin extended, Greek, Cyrillic, Hebrew, Arabic
+    if (high == 0x0E) return WIDE_GOOD;                // Thai
+    if (high == 0x30) return WIDE_GOOD;                // CJK punctuation, hiragana, katakana
+    if (high >= 0x4E && high <= 0x9F) return WIDE_HALF; // CJK ideographs; ASCII pairs land here too
+    if (high >= 0xAC && high <= 0xD7) return WIDE_GOOD; // Hangul
+    if (high >= 0xD8 && high <= 0xDB) return WIDE_HIGH_SURROGATE;
+    if (high >= 0xDC && high <= 0xDF) return WIDE_LOW_SURROGATE;
+    if (high == 0xFF) return unit >= 0xFFF0 ? WIDE_BAD : WIDE_GOOD; // Half-width and full-width forms
+    return WIDE_NEUTRAL;
+}
+
+// Function to get the UTF-8 transition out of the accepting state
+static Transition utf8_start(guint8 b) {
+    Transition t = { UTF8_ACCEPT, 0 };
+    if (b < 0x80) return t;
+
+    if (b >= 0xC2 && b <= 0xDF) t.next = UTF8_2_1;
+    else if (b == 0xE0) t.next = UTF8_3_2_E0;      // Overlong otherwise
+    else if (b == 0xED) t.next = UTF8_3_2_ED;      // Surrogates otherwise
+    else if (b >= 0xE1 && b <= 0xEF) t.next = UTF8_3_2;
+    else if (b == 0xF0) t.next = UTF8_4_3_F0;      // Overlong otherwise
+    else if (b == 0xF4) t.next = UTF8_4_3_F4;      // Beyond U+10FFFF otherwise
+    else if (b >= 0xF1 && b <= 0xF3) t.next = UTF8_4_3;
+    else t.points = BAD_POINTS;
+    return t;
+}
+
+// Function to get the Shift-JIS transition out of the idle state
+static Transition sjis_start(guint8 b) {
+    Transition t = { SJIS_IDLE, 0 };
+    if (b < 0x80) return t;
+
+    if (b >= 0x81 && b <= 0x84) t.next = SJIS_LEAD_KANA;
+    else if (b >= 0x85 && b <= 0x87) t.next = SJIS_LEAD_NEC;
+    else if ((b >= 0x88 && b <= 0x9F) || (b >= 0xE0 && b <= 0xEA)) t.next = SJIS_LEAD_KANJI;
+    else if (b >= 0xEB && b <= 0xFC) t.next = SJIS_LEAD_VENDOR;
+    else if (b >= 0xA1 && b <= 0xDF) t.points = POINT / 2;  // Half-width katakana
+    else t.points = BAD_POINTS;
+    return t;
+}
+
+// Function to get the EUC-JP transition out of the idle state
+static Transition euc_start(guint8 b) {
+    Transition t = { EUC_IDLE, 0 };
+    if (b < 0x80) return t;
+
+    if (b == 0xA1 || b == 0xA4 || b == 0xA5) t.next = EUC_LEAD_KANA;
+    else if (b >= 0xA2 && b <= 0xA8) t.next = EUC_LEAD_SYMBOL;
+    else if (b >= 0xB0 && b <= 0xF4) t.next = EUC_LEAD_KANJI;
+    else if (b >= 0xA1 && b <= 0xFE) t.next = EUC_LEAD_OTHER;
+    else if (b == 0x8E) t.next = EUC_HALFWIDTH;
+    else if (b == 0x8F) t.next = EUC_3_2;
+    else t.points = BAD_POINTS;
+    return t;
+}
+
+// Function to make a failed transition: the pending lead is bad and the byte starts afresh
+static Transition restart(Transition start) {
+    start.points += BAD_POINTS;
+    return start;
+}
+
+// Function to build the unit classes and state machine tables
+static void init_tables(void) {
+    static gsize initialized = 0;
+    if (!g_once_init_enter(&initialized)) return;
+
+    for (guint unit = 0; unit < 65536; unit++) {
+        wide_class[unit] = classify_utf16_unit(unit);
+    }
+
+    for (guint b = 0; b < 256; b++) {
+        bool continuation = b >= 0x80 && b <= 0xBF;
+        Transition broken = restart(utf8_start(b));
+
+        utf8_table[UTF8_ACCEPT][b] = utf8_start(b);
+        utf8_table[UTF8_2_1][b] = continuation ? (Transition){ UTF8_ACCEPT, 2 * POINT } : broken;
+        utf8_table[UTF8_3_2][b] = continuation ? (Transition){ UTF8_3_1, 0 } : broken;
+        utf8_table[UTF8_3_2_E0][b] = b >= 0xA0 && b <= 0xBF ? (Transition){ UTF8_3_1, 0 } : broken;
+        utf8_table[UTF8_3_2_ED][b] = b >= 0x80 && b <= 0x9F ? (Transition){ UTF8_3_1, 0 } : broken;
+        utf8_table[UTF8_3_1][b] = continuation ? (Transition){ UTF8_ACCEPT, 3 * POINT } : broken;
+        utf8_table[UTF8_4_3][b] = continuation ? (Transition){ UTF8_4_2, 0 } : broken;
+        utf8_table[UTF8_4_3_F0][b] = b >= 0x90 && b <= 0xBF ? (Transition){ UTF8_4_2, 0 } : broken;
+        utf8_table[UTF8_4_3_F4][b] = b >= 0x80 && b <= 0x8F ? (Transition){ UTF8_4_2, 0 } : broken;
+        utf8_table[UTF8_4_2][b] = continuation ? (Transition){ UTF8_4_1, 0 } : broken;
+        utf8_table[UTF8_4_1][b] = continuation ? (Transition){ UTF8_ACCEPT, 4 * POINT } : broken;
+
+        // A Shift-JIS pair is worth twice its weight; an ASCII trail byte was already credited as ASCII
+        static const gint8 sjis_weight[SJIS_STATES] = { 0, 10, 6, 9, 3 };
+        bool trail = (b >= 0x40 && b <= 0x7E) || (b >= 0x80 && b <= 0xFC);
+        sjis_table[SJIS_IDLE][b] = sjis_start(b);
+        for (guint state = SJIS_LEAD_KANA; state < SJIS_STATES; state++) {
+            gint8 points = 2 * sjis_weight[state] - (b < 0x80 ? POINT : 0);
+            sjis_table[state][b] = trail ? (Transition){ SJIS_IDLE, points } : restart(sjis_start(b));
+        }
+
+        static const gint8 euc_weight[EUC_STATES] = { 0, 10, 7, 9, 3 };
+        bool in_range = b >= 0xA1 && b <= 0xFE;
+        Transition euc_broken = restart(euc_start(b));
+        euc_table[EUC_IDLE][b] = euc_start(b);
+        for (guint state = EUC_LEAD_KANA; state <= EUC_LEAD_OTHER; state++) {
+            euc_table[state][b] = in_range ? (Transition){ EUC_IDLE, 2 * euc_weight[state] } : euc_broken;
+        }
+        euc_table[EUC_HALFWIDTH][b] = b >= 0xA1 && b <= 0xDF ? (Transition){ EUC_IDLE, 16 } : euc_broken;
+        euc_table[EUC_3_2][b] = in_range ? (Transition){ EUC_3_1, 0 } : euc_broken;
+        euc_table[EUC_3_1][b] = in_range ? (Transition){ EUC_IDLE, 24 } : euc_broken; // JIS X 0212
+    }
+
+    g_once_init_leave(&initialized, 1);
+}
+
+// Function to score one UTF-16 code unit, pairing surrogates
+static inline void feed_utf16_unit(WideScores *wide, guint order, gint8 value) {
+    if (G_UNLIKELY(value >= WIDE_HIGH_SURROGATE || wide->utf16_high_pending[order])) {
+        bool pending = wide->utf16_high_pending[order];
+        wide->utf16_high_pending[order] = value == WIDE_HIGH_SURROGATE;
+
+        if (value == WIDE_LOW_SURROGATE) {
+            value = pending ? 2 * WIDE_GOOD : WIDE_BAD;
+        } else {
+            if (pending) wide->utf16_score[order] += WIDE_BAD;
+            if (value == WIDE_HIGH_SURROGATE) return;
+        }
+    }
+    wide->utf16_score[order] += value;
+}
+
+// Function to score one UTF-32 code unit from its UTF-16 halves (twice the bytes of a UTF-16 unit)
+static inline gint8 utf32_value(guint16 high_half, gint8 low_class) {
+    if (high_half != 0) return high_half <= 0x10 ? WIDE_NEUTRAL : WIDE_BAD;
+    return low_class >= WIDE_HIGH_SURROGATE ? WIDE_BAD : low_class;
+}
+
+// Function to score a four-byte group as UTF-16 and UTF-32 in both byte orders
+static inline void feed_wide_group(WideScores *wide, const guint8 *p) {
+    guint16 le0 = p[0] | (p[1] << 8);
+    guint16 le1 = p[2] | (p[3] << 8);
+    guint16 be0 = (p[0] << 8) | p[1];
+    guint16 be1 = (p[2] << 8) | p[3];
+    gint8 le0_class = wide_class[le0], le1_class = wide_class[le1];
+    gint8 be0_class = wide_class[be0], be1_class = wide_class[be1];
+
+    feed_utf16_unit(wide, 0, le0_class);
+    feed_utf16_unit(wide, 0, le1_class);
+    feed_utf16_unit(wide, 1, be0_class);
+    feed_utf16_unit(wide, 1, be1_class);
+    wide->utf32_score[0] += 2 * utf32_value(le1, le0_class);
+    wide->utf32_score[1] += 2 * utf32_value(be0, be1_class);
+}
+
+// Function to score data as UTF-16 and UTF-32, carrying an incomplete group to the next chunk
+static void feed_wide(EncodingDetector *detector, const guint8 *data, size_t len) {
+    WideScores wide = detector->wide;
+    size_t i = 0;
+
+    if (detector->carry_len > 0) {
+        while (detector->carry_len < 4 && i < len) {
+            detector->carry[detector->carry_len++] = data[i++];
+        }
+        if (detector->carry_len == 4) {
+            feed_wide_group(&wide, detector->carry);
+            detector->carry_len = 0;
+        }
+    }
+    for (; i + 4 <= len; i += 4) {
+        feed_wide_group(&wide, data + i);
+    }
+    while (i < len) {
+        detector->carry[detector->carry_len++] = data[i++];
+    }
+
+    detector->wide = wide;
+}
+
+// Function to create a detector
+EncodingDetector* encoding_detector_new(void) {
+    init_tables();
+    return g_new0(EncodingDetector, 1);
+}
+
+// Function to forget everything fed so far
+void encoding_detector_reset(EncodingDetector *detector) {
+    memset(detector, 0, sizeof(EncodingDetector));
+}
+
+// Function to get the number of bytes fed since the last reset
+guint64 encoding_detector_bytes_seen(const EncodingDetector *detector) {
+    return detector->bytes_seen;
+}
+
+// Function to score one stretch of a sampled block
+static void feed_sample(EncodingDetector *detector, const guint8 *data, size_t len) {
+    size_t i;
+
+    // Byte histogram, four ways so consecutive equal bytes don't serialise on one counter
+    for (i = 0; i + 4 <= len; i += 4) {
+        detector->histogram[0][data[i]]++;
+        detector->histogram[1][data[i + 1]]++;
+        detector->histogram[2][data[i + 2]]++;
+        detector->histogram[3][data[i + 3]]++;
+    }
+    for (; i < len; i++) {
+        detector->histogram[0][data[i]]++;
+    }
+
+    // UTF-16 and UTF-32 units, aligned to the start of the data
+    feed_wide(detector, data, len);
+
+    // Multi-byte state machines; runs of ASCII between sequences are skipped a word at a time
+    guint utf8_state = detector->utf8_state, sjis_state = detector->sjis_state, euc_state = detector->euc_state;
+    gint64 utf8_points = 0, sjis_points = 0, euc_points = 0;
+
+    i = 0;
+    while (i < len) {
+        if ((utf8_state | sjis_state | euc_state) == 0) {
+            guint64 word;
+            while (i + 8 <= len) {
+                memcpy(&word, data + i, sizeof(word));
+                if (word & ASCII_MASK) break;
+                i += 8;
+            }
+            while (i < len && data[i] < 0x80) i++;
+            if (i >= len) break;
+        }
+
+        guint8 b = data[i++];
+        Transition utf8 = utf8_table[utf8_state][b];
+        Transition sjis = sjis_table[sjis_state][b];
+        Transition euc = euc_table[euc_state][b];
+        utf8_state = utf8.next;
+        sjis_state = sjis.next;
+        euc_state = euc.next;
+        utf8_points += utf8.points;
+        sjis_points += sjis.points;
+        euc_points += euc.points;
+    }
+
+    detector->utf8_state = utf8_state;
+    detector->sjis_state = sjis_state;
+    detector->euc_state = euc_state;
+    detector->utf8_points += utf8_points;
+    detector->sjis_points += sjis_points;
+    detector->euc_points += euc_points;
+    detector->total += len;
+}
+
+// Function to feed the next chunk of data (chunks continue each other)
+void encoding_detector_feed(EncodingDetector *detector, const guint8 *data, size_t len) {
+    for (size_t i = 0; detector->head_len < sizeof(detector->head) && i < len; i++) {
+        detector->head[detector->head_len++] = data[i];
+    }
+
+    // Past the first blocks only every SAMPLE_STRIDE-th block is scored; sequences cut off by a
+    // skipped block are dropped without penalty
+    while (len > 0) {
+        guint64 block = detector->bytes_seen / SAMPLE_BLOCK;
+        size_t span = MIN(len, SAMPLE_BLOCK - detector->bytes_seen % SAMPLE_BLOCK);
+
+        if (block < SAMPLE_FULL_BLOCKS || block % SAMPLE_STRIDE == 0) {
+            if (detector->skipped) {
+                detector->utf8_state = UTF8_ACCEPT;
+                detector->sjis_state = SJIS_IDLE;
+                detector->euc_state = EUC_IDLE;
+                detector->wide.utf16_high_pending[0] = false;
+                detector->wide.utf16_high_pending[1] = false;
+                detector->skipped = false;
+            }
+            feed_sample(detector, data, span);
+        } else {
+            detector->skipped = true;
+        }
+
+        detector->bytes_seen += span;
+        data += span;
+        len -= span;
+    }
+}
+
+// Function to weigh a high byte as ISO-8859-1 or ISO-8859-15 text
+static double latin_weight(guint8 b, bool latin9) {
+    // Accented letters common in western European languages
+    static const guint8 common[] = {
+        0xE9, 0xE0, 0xE8, 0xFC, 0xF6, 0xE4, 0xE7, 0xE1, 0xED, 0xF3, 0xF1,
+        0xDF, 0xEA, 0xFA, 0xE3, 0xF5, 0xE5, 0xF8, 0xE6, 0xE2, 0xF4, 0xEE,
+    };
+
+    if (memchr(common, b, sizeof(common)) != NULL) return 1.0;
+
+    switch (b) {
+        case 0xA4: return latin9 ? 0.8 : 0.1;                 // Euro sign or currency sign
+        case 0xA6: case 0xA8: case 0xB4: case 0xB8:
+        case 0xBC: case 0xBD: case 0xBE: return latin9 ? 0.7 : 0.2;
+        case 0xD7: case 0xF7: return 0.1;                     // Multiplication and division signs
+        default: break;
+    }
+
+    if (b >= 0xE0) return 0.6;  // Other lowercase letters
+    if (b >= 0xC0) return 0.4;  // Uppercase letters
+    if (b >= 0xA0) return 0.3;  // Symbols
+    return 0;                   // C1 controls, counted as bad
+}
+
+// Function to weigh a high byte as KOI8-R text
+static double koi8_weight(guint8 b) {
+    // Most frequent Russian letters (о е а и н т с р в л)
+    static const guint8 common[] = { 0xCF, 0xC5, 0xC1, 0xC9, 0xCE, 0xD4, 0xD3, 0xD2, 0xD7, 0xCC };
+
+    if (memchr(common, b, sizeof(common)) != NULL) return 1.0;
+    if (b == 0xA3 || b == 0xB3) return 1.0;  // ё and Ё
+    if (b >= 0xE0) return 0.5;               // Uppercase letters
+    if (b >= 0xC0) return 0.8;               // Lowercase letters
+    return 0.1;                              // Box drawing and symbols
+}
+
+// Function to find the encoding named by a byte order mark, or HEX for none
+static EncodingType byte_order_mark(const EncodingDetector *detector) {
+    const guint8 *h = detector->head;
+    guint n = detector->head_len;
+
+    if (n >= 3 && h[0] == 0xEF && h[1] == 0xBB && h[2] == 0xBF) return UTF8;
+    if (n >= 4 && h[0] == 0xFF && h[1] == 0xFE && h[2] == 0x00 && h[3] == 0x00) return UTF32LE;
+    if (n >= 4 && h[0] == 0x00 && h[1] == 0x00 && h[2] == 0xFE && h[3] == 0xFF) return UTF32BE;
+    if (n >= 2 && h[0] == 0xFF && h[1] == 0xFE) return UTF16LE;
+    if (n >= 2 && h[0] == 0xFE && h[1] == 0xFF) return UTF16BE;
+    return HEX;
+}
+
+static int compare_scores(const void *a, const void *b) {
+    double x = ((const EncodingScore *)a)->score;
+    double y = ((const EncodingScore *)b)->score;
+    return (x < y) - (x > y);
+}
+
+// Function to rank the candidates best first; fills up to max_scores entries and returns the count
+guint encoding_detector_rank(const EncodingDetector *detector, EncodingScore *scores, guint max_scores) {
+    EncodingScore all[ENCODING_DETECT_CANDIDATES];
+    guint64 histogram[256];
+
+    for (guint b = 0; b < 256; b++) {
+        histogram[b] = detector->histogram[0][b] + detector->histogram[1][b] +
+                       detector->histogram[2][b] + detector->histogram[3][b];
+    }
+
+    // Byte classes shared by every ASCII-compatible encoding
+    double ascii_good = histogram['\t'] + histogram['\n'] + histogram['\r'];
+    double controls = histogram[0x7F];
+    double high = 0, c1 = 0, latin1 = 0, latin9 = 0, koi8 = 0;
+    for (guint b = 0x01; b < 0x20; b++) {
+        if (b != '\t' && b != '\n' && b != '\r') controls += histogram[b];
+    }
+    for (guint b = 0x20; b < 0x7F; b++) {
+        ascii_good += histogram[b];
+    }
+    for (guint b = 0x80; b < 0x100; b++) {
+        if (histogram[b] == 0) continue;
+        high += histogram[b];
+        if (b < 0xA0) c1 += histogram[b];
+        latin1 += histogram[b] * latin_weight(b, false);
+        latin9 += histogram[b] * latin_weight(b, true);
+        koi8 += histogram[b] * koi8_weight(b);
+    }
+
+    // Pending half sequences at the end are ignored: the data may still be growing
+    double total = detector->total > 0 ? (double)detector->total : 1;
+    for (guint i = 0; i < ENCODING_DETECT_CANDIDATES; i++) {
+        double points = 0;
+        switch (candidates[i].encoding) {
+            case UTF8:
+                points = ascii_good + (double)detector->utf8_points / POINT - BAD_PENALTY * controls;
+                break;
+            case ASCII:
+                points = ascii_good - BAD_PENALTY * (controls + high);
+                break;
+            case ISO8859_1:
+                points = ascii_good + latin1 - BAD_PENALTY * (controls + c1);
+                break;
+            case ISO8859_15:
+                points = ascii_good + latin9 - BAD_PENALTY * (controls + c1);
+                break;
+            case KOI8_R:
+                points = ascii_good + koi8 - BAD_PENALTY * controls;
+                break;
+            case SHIFT_JIS:
+                points = ascii_good + (double)detector->sjis_points / POINT - BAD_PENALTY * controls;
+                break;
+            case EUC_JP:
+                points = ascii_good + (double)detector->euc_points / POINT - BAD_PENALTY * controls;
+                break;
+            case UTF16LE:
+            case UTF16BE:
+                points = detector->wide.utf16_score[candidates[i].encoding == UTF16BE];
+                break;
+            case UTF32LE:
+            case UTF32BE:
+                points = detector->wide.utf32_score[candidates[i].encoding == UTF32BE];
+                break;
+            default:
+                break;
+        }
+
+        double score = CLAMP(points / total, 0.0, 1.0);
+        all[i].encoding = candidates[i].encoding;
+        all[i].score = detector->total > 0 ? score * candidates[i].factor : 0;
+    }
+
+    // A byte order mark settles it
+    EncodingType bom = byte_order_mark(detector);
+    if (bom != HEX) {
+        for (guint i = 0; i < ENCODING_DETECT_CANDIDATES; i++) {
+            all[i].score = all[i].encoding == bom ? 1.0 : all[i].score * 0.9;
+        }
+    }
+
+    qsort(all, ENCODING_DETECT_CANDIDATES, sizeof(EncodingScore), compare_scores);
+
+    guint count = MIN(max_scores, ENCODING_DETECT_CANDIDATES);
+    memcpy(scores, all, count * sizeof(EncodingScore));
+    return count;
+}
+
+// Function to get the best candidate and its score (score may be NULL)
+EncodingType encoding_detector_best(const EncodingDetector *detector, double *score) {
+    EncodingScore best;
+    encoding_detector_rank(detector, &best, 1);
+    if (score != NULL) *score = best.score;
+    return best.encoding;
+}
+
+// Function to free a detector
+void encoding_detector_free(EncodingDetector *detector) {
+    g_free(detector);
+}
@@ -0,0 +1,42 @@
+#ifndef ENCODING_DETECT_H
+#define ENCODING_DETECT_H
+
+#include <glib.h>
+#include <stddef.h>
+#include "common.h"
+
+// Number of text encodings the detector ranks (every one but TABLE_FILE; no byte formats)
+#define ENCODING_DETECT_CANDIDATES 11
+
+// How well the data reads as one encoding, from 0 (not at all) to 1
+typedef struct {
+    EncodingType encoding;
+    double score;
+} EncodingScore;
+
+// Streaming encoding detector
+// Byte statistics are kept incrementally, so data that grows only has its new tail fed.
+typedef struct EncodingDetector EncodingDetector;
+
+// Function to create a detector
+EncodingDetector* encoding_detector_new(void);
+
+// Function to feed the next chunk of data (chunks continue each other)
+void encoding_detector_feed(EncodingDetector *detector, const guint8 *data, size_t len);
+
+// Function to forget everything fed so far
+void encoding_detector_reset(EncodingDetector *detector);
+
+// Function to get the number of bytes fed since the last reset
+guint64 encoding_detector_bytes_seen(const EncodingDetector *detector);
+
+// Function to rank the candidates best first; fills up to max_scores entries and returns the count
+guint encoding_detector_rank(const EncodingDetector *detector, EncodingScore *scores, guint max_scores);
+
+// Function to get the best candidate and its score (score may be NULL)
+EncodingType encoding_detector_best(const EncodingDetector *detector, double *score);
+
+// Function to free a detector
+void encoding_detector_free(EncodingDetector *detector);
+
+#endif /* ENCODING_DETECT_H */
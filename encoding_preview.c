@@ -0,0 +1,307 @@
+#include "encoding_preview.h"
+#include "text_decoder.h"
+#include <stdio.h>
+#include <string.h>
+
+// Delay before decoding, so typing doesn't queue a decode per key
+#define PREVIEW_DELAY_MS 150
+// Bytes decoded at most; beyond that the preview covers the start of the data
+#define PREVIEW_MAX_BYTES (4 * 1024 * 1024)
+// Characters shown per encoding
+#define PREVIEW_CHARS 160
+// Encodings shown: every text encoding, not HEX or the other byte formats (the table row is
+// unavailable until one is loaded)
+#define PREVIEW_FIRST ASCII
+#define PREVIEW_LAST TABLE_FILE
+
+// Panel state, owned by the preview box
+typedef struct {
+    GtkDropDown *target_dropdown;
+    GtkWidget *list;
+    GtkWidget *status_label;
+    GtkWidget *rows[PREVIEW_LAST + 1];
+    gint generation;    // Bumped for every decode; workers drop stale ones
+    guint source_id;    // Pending debounce timeout, or 0
+    GBytes *pending;    // Data waiting for the timeout, or NULL
+} PreviewState;
+
+// One decode of the data into every encoding
+typedef struct {
+    GtkWidget *preview_box;
+    PreviewState *state;
+    gint generation;
+    gint remaining;     // Encodings still being decoded
+    gint64 started;
+    GBytes *bytes;      // Reference to the data, which may be longer than len
+    const guint8 *data;
+    size_t len;
+    size_t total_len;
+    char *snippets[PREVIEW_LAST + 1];
+    size_t invalid[PREVIEW_LAST + 1];
+    bool failed[PREVIEW_LAST + 1];
+} PreviewJob;
+
+typedef struct {
+    PreviewJob *job;
+    EncodingType encoding;
+} PreviewTask;
+
+static GThreadPool *preview_pool = NULL;
+
+static void preview_state_free(gpointer data) {
+    PreviewState *state = data;
+    if (state->source_id != 0) g_source_remove(state->source_id);
+    if (state->pending != NULL) g_bytes_unref(state->pending);
+    g_free(state);
+}
+
+static void preview_job_free(PreviewJob *job) {
+    for (guint i = PREVIEW_FIRST; i <= PREVIEW_LAST; i++) {
+        g_free(job->snippets[i]);
+    }
+    g_bytes_unref(job->bytes);
+    g_object_unref(job->preview_box);
+    g_free(job);
+}
+
+// Function to cut decoded text down to one line for a row
+static char* make_snippet(const char *text) {
+    GString *snippet = g_string_new(NULL);
+    guint chars = 0;
+
+    for (const char *p = text; *p != '\0' && chars < PREVIEW_CHARS; p = g_utf8_next_char(p), chars++) {
+        gunichar ch = g_utf8_get_char(p);
+        if (ch == '\n') {
+            g_string_append(snippet, "⏎");
+        } else if (ch == '\r' || ch == '\t') {
+            g_string_append_c(snippet, ' ');
+        } else if (ch < 0x20 || (ch >= 0x7F && ch <= 0x9F)) {
+            g_string_append(snippet, "·"); // Other controls would not render
+        } else {
+            g_string_append_unichar(snippet, ch);
+        }
+    }
+
+    return g_string_free(snippet, FALSE);
+}
+
+// Function to show the results of a finished decode (main thread)
+static gboolean show_preview_results(gpointer user_data) {
+    PreviewJob *job = user_data;
+    PreviewState *state = job->state;
+
+    // A newer decode has started; its results will follow
+    if (job->generation != g_atomic_int_get(&state->generation)) {
+        preview_job_free(job);
+        return G_SOURCE_REMOVE;
+    }
+
+    for (guint i = PREVIEW_FIRST; i <= PREVIEW_LAST; i++) {
+        GtkWidget *row = state->rows[i];
+        GtkWidget *invalid_label = g_object_get_data(G_OBJECT(row), "invalid_label");
+        GtkWidget *text_label = g_object_get_data(G_OBJECT(row), "text_label");
+
+        char invalid_text[48];
+        if (job->failed[i]) {
+            snprintf(invalid_text, sizeof(invalid_text), "unavailable");
+        } else {
+            snprintf(invalid_text, sizeof(invalid_text), "%zu invalid", job->invalid[i]);
+        }
+        gtk_label_set_text(GTK_LABEL(invalid_label), invalid_text);
+        gtk_label_set_text(GTK_LABEL(text_label), job->snippets[i] != NULL ? job->snippets[i] : "");
+
+        // Sort key: fewest invalid sequences first
+        g_object_set_data(G_OBJECT(row), "invalid_count",
+                          GSIZE_TO_POINTER(job->failed[i] ? G_MAXSIZE : job->invalid[i]));
+    }
+    gtk_list_box_invalidate_sort(GTK_LIST_BOX(state->list));
+
+    char status[128];
+    double elapsed_ms = (g_get_monotonic_time() - job->started) / 1000.0;
+    if (job->len < job->total_len) {
+        snprintf(status, sizeof(status), "First %zu of %zu bytes decoded in %.1f ms",
+                 job->len, job->total_len, elapsed_ms);
+    } else {
+        snprintf(status, sizeof(status), "%zu bytes decoded in %.1f ms", job->len, elapsed_ms);
+    }
+    gtk_label_set_text(GTK_LABEL(state->status_label), status);
+
+    preview_job_free(job);
+    return G_SOURCE_REMOVE;
+}
+
+// Thread pool worker: decode the data in one encoding
+static void decode_preview(gpointer data, gpointer user_data) {
+    PreviewTask *task = data;
+    PreviewJob *job = task->job;
+
+    // Skip the work if the data has changed since
+    if (job->generation == g_atomic_int_get(&job->state->generation)) {
+        size_t invalid = 0;
+        char *text = text_decoder_decode(job->data, job->len, task->encoding, &invalid);
+        if (text != NULL) {
+            job->snippets[task->encoding] = make_snippet(text);
+            job->invalid[task->encoding] = invalid;
+            g_free(text);
+        } else {
+            job->failed[task->encoding] = true;
+        }
+    }
+
+    if (g_atomic_int_dec_and_test(&job->remaining)) {
+        g_idle_add(show_preview_results, job);
+    }
+    g_free(task);
+}
+
+// Function to start decoding the pending data (debounce timeout)
+static gboolean start_preview_decode(gpointer user_data) {
+    GtkWidget *preview_box = user_data;
+    PreviewState *state = g_object_get_data(G_OBJECT(preview_box), "preview_state");
+    state->source_id = 0;
+
+    if (preview_pool == NULL) {
+        GError *error = NULL;
+        preview_pool = g_thread_pool_new(decode_preview, NULL, (gint)g_get_num_processors(), FALSE, &error);
+        if (preview_pool == NULL) {
+            fprintf(stderr, "ERROR: Failed to create the preview worker pool: %s\n", error->message);
+            g_error_free(error);
+            return G_SOURCE_REMOVE;
+        }
+    }
+
+    PreviewJob *job = g_new0(PreviewJob, 1);
+    job->preview_box = g_object_ref(preview_box);
+    job->state = state;
+    job->generation = g_atomic_int_add(&state->generation, 1) + 1;
+    job->remaining = PREVIEW_LAST - PREVIEW_FIRST + 1;
+    job->started = g_get_monotonic_time();
+    job->bytes = state->pending;
+    state->pending = NULL;
+    gsize total_len = 0;
+    job->data = g_bytes_get_data(job->bytes, &total_len);
+    job->total_len = total_len;
+    job->len = MIN(total_len, PREVIEW_MAX_BYTES);
+
+    gtk_label_set_text(GTK_LABEL(state->status_label), "Decoding…");
+
+    for (guint i = PREVIEW_FIRST; i <= PREVIEW_LAST; i++) {
+        PreviewTask *task = g_new(PreviewTask, 1);
+        task->job = job;
+        task->encoding = (EncodingType)i;
+        g_thread_pool_push(preview_pool, task, NULL);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+// Function to decode data into every text encoding on the worker pool and show the results
+void update_encoding_preview(GtkWidget *preview_box, GBytes *bytes) {
+    if (preview_box == NULL) return;
+    PreviewState *state = g_object_get_data(G_OBJECT(preview_box), "preview_state");
+    if (state == NULL) return;
+
+    if (state->pending != NULL) g_bytes_unref(state->pending);
+    state->pending = bytes != NULL && g_bytes_get_size(bytes) > 0 ? g_bytes_ref(bytes) : NULL;
+
+    if (state->pending == NULL) {
+        // Nothing to decode: drop any decode in flight and clear the rows
+        if (state->source_id != 0) {
+            g_source_remove(state->source_id);
+            state->source_id = 0;
+        }
+        g_atomic_int_inc(&state->generation);
+        for (guint i = PREVIEW_FIRST; i <= PREVIEW_LAST; i++) {
+            gtk_label_set_text(GTK_LABEL(g_object_get_data(G_OBJECT(state->rows[i]), "invalid_label")), "");
+            gtk_label_set_text(GTK_LABEL(g_object_get_data(G_OBJECT(state->rows[i]), "text_label")), "");
+        }
+        gtk_label_set_text(GTK_LABEL(state->status_label), "No data");
+        return;
+    }
+
+    if (state->source_id == 0) {
+        state->source_id = g_timeout_add_full(G_PRIORITY_DEFAULT_IDLE, PREVIEW_DELAY_MS,
+                                              start_preview_decode, g_object_ref(preview_box),
+                                              g_object_unref);
+    }
+}
+
+// Sort rows by invalid count, then in dropdown order
+static int compare_preview_rows(GtkListBoxRow *a, GtkListBoxRow *b, gpointer user_data) {
+    gsize invalid_a = GPOINTER_TO_SIZE(g_object_get_data(G_OBJECT(a), "invalid_count"));
+    gsize invalid_b = GPOINTER_TO_SIZE(g_object_get_data(G_OBJECT(b), "invalid_count"));
+    if (invalid_a != invalid_b) return invalid_a < invalid_b ? -1 : 1;
+
+    guint encoding_a = GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(a), "encoding"));
+    guint encoding_b = GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(b), "encoding"));
+    return (encoding_a > encoding_b) - (encoding_a < encoding_b);
+}
+
+// Callback for clicking a row: show that encoding in the bottom view
+static void on_preview_row_activated(GtkListBox *list, GtkListBoxRow *row, gpointer user_data) {
+    PreviewState *state = user_data;
+    guint encoding = GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(row), "encoding"));
+    gtk_drop_down_set_selected(state->target_dropdown, encoding);
+}
+
+// Function to create the preview panel; clicking an encoding selects it in target_dropdown
+GtkWidget* create_encoding_preview_ui(GtkDropDown *target_dropdown) {
+    PreviewState *state = g_new0(PreviewState, 1);
+    state->target_dropdown = target_dropdown;
+
+    GtkWidget *main_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+
+    GtkWidget *title_label = gtk_label_new("Encoding preview");
+    gtk_widget_set_halign(title_label, GTK_ALIGN_START);
+
+    state->status_label = gtk_label_new("No data");
+    gtk_widget_add_css_class(state->status_label, "dim-label");
+    gtk_widget_set_halign(state->status_label, GTK_ALIGN_START);
+
+    state->list = gtk_list_box_new();
+    gtk_list_box_set_selection_mode(GTK_LIST_BOX(state->list), GTK_SELECTION_NONE);
+    gtk_list_box_set_sort_func(GTK_LIST_BOX(state->list), compare_preview_rows, NULL, NULL);
+    g_signal_connect(state->list, "row-activated", G_CALLBACK(on_preview_row_activated), state);
+
+    for (guint i = PREVIEW_FIRST; i <= PREVIEW_LAST; i++) {
+        GtkWidget *row_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+
+        GtkWidget *name_label = gtk_label_new(encoding_type_to_string((EncodingType)i));
+        gtk_label_set_width_chars(GTK_LABEL(name_label), 11);
+        gtk_label_set_xalign(GTK_LABEL(name_label), 0);
+
+        GtkWidget *invalid_label = gtk_label_new("");
+        gtk_label_set_width_chars(GTK_LABEL(invalid_label), 14);
+        gtk_label_set_xalign(GTK_LABEL(invalid_label), 1);
+        gtk_widget_add_css_class(invalid_label, "dim-label");
+
+        GtkWidget *text_label = gtk_label_new("");
+        gtk_label_set_xalign(GTK_LABEL(text_label), 0);
+        gtk_label_set_single_line_mode(GTK_LABEL(text_label), TRUE);
+        gtk_label_set_ellipsize(GTK_LABEL(text_label), PANGO_ELLIPSIZE_END);
+        gtk_widget_set_hexpand(text_label, TRUE);
+
+        gtk_box_append(GTK_BOX(row_box), name_label);
+        gtk_box_append(GTK_BOX(row_box), invalid_label);
+        gtk_box_append(GTK_BOX(row_box), text_label);
+
+        GtkWidget *row = gtk_list_box_row_new();
+        gtk_list_box_row_set_child(GTK_LIST_BOX_ROW(row), row_box);
+        g_object_set_data(G_OBJECT(row), "encoding", GUINT_TO_POINTER(i));
+        g_object_set_data(G_OBJECT(row), "invalid_label", invalid_label);
+        g_object_set_data(G_OBJECT(row), "text_label", text_label);
+        gtk_list_box_append(GTK_LIST_BOX(state->list), row);
+        state->rows[i] = row;
+    }
+
+    GtkWidget *scroll = gtk_scrolled_window_new();
+    gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scroll), state->list);
+    gtk_widget_set_vexpand(scroll, TRUE);
+
+    gtk_box_append(GTK_BOX(main_box), title_label);
+    gtk_box_append(GTK_BOX(main_box), state->status_label);
+    gtk_box_append(GTK_BOX(main_box), scroll);
+
+    g_object_set_data_full(G_OBJECT(main_box), "preview_state", state, preview_state_free);
+    return main_box;
+}
@@ -0,0 +1,16 @@
+#ifndef ENCODING_PREVIEW_H
+#define ENCODING_PREVIEW_H
+
+#include <gtk/gtk.h>
+#include <stddef.h>
+#include "common.h"
+
+// Function to create the preview panel; clicking an encoding selects it in target_dropdown
+GtkWidget* create_encoding_preview_ui(GtkDropDown *target_dropdown);
+
+// Function to decode data into every text encoding on the worker pool and show the results
+// A reference to bytes (may be NULL) is kept until the decode; edits in quick succession only
+// decode the last one.
+void update_encoding_preview(GtkWidget *preview_box, GBytes *bytes);
+
+#endif /* ENCODING_PREVIEW_H */
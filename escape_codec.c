@@ -0,0 +1,403 @@
+#include "escape_codec.h"
+#include <string.h>
+
+static const char upper_hex[] = "0123456789ABCDEF";
+static const char lower_hex[] = "0123456789abcdef";
+
+// Bytes written as they are in each format; the rest are escaped
+static guint8 c_plain[256];
+static guint8 json_plain[256];
+static guint8 url_plain[256];
+
+static void init_tables(void) {
+    static gsize initialized = 0;
+    if (g_once_init_enter(&initialized)) {
+        for (int c = 0x20; c < 0x7F; c++) {
+            c_plain[c] = c != '"' && c != '\\';
+            json_plain[c] = c != '"' && c != '\\';
+            url_plain[c] = g_ascii_isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~';
+        }
+        g_once_init_leave(&initialized, 1);
+    }
+}
+
+// Function to check whether an encoding is one of these formats
+bool escape_codec_handles(EncodingType format) {
+    return format == C_STRING || format == JSON_STRING || format == URL_ENCODED;
+}
+
+// Word-at-a-time tests over eight bytes: whether any byte is below n (n <= 0x80), or equals c
+#define ONES 0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+
+static inline guint64 any_below(guint64 x, guint8 n) {
+    return (x - ONES * n) & ~x & HIGHS;
+}
+
+static inline guint64 any_equal(guint64 x, guint8 c) {
+    guint64 y = x ^ (ONES * c);
+    return (y - ONES) & ~y & HIGHS;
+}
+
+// Function to find the end of the run of bytes from i that C or JSON writes as they are
+// Eight bytes are checked at once for a control character, a quote, a backslash, or a byte
+// past ASCII; the byte that ends the run is then found in the last word.
+static size_t plain_run_end(const guint8 *data, size_t i, size_t len, const guint8 *plain) {
+    while (i + 8 <= len) {
+        guint64 x;
+        memcpy(&x, data + i, 8);
+        if ((any_below(x, 0x20) | (x & HIGHS) | any_equal(x, '"') | any_equal(x, '\\') | any_equal(x, 0x7F)) != 0) break;
+        i += 8;
+    }
+    while (i < len && plain[data[i]]) i++;
+    return i;
+}
+
+// Function to write one byte as a C escape; returns whether it was written \xHH
+static bool append_c_escape(GString *out, guint8 byte) {
+    switch (byte) {
+        case '\n': g_string_append(out, "\\n"); return false;
+        case '\r': g_string_append(out, "\\r"); return false;
+        case '\t': g_string_append(out, "\\t"); return false;
+        case '"': g_string_append(out, "\\\""); return false;
+        case '\\': g_string_append(out, "\\\\"); return false;
+        default: {
+            char escape[4] = { '\\', 'x', upper_hex[byte >> 4], upper_hex[byte & 0xF] };
+            g_string_append_len(out, escape, 4);
+            return true;
+        }
+    }
+}
+
+static char* encode_c(const guint8 *data, size_t len) {
+    GString *out = g_string_sized_new(len + len / 4 + 1);
+    bool after_hex = false;
+    size_t i = 0;
+    while (i < len) {
+        // A hex digit right after \xHH would read as part of it, so it is escaped too
+        size_t run_end = after_hex && g_ascii_isxdigit(data[i]) ? i : plain_run_end(data, i, len, c_plain);
+        if (run_end > i) {
+            g_string_append_len(out, (const char *)data + i, (gssize)(run_end - i));
+            i = run_end;
+            after_hex = false;
+        } else {
+            after_hex = append_c_escape(out, data[i++]);
+        }
+    }
+    return g_string_free(out, FALSE);
+}
+
+static void append_json_unit(GString *out, guint32 unit) {
+    char escape[6] = { '\\', 'u', lower_hex[(unit >> 12) & 0xF], lower_hex[(unit >> 8) & 0xF],
+                       lower_hex[(unit >> 4) & 0xF], lower_hex[unit & 0xF] };
+    g_string_append_len(out, escape, 6);
+}
+
+static char* encode_json(const guint8 *data, size_t len) {
+    GString *out = g_string_sized_new(len + len / 4 + 1);
+    size_t i = 0;
+    while (i < len) {
+        size_t run_end = plain_run_end(data, i, len, json_plain);
+        g_string_append_len(out, (const char *)data + i, (gssize)(run_end - i));
+        i = run_end;
+        if (i == len) break;
+
+        guint8 byte = data[i];
+        if (byte == 0x7F) {
+            // JSON allows DEL as it is
+            g_string_append_c(out, (char)byte);
+            i++;
+        } else if (byte < 0x80) {
+            switch (byte) {
+                case '"': g_string_append(out, "\\\""); break;
+                case '\\': g_string_append(out, "\\\\"); break;
+                case '\b': g_string_append(out, "\\b"); break;
+                case '\f': g_string_append(out, "\\f"); break;
+                case '\n': g_string_append(out, "\\n"); break;
+                case '\r': g_string_append(out, "\\r"); break;
+                case '\t': g_string_append(out, "\\t"); break;
+                default: append_json_unit(out, byte); break;
+            }
+            i++;
+        } else {
+            gunichar ch = g_utf8_get_char_validated((const char *)data + i, (gssize)(len - i));
+            if (ch == (gunichar)-1 || ch == (gunichar)-2) {
+                // A byte that isn't UTF-8 is written as the Latin-1 character of that value
+                append_json_unit(out, byte);
+                i++;
+                continue;
+            }
+            if (ch >= 0x10000) {
+                append_json_unit(out, 0xD800 + ((ch - 0x10000) >> 10));
+                append_json_unit(out, 0xDC00 + ((ch - 0x10000) & 0x3FF));
+            } else {
+                append_json_unit(out, ch);
+            }
+            i = (size_t)(g_utf8_next_char((const char *)data + i) - (const char *)data);
+        }
+    }
+    return g_string_free(out, FALSE);
+}
+
+static char* encode_url(const guint8 *data, size_t len) {
+    GString *out = g_string_sized_new(len + len / 2 + 1);
+    size_t i = 0;
+    while (i < len) {
+        size_t run_end = i;
+        while (run_end < len && url_plain[data[run_end]]) run_end++;
+        g_string_append_len(out, (const char *)data + i, (gssize)(run_end - i));
+        i = run_end;
+        if (i == len) break;
+
+        char escape[3] = { '%', upper_hex[data[i] >> 4], upper_hex[data[i] & 0xF] };
+        g_string_append_len(out, escape, 3);
+        i++;
+    }
+    return g_string_free(out, FALSE);
+}
+
+// Function to write bytes as escaped text
+char* escape_codec_encode(const guint8 *data, size_t len, EncodingType format) {
+    init_tables();
+    switch (format) {
+        case C_STRING: return encode_c(data, len);
+        case JSON_STRING: return encode_json(data, len);
+        case URL_ENCODED: return encode_url(data, len);
+        default: return NULL;
+    }
+}
+
+// Function to read exactly count hex digits at text[*pos]
+static bool read_hex_digits(const char *text, size_t len, size_t *pos, guint count, guint32 *value) {
+    if (len - *pos < count) return false;
+    guint32 v = 0;
+    for (guint k = 0; k < count; k++) {
+        int digit = g_ascii_xdigit_value(text[*pos + k]);
+        if (digit < 0) return false;
+        v = v << 4 | (guint32)digit;
+    }
+    *pos += count;
+    *value = v;
+    return true;
+}
+
+// Function to write a code point as UTF-8; false for surrogates and values past U+10FFFF
+static bool put_code_point(guint32 ch, guint8 *out, size_t *n) {
+    if (ch > 0x10FFFF || (ch >= 0xD800 && ch <= 0xDFFF)) return false;
+    *n += (size_t)g_unichar_to_utf8(ch, (char *)out + *n);
+    return true;
+}
+
+// Function to resolve the C escape whose backslash is at text[*pos]
+static bool decode_c_escape(const char *text, size_t len, size_t *pos, guint8 *out, size_t *n) {
+    size_t i = *pos + 1;
+    if (i >= len) return false;
+
+    char c = text[i++];
+    guint8 byte;
+    switch (c) {
+        case 'a': byte = '\a'; break;
+        case 'b': byte = '\b'; break;
+        case 'f': byte = '\f'; break;
+        case 'n': byte = '\n'; break;
+        case 'r': byte = '\r'; break;
+        case 't': byte = '\t'; break;
+        case 'v': byte = '\v'; break;
+        case 'e': byte = 0x1B; break;
+        case '\\': case '\'': case '"': case '?': byte = (guint8)c; break;
+
+        case 'x': {
+            // Dumps write each byte as two digits, so no more are taken
+            guint digits = 0, value = 0;
+            while (digits < 2 && i < len && g_ascii_isxdigit(text[i])) {
+                value = value << 4 | (guint)g_ascii_xdigit_value(text[i++]);
+                digits++;
+            }
+            if (digits == 0) return false;
+            byte = (guint8)value;
+            break;
+        }
+
+        case 'u':
+        case 'U': {
+            guint32 ch;
+            if (!read_hex_digits(text, len, &i, c == 'u' ? 4 : 8, &ch) || !put_code_point(ch, out, n)) return false;
+            *pos = i;
+            return true;
+        }
+
+        default: {
+            if (c < '0' || c > '7') return false;
+            guint value = (guint)(c - '0');
+            for (guint digits = 1; digits < 3 && i < len && text[i] >= '0' && text[i] <= '7'; digits++) {
+                value = value << 3 | (guint)(text[i++] - '0');
+            }
+            if (value > 0xFF) return false;
+            byte = (guint8)value;
+            break;
+        }
+    }
+
+    out[(*n)++] = byte;
+    *pos = i;
+    return true;
+}
+
+// Function to find where the next of two characters is at or after i, or len
+// The last places found are kept in next_a and next_b (G_MAXSIZE before the first search) and
+// only searched again once passed, so each is looked for with memchr over the text once in all.
+static size_t find_either(const char *text, size_t i, size_t len, char a, char b, size_t *next_a, size_t *next_b) {
+    if (*next_a < i || *next_a == G_MAXSIZE) {
+        const char *found = memchr(text + i, a, len - i);
+        *next_a = found != NULL ? (size_t)(found - text) : len;
+    }
+    if (*next_b < i || *next_b == G_MAXSIZE) {
+        const char *found = memchr(text + i, b, len - i);
+        *next_b = found != NULL ? (size_t)(found - text) : len;
+    }
+    return MIN(*next_a, *next_b);
+}
+
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+// Function to resolve C escapes; runs without a backslash are copied as they are
+static bool decode_c(const char *text, size_t len, guint8 *out, size_t *n) {
+    size_t i = 0;
+    while (i < len && is_space(text[i])) i++;
+
+    if (i == len || text[i] != '"') {
+        // The inside of a literal
+        i = 0;
+        while (i < len) {
+            const char *backslash = memchr(text + i, '\\', len - i);
+            size_t run_end = backslash != NULL ? (size_t)(backslash - text) : len;
+            memcpy(out + *n, text + i, run_end - i);
+            *n += run_end - i;
+            i = run_end;
+            if (i < len && !decode_c_escape(text, len, &i, out, n)) return false;
+        }
+        return true;
+    }
+
+    // String literals, with only whitespace between them
+    size_t next_quote = G_MAXSIZE, next_backslash = G_MAXSIZE;
+    while (i < len) {
+        if (is_space(text[i])) {
+            i++;
+            continue;
+        }
+        if (text[i++] != '"') return false;
+
+        while (true) {
+            size_t run_end = find_either(text, i, len, '"', '\\', &next_quote, &next_backslash);
+            if (run_end == len) return false;
+            memcpy(out + *n, text + i, run_end - i);
+            *n += run_end - i;
+            i = run_end;
+            if (text[i] == '"') {
+                i++;
+                break;
+            }
+            if (!decode_c_escape(text, len, &i, out, n)) return false;
+        }
+    }
+    return true;
+}
+
+// Function to resolve JSON escapes, inside quotes or not
+static bool decode_json(const char *text, size_t len, guint8 *out, size_t *n) {
+    size_t start = 0, end = len;
+    while (start < end && is_space(text[start])) start++;
+    while (end > start && is_space(text[end - 1])) end--;
+    if (end - start >= 2 && text[start] == '"' && text[end - 1] == '"') {
+        text += start + 1;
+        len = end - start - 2;
+    }
+
+    size_t i = 0;
+    while (i < len) {
+        const char *backslash = memchr(text + i, '\\', len - i);
+        size_t run_end = backslash != NULL ? (size_t)(backslash - text) : len;
+        memcpy(out + *n, text + i, run_end - i);
+        *n += run_end - i;
+        i = run_end;
+        if (i == len) break;
+
+        if (++i == len) return false;
+        char c = text[i++];
+        switch (c) {
+            case '"': case '\\': case '/': out[(*n)++] = (guint8)c; break;
+            case 'b': out[(*n)++] = '\b'; break;
+            case 'f': out[(*n)++] = '\f'; break;
+            case 'n': out[(*n)++] = '\n'; break;
+            case 'r': out[(*n)++] = '\r'; break;
+            case 't': out[(*n)++] = '\t'; break;
+            case 'u': {
+                guint32 unit;
+                if (!read_hex_digits(text, len, &i, 4, &unit)) return false;
+                // A high surrogate takes the \u low surrogate after it
+                if (unit >= 0xD800 && unit <= 0xDBFF) {
+                    guint32 low;
+                    if (len - i < 2 || text[i] != '\\' || text[i + 1] != 'u') return false;
+                    i += 2;
+                    if (!read_hex_digits(text, len, &i, 4, &low) || low < 0xDC00 || low > 0xDFFF) return false;
+                    unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                }
+                if (!put_code_point(unit, out, n)) return false;
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+// Function to resolve %HH and '+'
+static bool decode_url(const char *text, size_t len, guint8 *out, size_t *n) {
+    size_t next_percent = G_MAXSIZE, next_plus = G_MAXSIZE;
+    size_t i = 0;
+    while (i < len) {
+        size_t run_end = find_either(text, i, len, '%', '+', &next_percent, &next_plus);
+        memcpy(out + *n, text + i, run_end - i);
+        *n += run_end - i;
+        i = run_end;
+        if (i == len) break;
+
+        if (text[i] == '+') {
+            out[(*n)++] = ' ';
+            i++;
+        } else {
+            i++;
+            guint32 value;
+            if (!read_hex_digits(text, len, &i, 2, &value)) return false;
+            out[(*n)++] = (guint8)value;
+        }
+    }
+    return true;
+}
+
+// Function to resolve the escapes in text
+guint8* escape_codec_decode(const char *text, size_t len, EncodingType format, size_t *out_len) {
+    *out_len = 0;
+    if (!escape_codec_handles(format)) return NULL;
+
+    // Every escape is longer than the bytes it stands for
+    guint8 *out = g_malloc(len + 1);
+    size_t n = 0;
+    bool ok;
+    switch (format) {
+        case C_STRING: ok = decode_c(text, len, out, &n); break;
+        case JSON_STRING: ok = decode_json(text, len, out, &n); break;
+        default: ok = decode_url(text, len, out, &n); break;
+    }
+
+    if (!ok) {
+        g_free(out);
+        return NULL;
+    }
+    *out_len = n;
+    return out;
+}
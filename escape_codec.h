@@ -0,0 +1,29 @@
+#ifndef ESCAPE_CODEC_H
+#define ESCAPE_CODEC_H
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// Escaped text as a byte format, like hex: the bytes are the UTF-8 of the text with its escapes
+// resolved.
+// C_STRING: \xHH (one or two digits), octal \NNN, \uXXXX, \UXXXXXXXX and the named escapes. The
+//   text may be one or more string literals ("..." "..."); otherwise it is taken as the inside
+//   of one. Bytes that aren't printable ASCII are written \xHH, or by name (\n, \t, ...).
+// JSON_STRING: \uXXXX (surrogate pairs combined) and the named escapes, inside quotes or not.
+//   Written with everything but printable ASCII as \uXXXX; a byte that is not part of UTF-8 is
+//   written as the Latin-1 character \u00XX, so it reads back as that character's UTF-8.
+// URL_ENCODED: %HH, and '+' for a space. Written with all but A-Z a-z 0-9 - _ . ~ as %HH.
+
+// Function to check whether an encoding is one of these formats
+bool escape_codec_handles(EncodingType format);
+
+// Function to write bytes as escaped text; returns NULL for other encodings
+char* escape_codec_encode(const guint8 *data, size_t len, EncodingType format);
+
+// Function to resolve the escapes in text; returns NULL (with out_len 0) for an escape that is
+// not valid or for other encodings, otherwise the bytes (never NULL, even when there are none)
+guint8* escape_codec_decode(const char *text, size_t len, EncodingType format, size_t *out_len);
+
+#endif /* ESCAPE_CODEC_H */
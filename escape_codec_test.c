@@ -0,0 +1,100 @@
+// Checks of the C string, JSON string and URL codecs: round trips of every byte, escapes written
+// by hand, escapes that are not valid, and bytes that are not UTF-8 written as JSON
+// Exits with 1 and names the case on the first failure.
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include "escape_codec.h"
+
+typedef struct {
+    const char *name;
+    EncodingType format;
+    const char *bytes;
+    size_t len;
+    const char *expected;   // The escaped text
+} EncodeCase;
+
+static const EncodeCase encode_cases[] = {
+    { "JSON, lone byte above ASCII", JSON_STRING, "a\xFF" "b", 3, "a\\u00ffb" },
+    { "JSON, cut off UTF-8 sequence", JSON_STRING, "\xC3", 1, "\\u00c3" },
+    { "JSON, bad byte before valid UTF-8", JSON_STRING, "\x80\xC3\xA9", 3, "\\u0080\\u00e9" },
+};
+
+typedef struct {
+    const char *name;
+    EncodingType format;
+    const char *text;
+    const char *bytes;      // NULL when the text is not valid
+    size_t len;
+} DecodeCase;
+
+static const DecodeCase decode_cases[] = {
+    { "C, hex, octal and named escapes", C_STRING, "\\x41\\101\\n\\e", "AA\n\x1B", 4 },
+    { "C, \\x takes two digits at most", C_STRING, "\\x414", "A4", 2 },
+    { "C, universal character names", C_STRING, "\\u00e9\\U0001F600", "\xC3\xA9\xF0\x9F\x98\x80", 6 },
+    { "C, string literals joined", C_STRING, "\"ab\" \"c\\\"d\"", "abc\"d", 5 },
+    { "C, octal past a byte", C_STRING, "\\777", NULL, 0 },
+    { "C, unknown escape", C_STRING, "\\q", NULL, 0 },
+    { "JSON, surrogate pair", JSON_STRING, "\\ud83d\\ude00", "\xF0\x9F\x98\x80", 4 },
+    { "JSON, quoted with named escapes", JSON_STRING, "\"a\\tb\\/\"", "a\tb/", 4 },
+    { "JSON, lone low surrogate", JSON_STRING, "\\ude00", NULL, 0 },
+    { "URL, plus and percent", URL_ENCODED, "a+b%2Fc%2f", "a b/c/", 6 },
+    { "URL, cut off escape", URL_ENCODED, "a%4", NULL, 0 },
+};
+
+static const EncodingType formats[] = { C_STRING, JSON_STRING, URL_ENCODED };
+
+// Every byte value round trips through C strings and URLs; JSON takes UTF-8, so it is given text
+static bool check_round_trip(EncodingType format) {
+    GByteArray *data = g_byte_array_new();
+    if (format == JSON_STRING) {
+        const char *text = "Plain, \"quoted\" \\ and\ttabbed\r\n\x01\x7F caf\xC3\xA9 \xE3\x81\x82 \xF0\x9F\x98\x80";
+        g_byte_array_append(data, (const guint8 *)text, (guint)strlen(text));
+    } else {
+        for (guint b = 0; b < 256; b++) {
+            guint8 byte = (guint8)b;
+            g_byte_array_append(data, &byte, 1);
+        }
+    }
+
+    char *text = escape_codec_encode(data->data, data->len, format);
+    size_t len = 0;
+    guint8 *bytes = text != NULL ? escape_codec_decode(text, strlen(text), format, &len) : NULL;
+    bool ok = bytes != NULL && len == data->len && memcmp(bytes, data->data, len) == 0;
+    if (!ok) fprintf(stderr, "FAIL: format %d did not round trip: %s\n", format, text != NULL ? text : "NULL");
+    g_free(bytes);
+    g_free(text);
+    g_byte_array_free(data, TRUE);
+    return ok;
+}
+
+int main(void) {
+    for (size_t i = 0; i < G_N_ELEMENTS(formats); i++) {
+        if (!check_round_trip(formats[i])) return 1;
+    }
+
+    for (size_t i = 0; i < G_N_ELEMENTS(decode_cases); i++) {
+        const DecodeCase *test = &decode_cases[i];
+        size_t len = 0;
+        guint8 *bytes = escape_codec_decode(test->text, strlen(test->text), test->format, &len);
+        bool ok = test->bytes == NULL ? bytes == NULL && len == 0
+                                      : bytes != NULL && len == test->len && memcmp(bytes, test->bytes, len) == 0;
+        if (!ok) fprintf(stderr, "FAIL: %s: decoded to %zu bytes\n", test->name, len);
+        g_free(bytes);
+        if (!ok) return 1;
+    }
+
+    for (size_t i = 0; i < G_N_ELEMENTS(encode_cases); i++) {
+        const EncodeCase *test = &encode_cases[i];
+        char *text = escape_codec_encode((const guint8 *)test->bytes, test->len, test->format);
+        bool ok = text != NULL && strcmp(text, test->expected) == 0;
+        if (!ok) {
+            fprintf(stderr, "FAIL: %s: got %s, expected %s\n", test->name, text != NULL ? text : "NULL", test->expected);
+        }
+        g_free(text);
+        if (!ok) return 1;
+    }
+    printf("%zu escape codec cases and round trips in %zu formats passed\n",
+           G_N_ELEMENTS(decode_cases) + G_N_ELEMENTS(encode_cases), G_N_ELEMENTS(formats));
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include "glossary.h"
+#include "aho_corasick.h"
+#include <stdbool.h>
+#include <string.h>
+
+typedef struct {
+    char *term;
+    char *line;   // Entry as shown to the model
+} GlossaryEntry;
+
+struct Glossary {
+    GArray *entries;     // GlossaryEntry, in file order
+    AhoCorasick *matcher; // Pattern id == entry index
+};
+
+// Scan state for one text
+typedef struct {
+    const Glossary *glossary;
+    const guint8 *text;
+    size_t text_len;
+    guint8 *found;       // One flag per entry
+} GlossaryScan;
+
+static inline bool is_ascii_word_byte(guint8 c) {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+}
+
+// Only accept a match of an ASCII word-like term at word boundaries,
+// so "Al" doesn't match inside "Also"; other terms (e.g. CJK) match anywhere
+static bool on_glossary_match(guint pattern_id, size_t end, gpointer user_data) {
+    GlossaryScan *scan = user_data;
+    if (scan->found[pattern_id]) return true;
+
+    const GlossaryEntry *entry = &g_array_index(scan->glossary->entries, GlossaryEntry, pattern_id);
+    size_t term_len = strlen(entry->term);
+    size_t start = end - term_len;
+
+    if (is_ascii_word_byte((guint8)entry->term[0]) && start > 0 && is_ascii_word_byte(scan->text[start - 1])) {
+        return true;
+    }
+    if (is_ascii_word_byte((guint8)entry->term[term_len - 1]) && end < scan->text_len &&
+        is_ascii_word_byte(scan->text[end])) {
+        return true;
+    }
+
+    scan->found[pattern_id] = 1;
+    return true;
+}
+
+// Function to parse a glossary from a string
+Glossary* glossary_new_from_string(const char *contents) {
+    if (contents == NULL) return NULL;
+
+    GArray *entries = g_array_new(FALSE, FALSE, sizeof(GlossaryEntry));
+    gchar **lines = g_strsplit(contents, "\n", -1);
+
+    for (guint i = 0; lines[i] != NULL; i++) {
+        char *line = g_strstrip(lines[i]);
+        if (*line == '\0' || *line == '#') continue;
+
+        // Term is everything before the first tab (or '=' if the line has no tab)
+        char *separator = strchr(line, '\t');
+        if (separator == NULL) separator = strchr(line, '=');
+        if (separator == NULL) continue;
+
+        char *term = g_strndup(line, separator - line);
+        g_strstrip(term);
+        if (*term == '\0') {
+            g_free(term);
+            continue;
+        }
+
+        char *rest = g_strdup(separator + 1);
+        g_strstrip(rest);
+
+        // Normalise tabs in the remaining fields for the prompt
+        for (char *p = rest; *p; p++) {
+            if (*p == '\t') *p = ';';
+        }
+
+        GlossaryEntry entry = { term, g_strdup_printf("%s = %s", term, rest) };
+        g_array_append_val(entries, entry);
+        g_free(rest);
+    }
+    g_strfreev(lines);
+
+    if (entries->len == 0) {
+        g_array_free(entries, TRUE);
+        return NULL;
+    }
+
+    Glossary *glossary = g_new0(Glossary, 1);
+    glossary->entries = entries;
+    glossary->matcher = aho_corasick_new(true);
+
+    for (guint i = 0; i < entries->len; i++) {
+        const char *term = g_array_index(entries, GlossaryEntry, i).term;
+        aho_corasick_add_pattern(glossary->matcher, (const guint8 *)term, strlen(term));
+    }
+    aho_corasick_build(glossary->matcher);
+
+    return glossary;
+}
+
+// Function to load a glossary file
+Glossary* glossary_load(const char *path) {
+    char *contents = NULL;
+    if (path == NULL || !g_file_get_contents(path, &contents, NULL, NULL)) {
+        return NULL;
+    }
+
+    Glossary *glossary = glossary_new_from_string(contents);
+    g_free(contents);
+    return glossary;
+}
+
+// Function to get the number of entries
+guint glossary_size(const Glossary *glossary) {
+    return glossary != NULL ? glossary->entries->len : 0;
+}
+
+// Function to select the entries whose term occurs in text
+char* glossary_select_for_text(const Glossary *glossary, const char *text) {
+    if (glossary == NULL || text == NULL) return NULL;
+
+    GlossaryScan scan = {
+        glossary,
+        (const guint8 *)text,
+        strlen(text),
+        g_malloc0(glossary->entries->len)
+    };
+
+    aho_corasick_scan(glossary->matcher, 0, scan.text, scan.text_len, 0, on_glossary_match, &scan);
+
+    GString *selected = NULL;
+    for (guint i = 0; i < glossary->entries->len; i++) {
+        if (!scan.found[i]) continue;
+
+        if (selected == NULL) selected = g_string_new(NULL);
+        else g_string_append_c(selected, '\n');
+        g_string_append(selected, g_array_index(glossary->entries, GlossaryEntry, i).line);
+    }
+
+    g_free(scan.found);
+    return selected != NULL ? g_string_free(selected, FALSE) : NULL;
+}
+
+// Function to free a glossary
+void glossary_free(Glossary *glossary) {
+    if (glossary == NULL) return;
+
+    for (guint i = 0; i < glossary->entries->len; i++) {
+        GlossaryEntry *entry = &g_array_index(glossary->entries, GlossaryEntry, i);
+        g_free(entry->term);
+        g_free(entry->line);
+    }
+    g_array_free(glossary->entries, TRUE);
+    aho_corasick_free(glossary->matcher);
+    g_free(glossary);
+}
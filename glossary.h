@@ -0,0 +1,27 @@
+#ifndef GLOSSARY_H
+#define GLOSSARY_H
+
+#include <glib.h>
+
+// Term glossary used to give the AI consistent names and terminology
+// File format: one entry per line, "term<TAB>translation[<TAB>note]" (or "term = translation");
+// blank lines and lines starting with '#' are ignored.
+typedef struct Glossary Glossary;
+
+// Function to parse a glossary from a string; returns NULL if it has no entries
+Glossary* glossary_new_from_string(const char *contents);
+
+// Function to load a glossary file; returns NULL if the file is missing or has no entries
+Glossary* glossary_load(const char *path);
+
+// Function to get the number of entries
+guint glossary_size(const Glossary *glossary);
+
+// Function to select the entries whose term occurs in text
+// Returns the matching entries, one per line in file order, or NULL if none occur.
+char* glossary_select_for_text(const Glossary *glossary, const char *text);
+
+// Function to free a glossary
+void glossary_free(Glossary *glossary);
+
+#endif /* GLOSSARY_H */
@@ -0,0 +1,225 @@
+#include "hex_dump.h"
+#include "text_decoder.h"
+#include <string.h>
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+#define HEX_DUMP_TYPE_ROWS (hex_dump_rows_get_type())
+G_DECLARE_FINAL_TYPE(HexDumpRows, hex_dump_rows, HEX_DUMP, ROWS, GObject)
+
+// List model of the rows of a hexdump; a row is laid out only when the list asks for it
+struct _HexDumpRows {
+    GObject parent_instance;
+    GBytes *bytes;                  // Bytes shown, or NULL when a piece table is
+    const PieceTable *table;
+    gsize len;
+    guint bytes_per_row;
+    guint address_digits;
+    EncodingType side_encoding;
+    guint n_rows;
+};
+
+static void hex_dump_rows_list_model_init(GListModelInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE(HexDumpRows, hex_dump_rows, G_TYPE_OBJECT,
+                              G_IMPLEMENT_INTERFACE(G_TYPE_LIST_MODEL, hex_dump_rows_list_model_init))
+
+// Function to get how many hex digits the addresses of data of len bytes need
+guint hex_dump_address_digits(gsize len) {
+    gsize last = len > 0 ? len - 1 : 0;
+    guint digits = 8;
+    while (digits < sizeof(gsize) * 2 && (last >> (digits * 4)) != 0) digits++;
+    return digits;
+}
+
+// Function to append the bytes decoded in an encoding, with what can't be shown as '.'
+static void append_side_column(GString *row, const guint8 *data, size_t len, EncodingType encoding) {
+    char *text = !encoding_is_byte_format(encoding) && encoding != ASCII ? text_decoder_decode(data, len, encoding, NULL) : NULL;
+    if (text == NULL) {
+        for (size_t i = 0; i < len; i++) {
+            g_string_append_c(row, data[i] >= 0x20 && data[i] < 0x7F ? (char)data[i] : '.');
+        }
+        return;
+    }
+
+    gunichar replacement = g_utf8_get_char(TEXT_DECODER_REPLACEMENT);
+    for (const char *p = text; *p != '\0'; p = g_utf8_next_char(p)) {
+        gunichar ch = g_utf8_get_char(p);
+        if (g_unichar_isprint(ch) && ch != replacement) {
+            g_string_append_unichar(row, ch);
+        } else {
+            g_string_append_c(row, '.');
+        }
+    }
+    g_free(text);
+}
+
+// Function to lay out one row like hexdump -C
+char* hex_dump_format_row(const guint8 *data, size_t len, gsize address, guint address_digits,
+                          guint bytes_per_row, EncodingType side_encoding) {
+    len = MIN(len, bytes_per_row);
+    GString *row = g_string_sized_new(address_digits + bytes_per_row * 4 + bytes_per_row / 8 + 4);
+
+    for (guint d = address_digits; d > 0; d--) {
+        g_string_append_c(row, hex_digits[(address >> ((d - 1) * 4)) & 0xF]);
+    }
+    g_string_append_c(row, ' ');
+
+    for (guint i = 0; i < bytes_per_row; i++) {
+        // An extra space before each group of eight
+        if (i % 8 == 0) g_string_append_c(row, ' ');
+        if (i < len) {
+            g_string_append_c(row, hex_digits[data[i] >> 4]);
+            g_string_append_c(row, hex_digits[data[i] & 0xF]);
+            g_string_append_c(row, ' ');
+        } else {
+            g_string_append(row, "   ");
+        }
+    }
+
+    g_string_append_c(row, ' ');
+    append_side_column(row, data, len, side_encoding);
+    return g_string_free(row, FALSE);
+}
+
+static GType hex_dump_rows_get_item_type(GListModel *list) {
+    return GTK_TYPE_STRING_OBJECT;
+}
+
+static guint hex_dump_rows_get_n_items(GListModel *list) {
+    return HEX_DUMP_ROWS(list)->n_rows;
+}
+
+// Function to lay out the row at position for the list
+static gpointer hex_dump_rows_get_item(GListModel *list, guint position) {
+    HexDumpRows *rows = HEX_DUMP_ROWS(list);
+    if (position >= rows->n_rows) return NULL;
+
+    gsize offset = (gsize)position * rows->bytes_per_row;
+    guint8 buffer[HEX_DUMP_MAX_ROW_BYTES];
+    const guint8 *data;
+    gsize len;
+    if (rows->table != NULL) {
+        len = piece_table_read(rows->table, offset, buffer, rows->bytes_per_row);
+        data = buffer;
+    } else {
+        data = (const guint8 *)g_bytes_get_data(rows->bytes, NULL) + offset;
+        len = MIN(rows->bytes_per_row, rows->len - offset);
+    }
+
+    char *text = hex_dump_format_row(data, len, offset, rows->address_digits, rows->bytes_per_row,
+                                     rows->side_encoding);
+    GtkStringObject *item = gtk_string_object_new(text);
+    g_free(text);
+    return item;
+}
+
+static void hex_dump_rows_list_model_init(GListModelInterface *iface) {
+    iface->get_item_type = hex_dump_rows_get_item_type;
+    iface->get_n_items = hex_dump_rows_get_n_items;
+    iface->get_item = hex_dump_rows_get_item;
+}
+
+static void hex_dump_rows_finalize(GObject *object) {
+    HexDumpRows *rows = HEX_DUMP_ROWS(object);
+    if (rows->bytes != NULL) g_bytes_unref(rows->bytes);
+    G_OBJECT_CLASS(hex_dump_rows_parent_class)->finalize(object);
+}
+
+static void hex_dump_rows_class_init(HexDumpRowsClass *klass) {
+    G_OBJECT_CLASS(klass)->finalize = hex_dump_rows_finalize;
+}
+
+static void hex_dump_rows_init(HexDumpRows *rows) {
+    rows->bytes_per_row = 16;
+    rows->address_digits = 8;
+    rows->side_encoding = ASCII;
+}
+
+// Function to show other contents; only the rows in sight are laid out again
+static void set_rows_source(HexDumpRows *rows, GBytes *bytes, const PieceTable *table,
+                            guint bytes_per_row, EncodingType side_encoding) {
+    bytes_per_row = CLAMP(bytes_per_row, 1, HEX_DUMP_MAX_ROW_BYTES);
+    // Nothing to lay out again when the same bytes are shown the same way (piece tables may have
+    // been edited, and a table file may have been loaded in place of the last one)
+    if (bytes != NULL && bytes == rows->bytes && bytes_per_row == rows->bytes_per_row &&
+        side_encoding == rows->side_encoding && side_encoding != TABLE_FILE) {
+        return;
+    }
+
+    guint old_rows = rows->n_rows;
+    if (bytes != NULL) g_bytes_ref(bytes);
+    if (rows->bytes != NULL) g_bytes_unref(rows->bytes);
+    rows->bytes = bytes;
+    rows->table = table;
+
+    if (table != NULL) {
+        rows->len = piece_table_get_length(table);
+    } else {
+        rows->len = bytes != NULL ? g_bytes_get_size(bytes) : 0;
+    }
+    rows->bytes_per_row = bytes_per_row;
+    rows->address_digits = hex_dump_address_digits(rows->len);
+    rows->side_encoding = side_encoding;
+    gsize n_rows = (rows->len + rows->bytes_per_row - 1) / rows->bytes_per_row;
+    rows->n_rows = (guint)MIN(n_rows, G_MAXUINT);
+
+    g_list_model_items_changed(G_LIST_MODEL(rows), 0, old_rows, rows->n_rows);
+}
+
+// Callbacks for the list's row widgets: a label each, given the text of the row it shows
+static void on_row_setup(GtkSignalListItemFactory *factory, GtkListItem *list_item, gpointer user_data) {
+    GtkWidget *label = gtk_label_new(NULL);
+    gtk_label_set_xalign(GTK_LABEL(label), 0);
+    gtk_list_item_set_child(list_item, label);
+}
+
+static void on_row_bind(GtkSignalListItemFactory *factory, GtkListItem *list_item, gpointer user_data) {
+    GtkStringObject *item = gtk_list_item_get_item(list_item);
+    GtkWidget *label = gtk_list_item_get_child(list_item);
+    gtk_label_set_text(GTK_LABEL(label), gtk_string_object_get_string(item));
+}
+
+// Function to create a read-only hexdump view
+GtkWidget* hex_dump_view_new(void) {
+    HexDumpRows *rows = g_object_new(HEX_DUMP_TYPE_ROWS, NULL);
+    GtkListItemFactory *factory = gtk_signal_list_item_factory_new();
+    g_signal_connect(factory, "setup", G_CALLBACK(on_row_setup), NULL);
+    g_signal_connect(factory, "bind", G_CALLBACK(on_row_bind), NULL);
+
+    // The selection takes the rows, and the list the selection and factory
+    GtkNoSelection *selection = gtk_no_selection_new(G_LIST_MODEL(rows));
+    GtkWidget *list = gtk_list_view_new(GTK_SELECTION_MODEL(selection), factory);
+    gtk_widget_add_css_class(list, "monospace");
+
+    GtkWidget *scroll = gtk_scrolled_window_new();
+    gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scroll), list);
+    gtk_widget_set_vexpand(scroll, TRUE);
+    gtk_widget_set_hexpand(scroll, TRUE);
+    g_object_set_data(G_OBJECT(scroll), "hex_dump_rows", rows);
+    g_object_set_data(G_OBJECT(scroll), "hex_dump_list", list);
+    return scroll;
+}
+
+// Function to show bytes in the view
+void hex_dump_view_set_bytes(GtkWidget *view, GBytes *bytes, guint bytes_per_row, EncodingType side_encoding) {
+    HexDumpRows *rows = g_object_get_data(G_OBJECT(view), "hex_dump_rows");
+    set_rows_source(rows, bytes, NULL, bytes_per_row, side_encoding);
+}
+
+// Function to show the contents of a piece table in the view
+void hex_dump_view_set_piece_table(GtkWidget *view, const PieceTable *table, guint bytes_per_row,
+                                   EncodingType side_encoding) {
+    HexDumpRows *rows = g_object_get_data(G_OBJECT(view), "hex_dump_rows");
+    set_rows_source(rows, NULL, table, bytes_per_row, side_encoding);
+}
+
+// Function to scroll the view to the row holding offset
+void hex_dump_view_scroll_to(GtkWidget *view, gsize offset) {
+    HexDumpRows *rows = g_object_get_data(G_OBJECT(view), "hex_dump_rows");
+    GtkWidget *list = g_object_get_data(G_OBJECT(view), "hex_dump_list");
+    if (rows->n_rows == 0) return;
+
+    gsize row = MIN(offset / rows->bytes_per_row, (gsize)rows->n_rows - 1);
+    gtk_list_view_scroll_to(GTK_LIST_VIEW(list), (guint)row, GTK_LIST_SCROLL_NONE, NULL);
+}
@@ -0,0 +1,37 @@
+#ifndef HEX_DUMP_H
+#define HEX_DUMP_H
+
+#include <gtk/gtk.h>
+#include <stddef.h>
+#include "common.h"
+#include "piece_table.h"
+
+// Bytes per row the layout allows at most
+#define HEX_DUMP_MAX_ROW_BYTES 64
+
+// Function to get how many hex digits the addresses of data of len bytes need (8 at least)
+guint hex_dump_address_digits(gsize len);
+
+// Function to lay out one row like hexdump -C: the address, bytes_per_row bytes in hex (fewer on
+// the last row, padded so the columns line up) and the bytes decoded in side_encoding, with
+// characters that can't be shown as '.'. The side column lines up for single-byte encodings;
+// others show the row's characters as they decode. Byte formats (HEX, Base64, ...) show ASCII.
+char* hex_dump_format_row(const guint8 *data, size_t len, gsize address, guint address_digits,
+                          guint bytes_per_row, EncodingType side_encoding);
+
+// Function to create a read-only hexdump view (a scrolled list) that lays out rows only as they
+// are scrolled into sight, so its cost doesn't grow with the length of the data
+GtkWidget* hex_dump_view_new(void);
+
+// Function to show bytes (a reference is kept; NULL for none) in the view
+void hex_dump_view_set_bytes(GtkWidget *view, GBytes *bytes, guint bytes_per_row, EncodingType side_encoding);
+
+// Function to show the contents of a piece table in the view; call again after edits
+// The table is read as rows are shown, so it must outlive the view or be replaced first.
+void hex_dump_view_set_piece_table(GtkWidget *view, const PieceTable *table, guint bytes_per_row,
+                                   EncodingType side_encoding);
+
+// Function to scroll the view to the row holding offset
+void hex_dump_view_scroll_to(GtkWidget *view, gsize offset);
+
+#endif /* HEX_DUMP_H */
@@ -0,0 +1,418 @@
+#include "hex_import.h"
+#include <string.h>
+
+// Character classes: a hex digit's value (0-15), or one of these
+#define CHAR_SPACE 0x10         // Whitespace
+#define CHAR_SEPARATOR 0x20     // Other separators plain hex may have between digits
+#define CHAR_OTHER 0xFF
+
+// Bytes a dump line may hold at most
+#define MAX_LINE_BYTES 4096
+// Bytes per line of xxd and hexdump -C, for a dump too short to tell from its addresses
+#define DEFAULT_LINE_BYTES 16
+// Bytes "*" lines may add in all, so a bad address can't blow up the result
+#define MAX_REPEAT_BYTES (64 * 1024 * 1024)
+
+static guint8 char_classes[256];
+
+static void init_char_classes(void) {
+    static gsize initialized = 0;
+    if (g_once_init_enter(&initialized)) {
+        memset(char_classes, CHAR_OTHER, sizeof(char_classes));
+        for (int c = '0'; c <= '9'; c++) char_classes[c] = (guint8)(c - '0');
+        for (int c = 'a'; c <= 'f'; c++) {
+            char_classes[c] = (guint8)(c - 'a' + 10);
+            char_classes[c - 'a' + 'A'] = (guint8)(c - 'a' + 10);
+        }
+        for (const char *c = " \t\r\n\f\v"; *c != '\0'; c++) char_classes[(guint8)*c] = CHAR_SPACE;
+        for (const char *c = ",;:-"; *c != '\0'; c++) char_classes[(guint8)*c] = CHAR_SEPARATOR;
+        g_once_init_leave(&initialized, 1);
+    }
+}
+
+static inline guint8 char_class(char c) {
+    return char_classes[(guint8)c];
+}
+
+static inline bool is_hex(char c) {
+    return char_class(c) < 16;
+}
+
+static inline bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Function to read plain hex; digits pair up across spaces and separators, as before
+static guint8* parse_plain(const char *text, size_t len, size_t *out_len) {
+    guint8 *out = g_malloc(len / 2 + 1);
+    size_t n = 0;
+    int high = -1;
+
+    size_t i = 0;
+    while (i < len) {
+        // Most bytes are two digits together; classes other than digits have bits above the low four
+        if (high < 0 && i + 1 < len) {
+            guint8 a = char_class(text[i]);
+            guint8 b = char_class(text[i + 1]);
+            if ((a | b) < 16) {
+                out[n++] = (guint8)(a << 4 | b);
+                i += 2;
+                continue;
+            }
+        }
+
+        guint8 cls = char_class(text[i++]);
+        if (cls < 16) {
+            if (high < 0) {
+                high = cls;
+            } else {
+                out[n++] = (guint8)(high << 4 | cls);
+                high = -1;
+            }
+        } else if (cls == CHAR_OTHER) {
+            g_free(out);
+            return NULL;
+        }
+    }
+
+    if (high >= 0) {
+        g_free(out);
+        return NULL;
+    }
+    *out_len = n;
+    return out;
+}
+
+// Function to append the bytes n digits stand for (a leading zero is implied for an odd count)
+static void append_digits(GByteArray *out, const char *digits, size_t n) {
+    size_t i = 0;
+    if (n % 2 != 0) {
+        guint8 byte = char_class(digits[0]);
+        g_byte_array_append(out, &byte, 1);
+        i = 1;
+    }
+    for (; i < n; i += 2) {
+        guint8 byte = (guint8)(char_class(digits[i]) << 4 | char_class(digits[i + 1]));
+        g_byte_array_append(out, &byte, 1);
+    }
+}
+
+static inline bool is_word_char(char c) {
+    return g_ascii_isalnum(c) || c == '_';
+}
+
+// Function to read 0x12 and $12 values, skipping everything else
+// Returns whether the text looks written that way: more prefixed values than bare hex words (a
+// C array's size is one; a "$" typo in plain hex has many around it).
+static bool parse_prefixed(const char *text, size_t len, GByteArray *out) {
+    size_t values = 0, bare = 0;
+    size_t i = 0;
+    while (i < len) {
+        if (!is_word_char(text[i])) {
+            i++;
+            continue;
+        }
+
+        size_t start = i;
+        while (i < len && is_word_char(text[i])) i++;
+        const char *digits = text + start;
+        size_t n = i - start;
+
+        if (start > 0 && text[start - 1] == '$') {
+            // $12
+        } else if (n > 2 && digits[0] == '0' && (digits[1] | 0x20) == 'x') {
+            digits += 2;
+            n -= 2;
+        } else {
+            size_t k = 0;
+            while (k < n && is_hex(digits[k])) k++;
+            if (k == n) bare++;
+            continue;
+        }
+
+        // Digits, then maybe a C suffix (0x12u)
+        size_t k = 0;
+        while (k < n && is_hex(digits[k])) k++;
+        if (k == 0) continue;
+        append_digits(out, digits, k);
+        values++;
+    }
+    return values > bare;
+}
+
+// Function to read the address a dump line starts with; returns where the rest of the line
+// starts, or NULL when the line doesn't start with one
+// An address ends in ':' before a space (xxd, most emulators), or is at least six digits before
+// two spaces or a tab (hexdump -C), or before a space when it is bank:address.
+static const char* parse_address(const char *p, const char *end, guint64 *address) {
+    if (p < end && *p == '$') {
+        p++;
+    } else if (end - p > 2 && p[0] == '0' && (p[1] | 0x20) == 'x') {
+        p += 2;
+    }
+
+    guint64 value = 0;
+    int digits = 0;
+    bool bank = false;
+    while (p < end) {
+        if (is_hex(*p)) {
+            value = value << 4 | char_class(*p);
+            digits++;
+            p++;
+        } else if (*p == ':' && !bank && digits > 0 && p + 1 < end && is_hex(p[1])) {
+            bank = true;
+            p++;
+        } else {
+            break;
+        }
+    }
+    if (digits == 0 || digits > 16) return NULL;
+
+    if (p < end && *p == ':' && (p + 1 == end || is_blank(p[1]))) {
+        *address = value;
+        return p + 1;
+    }
+    if (digits >= 6 && p < end && (*p == '\t' || (bank && *p == ' ') || (end - p > 1 && p[0] == ' ' && p[1] == ' '))) {
+        *address = value;
+        return p;
+    }
+    return NULL;
+}
+
+// Function to find the end of the line starting at p
+static const char* line_end_of(const char *p, const char *end) {
+    const char *newline = memchr(p, '\n', (size_t)(end - p));
+    return newline != NULL ? newline : end;
+}
+
+static const char* skip_blanks(const char *p, const char *end) {
+    while (p < end && is_blank(*p)) p++;
+    return p;
+}
+
+// Function to read the bytes of a dump line after its address, up to its text column
+// limit is how many bytes the line holds; the bytes are also left in line for "*" lines, and
+// appended to out unless it is NULL. stop (if not NULL) receives where the bytes end.
+static guint parse_dump_bytes(const char *p, const char *end, guint limit, GByteArray *out, guint8 *line,
+                              const char **stop) {
+    guint count = 0;
+    while (p < end) {
+        const char *word = skip_blanks(p, end);
+        if (word >= end || *word == '|') break;
+        // Short last lines are padded up to the text column
+        if (count > 0 && word - p >= 3) break;
+
+        const char *word_end = word;
+        while (word_end < end && is_hex(*word_end)) word_end++;
+        size_t digits = (size_t)(word_end - word);
+        if (digits == 0 || digits % 2 != 0 || (word_end < end && !is_blank(*word_end))) break;
+        if (count + digits / 2 > limit) break;
+
+        for (size_t i = 0; i < digits; i += 2) {
+            line[count++] = (guint8)(char_class(word[i]) << 4 | char_class(word[i + 1]));
+        }
+        p = word_end;
+    }
+
+    if (out != NULL) g_byte_array_append(out, line, count);
+    if (stop != NULL) *stop = p;
+    return count;
+}
+
+// Function to read lines that start with an address
+static void parse_dump(const char *text, size_t len, GByteArray *out) {
+    const char *end = text + len;
+    guint8 last_line[MAX_LINE_BYTES];
+    guint last_count = 0;           // Bytes of the last line with any
+    guint64 expected = 0;           // Address after that line
+    guint line_bytes = 0;           // Bytes per line, from the addresses (0 until two are seen)
+    gsize repeated = 0;
+    bool repeat = false;
+
+    for (const char *line = text; line < end; ) {
+        const char *line_end = line_end_of(line, end);
+        const char *next_line = line_end < end ? line_end + 1 : end;
+        const char *p = skip_blanks(line, line_end);
+
+        guint64 address = 0;
+        const char *content = parse_address(p, line_end, &address);
+        if (content == NULL) {
+            // Lines without an address are headers or blank, except hexdump's "*"
+            if (p < line_end && *p == '*') repeat = true;
+            line = next_line;
+            continue;
+        }
+
+        // "*" stands for lines equal to the one before, up to this address
+        if (repeat && last_count > 0) {
+            while (address >= expected + last_count && repeated + last_count <= MAX_REPEAT_BYTES) {
+                g_byte_array_append(out, last_line, last_count);
+                expected += last_count;
+                repeated += last_count;
+            }
+        }
+        repeat = false;
+
+        // The next line's address says how many bytes this one holds
+        guint64 next_address = 0;
+        const char *next_p = skip_blanks(next_line, line_end_of(next_line, end));
+        if (next_line < end && parse_address(next_p, line_end_of(next_line, end), &next_address) != NULL &&
+            next_address > address && next_address - address <= MAX_LINE_BYTES) {
+            line_bytes = (guint)(next_address - address);
+        }
+
+        // Without a next line either, a text column of hex digits would be taken for more bytes
+        guint count = parse_dump_bytes(content, line_end, line_bytes > 0 ? line_bytes : DEFAULT_LINE_BYTES,
+                                       out, last_line, NULL);
+        if (count > 0) {
+            last_count = count;
+            expected = address + count;
+        }
+        line = next_line;
+    }
+}
+
+// Function to tell a dump from plain hex whose first group looks like an address ("DEADBEEF  CAFEBABE")
+// The next address must step by the bytes the first line holds, or the first line must have a text column.
+static bool starts_dump(const char *p, const char *end) {
+    const char *line_end = line_end_of(p, end);
+    guint64 address = 0;
+    const char *content = parse_address(p, line_end, &address);
+    if (content == NULL) return false;
+
+    // The next line with anything on it
+    const char *next_line = line_end;
+    const char *next_end = line_end;
+    const char *next_p = line_end;
+    while (next_p == next_end && next_end < end) {
+        next_line = next_end + 1;
+        next_end = line_end_of(next_line, end);
+        next_p = skip_blanks(next_line, next_end);
+    }
+
+    guint64 next_address = 0;
+    bool stepped = next_p < next_end && parse_address(next_p, next_end, &next_address) != NULL &&
+                   next_address > address && next_address - address <= MAX_LINE_BYTES;
+
+    guint8 line[MAX_LINE_BYTES];
+    const char *stop = content;
+    guint count = parse_dump_bytes(content, line_end, stepped ? (guint)(next_address - address) : DEFAULT_LINE_BYTES,
+                                   NULL, line, &stop);
+    if (stepped && count == next_address - address) return true;
+    return count > 0 && skip_blanks(stop, line_end) < line_end;
+}
+
+// Function to read bytes from hex text in any of the syntaxes, in one pass
+guint8* hex_import_parse(const char *text, size_t len, size_t *out_len, HexImportFormat *format) {
+    init_char_classes();
+    *out_len = 0;
+
+    // A dump is known by its first lines
+    const char *end = text + len;
+    const char *p = text;
+    while (p < end && char_class(*p) == CHAR_SPACE) p++;
+    if (p < end && starts_dump(p, end)) {
+        GByteArray *out = g_byte_array_sized_new((guint)MIN(len / 3 + 1, G_MAXUINT));
+        parse_dump(text, len, out);
+        if (format != NULL) *format = HEX_IMPORT_DUMP;
+        *out_len = out->len;
+        guint8 *data = g_byte_array_free(out, FALSE);
+        return data != NULL ? data : g_malloc(1);
+    }
+
+    guint8 *data = parse_plain(text, len, out_len);
+    if (data != NULL) {
+        if (format != NULL) *format = HEX_IMPORT_PLAIN;
+        return data;
+    }
+
+    GByteArray *out = g_byte_array_sized_new((guint)MIN(len / 4 + 1, G_MAXUINT));
+    if (!parse_prefixed(text, len, out)) {
+        g_byte_array_free(out, TRUE);
+        return NULL;
+    }
+    if (format != NULL) *format = HEX_IMPORT_PREFIXED;
+    *out_len = out->len;
+    data = g_byte_array_free(out, FALSE);
+    return data != NULL ? data : g_malloc(1);
+}
+
+// Function to read plain hex, keeping every byte whose two digits read and marking the others
+guint8* hex_import_parse_lossy(const char *text, size_t len, size_t *out_len, guint8 **bad, size_t *bad_count) {
+    init_char_classes();
+    // Each byte takes two characters, or one before a separator or the end
+    size_t max_bytes = len / 2 + 1;
+    guint8 *out = g_malloc(max_bytes);
+    guint8 *bits = g_malloc0(max_bytes / 8 + 1);
+    size_t n = 0, n_bad = 0;
+    int high = -1;                  // The first digit of a pair, or CHAR_OTHER for a bad one
+    bool word_bad = false;          // Whether the word being read has characters that aren't hex
+
+    size_t i = 0;
+    while (i < len) {
+        if (high < 0 && i + 1 < len) {
+            guint8 a = char_class(text[i]);
+            guint8 b = char_class(text[i + 1]);
+            if ((a | b) < 16) {
+                out[n++] = (guint8)(a << 4 | b);
+                i += 2;
+                continue;
+            }
+        }
+
+        guint8 c = (guint8)text[i++];
+        // The rest of a UTF-8 character takes no place of its own
+        if ((c & 0xC0) == 0x80) continue;
+
+        guint8 cls = char_class((char)c);
+        if (cls == CHAR_SPACE || cls == CHAR_SEPARATOR) {
+            // A digit left over in a word with a typo doesn't pair with the next word
+            if (word_bad && high >= 0) {
+                bits[n / 8] |= (guint8)(1 << (n % 8));
+                out[n++] = 0;
+                n_bad++;
+                high = -1;
+            }
+            word_bad = false;
+        } else if (high < 0) {
+            high = cls;
+            if (cls == CHAR_OTHER) word_bad = true;
+        } else {
+            if (cls == CHAR_OTHER) word_bad = true;
+            if (high == CHAR_OTHER || cls == CHAR_OTHER) {
+                bits[n / 8] |= (guint8)(1 << (n % 8));
+                out[n++] = 0;
+                n_bad++;
+            } else {
+                out[n++] = (guint8)(high << 4 | cls);
+            }
+            high = -1;
+        }
+    }
+
+    if (high >= 0) {
+        bits[n / 8] |= (guint8)(1 << (n % 8));
+        out[n++] = 0;
+        n_bad++;
+    }
+
+    *out_len = n;
+    *bad = bits;
+    *bad_count = n_bad;
+    return out;
+}
+
+// Function to find the first bad byte at or after from, or len if there is none
+size_t hex_import_next_bad(const guint8 *bad, size_t from, size_t len) {
+    size_t i = from;
+    while (i < len) {
+        // Whole bytes of good bits are skipped at once
+        if (i % 8 == 0 && bad[i / 8] == 0) {
+            i += 8;
+            continue;
+        }
+        if (hex_import_is_bad(bad, i)) return i;
+        i++;
+    }
+    return len;
+}
@@ -0,0 +1,41 @@
+#ifndef HEX_IMPORT_H
+#define HEX_IMPORT_H
+
+#include <glib.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Syntaxes hex text is read in; the first fitting one is picked from the start of the text
+typedef enum {
+    HEX_IMPORT_PLAIN,       // Hex digits with spaces, ',', ';', ':' or '-' between them
+    HEX_IMPORT_PREFIXED,    // Values written 0x12 or $12, as in C arrays; all other text is skipped
+    HEX_IMPORT_DUMP         // Lines that start with an address (xxd, hexdump -C, emulator memory views)
+} HexImportFormat;
+
+// Function to read bytes from hex text in any of the syntaxes, in one pass
+// Dump lines are read up to their text column: a '|', a gap of three or more spaces, a word that
+// isn't hex, or as many bytes as the next line's address says the line holds (as the lines before
+// held for the last line, or 16, xxd's width, for a dump of one line). Lines without an
+// address are skipped, and a "*" line (hexdump's repeated lines) repeats the line before up to
+// the next address. Prefixed values longer than a byte give their bytes in the order written.
+// Returns NULL for plain text that has other characters or an odd number of digits; otherwise
+// the bytes (never NULL, even when there are none), with their count in out_len and the syntax
+// in format (may be NULL).
+guint8* hex_import_parse(const char *text, size_t len, size_t *out_len, HexImportFormat *format);
+
+// Function to read plain hex, keeping every byte whose two digits read and marking the others
+// Characters that aren't hex take a digit's place, so a typo costs only the byte it is in; a
+// digit left over in a word with such a character, or at the end, is a bad byte of its own.
+// Bad bytes are 0 in the result and have their bit set in bad (bit i % 8 of byte i / 8), with
+// their count in bad_count. Text that hex_import_parse reads as plain gives the same bytes.
+guint8* hex_import_parse_lossy(const char *text, size_t len, size_t *out_len, guint8 **bad, size_t *bad_count);
+
+// Function to check whether byte i was marked bad
+static inline bool hex_import_is_bad(const guint8 *bad, size_t i) {
+    return (bad[i / 8] >> (i % 8)) & 1;
+}
+
+// Function to find the first bad byte at or after from, or len if there is none
+size_t hex_import_next_bad(const guint8 *bad, size_t from, size_t len);
+
+#endif /* HEX_IMPORT_H */
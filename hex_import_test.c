@@ -0,0 +1,63 @@
+// Checks of hex_import_parse on dumps whose text column could be read as more bytes, and on
+// plain hex that only starts like a dump. Exits with 1 and names the case on the first failure.
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include "hex_import.h"
+
+typedef struct {
+    const char *name;
+    const char *text;
+    const char *expected;   // The bytes as plain hex
+    HexImportFormat format;
+} DumpCase;
+
+static const DumpCase cases[] = {
+    { "xxd, one line, hex text column",
+      "00000000: 4865 6c6c 6f2c 2077 6f72 6c64 210a 0102  cafe babe cafe b\n",
+      "48656c6c6f2c20776f726c64210a0102", HEX_IMPORT_DUMP },
+    { "xxd, one line, no newline",
+      "00000000: 4865 6c6c 6f2c 2077 6f72 6c64 210a 0102  cafebabecafebabe",
+      "48656c6c6f2c20776f726c64210a0102", HEX_IMPORT_DUMP },
+    { "xxd, short one line",
+      "00000000: 4142 4344                                abcd\n",
+      "41424344", HEX_IMPORT_DUMP },
+    { "xxd, last line after full ones",
+      "00000000: 4865 6c6c 6f2c 2077 6f72 6c64 210a 0102  Hello, world!...\n"
+      "00000010: 4142 4344 4546 4748 4950 5152 5354 5556  cafebabecafebabe\n",
+      "48656c6c6f2c20776f726c64210a010241424344454647484950515253545556", HEX_IMPORT_DUMP },
+    { "hexdump -C, one line",
+      "00000000  48 65 6c 6c 6f 2c 20 77  6f 72 6c 64 21 0a 01 02  |Hello, world!...|\n",
+      "48656c6c6f2c20776f726c64210a0102", HEX_IMPORT_DUMP },
+    { "plain hex, first group like a hexdump -C address",
+      "DEADBEEF  CAFEBABE\n",
+      "deadbeefcafebabe", HEX_IMPORT_PLAIN },
+    { "plain hex, groups like addresses on two lines",
+      "DEADBEEF  CAFEBABE\n12345678  9ABCDEF0\n",
+      "deadbeefcafebabe123456789abcdef0", HEX_IMPORT_PLAIN },
+    { "hexdump -C, two lines without text column",
+      "00000000  48 65 6c 6c\n00000004  6f 21\n",
+      "48656c6c6f21", HEX_IMPORT_DUMP },
+};
+
+int main(void) {
+    for (size_t i = 0; i < G_N_ELEMENTS(cases); i++) {
+        const DumpCase *test = &cases[i];
+        size_t len = 0;
+        HexImportFormat format = HEX_IMPORT_PLAIN;
+        guint8 *data = hex_import_parse(test->text, strlen(test->text), &len, &format);
+        char *hex = data != NULL ? g_malloc(len * 2 + 1) : NULL;
+        for (size_t j = 0; hex != NULL && j < len; j++) snprintf(hex + j * 2, 3, "%02x", data[j]);
+        if (hex != NULL) hex[len * 2] = '\0';
+
+        bool ok = data != NULL && format == test->format && strcmp(hex, test->expected) == 0;
+        if (!ok) {
+            fprintf(stderr, "FAIL: %s: got %s, expected %s\n", test->name, hex != NULL ? hex : "NULL", test->expected);
+        }
+        g_free(hex);
+        g_free(data);
+        if (!ok) return 1;
+    }
+    printf("%zu hex import cases passed\n", G_N_ELEMENTS(cases));
+    return 0;
+}
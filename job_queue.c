@@ -0,0 +1,449 @@
+#include "job_queue.h"
+#include "record_file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Journal records, one per line with tab separated fields:
+//   R <run> <key> <segments> <created>   run header
+//   S <run> <index> <source> <prompt>    segment (empty prompt: no request needed)
+//   I <run> <index>                      request sent
+//   D <run> <index> <translation>        segment done
+//   F <run>                              run delivered in full
+// A run header and its segments are written together; a run missing segments, a torn last
+// line or any other malformed record is ignored on replay.
+
+// Compact once superseded records exceed this many plus twice the live ones
+#define COMPACT_SLACK_RECORDS 64
+// Unfinished runs older than this are dropped when the journal is compacted
+#define MAX_RUN_AGE_SECONDS (7 * 24 * 60 * 60)
+
+typedef struct {
+    guint id;
+    char *key;
+    guint count;
+    gint64 created;
+    guint segments_seen;  // S records replayed so far
+    char **sources;
+    char **prompts;
+    char **results;
+    bool *in_flight;
+    guint completed;
+} JournalRun;
+
+struct JobQueue {
+    GMutex mutex;
+    char *path;
+    GHashTable *runs;    // run id -> JournalRun*, unfinished runs only
+    GHashTable *keys;    // key -> run id of the newest unfinished run
+    guint next_id;
+    guint records;       // Records currently in the file
+    guint live_records;  // Records a compaction would keep
+};
+
+static JournalRun* journal_run_new(guint id, const char *key, guint count, gint64 created) {
+    JournalRun *run = g_new0(JournalRun, 1);
+    run->id = id;
+    run->key = g_strdup(key);
+    run->count = count;
+    run->created = created;
+    run->sources = g_new0(char *, count);
+    run->prompts = g_new0(char *, count);
+    run->results = g_new0(char *, count);
+    run->in_flight = g_new0(bool, count);
+    return run;
+}
+
+static void journal_run_free(gpointer data) {
+    JournalRun *run = data;
+    for (guint i = 0; i < run->count; i++) {
+        g_free(run->sources[i]);
+        g_free(run->prompts[i]);
+        g_free(run->results[i]);
+    }
+    g_free(run->sources);
+    g_free(run->prompts);
+    g_free(run->results);
+    g_free(run->in_flight);
+    g_free(run->key);
+    g_free(run);
+}
+
+// Number of records a run occupies after compaction
+static guint run_live_records(const JournalRun *run) {
+    return 1 + run->count + run->completed;
+}
+
+// Parse an unsigned field; false if it isn't a plain number
+static bool parse_uint(const char *field, guint64 *value) {
+    if (field == NULL || *field == '\0') return false;
+    char *end = NULL;
+    *value = g_ascii_strtoull(field, &end, 10);
+    return end != NULL && *end == '\0';
+}
+
+static void append_uint_field(GString *line, guint64 value) {
+    char number[24];
+    snprintf(number, sizeof(number), "%" G_GUINT64_FORMAT, value);
+    record_append_field(line, number);
+}
+
+// Serialize a run's header and segments
+static void append_run_records(GString *out, const JournalRun *run) {
+    record_append_field(out, "R");
+    append_uint_field(out, run->id);
+    record_append_field(out, run->key);
+    append_uint_field(out, run->count);
+    append_uint_field(out, (guint64)run->created);
+    g_string_append_c(out, '\n');
+
+    for (guint i = 0; i < run->count; i++) {
+        record_append_field(out, "S");
+        append_uint_field(out, run->id);
+        append_uint_field(out, i);
+        record_append_field(out, run->sources[i]);
+        record_append_field(out, run->prompts[i] != NULL ? run->prompts[i] : "");
+        g_string_append_c(out, '\n');
+    }
+}
+
+static void append_done_record(GString *out, guint run_id, guint index, const char *result) {
+    record_append_field(out, "D");
+    append_uint_field(out, run_id);
+    append_uint_field(out, index);
+    record_append_field(out, result);
+    g_string_append_c(out, '\n');
+}
+
+// Look up the unfinished run a segment record refers to; NULL if the record is stale or invalid
+static JournalRun* lookup_segment(JobQueue *queue, gchar **fields, guint min_fields, guint *index) {
+    guint64 run_id = 0, value = 0;
+    if (g_strv_length(fields) < min_fields || !parse_uint(fields[1], &run_id) ||
+        !parse_uint(fields[2], &value)) {
+        return NULL;
+    }
+
+    JournalRun *run = g_hash_table_lookup(queue->runs, GUINT_TO_POINTER((guint)run_id));
+    if (run == NULL || value >= run->count) return NULL;
+
+    *index = (guint)value;
+    return run;
+}
+
+// Apply one journal record to the in-memory state
+static void replay_record(JobQueue *queue, const char *line) {
+    gchar **fields = record_split_fields(line);
+    guint n = g_strv_length(fields);
+    guint64 run_id = 0;
+    guint index = 0;
+
+    if (n >= 5 && strcmp(fields[0], "R") == 0) {
+        guint64 count = 0, created = 0;
+        if (parse_uint(fields[1], &run_id) && run_id > 0 && run_id < G_MAXUINT &&
+            parse_uint(fields[3], &count) && count > 0 && count < G_MAXUINT &&
+            parse_uint(fields[4], &created)) {
+            JournalRun *run = journal_run_new((guint)run_id, fields[2], (guint)count, (gint64)created);
+            g_hash_table_replace(queue->runs, GUINT_TO_POINTER(run->id), run);
+            queue->next_id = MAX(queue->next_id, run->id + 1);
+        }
+    } else if (strcmp(fields[0], "S") == 0) {
+        JournalRun *run = lookup_segment(queue, fields, 5, &index);
+        if (run != NULL && run->sources[index] == NULL) {
+            run->sources[index] = g_strdup(fields[3]);
+            run->prompts[index] = fields[4][0] != '\0' ? g_strdup(fields[4]) : NULL;
+            run->segments_seen++;
+        }
+    } else if (strcmp(fields[0], "I") == 0) {
+        JournalRun *run = lookup_segment(queue, fields, 3, &index);
+        if (run != NULL) run->in_flight[index] = true;
+    } else if (strcmp(fields[0], "D") == 0) {
+        JournalRun *run = lookup_segment(queue, fields, 4, &index);
+        if (run != NULL) {
+            if (run->results[index] == NULL) run->completed++;
+            g_free(run->results[index]);
+            run->results[index] = g_strdup(fields[3]);
+            run->in_flight[index] = false;
+        }
+    } else if (n >= 2 && strcmp(fields[0], "F") == 0) {
+        if (parse_uint(fields[1], &run_id)) {
+            g_hash_table_remove(queue->runs, GUINT_TO_POINTER((guint)run_id));
+        }
+    }
+
+    g_strfreev(fields);
+}
+
+// Rewrite the journal with only the live state of unfinished runs
+// Must be called with queue->mutex held
+static void compact_locked(JobQueue *queue) {
+    gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+    GString *out = g_string_new(NULL);
+    guint records = 0;
+
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, queue->runs);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        JournalRun *run = value;
+        if (now - run->created > MAX_RUN_AGE_SECONDS) {
+            fprintf(stderr, "DEBUG: Dropping stale translation run %u (%u of %u segments done)\n",
+                    run->id, run->completed, run->count);
+            if (GPOINTER_TO_UINT(g_hash_table_lookup(queue->keys, run->key)) == run->id) {
+                g_hash_table_remove(queue->keys, run->key);
+            }
+            g_hash_table_iter_remove(&iter);
+            continue;
+        }
+
+        append_run_records(out, run);
+        for (guint i = 0; i < run->count; i++) {
+            if (run->results[i] != NULL) append_done_record(out, run->id, i, run->results[i]);
+        }
+        records += run_live_records(run);
+    }
+
+    GError *error = NULL;
+    if (g_file_set_contents_full(queue->path, out->str, out->len,
+                                 G_FILE_SET_CONTENTS_CONSISTENT | G_FILE_SET_CONTENTS_DURABLE,
+                                 0600, &error)) {
+        fprintf(stderr, "DEBUG: Compacted job journal from %u to %u records\n", queue->records, records);
+        queue->records = records;
+        queue->live_records = records;
+    } else {
+        fprintf(stderr, "ERROR: Could not compact job journal %s: %s\n", queue->path, error->message);
+        g_error_free(error);
+    }
+
+    g_string_free(out, TRUE);
+}
+
+// Append records for the current run state, compacting when dead records pile up
+// Must be called with queue->mutex held
+static bool append_locked(JobQueue *queue, const GString *records, guint count, bool sync) {
+    if (!record_file_append(queue->path, records->str, records->len, sync)) return false;
+
+    queue->records += count;
+    if (queue->records - queue->live_records > 2 * queue->live_records + COMPACT_SLACK_RECORDS) {
+        compact_locked(queue);
+    }
+    return true;
+}
+
+// Function to open (and compact) the journal at path
+JobQueue* job_queue_open(const char *path) {
+    JobQueue *queue = g_new0(JobQueue, 1);
+    g_mutex_init(&queue->mutex);
+    queue->path = g_strdup(path);
+    queue->runs = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, journal_run_free);
+    queue->keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    queue->next_id = 1;
+
+    char *contents = NULL;
+    gsize length = 0;
+    bool torn = false;
+    if (g_file_get_contents(path, &contents, &length, NULL)) {
+        char *line = contents;
+        char *end = contents + length;
+        while (line < end) {
+            char *newline = memchr(line, '\n', end - line);
+            if (newline == NULL) {
+                // The last write never finished
+                torn = true;
+                break;
+            }
+            *newline = '\0';
+            if (*line != '\0') replay_record(queue, line);
+            queue->records++;
+            line = newline + 1;
+        }
+        g_free(contents);
+    }
+
+    // Drop runs whose segment records didn't all make it to disk
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, queue->runs);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        JournalRun *run = value;
+        if (run->segments_seen != run->count) {
+            g_hash_table_iter_remove(&iter);
+            continue;
+        }
+        queue->live_records += run_live_records(run);
+
+        guint current = GPOINTER_TO_UINT(g_hash_table_lookup(queue->keys, run->key));
+        if (current < run->id) g_hash_table_replace(queue->keys, g_strdup(run->key), GUINT_TO_POINTER(run->id));
+    }
+
+    fprintf(stderr, "DEBUG: Job journal has %u unfinished runs in %u records\n",
+            g_hash_table_size(queue->runs), queue->records);
+
+    if (torn || queue->records > queue->live_records) {
+        g_mutex_lock(&queue->mutex);
+        compact_locked(queue);
+        g_mutex_unlock(&queue->mutex);
+    }
+
+    return queue;
+}
+
+// Function to find the unfinished run recorded under key
+JobQueueRun* job_queue_find_run(JobQueue *queue, const char *key) {
+    if (queue == NULL || key == NULL) return NULL;
+
+    g_mutex_lock(&queue->mutex);
+    guint id = GPOINTER_TO_UINT(g_hash_table_lookup(queue->keys, key));
+    JournalRun *run = id != 0 ? g_hash_table_lookup(queue->runs, GUINT_TO_POINTER(id)) : NULL;
+
+    JobQueueRun *copy = NULL;
+    if (run != NULL) {
+        copy = g_new0(JobQueueRun, 1);
+        copy->id = run->id;
+        copy->sources = g_ptr_array_new_full(run->count, g_free);
+        copy->prompts = g_ptr_array_new_full(run->count, g_free);
+        copy->results = g_new0(char *, run->count);
+        copy->completed = run->completed;
+        for (guint i = 0; i < run->count; i++) {
+            g_ptr_array_add(copy->sources, g_strdup(run->sources[i]));
+            g_ptr_array_add(copy->prompts, g_strdup(run->prompts[i]));
+            copy->results[i] = g_strdup(run->results[i]);
+            if (run->in_flight[i]) copy->interrupted++;
+        }
+    }
+    g_mutex_unlock(&queue->mutex);
+
+    return copy;
+}
+
+// Function to record a new run under key
+guint job_queue_add_run(JobQueue *queue, const char *key, GPtrArray *sources, GPtrArray *prompts,
+                        char **results) {
+    if (queue == NULL || key == NULL || sources->len == 0) return 0;
+
+    g_mutex_lock(&queue->mutex);
+    JournalRun *run = journal_run_new(queue->next_id, key, sources->len, g_get_real_time() / G_USEC_PER_SEC);
+    for (guint i = 0; i < run->count; i++) {
+        run->sources[i] = g_strdup(g_ptr_array_index(sources, i));
+        run->prompts[i] = g_strdup(g_ptr_array_index(prompts, i));
+        if (results[i] != NULL) {
+            run->results[i] = g_strdup(results[i]);
+            run->completed++;
+        }
+    }
+
+    GString *records = g_string_new(NULL);
+    append_run_records(records, run);
+    for (guint i = 0; i < run->count; i++) {
+        if (run->results[i] != NULL) append_done_record(records, run->id, i, run->results[i]);
+    }
+
+    guint id = 0;
+    guint count = run_live_records(run);
+    if (record_file_append(queue->path, records->str, records->len, true)) {
+        id = run->id;
+        queue->next_id++;
+        queue->records += count;
+        queue->live_records += count;
+        g_hash_table_replace(queue->keys, g_strdup(key), GUINT_TO_POINTER(id));
+        g_hash_table_replace(queue->runs, GUINT_TO_POINTER(id), run);
+    } else {
+        journal_run_free(run);
+    }
+    g_mutex_unlock(&queue->mutex);
+
+    g_string_free(records, TRUE);
+    return id;
+}
+
+// Function to record that a segment's request was sent
+void job_queue_mark_started(JobQueue *queue, guint run_id, guint index) {
+    if (queue == NULL || run_id == 0) return;
+
+    g_mutex_lock(&queue->mutex);
+    JournalRun *run = g_hash_table_lookup(queue->runs, GUINT_TO_POINTER(run_id));
+    if (run != NULL && index < run->count && !run->in_flight[index]) {
+        run->in_flight[index] = true;
+
+        // Losing this record only loses the "interrupted" note, so it isn't synced
+        GString *record = g_string_new(NULL);
+        record_append_field(record, "I");
+        append_uint_field(record, run_id);
+        append_uint_field(record, index);
+        g_string_append_c(record, '\n');
+        append_locked(queue, record, 1, false);
+        g_string_free(record, TRUE);
+    }
+    g_mutex_unlock(&queue->mutex);
+}
+
+// Function to record a segment's translation
+void job_queue_mark_done(JobQueue *queue, guint run_id, guint index, const char *result) {
+    if (queue == NULL || run_id == 0 || result == NULL) return;
+
+    g_mutex_lock(&queue->mutex);
+    JournalRun *run = g_hash_table_lookup(queue->runs, GUINT_TO_POINTER(run_id));
+    if (run != NULL && index < run->count) {
+        if (run->results[index] == NULL) {
+            run->completed++;
+            queue->live_records++;
+        }
+        g_free(run->results[index]);
+        run->results[index] = g_strdup(result);
+        run->in_flight[index] = false;
+
+        // A paid translation must survive a crash right after it arrives
+        GString *record = g_string_new(NULL);
+        append_done_record(record, run_id, index, result);
+        append_locked(queue, record, 1, true);
+        g_string_free(record, TRUE);
+    }
+    g_mutex_unlock(&queue->mutex);
+}
+
+// Function to record that a run was delivered in full
+void job_queue_finish_run(JobQueue *queue, guint run_id) {
+    if (queue == NULL || run_id == 0) return;
+
+    g_mutex_lock(&queue->mutex);
+    JournalRun *run = g_hash_table_lookup(queue->runs, GUINT_TO_POINTER(run_id));
+    if (run != NULL) {
+        queue->live_records -= run_live_records(run);
+        if (GPOINTER_TO_UINT(g_hash_table_lookup(queue->keys, run->key)) == run_id) {
+            g_hash_table_remove(queue->keys, run->key);
+        }
+        g_hash_table_remove(queue->runs, GUINT_TO_POINTER(run_id));
+
+        // If this record is lost the run just resumes with nothing left to send
+        GString *record = g_string_new(NULL);
+        record_append_field(record, "F");
+        append_uint_field(record, run_id);
+        g_string_append_c(record, '\n');
+        append_locked(queue, record, 1, false);
+        g_string_free(record, TRUE);
+    }
+    g_mutex_unlock(&queue->mutex);
+}
+
+// Function to free a recovered run
+void job_queue_run_free(JobQueueRun *run) {
+    if (run == NULL) return;
+
+    for (guint i = 0; i < run->sources->len; i++) {
+        g_free(run->results[i]);
+    }
+    g_free(run->results);
+    g_ptr_array_unref(run->sources);
+    g_ptr_array_unref(run->prompts);
+    g_free(run);
+}
+
+// Function to free a queue
+void job_queue_free(JobQueue *queue) {
+    if (queue == NULL) return;
+
+    g_mutex_clear(&queue->mutex);
+    g_hash_table_destroy(queue->runs);
+    g_hash_table_destroy(queue->keys);
+    g_free(queue->path);
+    g_free(queue);
+}
@@ -0,0 +1,50 @@
+#ifndef JOB_QUEUE_H
+#define JOB_QUEUE_H
+
+#include <glib.h>
+#include <stdbool.h>
+
+// Journaled queue of translation runs
+// Every run, its segments and each finished translation are appended to a log as they happen,
+// so a run cut short by a crash or a closed window resumes with only the missing segments.
+// The log is compacted down to the unfinished runs when it is opened and whenever
+// superseded records outgrow the live ones. The queue is internally locked.
+typedef struct JobQueue JobQueue;
+
+// Unfinished run recovered from the journal; owned by the caller (free with job_queue_run_free)
+typedef struct {
+    guint id;
+    GPtrArray *sources;  // Source text per segment
+    GPtrArray *prompts;  // Prompt per segment, NULL for segments that needed no request
+    char **results;      // Translation per segment, NULL while pending
+    guint completed;     // Number of segments with a result
+    guint interrupted;   // Segments that were in flight when the run stopped
+} JobQueueRun;
+
+// Function to open (and compact) the journal at path; a missing file is fine
+JobQueue* job_queue_open(const char *path);
+
+// Function to find the unfinished run recorded under key, or NULL
+JobQueueRun* job_queue_find_run(JobQueue *queue, const char *key);
+
+// Function to record a new run under key; results holds segments already translated (or NULLs)
+// Returns the run id, or 0 if the journal could not be written.
+guint job_queue_add_run(JobQueue *queue, const char *key, GPtrArray *sources, GPtrArray *prompts,
+                        char **results);
+
+// Function to record that a segment's request was sent
+void job_queue_mark_started(JobQueue *queue, guint run_id, guint index);
+
+// Function to record a segment's translation (on disk before this returns)
+void job_queue_mark_done(JobQueue *queue, guint run_id, guint index, const char *result);
+
+// Function to record that a run was delivered in full
+void job_queue_finish_run(JobQueue *queue, guint run_id);
+
+// Function to free a recovered run
+void job_queue_run_free(JobQueueRun *run);
+
+// Function to free a queue (the journal stays on disk)
+void job_queue_free(JobQueue *queue);
+
+#endif /* JOB_QUEUE_H */
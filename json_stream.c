@@ -0,0 +1,523 @@
+#include "json_stream.h"
+#include <stdio.h>
+#include <string.h>
+
+// Nesting limit of the pull parser
+#define PULL_MAX_DEPTH 256
+// Keys longer than this are never compared against watched paths
+#define PULL_MAX_KEY 128
+
+// Function to start writing into buffer
+void json_writer_init(JsonWriter *writer, GString *buffer) {
+    memset(writer, 0, sizeof(*writer));
+    writer->buffer = buffer;
+    g_string_truncate(buffer, 0);
+}
+
+// Write the separator needed before a new value or key
+static void writer_prepare_item(JsonWriter *writer) {
+    if (writer->after_key) {
+        writer->after_key = false;
+        return;
+    }
+    if (writer->depth > 0) {
+        if (writer->has_items[writer->depth - 1]) g_string_append_c(writer->buffer, ',');
+        writer->has_items[writer->depth - 1] = true;
+    }
+}
+
+static void writer_open(JsonWriter *writer, char bracket) {
+    g_return_if_fail(writer->depth < JSON_WRITER_MAX_DEPTH);
+
+    writer_prepare_item(writer);
+    g_string_append_c(writer->buffer, bracket);
+    writer->has_items[writer->depth++] = false;
+}
+
+static void writer_close(JsonWriter *writer, char bracket) {
+    g_return_if_fail(writer->depth > 0);
+
+    writer->depth--;
+    g_string_append_c(writer->buffer, bracket);
+}
+
+// Functions to open and close objects and arrays
+void json_writer_begin_object(JsonWriter *writer) { writer_open(writer, '{'); }
+void json_writer_end_object(JsonWriter *writer) { writer_close(writer, '}'); }
+void json_writer_begin_array(JsonWriter *writer) { writer_open(writer, '['); }
+void json_writer_end_array(JsonWriter *writer) { writer_close(writer, ']'); }
+
+// Function to append a string with JSON escaping, without quotes
+// Runs of characters that need no escaping are copied in one go.
+void json_escape_append(GString *buffer, const char *text) {
+    static const char hex[] = "0123456789abcdef";
+    const char *run = text;
+    const char *p = text;
+
+    for (;; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        if (p > run) g_string_append_len(buffer, run, p - run);
+        if (c == '\0') break;
+        run = p + 1;
+
+        switch (c) {
+            case '"': g_string_append(buffer, "\\\""); break;
+            case '\\': g_string_append(buffer, "\\\\"); break;
+            case '\n': g_string_append(buffer, "\\n"); break;
+            case '\r': g_string_append(buffer, "\\r"); break;
+            case '\t': g_string_append(buffer, "\\t"); break;
+            case '\b': g_string_append(buffer, "\\b"); break;
+            case '\f': g_string_append(buffer, "\\f"); break;
+            default: {
+                char escape[7] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF], '\0' };
+                g_string_append(buffer, escape);
+                break;
+            }
+        }
+    }
+}
+
+// Function to write an object key
+void json_writer_key(JsonWriter *writer, const char *key) {
+    writer_prepare_item(writer);
+    g_string_append_c(writer->buffer, '"');
+    json_escape_append(writer->buffer, key);
+    g_string_append(writer->buffer, "\":");
+    writer->after_key = true;
+}
+
+// Functions to write values
+void json_writer_string(JsonWriter *writer, const char *value) {
+    writer_prepare_item(writer);
+    if (value == NULL) {
+        g_string_append(writer->buffer, "null");
+        return;
+    }
+    g_string_append_c(writer->buffer, '"');
+    json_escape_append(writer->buffer, value);
+    g_string_append_c(writer->buffer, '"');
+}
+
+void json_writer_int(JsonWriter *writer, gint64 value) {
+    writer_prepare_item(writer);
+    g_string_append_printf(writer->buffer, "%" G_GINT64_FORMAT, value);
+}
+
+void json_writer_double(JsonWriter *writer, double value) {
+    writer_prepare_item(writer);
+    char number[G_ASCII_DTOSTR_BUF_SIZE];
+    g_string_append(writer->buffer, g_ascii_dtostr(number, sizeof(number), value));
+}
+
+// Pull parser
+
+typedef enum {
+    PULL_VALUE,          // Expecting a value
+    PULL_VALUE_OR_END,   // After '['
+    PULL_KEY_OR_END,     // After '{'
+    PULL_KEY,            // After ',' in an object
+    PULL_COLON,
+    PULL_AFTER_VALUE,    // Expecting ',' or the end of the container
+    PULL_STRING,
+    PULL_STRING_ESCAPE,
+    PULL_STRING_UNICODE,
+    PULL_LITERAL,        // Number, true, false or null
+    PULL_DONE,
+    PULL_ERROR
+} PullState;
+
+typedef struct {
+    bool is_array;
+    gint64 index;        // Current element of an array
+    GString *key;        // Current key of an object
+    bool key_too_long;
+} PullFrame;
+
+// One step of a watched path: an object key, or an array index (-1 for any)
+typedef struct {
+    char *key;
+    gint64 index;
+} PathStep;
+
+typedef struct {
+    GArray *steps;       // PathStep
+    GString *value;      // NULL until a string matched
+} PullWatch;
+
+struct JsonPullParser {
+    PullState state;
+    PullFrame *frames;
+    guint depth;
+    guint capacity;
+    GPtrArray *watches;  // PullWatch*
+
+    // Current string
+    bool string_is_key;
+    GString *sink;       // Where unescaped characters go, NULL to skip them
+    guint unicode_digits;
+    gunichar unicode_value;
+    gunichar pending_high; // High surrogate waiting for its low half
+};
+
+static void pull_watch_free(gpointer data) {
+    PullWatch *watch = data;
+    for (guint i = 0; i < watch->steps->len; i++) {
+        g_free(g_array_index(watch->steps, PathStep, i).key);
+    }
+    g_array_free(watch->steps, TRUE);
+    if (watch->value != NULL) g_string_free(watch->value, TRUE);
+    g_free(watch);
+}
+
+// Function to create a parser
+JsonPullParser* json_pull_parser_new(void) {
+    JsonPullParser *parser = g_new0(JsonPullParser, 1);
+    parser->state = PULL_VALUE;
+    parser->watches = g_ptr_array_new_with_free_func(pull_watch_free);
+    return parser;
+}
+
+// Function to watch a path
+guint json_pull_parser_watch(JsonPullParser *parser, const char *path) {
+    PullWatch *watch = g_new0(PullWatch, 1);
+    watch->steps = g_array_new(FALSE, FALSE, sizeof(PathStep));
+
+    const char *p = path;
+    while (*p != '\0') {
+        if (*p == '.') {
+            p++;
+        } else if (*p == '[') {
+            PathStep step = { NULL, -1 };
+            if (p[1] != '*') step.index = g_ascii_strtoll(p + 1, NULL, 10);
+            g_array_append_val(watch->steps, step);
+            const char *close = strchr(p, ']');
+            p = close != NULL ? close + 1 : p + strlen(p);
+        } else {
+            size_t len = strcspn(p, ".[");
+            PathStep step = { g_strndup(p, len), 0 };
+            g_array_append_val(watch->steps, step);
+            p += len;
+        }
+    }
+
+    g_ptr_array_add(parser->watches, watch);
+    return parser->watches->len - 1;
+}
+
+// Find the watch whose path is exactly the current position, if any
+static PullWatch* matching_watch(JsonPullParser *parser) {
+    for (guint w = 0; w < parser->watches->len; w++) {
+        PullWatch *watch = g_ptr_array_index(parser->watches, w);
+        if (watch->steps->len != parser->depth) continue;
+
+        bool match = true;
+        for (guint i = 0; i < parser->depth && match; i++) {
+            const PathStep *step = &g_array_index(watch->steps, PathStep, i);
+            const PullFrame *frame = &parser->frames[i];
+
+            if (frame->is_array) {
+                match = step->key == NULL && (step->index < 0 || step->index == frame->index);
+            } else {
+                match = step->key != NULL && !frame->key_too_long && strcmp(step->key, frame->key->str) == 0;
+            }
+        }
+        if (match) return watch;
+    }
+    return NULL;
+}
+
+static bool push_frame(JsonPullParser *parser, bool is_array) {
+    if (parser->depth >= PULL_MAX_DEPTH) return false;
+
+    if (parser->depth == parser->capacity) {
+        guint capacity = MAX(parser->capacity * 2, 8);
+        parser->frames = g_renew(PullFrame, parser->frames, capacity);
+        memset(parser->frames + parser->capacity, 0, (capacity - parser->capacity) * sizeof(PullFrame));
+        parser->capacity = capacity;
+    }
+
+    PullFrame *frame = &parser->frames[parser->depth++];
+    frame->is_array = is_array;
+    frame->index = 0;
+    frame->key_too_long = false;
+    if (frame->key == NULL) frame->key = g_string_new(NULL);
+    g_string_truncate(frame->key, 0);
+    return true;
+}
+
+// Move on after a complete value
+static void value_done(JsonPullParser *parser) {
+    parser->state = parser->depth == 0 ? PULL_DONE : PULL_AFTER_VALUE;
+}
+
+// Append a decoded character to the current string
+static void sink_char(JsonPullParser *parser, gunichar c) {
+    if (parser->sink == NULL) return;
+
+    char utf8[6];
+    g_string_append_len(parser->sink, utf8, g_unichar_to_utf8(c, utf8));
+}
+
+// A high surrogate that is not followed by a low one is replaced
+static void flush_pending_surrogate(JsonPullParser *parser) {
+    if (parser->pending_high != 0) {
+        sink_char(parser, 0xFFFD);
+        parser->pending_high = 0;
+    }
+}
+
+static void begin_string(JsonPullParser *parser, bool is_key) {
+    parser->string_is_key = is_key;
+    parser->pending_high = 0;
+
+    if (is_key) {
+        PullFrame *frame = &parser->frames[parser->depth - 1];
+        g_string_truncate(frame->key, 0);
+        frame->key_too_long = false;
+        parser->sink = frame->key;
+    } else {
+        PullWatch *watch = matching_watch(parser);
+        if (watch != NULL && watch->value == NULL) watch->value = g_string_new(NULL);
+        parser->sink = watch != NULL ? watch->value : NULL;
+    }
+    parser->state = PULL_STRING;
+}
+
+static void end_string(JsonPullParser *parser) {
+    flush_pending_surrogate(parser);
+
+    if (parser->string_is_key) {
+        PullFrame *frame = &parser->frames[parser->depth - 1];
+        if (frame->key->len > PULL_MAX_KEY) frame->key_too_long = true;
+        parser->state = PULL_COLON;
+    } else {
+        value_done(parser);
+    }
+    parser->sink = NULL;
+}
+
+static inline bool is_json_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline bool is_literal_char(char c) {
+    return g_ascii_isalnum(c) || c == '-' || c == '+' || c == '.';
+}
+
+// Function to feed the next chunk
+bool json_pull_parser_feed(JsonPullParser *parser, const char *data, size_t len) {
+    size_t i = 0;
+
+    while (i < len) {
+        char c = data[i];
+
+        switch (parser->state) {
+            case PULL_STRING: {
+                // Copy the run up to the next quote, escape or control character in one go
+                size_t run = i;
+                while (run < len && data[run] != '"' && data[run] != '\\' && (unsigned char)data[run] >= 0x20) run++;
+                if (run > i) {
+                    flush_pending_surrogate(parser);
+                    if (parser->sink != NULL) {
+                        if (!parser->string_is_key || parser->sink->len <= PULL_MAX_KEY) {
+                            g_string_append_len(parser->sink, data + i, run - i);
+                        }
+                    }
+                    i = run;
+                    continue;
+                }
+                if (c == '"') {
+                    end_string(parser);
+                } else if (c == '\\') {
+                    parser->state = PULL_STRING_ESCAPE;
+                } else {
+                    parser->state = PULL_ERROR;
+                }
+                i++;
+                continue;
+            }
+
+            case PULL_STRING_ESCAPE: {
+                parser->state = PULL_STRING;
+                if (c == 'u') {
+                    parser->state = PULL_STRING_UNICODE;
+                    parser->unicode_digits = 0;
+                    parser->unicode_value = 0;
+                    i++;
+                    continue;
+                }
+
+                flush_pending_surrogate(parser);
+                switch (c) {
+                    case '"': sink_char(parser, '"'); break;
+                    case '\\': sink_char(parser, '\\'); break;
+                    case '/': sink_char(parser, '/'); break;
+                    case 'b': sink_char(parser, '\b'); break;
+                    case 'f': sink_char(parser, '\f'); break;
+                    case 'n': sink_char(parser, '\n'); break;
+                    case 'r': sink_char(parser, '\r'); break;
+                    case 't': sink_char(parser, '\t'); break;
+                    default: parser->state = PULL_ERROR; break;
+                }
+                i++;
+                continue;
+            }
+
+            case PULL_STRING_UNICODE: {
+                gint digit = g_ascii_xdigit_value(c);
+                if (digit < 0) {
+                    parser->state = PULL_ERROR;
+                    continue;
+                }
+                parser->unicode_value = (parser->unicode_value << 4) | (gunichar)digit;
+                i++;
+                if (++parser->unicode_digits < 4) continue;
+
+                gunichar u = parser->unicode_value;
+                parser->state = PULL_STRING;
+                if (u >= 0xD800 && u <= 0xDBFF) {
+                    flush_pending_surrogate(parser);
+                    parser->pending_high = u;
+                } else if (u >= 0xDC00 && u <= 0xDFFF) {
+                    if (parser->pending_high != 0) {
+                        sink_char(parser, 0x10000 + ((parser->pending_high - 0xD800) << 10) + (u - 0xDC00));
+                        parser->pending_high = 0;
+                    } else {
+                        sink_char(parser, 0xFFFD);
+                    }
+                } else {
+                    flush_pending_surrogate(parser);
+                    sink_char(parser, u);
+                }
+                continue;
+            }
+
+            case PULL_LITERAL:
+                if (is_literal_char(c)) {
+                    i++;
+                } else {
+                    value_done(parser);
+                }
+                continue;
+
+            case PULL_ERROR:
+                return false;
+
+            default:
+                break;
+        }
+
+        // Structural states: skip whitespace between tokens
+        if (is_json_space(c)) {
+            i++;
+            continue;
+        }
+        i++;
+
+        switch (parser->state) {
+            case PULL_VALUE_OR_END:
+                if (c == ']') {
+                    parser->depth--;
+                    value_done(parser);
+                    break;
+                }
+                /* fall through */
+            case PULL_VALUE:
+                if (c == '{') {
+                    parser->state = push_frame(parser, false) ? PULL_KEY_OR_END : PULL_ERROR;
+                } else if (c == '[') {
+                    parser->state = push_frame(parser, true) ? PULL_VALUE_OR_END : PULL_ERROR;
+                } else if (c == '"') {
+                    begin_string(parser, false);
+                } else if (is_literal_char(c)) {
+                    parser->state = PULL_LITERAL;
+                } else {
+                    parser->state = PULL_ERROR;
+                }
+                break;
+
+            case PULL_KEY_OR_END:
+                if (c == '}') {
+                    parser->depth--;
+                    value_done(parser);
+                    break;
+                }
+                /* fall through */
+            case PULL_KEY:
+                if (c == '"') begin_string(parser, true);
+                else parser->state = PULL_ERROR;
+                break;
+
+            case PULL_COLON:
+                parser->state = c == ':' ? PULL_VALUE : PULL_ERROR;
+                break;
+
+            case PULL_AFTER_VALUE: {
+                PullFrame *frame = &parser->frames[parser->depth - 1];
+                if (c == ',') {
+                    if (frame->is_array) {
+                        frame->index++;
+                        parser->state = PULL_VALUE;
+                    } else {
+                        parser->state = PULL_KEY;
+                    }
+                } else if ((c == ']' && frame->is_array) || (c == '}' && !frame->is_array)) {
+                    parser->depth--;
+                    value_done(parser);
+                } else {
+                    parser->state = PULL_ERROR;
+                }
+                break;
+            }
+
+            default:
+                // Anything but whitespace after the document
+                parser->state = PULL_ERROR;
+                break;
+        }
+    }
+
+    return parser->state != PULL_ERROR;
+}
+
+// Function to check that the input held exactly one complete JSON value
+bool json_pull_parser_finish(JsonPullParser *parser) {
+    if (parser->state == PULL_LITERAL && parser->depth == 0) {
+        parser->state = PULL_DONE;
+    }
+    return parser->state == PULL_DONE;
+}
+
+// Function to get the text collected for a watch
+const char* json_pull_parser_get(JsonPullParser *parser, guint watch_id) {
+    g_return_val_if_fail(watch_id < parser->watches->len, NULL);
+
+    PullWatch *watch = g_ptr_array_index(parser->watches, watch_id);
+    return watch->value != NULL ? watch->value->str : NULL;
+}
+
+// Function to take ownership of the text collected for a watch
+char* json_pull_parser_steal(JsonPullParser *parser, guint watch_id) {
+    g_return_val_if_fail(watch_id < parser->watches->len, NULL);
+
+    PullWatch *watch = g_ptr_array_index(parser->watches, watch_id);
+    if (watch->value == NULL) return NULL;
+
+    char *value = g_string_free(watch->value, FALSE);
+    watch->value = NULL;
+    return value;
+}
+
+// Function to free a parser
+void json_pull_parser_free(JsonPullParser *parser) {
+    if (parser == NULL) return;
+
+    for (guint i = 0; i < parser->capacity; i++) {
+        if (parser->frames[i].key != NULL) g_string_free(parser->frames[i].key, TRUE);
+    }
+    g_free(parser->frames);
+    g_ptr_array_unref(parser->watches);
+    g_free(parser);
+}
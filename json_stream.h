@@ -0,0 +1,66 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Streaming JSON writer
+// Values are escaped straight into the caller's buffer; no document tree is built.
+#define JSON_WRITER_MAX_DEPTH 32
+
+typedef struct {
+    GString *buffer;
+    guint depth;
+    bool has_items[JSON_WRITER_MAX_DEPTH]; // Whether the container at each depth has an item yet
+    bool after_key;                        // A key was written and its value is next
+} JsonWriter;
+
+// Function to start writing into buffer (its previous contents are discarded, its memory reused)
+void json_writer_init(JsonWriter *writer, GString *buffer);
+
+// Functions to open and close objects and arrays
+void json_writer_begin_object(JsonWriter *writer);
+void json_writer_end_object(JsonWriter *writer);
+void json_writer_begin_array(JsonWriter *writer);
+void json_writer_end_array(JsonWriter *writer);
+
+// Function to write an object key; the next call writes its value
+void json_writer_key(JsonWriter *writer, const char *key);
+
+// Functions to write values
+void json_writer_string(JsonWriter *writer, const char *value);
+void json_writer_int(JsonWriter *writer, gint64 value);
+void json_writer_double(JsonWriter *writer, double value);
+
+// Function to append a string with JSON escaping, without quotes
+void json_escape_append(GString *buffer, const char *text);
+
+// Incremental JSON pull parser
+// Feed the document in chunks as it arrives; string values found at watched paths are
+// unescaped into their own buffer as they stream past, and the rest is skipped.
+typedef struct JsonPullParser JsonPullParser;
+
+// Function to create a parser
+JsonPullParser* json_pull_parser_new(void);
+
+// Function to watch a path, e.g. "choices[0].message.content" or "candidates[0].content.parts[*].text"
+// ([*] matches every array element; the strings of all matches are concatenated). Returns the watch id.
+guint json_pull_parser_watch(JsonPullParser *parser, const char *path);
+
+// Function to feed the next chunk; returns false once the input is not valid JSON
+bool json_pull_parser_feed(JsonPullParser *parser, const char *data, size_t len);
+
+// Function to check that the input held exactly one complete JSON value
+bool json_pull_parser_finish(JsonPullParser *parser);
+
+// Function to get the text collected for a watch, or NULL if no string matched it
+const char* json_pull_parser_get(JsonPullParser *parser, guint watch_id);
+
+// Function to take ownership of the text collected for a watch (NULL if none)
+char* json_pull_parser_steal(JsonPullParser *parser, guint watch_id);
+
+// Function to free a parser
+void json_pull_parser_free(JsonPullParser *parser);
+
+#endif /* JSON_STREAM_H */
@@ -2,85 +2,60 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include <stdbool.h>
 #include "common.h"
 #include "ai_translator.h"
+#include "text_decoder.h"
+#include "text_encoder.h"
+#include "byte_document.h"
+#include "render_cache.h"
+#include "encoding_detect.h"
+#include "encoding_preview.h"
+#include "char_table.h"
+#include "scan_window.h"
+#include "hex_dump.h"
+#include "patch_window.h"
+#include "hex_import.h"
+#include "base_codec.h"
+#include "escape_codec.h"
 
 // Global flag for debugging
 bool debug_mode = false;
 
+// Renderings kept per window, and the text they may hold in all
+#define RENDER_CACHE_ENTRIES 8
+#define RENDER_CACHE_BYTES (64 * 1024 * 1024)
+
+// Layouts offered for hex: plain text, or hexdump rows of this many bytes
+static const struct {
+    const char *name;
+    guint row_bytes;
+} hex_layouts[] = {
+    { "Plain", 0 },
+    { "Dump, 8 bytes/row", 8 },
+    { "Dump, 16 bytes/row", 16 },
+    { "Dump, 32 bytes/row", 32 },
+};
+
 // Forward declarations
 static void update_conversion(WindowData *data);
 static void update_reverse_conversion(WindowData *data);
 static void convert_between_formats(const char *input, EncodingType from_type,
                                   char **output, size_t *output_len, EncodingType to_type);
 static void toggle_ai_translator(GSimpleAction *action, GVariant *parameter, gpointer user_data);
+static void toggle_encoding_preview(GSimpleAction *action, GVariant *parameter, gpointer user_data);
+static void load_table_file(GSimpleAction *action, GVariant *parameter, gpointer user_data);
+static void scan_file(GSimpleAction *action, GVariant *parameter, gpointer user_data);
+static void patch_file(GSimpleAction *action, GVariant *parameter, gpointer user_data);
 static void show_ai_settings(GSimpleAction *action, GVariant *parameter, gpointer user_data);
 static void update_counter_labels(WindowData *data);
 static void open_new_window(GSimpleAction *action, GVariant *parameter, gpointer user_data);
 static void on_window_destroy(GtkWidget *window, gpointer user_data);
 static void on_send_to_ai_clicked(GtkButton *button, gpointer user_data);
 
-// Convert a single hex character to its value
-static int hex_char_to_int(char c) {
-    if (c >= '0' && c <= '9') return c - '0';
-    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-    return -1; // Invalid hex character
-}
-
-// Convert a string of hex to binary data
+// Convert hex text to binary data: plain hex, C arrays and 0x/$ values, or xxd/hexdump lines
 static unsigned char *hex_to_binary(const char *hex_str, size_t *out_len) {
-    size_t hex_len = strlen(hex_str);
-    size_t bin_len = 0;
-    unsigned char *bin_data;
-
-    // Remove spaces and validate hex string
-    char *clean_hex = g_malloc(hex_len + 1);
-    size_t clean_index = 0;
-
-    for (size_t i = 0; i < hex_len; i++) {
-        if (isspace(hex_str[i])) continue;
-        if (isxdigit(hex_str[i])) {
-            clean_hex[clean_index++] = hex_str[i];
-        } else {
-            g_free(clean_hex);
-            *out_len = 0;
-            return NULL; // Invalid character
-        }
-    }
-
-    clean_hex[clean_index] = '\0';
-    hex_len = clean_index;
-
-    // Ensure even number of hex digits
-    if (hex_len % 2 != 0) {
-        g_free(clean_hex);
-        *out_len = 0;
-        return NULL;
-    }
-
-    bin_len = hex_len / 2;
-    bin_data = g_malloc(bin_len);
-
-    for (size_t i = 0; i < bin_len; i++) {
-        int high = hex_char_to_int(clean_hex[i * 2]);
-        int low = hex_char_to_int(clean_hex[i * 2 + 1]);
-
-        if (high == -1 || low == -1) {
-            g_free(clean_hex);
-            g_free(bin_data);
-            *out_len = 0;
-            return NULL;
-        }
-
-        bin_data[i] = (high << 4) | low;
-    }
-
-    g_free(clean_hex);
-    *out_len = bin_len;
-    return bin_data;
+    return hex_import_parse(hex_str, strlen(hex_str), out_len, NULL);
 }
 
 // Convert binary data to hex string
@@ -105,216 +80,42 @@ static char *binary_to_hex(const unsigned char *data, size_t len) {
     return hex_str;
 }
 
-// Convert binary data to text based on encoding
+// Convert binary data to text based on encoding (or Base64, escapes and the like)
 static char *binary_to_text(const unsigned char *data, size_t len, EncodingType encoding) {
-    GError *error = NULL;
-    char *text = NULL;
-
-    switch (encoding) {
-        case ASCII: {
-            // For ASCII, just copy and ensure null termination
-            text = g_malloc(len + 1);
-            memcpy(text, data, len);
-            text[len] = '\0';
-
-            // Replace non-printable ASCII with replacement character
-            // For ASCII, we'll use a simple '?' since we can't fit Unicode in a char
-            for (size_t i = 0; i < len; i++) {
-                if (text[i] < 32 || text[i] > 126) {
-                    text[i] = '?'; // Question mark as replacement character for ASCII
-                }
-            }
-            break;
-        }
-
-        case UTF8: {
-            // For UTF-8, handle invalid sequences character by character
-            GString *result = g_string_new(NULL);
-            const char *end = (const char *)data + len;
-            const char *p = (const char *)data;
-
-            while (p < end) {
-                gunichar ch;
-                if (g_utf8_validate(p, 1, NULL)) {
-                    ch = g_utf8_get_char_validated(p, end - p);
-                    if (ch == (gunichar)-1 || ch == (gunichar)-2) {
-                        // Invalid UTF-8 sequence
-                        g_string_append(result, "⍰"); // Diamond with question mark as replacement character
-                        p++; // Skip this byte
-                    } else {
-                        // Valid character
-                        g_string_append_unichar(result, ch);
-                        p = g_utf8_next_char(p);
-                    }
-                } else {
-                    // Invalid UTF-8 byte
-                    g_string_append(result, "⍰"); // Diamond with question mark as replacement character
-                    p++; // Skip this byte
-                }
-            }
-
-            text = g_string_free(result, FALSE);
-            break;
-        }
-
-        case UTF16LE: {
-            // Convert from UTF-16LE to UTF-8 with error handling
-            GString *result = g_string_new(NULL);
-
-            // Process 2 bytes at a time
-            for (size_t i = 0; i < len; i += 2) {
-                if (i + 1 >= len) {
-                    // Incomplete surrogate pair
-                    g_string_append(result, "⍰");
-                    break;
-                }
-
-                // Get UTF-16 code unit
-                guint16 code_unit = data[i] | (data[i+1] << 8);
-
-                // Check if it's a high surrogate
-                if (code_unit >= 0xD800 && code_unit <= 0xDBFF) {
-                    // Need another code unit for the low surrogate
-                    if (i + 3 >= len) {
-                        // Incomplete surrogate pair
-                        g_string_append(result, "⍰");
-                        break;
-                    }
-
-                    guint16 low_surrogate = data[i+2] | (data[i+3] << 8);
-                    if (low_surrogate >= 0xDC00 && low_surrogate <= 0xDFFF) {
-                        // Valid surrogate pair
-                        gunichar ch = 0x10000 + ((code_unit - 0xD800) << 10) + (low_surrogate - 0xDC00);
-                        g_string_append_unichar(result, ch);
-                        i += 2; // Skip the low surrogate
-                    } else {
-                        // Invalid surrogate pair
-                        g_string_append(result, "⍰");
-                    }
-                } else if (code_unit >= 0xDC00 && code_unit <= 0xDFFF) {
-                    // Unexpected low surrogate
-                    g_string_append(result, "⍰");
-                } else {
-                    // Regular BMP character
-                    g_string_append_unichar(result, code_unit);
-                }
-            }
-
-            text = g_string_free(result, FALSE);
-            break;
-        }
-
-        case UTF16BE: {
-            // Convert from UTF-16BE to UTF-8 with error handling
-            GString *result = g_string_new(NULL);
-
-            // Process 2 bytes at a time
-            for (size_t i = 0; i < len; i += 2) {
-                if (i + 1 >= len) {
-                    // Incomplete surrogate pair
-                    g_string_append(result, "⍰");
-                    break;
-                }
-
-                // Get UTF-16 code unit (big endian)
-                guint16 code_unit = (data[i] << 8) | data[i+1];
-
-                // Check if it's a high surrogate
-                if (code_unit >= 0xD800 && code_unit <= 0xDBFF) {
-                    // Need another code unit for the low surrogate
-                    if (i + 3 >= len) {
-                        // Incomplete surrogate pair
-                        g_string_append(result, "⍰");
-                        break;
-                    }
-
-                    guint16 low_surrogate = (data[i+2] << 8) | data[i+3];
-                    if (low_surrogate >= 0xDC00 && low_surrogate <= 0xDFFF) {
-                        // Valid surrogate pair
-                        gunichar ch = 0x10000 + ((code_unit - 0xD800) << 10) + (low_surrogate - 0xDC00);
-                        g_string_append_unichar(result, ch);
-                        i += 2; // Skip the low surrogate
-                    } else {
-                        // Invalid surrogate pair
-                        g_string_append(result, "⍰");
-                    }
-                } else if (code_unit >= 0xDC00 && code_unit <= 0xDFFF) {
-                    // Unexpected low surrogate
-                    g_string_append(result, "⍰");
-                } else {
-                    // Regular BMP character
-                    g_string_append_unichar(result, code_unit);
-                }
-            }
-
-            text = g_string_free(result, FALSE);
-            break;
-        }
-    }
-
-    return text;
+    if (base_codec_handles(encoding)) return base_codec_encode(data, len, encoding);
+    if (escape_codec_handles(encoding)) return escape_codec_encode(data, len, encoding);
+    return text_decoder_decode(data, len, encoding, NULL);
 }
 
-// Convert text to binary based on encoding
+// Convert text to binary based on encoding (or Base64, escapes and the like)
 static unsigned char *text_to_binary(const char *text, size_t *out_len, EncodingType encoding) {
-    GError *error = NULL;
-    unsigned char *bin_data = NULL;
-    size_t text_len = strlen(text);
-
-    switch (encoding) {
-        case ASCII: {
-            // For ASCII, just copy the bytes
-            bin_data = g_malloc(text_len);
-            memcpy(bin_data, text, text_len);
-            *out_len = text_len;
-            break;
-        }
-
-        case UTF8: {
-            // For UTF-8, just copy if valid
-            if (g_utf8_validate(text, -1, NULL)) {
-                bin_data = g_malloc(text_len);
-                memcpy(bin_data, text, text_len);
-                *out_len = text_len;
-            } else {
-                *out_len = 0;
-                return NULL;
-            }
-            break;
-        }
-
-        case UTF16LE: {
-            // Convert from UTF-8 to UTF-16LE
-            gsize bytes_written;
-            char *converted = g_convert(text, -1, "UTF-16LE", "UTF-8", NULL, &bytes_written, &error);
-            if (error) {
-                g_error_free(error);
-                *out_len = 0;
-                return NULL;
-            }
-
-            bin_data = (unsigned char *)converted;
-            *out_len = bytes_written;
-            break;
-        }
-
-        case UTF16BE: {
-            // Convert from UTF-8 to UTF-16BE
-            gsize bytes_written;
-            char *converted = g_convert(text, -1, "UTF-16BE", "UTF-8", NULL, &bytes_written, &error);
-            if (error) {
-                g_error_free(error);
-                *out_len = 0;
-                return NULL;
-            }
+    if (base_codec_handles(encoding)) return base_codec_decode(text, strlen(text), encoding, out_len);
+    if (escape_codec_handles(encoding)) return escape_codec_decode(text, strlen(text), encoding, out_len);
+    return text_encoder_encode(text, strlen(text), encoding, out_len);
+}
 
-            bin_data = (unsigned char *)converted;
-            *out_len = bytes_written;
-            break;
+// Function to decode bytes with some marked bad: the runs between them are decoded as usual, and
+// each bad byte shows as a placeholder
+static char *decode_around_bad_bytes(const unsigned char *data, size_t len, const guint8 *bad, EncodingType to_type) {
+    GString *out = g_string_sized_new(len * 3 + 1);
+    size_t i = 0;
+    while (i < len) {
+        size_t run_end = hex_import_next_bad(bad, i, len);
+        if (run_end > i) {
+            char *text = to_type == HEX ? binary_to_hex(data + i, run_end - i)
+                                        : binary_to_text(data + i, run_end - i, to_type);
+            if (to_type == HEX && out->len > 0) g_string_append_c(out, ' ');
+            g_string_append(out, text != NULL ? text : "[Conversion error]");
+            g_free(text);
+            i = run_end;
+        } else {
+            if (to_type == HEX && out->len > 0) g_string_append_c(out, ' ');
+            g_string_append(out, to_type == HEX ? TEXT_DECODER_REPLACEMENT TEXT_DECODER_REPLACEMENT
+                                                : TEXT_DECODER_REPLACEMENT);
+            i++;
         }
     }
-
-    return bin_data;
+    return g_string_free(out, FALSE);
 }
 
 // Convert between any two formats
@@ -335,32 +136,17 @@ static void convert_between_formats(const char *input, EncodingType from_type,
     if (from_type == HEX) {
         bin_data = hex_to_binary(input, &bin_len);
         if (!bin_data) {
-            // Try to salvage as much as possible from invalid hex
-            GString *valid_hex = g_string_new(NULL);
-            size_t input_len = strlen(input);
-
-            for (size_t i = 0; i < input_len; i += 2) {
-                // Skip whitespace
-                while (i < input_len && isspace(input[i])) i++;
-                if (i >= input_len) break;
-
-                // Need at least 2 characters for a hex byte
-                if (i + 1 >= input_len) {
-                    g_string_append(valid_hex, "⍰");
-                    break;
-                }
-
-                // Check if we have a valid hex byte
-                if (isxdigit(input[i]) && isxdigit(input[i+1])) {
-                    char hex_byte[3] = {input[i], input[i+1], '\0'};
-                    g_string_append(valid_hex, hex_byte);
-                } else {
-                    g_string_append(valid_hex, "⍰⍰"); // Placeholder for invalid hex
-                }
+            // Decode every byte that reads, with a placeholder for each one that doesn't
+            guint8 *bad = NULL;
+            size_t bad_count = 0;
+            bin_data = hex_import_parse_lossy(input, strlen(input), &bin_len, &bad, &bad_count);
+            if (debug_mode) {
+                fprintf(stderr, "DEBUG: %zu of %zu hex bytes didn't read\n", bad_count, bin_len);
             }
-
-            *output = g_string_free(valid_hex, FALSE);
+            *output = decode_around_bad_bytes(bin_data, bin_len, bad, to_type);
             *output_len = strlen(*output);
+            g_free(bad);
+            g_free(bin_data);
             return;
         }
     } else {
@@ -395,72 +181,319 @@ static void convert_between_formats(const char *input, EncodingType from_type,
     g_free(bin_data);
 }
 
-// Update conversion between the two text views
+// Function to detect the encoding of the document and pre-select it in the bottom dropdown
+static void detect_bottom_encoding(WindowData *data) {
+    GBytes *bytes = byte_document_get_bytes(data->document);
+    gsize bin_len = g_bytes_get_size(bytes);
+
+    g_free(data->detected_summary);
+    data->detected_summary = NULL;
+
+    if (bin_len == 0) {
+        if (data->detected_bytes) g_bytes_unref(data->detected_bytes);
+        data->detected_bytes = NULL;
+        if (data->encoding_detector) encoding_detector_reset(data->encoding_detector);
+        // Cleared input: the next dump gets detected afresh
+        if (gtk_text_buffer_get_char_count(data->top_buffer) == 0) data->bottom_encoding_chosen = false;
+        return;
+    }
+
+    if (!data->encoding_detector) data->encoding_detector = encoding_detector_new();
+
+    // Feed only what was appended; anything else is rescanned from the start
+    const unsigned char *bin_data = g_bytes_get_data(bytes, NULL);
+    gsize seen_len = data->detected_bytes ? g_bytes_get_size(data->detected_bytes) : 0;
+    if (data->detected_bytes && bin_len >= seen_len &&
+        memcmp(bin_data, g_bytes_get_data(data->detected_bytes, NULL), seen_len) == 0) {
+        encoding_detector_feed(data->encoding_detector, bin_data + seen_len, bin_len - seen_len);
+    } else {
+        encoding_detector_reset(data->encoding_detector);
+        encoding_detector_feed(data->encoding_detector, bin_data, bin_len);
+    }
+    if (data->detected_bytes) g_bytes_unref(data->detected_bytes);
+    data->detected_bytes = g_bytes_ref(bytes);
+
+    double score = 0;
+    EncodingType best = encoding_detector_best(data->encoding_detector, &score);
+    data->detected_summary = g_strdup_printf("Detected: %s (%d%%)", encoding_type_to_string(best), (int)(score * 100 + 0.5));
+
+    // Only a confident guess replaces the selection, and never one the user made
+    if (!data->bottom_encoding_chosen && score >= 0.6 && bin_len >= 4 &&
+        gtk_drop_down_get_selected(data->bottom_encoding_dropdown) != (guint)best) {
+        if (debug_mode) {
+            fprintf(stderr, "DEBUG: Detected %s (score %.2f) in %zu bytes\n",
+                    encoding_type_to_string(best), score, bin_len);
+        }
+        data->auto_selecting = true;
+        gtk_drop_down_set_selected(data->bottom_encoding_dropdown, best);
+        data->auto_selecting = false;
+    }
+}
+
+// Function to run encoding detection when the top view shows hex (or another byte format)
+static void update_detection(WindowData *data) {
+    if (encoding_is_byte_format(gtk_drop_down_get_selected(data->top_encoding_dropdown))) {
+        detect_bottom_encoding(data);
+    } else {
+        g_free(data->detected_summary);
+        data->detected_summary = NULL;
+    }
+}
+
+// Function to decode the document into every encoding in the preview panel
+static void update_preview_panel(WindowData *data) {
+    if (data->encoding_preview_box != NULL && gtk_widget_get_visible(data->encoding_preview_box)) {
+        update_encoding_preview(data->encoding_preview_box, byte_document_get_bytes(data->document));
+    }
+}
+
+// Function to get the whole text of a buffer
+static char *get_buffer_text(GtkTextBuffer *buffer) {
+    GtkTextIter start, end;
+    gtk_text_buffer_get_bounds(buffer, &start, &end);
+    return gtk_text_buffer_get_text(buffer, &start, &end, FALSE);
+}
+
+// Function to make a view's text the document; false if it isn't valid in the view's encoding
+static bool parse_view_into_document(WindowData *data, const char *text, EncodingType encoding) {
+    size_t bin_len = 0;
+    unsigned char *bin_data = NULL;
+
+    if (*text != '\0') {
+        bin_data = encoding == HEX ? hex_to_binary(text, &bin_len) : text_to_binary(text, &bin_len, encoding);
+        // Whitespace alone is an empty hex dump
+        if (bin_data == NULL && !(encoding == HEX && text[strspn(text, " \t\r\n\f\v")] == '\0')) {
+            byte_document_take(data->document, NULL, 0);
+            return false;
+        }
+    }
+
+    byte_document_take(data->document, bin_data, bin_len);
+    return true;
+}
+
+// Function to check whether a view shows hexdump rows instead of its text
+static bool view_shows_dump(WindowData *data, GtkTextBuffer *buffer, EncodingType encoding) {
+    GtkDropDown *layout_dropdown = buffer == data->top_buffer ? data->top_layout_dropdown : data->bottom_layout_dropdown;
+    if (encoding != HEX || layout_dropdown == NULL || data->unparsed_buffer != NULL) return false;
+    return hex_layouts[gtk_drop_down_get_selected(layout_dropdown)].row_bytes > 0;
+}
+
+// Function to show the document as text in a view, in the view's encoding (caller sets is_updating)
+// Renderings are cached, so flipping between encodings doesn't decode again; table renderings
+// aren't, as they change with the loaded table.
+static void render_view_text(WindowData *data, GtkTextBuffer *buffer, EncodingType encoding) {
+    guint64 generation = byte_document_get_generation(data->document);
+    gsize text_len = 0, text_chars = 0;
+    const char *cached = encoding != TABLE_FILE
+        ? render_cache_lookup(data->render_cache, generation, encoding, &text_len, &text_chars) : NULL;
+
+    if (cached != NULL) {
+        gtk_text_buffer_set_text(buffer, cached, (int)text_len);
+    } else {
+        size_t len = 0;
+        const unsigned char *bin_data = byte_document_get_data(data->document, &len);
+        char *text;
+
+        if (len == 0) {
+            text = g_strdup("");
+        } else if (encoding == HEX) {
+            text = binary_to_hex(bin_data, len);
+        } else {
+            text = binary_to_text(bin_data, len, encoding);
+            if (!text) text = g_strdup("[Conversion error]");
+        }
+
+        text_len = strlen(text);
+        text_chars = g_utf8_strlen(text, text_len);
+        gtk_text_buffer_set_text(buffer, text, (int)text_len);
+        if (encoding != TABLE_FILE) {
+            render_cache_store(data->render_cache, generation, encoding, text, text_len, text_chars);
+        } else {
+            g_free(text);
+        }
+    }
+
+    if (buffer == data->bottom_buffer) {
+        data->bottom_chars = text_chars;
+        data->bottom_bytes = text_len;
+        data->bottom_stats_valid = true;
+    }
+    if (buffer == data->top_buffer) {
+        data->top_text_stale = false;
+    } else {
+        data->bottom_text_stale = false;
+    }
+}
+
+// Function to show the document in a view (caller sets is_updating)
+// A view showing hexdump rows gets no text, which for a large document would be most of the
+// work; it is rendered when the view shows text again, or when something needs it.
+static void render_view(WindowData *data, GtkTextBuffer *buffer, EncodingType encoding) {
+    if (!view_shows_dump(data, buffer, encoding)) {
+        render_view_text(data, buffer, encoding);
+        return;
+    }
+
+    gtk_text_buffer_set_text(buffer, "", 0);
+    if (buffer == data->top_buffer) {
+        data->top_text_stale = true;
+    } else {
+        // The counter shows the size of the text binary_to_hex would give
+        size_t len = 0;
+        byte_document_get_data(data->document, &len);
+        data->bottom_chars = len > 0 ? len * 3 - 1 : 0;
+        data->bottom_bytes = data->bottom_chars;
+        data->bottom_stats_valid = true;
+        data->bottom_text_stale = true;
+    }
+}
+
+// Function to render the text of a view that was left out while it showed hexdump rows
+static void ensure_view_text(WindowData *data, GtkTextBuffer *buffer) {
+    bool stale = buffer == data->top_buffer ? data->top_text_stale : data->bottom_text_stale;
+    if (!stale) return;
+
+    GtkDropDown *dropdown = buffer == data->top_buffer ? data->top_encoding_dropdown : data->bottom_encoding_dropdown;
+    bool was_updating = data->is_updating;
+    data->is_updating = true;
+    render_view_text(data, buffer, gtk_drop_down_get_selected(dropdown));
+    data->is_updating = was_updating;
+}
+
+// Function to refresh the prompt size estimate shown in the AI translator
+static void update_ai_estimate(WindowData *data) {
+    if (data->ai_translator_box == NULL || !gtk_widget_get_visible(data->ai_translator_box)) return;
+    if (data->bottom_buffer == NULL) return;
+
+    ensure_view_text(data, data->bottom_buffer);
+    char *text = get_buffer_text(data->bottom_buffer);
+    update_ai_token_estimate(data->ai_translator_box, text,
+                             encoding_type_to_string(gtk_drop_down_get_selected(data->top_encoding_dropdown)),
+                             encoding_type_to_string(gtk_drop_down_get_selected(data->bottom_encoding_dropdown)));
+    g_free(text);
+}
+
+// Function to show a view as text or, when it shows hex in a dump layout, as hexdump rows
+// The rows are laid out as they scroll into sight, with the other view's encoding beside them.
+// Text that didn't convert stays on show, so it can be fixed.
+static void update_view_layout(WindowData *data, GtkTextBuffer *buffer) {
+    bool top = buffer == data->top_buffer;
+    GtkDropDown *encoding_dropdown = top ? data->top_encoding_dropdown : data->bottom_encoding_dropdown;
+    GtkDropDown *other_dropdown = top ? data->bottom_encoding_dropdown : data->top_encoding_dropdown;
+    GtkDropDown *layout_dropdown = top ? data->top_layout_dropdown : data->bottom_layout_dropdown;
+    GtkWidget *stack = top ? data->top_stack : data->bottom_stack;
+    GtkWidget *dump_view = top ? data->top_dump_view : data->bottom_dump_view;
+    if (stack == NULL) return;
+
+    EncodingType encoding = gtk_drop_down_get_selected(encoding_dropdown);
+    guint row_bytes = hex_layouts[gtk_drop_down_get_selected(layout_dropdown)].row_bytes;
+    bool dump = view_shows_dump(data, buffer, encoding);
+    gtk_widget_set_sensitive(GTK_WIDGET(layout_dropdown), encoding == HEX);
+
+    if (dump) {
+        hex_dump_view_set_bytes(dump_view, byte_document_get_bytes(data->document), row_bytes,
+                                gtk_drop_down_get_selected(other_dropdown));
+    } else {
+        hex_dump_view_set_bytes(dump_view, NULL, 16, ASCII);
+        ensure_view_text(data, buffer);
+    }
+    gtk_stack_set_visible_child_name(GTK_STACK(stack), dump ? "dump" : "text");
+}
+
+// Function to bring the layout of both views up to date
+static void update_layouts(WindowData *data) {
+    update_view_layout(data, data->top_buffer);
+    update_view_layout(data, data->bottom_buffer);
+}
+
+// Update conversion between the two text views: the top text becomes the document
 static void update_conversion(WindowData *data) {
     if (data->is_updating) return;
     data->is_updating = true;
 
-    // Get the source text (from top buffer)
-    GtkTextIter start, end;
-    gtk_text_buffer_get_bounds(data->top_buffer, &start, &end);
-    char *source_text = gtk_text_buffer_get_text(data->top_buffer, &start, &end, FALSE);
-
-    // Get encoding types
+    char *source_text = get_buffer_text(data->top_buffer);
     EncodingType from_type = gtk_drop_down_get_selected(data->top_encoding_dropdown);
-    EncodingType to_type = gtk_drop_down_get_selected(data->bottom_encoding_dropdown);
+    bool parsed = parse_view_into_document(data, source_text, from_type);
+    data->unparsed_buffer = parsed ? NULL : data->top_buffer;
 
-    // Convert between formats
-    char *result = NULL;
-    size_t result_len = 0;
+    // Detection may change the bottom encoding, so it goes first
+    update_detection(data);
+    update_preview_panel(data);
+    EncodingType to_type = gtk_drop_down_get_selected(data->bottom_encoding_dropdown);
 
-    if (strlen(source_text) > 0) {
+    if (parsed) {
+        render_view(data, data->bottom_buffer, to_type);
+    } else {
+        // Show what can be salvaged from the text
+        char *result = NULL;
+        size_t result_len = 0;
         convert_between_formats(source_text, from_type, &result, &result_len, to_type);
         gtk_text_buffer_set_text(data->bottom_buffer, result, -1);
+        data->bottom_stats_valid = false;
+        data->bottom_text_stale = false;
         g_free(result);
-    } else {
-        gtk_text_buffer_set_text(data->bottom_buffer, "", -1);
     }
 
     g_free(source_text);
     data->is_updating = false;
+    update_layouts(data);
 
     // Update character and byte counters
     update_counter_labels(data);
 }
 
-// Update conversion from bottom to top
+// Update conversion from bottom to top: the bottom text becomes the document
 static void update_reverse_conversion(WindowData *data) {
     if (data->is_updating) return;
     data->is_updating = true;
 
-    // Get the source text (from bottom buffer)
-    GtkTextIter start, end;
-    gtk_text_buffer_get_bounds(data->bottom_buffer, &start, &end);
-    char *source_text = gtk_text_buffer_get_text(data->bottom_buffer, &start, &end, FALSE);
-
-    // Get encoding types
+    char *source_text = get_buffer_text(data->bottom_buffer);
+    data->bottom_bytes = strlen(source_text);
+    data->bottom_chars = g_utf8_strlen(source_text, data->bottom_bytes);
+    data->bottom_stats_valid = true;
     EncodingType from_type = gtk_drop_down_get_selected(data->bottom_encoding_dropdown);
-    EncodingType to_type = gtk_drop_down_get_selected(data->top_encoding_dropdown);
-
-    // Convert between formats
-    char *result = NULL;
-    size_t result_len = 0;
+    bool parsed = parse_view_into_document(data, source_text, from_type);
+    data->unparsed_buffer = parsed ? NULL : data->bottom_buffer;
+    update_preview_panel(data);
 
-    if (strlen(source_text) > 0) {
-        convert_between_formats(source_text, from_type, &result, &result_len, to_type);
-        gtk_text_buffer_set_text(data->top_buffer, result, -1);
-        g_free(result);
+    if (parsed) {
+        render_view(data, data->top_buffer, gtk_drop_down_get_selected(data->top_encoding_dropdown));
     } else {
-        gtk_text_buffer_set_text(data->top_buffer, "", -1);
+        gtk_text_buffer_set_text(data->top_buffer, "[Conversion error - invalid input format]", -1);
+        data->top_text_stale = false;
     }
 
     g_free(source_text);
     data->is_updating = false;
+    update_layouts(data);
 
     // Update character and byte counters
     update_counter_labels(data);
 }
 
+// Function to show the document again in a view whose encoding (or table) changed
+static void refresh_view(WindowData *data, GtkTextBuffer *buffer) {
+    if (data->is_updating) return;
+
+    // Text that didn't convert is tried again instead, as there is no document to show
+    if (data->unparsed_buffer == data->bottom_buffer) {
+        update_reverse_conversion(data);
+        return;
+    } else if (data->unparsed_buffer == data->top_buffer) {
+        update_conversion(data);
+        return;
+    }
+
+    data->is_updating = true;
+    GtkDropDown *dropdown = buffer == data->top_buffer ? data->top_encoding_dropdown : data->bottom_encoding_dropdown;
+    render_view(data, buffer, gtk_drop_down_get_selected(dropdown));
+    data->is_updating = false;
+    update_layouts(data);
+
+    update_counter_labels(data);
+}
+
 // Function to update character and byte counters
 static void update_counter_labels(WindowData *data) {
     if (data->is_updating) return;
@@ -471,128 +504,134 @@ static void update_counter_labels(WindowData *data) {
 
     // Update top counter
     if (data->top_buffer != NULL && data->top_counter_label != NULL) {
-        GtkTextIter start, end;
-        gtk_text_buffer_get_bounds(data->top_buffer, &start, &end);
-        char *text = gtk_text_buffer_get_text(data->top_buffer, &start, &end, FALSE);
-
         size_t bytes, chars;
 
-        if (top_encoding == HEX) {
-            // For hex input, show the decoded metrics
+        if (encoding_is_byte_format(top_encoding) && data->unparsed_buffer != data->top_buffer) {
+            // For hex input, show the metrics of the bytes
             size_t bin_len = 0;
-            unsigned char *bin_data = hex_to_binary(text, &bin_len);
-
-            if (bin_data) {
-                // For hex input, we want to show the actual number of bytes in the binary data
-                bytes = bin_len;
-
-                // For character count, we need to interpret based on the encoding
-                if (bottom_encoding == UTF16LE || bottom_encoding == UTF16BE) {
-                    // For UTF-16, each character is typically 2 bytes
-                    // Count the actual characters by looking at the data
-                    chars = 0;
-                    size_t i = 0;
-                    while (i < bin_len) {
-                        // Check if we have enough bytes for a character
-                        if (i + 1 >= bin_len) {
-                            // Incomplete character at the end
-                            chars++;
-                            break;
-                        }
+            const unsigned char *bin_data = byte_document_get_data(data->document, &bin_len);
+
+            // For hex input, we want to show the actual number of bytes in the binary data
+            bytes = bin_len;
+
+            // For character count, we need to interpret based on the encoding
+            if (bottom_encoding == UTF16LE || bottom_encoding == UTF16BE) {
+                // For UTF-16, each character is typically 2 bytes
+                // Count the actual characters by looking at the data
+                chars = 0;
+                size_t i = 0;
+                while (i < bin_len) {
+                    // Check if we have enough bytes for a character
+                    if (i + 1 >= bin_len) {
+                        // Incomplete character at the end
+                        chars++;
+                        break;
+                    }
 
-                        // Get the code unit
-                        guint16 code_unit;
-                        if (bottom_encoding == UTF16LE) {
-                            code_unit = bin_data[i] | (bin_data[i+1] << 8);
-                        } else { // UTF16BE
-                            code_unit = (bin_data[i] << 8) | bin_data[i+1];
-                        }
+                    // Get the code unit
+                    guint16 code_unit;
+                    if (bottom_encoding == UTF16LE) {
+                        code_unit = bin_data[i] | (bin_data[i+1] << 8);
+                    } else { // UTF16BE
+                        code_unit = (bin_data[i] << 8) | bin_data[i+1];
+                    }
 
-                        // Check if it's a high surrogate (part of a surrogate pair)
-                        if (code_unit >= 0xD800 && code_unit <= 0xDBFF) {
-                            // This is a surrogate pair, need 4 bytes for one character
-                            if (i + 3 < bin_len) {
-                                // We have enough bytes for the low surrogate
-                                guint16 low_surrogate;
-                                if (bottom_encoding == UTF16LE) {
-                                    low_surrogate = bin_data[i+2] | (bin_data[i+3] << 8);
-                                } else { // UTF16BE
-                                    low_surrogate = (bin_data[i+2] << 8) | bin_data[i+3];
-                                }
-
-                                if (low_surrogate >= 0xDC00 && low_surrogate <= 0xDFFF) {
-                                    // Valid surrogate pair
-                                    chars++;
-                                    i += 4; // Skip both surrogates (4 bytes)
-                                    continue;
-                                }
+                    // Check if it's a high surrogate (part of a surrogate pair)
+                    if (code_unit >= 0xD800 && code_unit <= 0xDBFF) {
+                        // This is a surrogate pair, need 4 bytes for one character
+                        if (i + 3 < bin_len) {
+                            // We have enough bytes for the low surrogate
+                            guint16 low_surrogate;
+                            if (bottom_encoding == UTF16LE) {
+                                low_surrogate = bin_data[i+2] | (bin_data[i+3] << 8);
+                            } else { // UTF16BE
+                                low_surrogate = (bin_data[i+2] << 8) | bin_data[i+3];
+                            }
+
+                            if (low_surrogate >= 0xDC00 && low_surrogate <= 0xDFFF) {
+                                // Valid surrogate pair
+                                chars++;
+                                i += 4; // Skip both surrogates (4 bytes)
+                                continue;
                             }
-                            // Invalid or incomplete surrogate pair
-                            chars++;
-                            i += 2;
-                        } else {
-                            // Regular BMP character
-                            chars++;
-                            i += 2;
                         }
-                    }
-                } else if (bottom_encoding == UTF8) {
-                    // For UTF-8, count Unicode code points
-                    char *utf8_text = g_convert((const char *)bin_data, bin_len, "UTF-8", "UTF-8", NULL, NULL, NULL);
-                    if (utf8_text) {
-                        chars = g_utf8_strlen(utf8_text, -1);
-                        g_free(utf8_text);
+                        // Invalid or incomplete surrogate pair
+                        chars++;
+                        i += 2;
                     } else {
-                        chars = bin_len; // Fallback
+                        // Regular BMP character
+                        chars++;
+                        i += 2;
                     }
+                }
+            } else if (bottom_encoding == UTF8) {
+                // For UTF-8, count Unicode code points
+                char *utf8_text = g_convert((const char *)bin_data, bin_len, "UTF-8", "UTF-8", NULL, NULL, NULL);
+                if (utf8_text) {
+                    chars = g_utf8_strlen(utf8_text, -1);
+                    g_free(utf8_text);
                 } else {
-                    // For ASCII and other encodings, assume 1:1 mapping
-                    chars = bin_len;
+                    chars = bin_len; // Fallback
                 }
-
-                g_free(bin_data);
             } else {
-                // If conversion failed, show raw metrics
-                bytes = strlen(text);
-                chars = g_utf8_strlen(text, -1);
+                // For ASCII and other encodings, assume 1:1 mapping
+                chars = bin_len;
             }
         } else {
-            // For non-hex input, show raw metrics
+            // For non-hex input, and hex that didn't convert, show raw metrics
+            char *text = get_buffer_text(data->top_buffer);
             bytes = strlen(text);
             chars = g_utf8_strlen(text, -1);
+            g_free(text);
         }
 
         // Update the label
-        char counter_text[100];
-        snprintf(counter_text, sizeof(counter_text), "Characters: %zu | Bytes: %zu", chars, bytes);
+        char counter_text[160];
+        if (encoding_is_byte_format(top_encoding) && data->detected_summary) {
+            snprintf(counter_text, sizeof(counter_text), "Characters: %zu | Bytes: %zu | %s",
+                     chars, bytes, data->detected_summary);
+        } else {
+            snprintf(counter_text, sizeof(counter_text), "Characters: %zu | Bytes: %zu", chars, bytes);
+        }
         gtk_label_set_text(GTK_LABEL(data->top_counter_label), counter_text);
-
-        g_free(text);
     }
 
     // Update bottom counter
     if (data->bottom_buffer != NULL && data->bottom_counter_label != NULL) {
-        GtkTextIter start, end;
-        gtk_text_buffer_get_bounds(data->bottom_buffer, &start, &end);
-        char *text = gtk_text_buffer_get_text(data->bottom_buffer, &start, &end, FALSE);
-
-        // For the bottom counter, always show the actual metrics
-        size_t bytes = strlen(text);
-        size_t chars = g_utf8_strlen(text, -1);
+        // For the bottom counter, always show the actual metrics (known from rendering when cached)
+        char *text = NULL;
+        if (!data->bottom_stats_valid) {
+            text = get_buffer_text(data->bottom_buffer);
+            data->bottom_bytes = strlen(text);
+            data->bottom_chars = g_utf8_strlen(text, -1);
+            data->bottom_stats_valid = true;
+        }
 
         // Update the label
         char counter_text[100];
-        snprintf(counter_text, sizeof(counter_text), "Characters: %zu | Bytes: %zu", chars, bytes);
+        snprintf(counter_text, sizeof(counter_text), "Characters: %zu | Bytes: %zu",
+                 data->bottom_chars, data->bottom_bytes);
         gtk_label_set_text(GTK_LABEL(data->bottom_counter_label), counter_text);
 
         g_free(text);
     }
+
+    update_ai_estimate(data);
 }
 
 // Callback for text buffer changes
 static void on_text_buffer_changed(GtkTextBuffer *buffer, gpointer user_data) {
     WindowData *data = (WindowData *)user_data;
 
+    // Text typed or pasted in is the view's text now
+    if (!data->is_updating) {
+        if (buffer == data->top_buffer) {
+            data->top_text_stale = false;
+        } else if (buffer == data->bottom_buffer) {
+            data->bottom_text_stale = false;
+        }
+    }
+
     if (buffer == data->top_buffer) {
         update_conversion(data); // Top to bottom
     } else if (buffer == data->bottom_buffer) {
@@ -604,46 +643,61 @@ static void on_text_buffer_changed(GtkTextBuffer *buffer, gpointer user_data) {
 static void on_encoding_changed(GtkDropDown *dropdown, GParamSpec *pspec, gpointer user_data) {
     WindowData *data = (WindowData *)user_data;
 
-    // When encoding changes, update the conversion
-    if (dropdown == data->top_encoding_dropdown || dropdown == data->bottom_encoding_dropdown) {
-        update_conversion(data);
+    // A bottom encoding picked by hand sticks until the input is cleared
+    if (dropdown == data->bottom_encoding_dropdown && !data->auto_selecting && !data->is_updating) {
+        data->bottom_encoding_chosen = true;
+    }
+
+    // The bytes stay the same; only the view whose encoding changed is shown again
+    if (dropdown == data->top_encoding_dropdown) {
+        refresh_view(data, data->top_buffer);
+        if (!data->is_updating && data->unparsed_buffer == NULL) {
+            update_detection(data);
+            update_counter_labels(data);
+        }
+    } else if (dropdown == data->bottom_encoding_dropdown) {
+        refresh_view(data, data->bottom_buffer);
     }
 }
 
-// Callback for swap button
-static void on_swap_clicked(GtkButton *button, gpointer user_data) {
+// Callback for layout dropdown changes
+static void on_layout_changed(GtkDropDown *dropdown, GParamSpec *pspec, gpointer user_data) {
     WindowData *data = (WindowData *)user_data;
-    GtkTextIter start, end;
+    update_view_layout(data, dropdown == data->top_layout_dropdown ? data->top_buffer : data->bottom_buffer);
+}
 
-    // Get top content
-    gtk_text_buffer_get_bounds(data->top_buffer, &start, &end);
-    char *top_content = gtk_text_buffer_get_text(data->top_buffer, &start, &end, FALSE);
+// Callback for swap button: swap the encodings and show the same bytes in both views again
+static void on_swap_clicked(GtkButton *button, gpointer user_data) {
+    WindowData *data = (WindowData *)user_data;
 
-    // Get bottom content
-    gtk_text_buffer_get_bounds(data->bottom_buffer, &start, &end);
-    char *bottom_content = gtk_text_buffer_get_text(data->bottom_buffer, &start, &end, FALSE);
+    // Text that didn't convert moves to the other view with its encoding
+    GtkTextBuffer *unparsed_buffer = data->unparsed_buffer;
+    char *unparsed_text = unparsed_buffer != NULL ? get_buffer_text(unparsed_buffer) : NULL;
 
-    // Swap encoding selections
     guint top_encoding = gtk_drop_down_get_selected(data->top_encoding_dropdown);
     guint bottom_encoding = gtk_drop_down_get_selected(data->bottom_encoding_dropdown);
 
     data->is_updating = true; // Prevent recursive updates
-
-    // Swap contents
-    gtk_text_buffer_set_text(data->top_buffer, bottom_content, -1);
-    gtk_text_buffer_set_text(data->bottom_buffer, top_content, -1);
-
-    // Swap encodings
     gtk_drop_down_set_selected(data->top_encoding_dropdown, bottom_encoding);
     gtk_drop_down_set_selected(data->bottom_encoding_dropdown, top_encoding);
+    data->is_updating = false;
 
-    g_free(top_content);
-    g_free(bottom_content);
+    if (unparsed_text != NULL) {
+        GtkTextBuffer *target = unparsed_buffer == data->top_buffer ? data->bottom_buffer : data->top_buffer;
+        data->unparsed_buffer = NULL;
+        gtk_text_buffer_set_text(target, unparsed_text, -1);
+        g_free(unparsed_text);
+        return;
+    }
 
+    data->is_updating = true;
+    update_detection(data);
+    render_view(data, data->top_buffer, bottom_encoding);
+    render_view(data, data->bottom_buffer, gtk_drop_down_get_selected(data->bottom_encoding_dropdown));
     data->is_updating = false;
+    update_layouts(data);
 
-    // Update conversion
-    update_conversion(data);
+    update_counter_labels(data);
 }
 
 // Create a text view with monospace font
@@ -683,7 +737,9 @@ static GtkWidget *create_encoding_dropdown(const char *label_text, EncodingType
     const char * const encoding_strings[] = {
         "Hex", "ASCII", "UTF-8", "UTF-16LE", "UTF-16BE",
         "UTF-32LE", "UTF-32BE", "ISO-8859-1", "ISO-8859-15",
-        "Shift-JIS", "EUC-JP", "KOI8-R", NULL
+        "Shift-JIS", "EUC-JP", "KOI8-R", "Table (.tbl)",
+        "Base64", "Base64url", "Base32", "Ascii85",
+        "C String", "JSON String", "URL Encoded", NULL
     };
     GtkStringList *encodings = gtk_string_list_new(encoding_strings);
 
@@ -698,6 +754,21 @@ static GtkWidget *create_encoding_dropdown(const char *label_text, EncodingType
     return box;
 }
 
+// Create a dropdown for the hex layout, added to a format box
+static GtkDropDown *create_layout_dropdown(GtkWidget *box) {
+    const char *layout_strings[G_N_ELEMENTS(hex_layouts) + 1];
+    for (guint i = 0; i < G_N_ELEMENTS(hex_layouts); i++) {
+        layout_strings[i] = hex_layouts[i].name;
+    }
+    layout_strings[G_N_ELEMENTS(hex_layouts)] = NULL;
+    GtkStringList *layouts = gtk_string_list_new(layout_strings);
+    GtkWidget *dropdown = gtk_drop_down_new(G_LIST_MODEL(layouts), NULL);
+
+    gtk_box_append(GTK_BOX(box), gtk_label_new("Layout:"));
+    gtk_box_append(GTK_BOX(box), dropdown);
+    return GTK_DROP_DOWN(dropdown);
+}
+
 // Application activate callback
 static void activate(GtkApplication *app, gpointer user_data) {
     // If user_data is NULL, create a new window, otherwise use the provided window
@@ -712,6 +783,8 @@ static void activate(GtkApplication *app, gpointer user_data) {
     WindowData *data = g_malloc(sizeof(WindowData));
     memset(data, 0, sizeof(WindowData));
     data->is_updating = false;
+    data->document = byte_document_new();
+    data->render_cache = render_cache_new(RENDER_CACHE_ENTRIES, RENDER_CACHE_BYTES);
 
     // Store the data in the window
     g_object_set_data(G_OBJECT(window), "window_data", data);
@@ -732,6 +805,10 @@ static void activate(GtkApplication *app, gpointer user_data) {
     // Create menu model
     GMenu *tools_menu = g_menu_new();
     g_menu_append(tools_menu, "New Window", "app.new_window");
+    g_menu_append(tools_menu, "Load Table File…", "app.load_table");
+    g_menu_append(tools_menu, "Scan File…", "app.scan_file");
+    g_menu_append(tools_menu, "Patch File…", "app.patch_file");
+    g_menu_append(tools_menu, "Encoding Preview", "app.encoding_preview");
     g_menu_append(tools_menu, "AI Translator", "app.ai_translator");
     g_menu_append(tools_menu, "AI Settings", "app.ai_settings");
 
@@ -741,16 +818,28 @@ static void activate(GtkApplication *app, gpointer user_data) {
 
     // Create actions
     GSimpleAction *new_window_action = g_simple_action_new("new_window", NULL);
+    GSimpleAction *load_table_action = g_simple_action_new("load_table", NULL);
+    GSimpleAction *scan_file_action = g_simple_action_new("scan_file", NULL);
+    GSimpleAction *patch_file_action = g_simple_action_new("patch_file", NULL);
+    GSimpleAction *encoding_preview_action = g_simple_action_new("encoding_preview", NULL);
     GSimpleAction *ai_translator_action = g_simple_action_new("ai_translator", NULL);
     GSimpleAction *ai_settings_action = g_simple_action_new("ai_settings", NULL);
 
     // Action handlers
     g_signal_connect(new_window_action, "activate", G_CALLBACK(open_new_window), app);
+    g_signal_connect(load_table_action, "activate", G_CALLBACK(load_table_file), window);
+    g_signal_connect(scan_file_action, "activate", G_CALLBACK(scan_file), window);
+    g_signal_connect(patch_file_action, "activate", G_CALLBACK(patch_file), window);
+    g_signal_connect(encoding_preview_action, "activate", G_CALLBACK(toggle_encoding_preview), window);
     g_signal_connect(ai_translator_action, "activate", G_CALLBACK(toggle_ai_translator), window);
     g_signal_connect(ai_settings_action, "activate", G_CALLBACK(show_ai_settings), window);
 
     // Add actions to application
     g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(new_window_action));
+    g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(load_table_action));
+    g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(scan_file_action));
+    g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(patch_file_action));
+    g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(encoding_preview_action));
     g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(ai_translator_action));
     g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(ai_settings_action));
 
@@ -769,11 +858,16 @@ static void activate(GtkApplication *app, gpointer user_data) {
     GtkWidget *top_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
     GtkWidget *top_label_box = create_encoding_dropdown("Format:", HEX);
     data->top_encoding_dropdown = GTK_DROP_DOWN(gtk_widget_get_last_child(top_label_box));
+    data->top_layout_dropdown = create_layout_dropdown(top_label_box);
 
-    // Create top text view with scrolling
+    // Create top text view with scrolling, and the hexdump shown instead in a dump layout
     GtkWidget *top_scroll = gtk_scrolled_window_new();
     data->top_text_view = create_text_view(&data->top_buffer);
     gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(top_scroll), data->top_text_view);
+    data->top_dump_view = hex_dump_view_new();
+    data->top_stack = gtk_stack_new();
+    gtk_stack_add_named(GTK_STACK(data->top_stack), top_scroll, "text");
+    gtk_stack_add_named(GTK_STACK(data->top_stack), data->top_dump_view, "dump");
 
     // Create character/byte counter for top field
     data->top_counter_label = gtk_label_new("Characters: 0 | Bytes: 0");
@@ -783,7 +877,7 @@ static void activate(GtkApplication *app, gpointer user_data) {
 
     // Pack top widgets
     gtk_box_append(GTK_BOX(top_box), top_label_box);
-    gtk_box_append(GTK_BOX(top_box), top_scroll);
+    gtk_box_append(GTK_BOX(top_box), data->top_stack);
     gtk_box_append(GTK_BOX(top_box), data->top_counter_label);
 
     // Swap button
@@ -800,11 +894,16 @@ static void activate(GtkApplication *app, gpointer user_data) {
     GtkWidget *bottom_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
     GtkWidget *bottom_label_box = create_encoding_dropdown("Format:", UTF8);
     data->bottom_encoding_dropdown = GTK_DROP_DOWN(gtk_widget_get_last_child(bottom_label_box));
+    data->bottom_layout_dropdown = create_layout_dropdown(bottom_label_box);
 
-    // Create bottom text view with scrolling
+    // Create bottom text view with scrolling, and the hexdump shown instead in a dump layout
     GtkWidget *bottom_scroll = gtk_scrolled_window_new();
     data->bottom_text_view = create_text_view(&data->bottom_buffer);
     gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(bottom_scroll), data->bottom_text_view);
+    data->bottom_dump_view = hex_dump_view_new();
+    data->bottom_stack = gtk_stack_new();
+    gtk_stack_add_named(GTK_STACK(data->bottom_stack), bottom_scroll, "text");
+    gtk_stack_add_named(GTK_STACK(data->bottom_stack), data->bottom_dump_view, "dump");
 
     // Create character/byte counter for bottom field
     data->bottom_counter_label = gtk_label_new("Characters: 0 | Bytes: 0");
@@ -814,13 +913,19 @@ static void activate(GtkApplication *app, gpointer user_data) {
 
     // Pack bottom widgets
     gtk_box_append(GTK_BOX(bottom_box), bottom_label_box);
-    gtk_box_append(GTK_BOX(bottom_box), bottom_scroll);
+    gtk_box_append(GTK_BOX(bottom_box), data->bottom_stack);
     gtk_box_append(GTK_BOX(bottom_box), data->bottom_counter_label);
 
     // Add the bottom box to the container
     gtk_box_append(GTK_BOX(bottom_container), bottom_box);
     gtk_widget_set_hexpand(bottom_box, TRUE);
 
+    // Middle - encoding preview (initially hidden)
+    data->encoding_preview_box = create_encoding_preview_ui(data->bottom_encoding_dropdown);
+    gtk_widget_set_visible(data->encoding_preview_box, FALSE);
+    gtk_widget_set_hexpand(data->encoding_preview_box, TRUE);
+    gtk_box_append(GTK_BOX(bottom_container), data->encoding_preview_box);
+
     // Right side - AI translator (initially hidden)
     data->ai_translator_box = create_ai_translator_ui(window);
     if (data->ai_translator_box != NULL) {
@@ -853,6 +958,8 @@ static void activate(GtkApplication *app, gpointer user_data) {
     g_signal_connect(data->bottom_buffer, "changed", G_CALLBACK(on_text_buffer_changed), data);
     g_signal_connect(data->top_encoding_dropdown, "notify::selected", G_CALLBACK(on_encoding_changed), data);
     g_signal_connect(data->bottom_encoding_dropdown, "notify::selected", G_CALLBACK(on_encoding_changed), data);
+    g_signal_connect(data->top_layout_dropdown, "notify::selected", G_CALLBACK(on_layout_changed), data);
+    g_signal_connect(data->bottom_layout_dropdown, "notify::selected", G_CALLBACK(on_layout_changed), data);
 
     // Store references for use in action handlers
     g_object_set_data(G_OBJECT(window), "window_data", data);
@@ -861,7 +968,8 @@ static void activate(GtkApplication *app, gpointer user_data) {
     g_object_set_data(G_OBJECT(window), "top_encoding_dropdown", data->top_encoding_dropdown);
     g_object_set_data(G_OBJECT(window), "bottom_encoding_dropdown", data->bottom_encoding_dropdown);
 
-    // Initial update of the counters
+    // Initial update of the layouts and counters
+    update_layouts(data);
     update_counter_labels(data);
 
     // Show window
@@ -904,6 +1012,11 @@ static void toggle_ai_translator(GSimpleAction *action, GVariant *parameter, gpo
         gboolean visible = gtk_widget_get_visible(data->ai_translator_box);
         fprintf(stderr, "DEBUG: Current visibility: %d, setting to: %d\n", visible, !visible);
         gtk_widget_set_visible(data->ai_translator_box, !visible);
+
+        // The estimate is only kept up to date while shown
+        if (!visible) {
+            update_ai_estimate(data);
+        }
     } else {
         fprintf(stderr, "ERROR: ai_translator_box is NULL!\n");
     }
@@ -911,6 +1024,99 @@ static void toggle_ai_translator(GSimpleAction *action, GVariant *parameter, gpo
     fprintf(stderr, "DEBUG: toggle_ai_translator() completed\n");
 }
 
+// Toggle encoding preview visibility
+static void toggle_encoding_preview(GSimpleAction *action, GVariant *parameter, gpointer user_data) {
+    GtkWidget *window = GTK_WIDGET(user_data);
+    WindowData *data = g_object_get_data(G_OBJECT(window), "window_data");
+    if (data == NULL || data->encoding_preview_box == NULL) {
+        fprintf(stderr, "ERROR: encoding preview is not available\n");
+        return;
+    }
+
+    gboolean visible = gtk_widget_get_visible(data->encoding_preview_box);
+    gtk_widget_set_visible(data->encoding_preview_box, !visible);
+
+    // The preview is only kept up to date while shown
+    if (!visible) {
+        update_preview_panel(data);
+    }
+}
+
+// Callback for the table file dialog: load the table and show the bottom view through it
+static void on_table_file_chosen(GObject *source, GAsyncResult *result, gpointer user_data) {
+    GtkWidget *window = GTK_WIDGET(user_data);
+    GError *error = NULL;
+    GFile *file = gtk_file_dialog_open_finish(GTK_FILE_DIALOG(source), result, &error);
+
+    if (file == NULL) {
+        // Cancelled
+        g_clear_error(&error);
+        g_object_unref(window);
+        return;
+    }
+
+    char *path = g_file_get_path(file);
+    char *message = NULL;
+    CharTable *table = path != NULL ? char_table_load(path, &message) : NULL;
+
+    if (table == NULL) {
+        fprintf(stderr, "ERROR: Failed to load table %s: %s\n", path ? path : "(no path)", message ? message : "");
+        char *text = g_strdup_printf("Could not load the table: %s", message ? message : "not a local file");
+        GtkAlertDialog *alert = gtk_alert_dialog_new("%s", text);
+        gtk_alert_dialog_set_modal(alert, TRUE);
+        gtk_alert_dialog_show(alert, GTK_WINDOW(window));
+        g_object_unref(alert);
+        g_free(text);
+    } else {
+        char_table_set_active(table);
+        char_table_unref(table);
+
+        WindowData *data = g_object_get_data(G_OBJECT(window), "window_data");
+        if (data != NULL) {
+            if (gtk_drop_down_get_selected(data->bottom_encoding_dropdown) == TABLE_FILE) {
+                refresh_view(data, data->bottom_buffer);
+            } else {
+                gtk_drop_down_set_selected(data->bottom_encoding_dropdown, TABLE_FILE);
+            }
+        }
+    }
+
+    g_free(message);
+    g_free(path);
+    g_object_unref(file);
+    g_object_unref(window);
+}
+
+// Show the dialog for loading a character table
+static void load_table_file(GSimpleAction *action, GVariant *parameter, gpointer user_data) {
+    GtkWidget *window = GTK_WIDGET(user_data);
+
+    GtkFileFilter *filter = gtk_file_filter_new();
+    gtk_file_filter_set_name(filter, "Table files (*.tbl)");
+    gtk_file_filter_add_pattern(filter, "*.tbl");
+    gtk_file_filter_add_pattern(filter, "*.TBL");
+
+    GtkFileDialog *dialog = gtk_file_dialog_new();
+    gtk_file_dialog_set_title(dialog, "Load Table File");
+    gtk_file_dialog_set_default_filter(dialog, filter);
+    gtk_file_dialog_open(dialog, GTK_WINDOW(window), NULL, on_table_file_chosen, g_object_ref(window));
+
+    g_object_unref(filter);
+    g_object_unref(dialog);
+}
+
+// Show the file scanner
+static void scan_file(GSimpleAction *action, GVariant *parameter, gpointer user_data) {
+    GtkWidget *window = GTK_WIDGET(user_data);
+    show_scan_window(window);
+}
+
+// Show the binary patcher
+static void patch_file(GSimpleAction *action, GVariant *parameter, gpointer user_data) {
+    GtkWidget *window = GTK_WIDGET(user_data);
+    show_patch_window(window);
+}
+
 // Show AI settings dialog
 static void show_ai_settings(GSimpleAction *action, GVariant *parameter, gpointer user_data) {
     GtkWidget *window = GTK_WIDGET(user_data);
@@ -939,6 +1145,7 @@ static void on_send_to_ai_clicked(GtkButton *button, gpointer user_data) {
     }
 
     // Get the text from the bottom buffer
+    ensure_view_text(data, data->bottom_buffer);
     GtkTextIter start, end;
     gtk_text_buffer_get_bounds(data->bottom_buffer, &start, &end);
     char *text = gtk_text_buffer_get_text(data->bottom_buffer, &start, &end, FALSE);
@@ -968,6 +1175,11 @@ static void on_send_to_ai_clicked(GtkButton *button, gpointer user_data) {
 static void on_window_destroy(GtkWidget *window, gpointer user_data) {
     WindowData *data = g_object_get_data(G_OBJECT(window), "window_data");
     if (data != NULL) {
+        if (data->encoding_detector) encoding_detector_free(data->encoding_detector);
+        if (data->detected_bytes) g_bytes_unref(data->detected_bytes);
+        byte_document_unref(data->document);
+        render_cache_free(data->render_cache);
+        g_free(data->detected_summary);
         g_free(data);
     }
 }
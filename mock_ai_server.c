@@ -0,0 +1,474 @@
+// Local stand-in for the OpenAI and Gemini endpoints used by ai_client.c
+// Answers /v1/chat/completions, /v1beta/models/<model>:generateContent and the model lists
+// with the same JSON shapes as the real APIs, after a configurable latency, with injected
+// errors and 429s, optionally trickling the body in chunks. The reply echoes the content
+// that was sent for translation. Point the app at it with
+//   HEX2TEXT_OPENAI_BASE_URL=http://127.0.0.1:8089 HEX2TEXT_GEMINI_BASE_URL=http://127.0.0.1:8089
+#include <glib.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "json_stream.h"
+
+// Largest request accepted
+#define MAX_REQUEST_BYTES (16 * 1024 * 1024)
+
+// Markers after which the prompts built by ai_translator.c carry the text to translate
+static const char *content_markers[] = { "Content to translate:\n", "New source:\n", NULL };
+
+// Server settings from the command line
+static gint port = 8089;
+static gchar *bind_address = NULL;
+static gchar *latency_distribution = NULL;
+static gdouble latency_ms = 800;
+static gdouble latency_sigma = 0.6;
+static gdouble error_rate = 0;
+static gdouble rate_limit_rate = 0;
+static gint retry_after_seconds = 1;
+static gboolean stream = FALSE;
+static gint chunk_bytes = 64;
+static gdouble chunk_delay_ms = 20;
+static gint64 seed = 1;
+static gboolean quiet = FALSE;
+
+static GOptionEntry option_entries[] = {
+    { "port", 'p', 0, G_OPTION_ARG_INT, &port, "Port to listen on (default 8089)", "PORT" },
+    { "bind", 'b', 0, G_OPTION_ARG_STRING, &bind_address, "Address to listen on (default 127.0.0.1)", "ADDR" },
+    { "latency", 'l', 0, G_OPTION_ARG_DOUBLE, &latency_ms, "Median time to first byte in ms (default 800)", "MS" },
+    { "distribution", 'd', 0, G_OPTION_ARG_STRING, &latency_distribution,
+      "Latency distribution: fixed, uniform, exponential or lognormal (default)", "NAME" },
+    { "sigma", 0, 0, G_OPTION_ARG_DOUBLE, &latency_sigma, "Spread of the lognormal distribution (default 0.6)", "S" },
+    { "error-rate", 'e', 0, G_OPTION_ARG_DOUBLE, &error_rate, "Fraction of requests answered with HTTP 500", "P" },
+    { "rate-limit-rate", 'r', 0, G_OPTION_ARG_DOUBLE, &rate_limit_rate, "Fraction of requests answered with HTTP 429", "P" },
+    { "retry-after", 0, 0, G_OPTION_ARG_INT, &retry_after_seconds, "Retry-After seconds sent with a 429 (default 1)", "S" },
+    { "stream", 's', 0, G_OPTION_ARG_NONE, &stream, "Send bodies chunked, a piece at a time", NULL },
+    { "chunk-bytes", 0, 0, G_OPTION_ARG_INT, &chunk_bytes, "Bytes per streamed chunk (default 64)", "N" },
+    { "chunk-delay", 0, 0, G_OPTION_ARG_DOUBLE, &chunk_delay_ms, "Delay between streamed chunks in ms (default 20)", "MS" },
+    { "seed", 0, 0, G_OPTION_ARG_INT64, &seed, "Random seed; request n always gets the same latency and outcome", "N" },
+    { "quiet", 'q', 0, G_OPTION_ARG_NONE, &quiet, "Don't log every request", NULL },
+    { NULL }
+};
+
+static guint request_counter = 0;
+
+// One parsed HTTP request
+typedef struct {
+    char method[16];
+    char path[1024];
+    GString *body;
+} HttpRequest;
+
+// Write all of data, ignoring a client that went away
+static bool send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return true;
+}
+
+static void sleep_ms(double ms) {
+    if (ms > 0) g_usleep((gulong)(ms * 1000));
+}
+
+// Find a header value (case-insensitive name) in the header block
+static const char* find_header(const char *headers, const char *name) {
+    size_t name_len = strlen(name);
+    for (const char *line = strstr(headers, "\r\n"); line != NULL; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (g_ascii_strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char *value = line + name_len + 1;
+            while (*value == ' ') value++;
+            return value;
+        }
+    }
+    return NULL;
+}
+
+// Read the request line, headers and body; false if the client sent something unusable
+static bool read_request(int fd, HttpRequest *request) {
+    GString *data = g_string_new(NULL);
+    char buffer[16384];
+    char *header_end = NULL;
+
+    while ((header_end = strstr(data->str, "\r\n\r\n")) == NULL) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0 || data->len + n > MAX_REQUEST_BYTES) {
+            g_string_free(data, TRUE);
+            return false;
+        }
+        g_string_append_len(data, buffer, n);
+    }
+
+    size_t header_len = header_end - data->str + 4;
+    char *headers = g_strndup(data->str, header_len);
+    bool ok = sscanf(headers, "%15s %1023s", request->method, request->path) == 2;
+
+    const char *length_value = find_header(headers, "Content-Length");
+    size_t content_length = length_value != NULL ? g_ascii_strtoull(length_value, NULL, 10) : 0;
+    const char *expect = find_header(headers, "Expect");
+    if (ok && expect != NULL && g_ascii_strncasecmp(expect, "100-continue", 12) == 0) {
+        send_all(fd, "HTTP/1.1 100 Continue\r\n\r\n", 25);
+    }
+    g_free(headers);
+
+    if (content_length > MAX_REQUEST_BYTES) ok = false;
+
+    request->body = g_string_new_len(data->str + header_len, data->len - header_len);
+    while (ok && request->body->len < content_length) {
+        ssize_t n = recv(fd, buffer, MIN(sizeof(buffer), content_length - request->body->len), 0);
+        if (n <= 0) {
+            ok = false;
+            break;
+        }
+        g_string_append_len(request->body, buffer, n);
+    }
+
+    g_string_free(data, TRUE);
+    return ok;
+}
+
+// Draw the time to first byte of one request
+static double sample_latency(GRand *rand) {
+    const char *distribution = latency_distribution != NULL ? latency_distribution : "lognormal";
+
+    if (strcmp(distribution, "fixed") == 0) {
+        return latency_ms;
+    } else if (strcmp(distribution, "uniform") == 0) {
+        return g_rand_double_range(rand, 0, 2 * latency_ms);
+    } else if (strcmp(distribution, "exponential") == 0) {
+        // Scaled so the median is latency_ms
+        return -latency_ms / G_LN2 * log(1 - g_rand_double(rand));
+    }
+
+    // Lognormal around the median, via Box-Muller
+    double u1 = 1 - g_rand_double(rand);
+    double u2 = g_rand_double(rand);
+    double z = sqrt(-2 * log(u1)) * cos(2 * G_PI * u2);
+    return latency_ms * exp(latency_sigma * z);
+}
+
+// Extract the text the client asked to translate: the part of the prompt after the content
+// marker, or the whole prompt if there is none
+static char* extract_content(const char *body, bool gemini) {
+    JsonPullParser *parser = json_pull_parser_new();
+    guint watch = json_pull_parser_watch(parser, gemini ? "contents[1].parts[*].text" : "messages[1].content");
+    json_pull_parser_feed(parser, body, strlen(body));
+
+    char *prompt = json_pull_parser_finish(parser) ? json_pull_parser_steal(parser, watch) : NULL;
+    json_pull_parser_free(parser);
+    if (prompt == NULL) return NULL;
+
+    for (guint i = 0; content_markers[i] != NULL; i++) {
+        const char *marker = g_strrstr(prompt, content_markers[i]);
+        if (marker != NULL) {
+            char *content = g_strdup(marker + strlen(content_markers[i]));
+            g_free(prompt);
+            return content;
+        }
+    }
+    return prompt;
+}
+
+// Build a successful completion in the provider's response shape
+static void write_completion(GString *out, bool gemini, const char *model, guint number, const char *content) {
+    char *text = g_strdup_printf("[mock translation %u]\n%s", number, content);
+    gint64 prompt_tokens = (gint64)strlen(content) / 4 + 1;
+    gint64 completion_tokens = (gint64)strlen(text) / 4 + 1;
+
+    JsonWriter writer;
+    json_writer_init(&writer, out);
+    json_writer_begin_object(&writer);
+
+    if (gemini) {
+        json_writer_key(&writer, "candidates");
+        json_writer_begin_array(&writer);
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "content");
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "parts");
+        json_writer_begin_array(&writer);
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "text");
+        json_writer_string(&writer, text);
+        json_writer_end_object(&writer);
+        json_writer_end_array(&writer);
+        json_writer_key(&writer, "role");
+        json_writer_string(&writer, "model");
+        json_writer_end_object(&writer);
+        json_writer_key(&writer, "finishReason");
+        json_writer_string(&writer, "STOP");
+        json_writer_end_object(&writer);
+        json_writer_end_array(&writer);
+
+        json_writer_key(&writer, "usageMetadata");
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "promptTokenCount");
+        json_writer_int(&writer, prompt_tokens);
+        json_writer_key(&writer, "candidatesTokenCount");
+        json_writer_int(&writer, completion_tokens);
+        json_writer_end_object(&writer);
+        json_writer_key(&writer, "modelVersion");
+        json_writer_string(&writer, model);
+    } else {
+        char *id = g_strdup_printf("chatcmpl-mock-%u", number);
+        json_writer_key(&writer, "id");
+        json_writer_string(&writer, id);
+        g_free(id);
+        json_writer_key(&writer, "object");
+        json_writer_string(&writer, "chat.completion");
+        json_writer_key(&writer, "model");
+        json_writer_string(&writer, model);
+
+        json_writer_key(&writer, "choices");
+        json_writer_begin_array(&writer);
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "index");
+        json_writer_int(&writer, 0);
+        json_writer_key(&writer, "message");
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "role");
+        json_writer_string(&writer, "assistant");
+        json_writer_key(&writer, "content");
+        json_writer_string(&writer, text);
+        json_writer_end_object(&writer);
+        json_writer_key(&writer, "finish_reason");
+        json_writer_string(&writer, "stop");
+        json_writer_end_object(&writer);
+        json_writer_end_array(&writer);
+
+        json_writer_key(&writer, "usage");
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "prompt_tokens");
+        json_writer_int(&writer, prompt_tokens);
+        json_writer_key(&writer, "completion_tokens");
+        json_writer_int(&writer, completion_tokens);
+        json_writer_key(&writer, "total_tokens");
+        json_writer_int(&writer, prompt_tokens + completion_tokens);
+        json_writer_end_object(&writer);
+    }
+
+    json_writer_end_object(&writer);
+    g_free(text);
+}
+
+// Build an error body in the provider's shape
+static void write_error(GString *out, bool gemini, int status, const char *message) {
+    JsonWriter writer;
+    json_writer_init(&writer, out);
+    json_writer_begin_object(&writer);
+    json_writer_key(&writer, "error");
+    json_writer_begin_object(&writer);
+    json_writer_key(&writer, "message");
+    json_writer_string(&writer, message);
+    if (gemini) {
+        json_writer_key(&writer, "code");
+        json_writer_int(&writer, status);
+        json_writer_key(&writer, "status");
+        json_writer_string(&writer, status == 429 ? "RESOURCE_EXHAUSTED" : status == 404 ? "NOT_FOUND" : "INTERNAL");
+    } else {
+        json_writer_key(&writer, "type");
+        json_writer_string(&writer, status == 429 ? "rate_limit_exceeded" : status == 404 ? "invalid_request_error" : "server_error");
+    }
+    json_writer_end_object(&writer);
+    json_writer_end_object(&writer);
+}
+
+// Build a model list for the API key check
+static void write_model_list(GString *out, bool gemini) {
+    JsonWriter writer;
+    json_writer_init(&writer, out);
+    json_writer_begin_object(&writer);
+    json_writer_key(&writer, gemini ? "models" : "data");
+    json_writer_begin_array(&writer);
+    json_writer_begin_object(&writer);
+    json_writer_key(&writer, gemini ? "name" : "id");
+    json_writer_string(&writer, gemini ? "models/gemini-2.0-flash" : "gpt-3.5-turbo");
+    json_writer_end_object(&writer);
+    json_writer_end_array(&writer);
+    json_writer_end_object(&writer);
+}
+
+static const char* status_text(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 429: return "Too Many Requests";
+        default: return "Internal Server Error";
+    }
+}
+
+// Send status, headers and body, trickling the body in chunks when streaming
+static void send_response(int fd, int status, const GString *body) {
+    GString *head = g_string_new(NULL);
+    g_string_append_printf(head, "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nConnection: close\r\n",
+                           status, status_text(status));
+    if (status == 429) {
+        g_string_append_printf(head, "Retry-After: %d\r\n", retry_after_seconds);
+    }
+
+    if (!stream) {
+        g_string_append_printf(head, "Content-Length: %zu\r\n\r\n", body->len);
+        if (send_all(fd, head->str, head->len)) send_all(fd, body->str, body->len);
+        g_string_free(head, TRUE);
+        return;
+    }
+
+    g_string_append(head, "Transfer-Encoding: chunked\r\n\r\n");
+    bool ok = send_all(fd, head->str, head->len);
+    g_string_free(head, TRUE);
+
+    size_t step = chunk_bytes > 0 ? (size_t)chunk_bytes : 64;
+    for (size_t offset = 0; ok && offset < body->len; offset += step) {
+        size_t len = MIN(step, body->len - offset);
+        char size_line[32];
+        int size_len = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+        ok = send_all(fd, size_line, size_len) && send_all(fd, body->str + offset, len) && send_all(fd, "\r\n", 2);
+        if (ok && offset + len < body->len) sleep_ms(chunk_delay_ms);
+    }
+    if (ok) send_all(fd, "0\r\n\r\n", 5);
+}
+
+// Connection thread: answer one request and close
+static gpointer handle_connection(gpointer data) {
+    int fd = GPOINTER_TO_INT(data);
+    HttpRequest request = { 0 };
+
+    if (!read_request(fd, &request)) {
+        if (request.body != NULL) g_string_free(request.body, TRUE);
+        close(fd);
+        return NULL;
+    }
+
+    // Each request draws from its own generator, so a run with the same seed sees the
+    // same latencies and failures in the same request order
+    guint number = (guint)g_atomic_int_add(&request_counter, 1) + 1;
+    GRand *rand = g_rand_new_with_seed((guint32)(seed * 2654435761u + number));
+    double delay = sample_latency(rand);
+    double roll = g_rand_double(rand);
+    g_rand_free(rand);
+
+    GString *body = g_string_new(NULL);
+    int status = 200;
+    bool gemini = g_str_has_prefix(request.path, "/v1beta/models/");
+    char *model = NULL;
+
+    if (strcmp(request.method, "GET") == 0 && g_str_has_prefix(request.path, "/v1/models")) {
+        gemini = strstr(request.path, "key=") != NULL;
+        write_model_list(body, gemini);
+        delay = 0;
+    } else if (strcmp(request.method, "POST") == 0 &&
+               (strcmp(request.path, "/v1/chat/completions") == 0 || strstr(request.path, ":generateContent") != NULL)) {
+        if (gemini) {
+            const char *start = request.path + strlen("/v1beta/models/");
+            model = g_strndup(start, strcspn(start, ":"));
+        } else {
+            model = g_strdup("mock-gpt");
+        }
+
+        char *content = extract_content(request.body->str, gemini);
+        if (roll < rate_limit_rate) {
+            status = 429;
+            write_error(body, gemini, status, "Rate limit reached (mock)");
+            delay = MIN(delay, 50);
+        } else if (roll < rate_limit_rate + error_rate) {
+            status = 500;
+            write_error(body, gemini, status, "The server had an error while processing your request (mock)");
+        } else if (content == NULL) {
+            status = 400;
+            write_error(body, gemini, status, "Could not find the prompt in the request body (mock)");
+        } else {
+            write_completion(body, gemini, model, number, content);
+        }
+        g_free(content);
+    } else {
+        status = 404;
+        write_error(body, gemini, status, "Unknown endpoint (mock)");
+        delay = 0;
+    }
+
+    sleep_ms(delay);
+    send_response(fd, status, body);
+
+    if (!quiet) {
+        fprintf(stderr, "DEBUG: #%u %s %s -> %d after %.0f ms (%zu bytes in, %zu out)\n", number,
+                request.method, request.path, status, delay, request.body->len, body->len);
+    }
+
+    g_free(model);
+    g_string_free(body, TRUE);
+    g_string_free(request.body, TRUE);
+    shutdown(fd, SHUT_WR);
+    close(fd);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    GError *error = NULL;
+    GOptionContext *context = g_option_context_new("- local mock of the OpenAI and Gemini APIs");
+    g_option_context_add_main_entries(context, option_entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        fprintf(stderr, "ERROR: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return 1;
+    }
+    g_option_context_free(context);
+
+    signal(SIGPIPE, SIG_IGN);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address = { 0 };
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, bind_address != NULL ? bind_address : "127.0.0.1", &address.sin_addr) != 1) {
+        fprintf(stderr, "ERROR: Invalid bind address %s\n", bind_address);
+        return 1;
+    }
+
+    if (bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 128) != 0) {
+        fprintf(stderr, "ERROR: Could not listen on port %d: %s\n", port, g_strerror(errno));
+        return 1;
+    }
+
+    fprintf(stderr, "Mock AI server listening on http://%s:%d (%s latency, median %.0f ms, %.0f%% errors, %.0f%% 429s%s)\n",
+            bind_address != NULL ? bind_address : "127.0.0.1", port,
+            latency_distribution != NULL ? latency_distribution : "lognormal", latency_ms,
+            error_rate * 100, rate_limit_rate * 100, stream ? ", streaming" : "");
+
+    while (true) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "ERROR: accept failed: %s\n", g_strerror(errno));
+            break;
+        }
+
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        GThread *thread = g_thread_new("mock-connection", handle_connection, GINT_TO_POINTER(fd));
+        g_thread_unref(thread);
+    }
+
+    close(listener);
+    return 0;
+}
@@ -0,0 +1,494 @@
+#include "patch_window.h"
+#include "piece_table.h"
+#include "hex_dump.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+
+// Bytes per row of the hexdump
+#define VIEW_ROW_BYTES 16
+// Bytes an edit can be typed with at most
+#define MAX_EDIT_BYTES (1024 * 1024)
+
+// Window state, owned by the window
+typedef struct {
+    GtkWidget *window;
+    GtkWidget *parent;          // Cleared when it closes
+    GtkWidget *file_label;
+    GtkWidget *open_button;
+    GtkWidget *save_button;
+    GtkWidget *save_as_button;
+    GtkWidget *offset_entry;
+    GtkWidget *bytes_entry;
+    GtkWidget *insert_button;
+    GtkWidget *overwrite_button;
+    GtkWidget *delete_spin;
+    GtkWidget *delete_button;
+    GtkWidget *undo_button;
+    GtkWidget *redo_button;
+    GtkWidget *dump_view;
+    GtkWidget *status_label;
+    PieceTable *table;
+    char *path;
+    bool confirming;            // Whether the unsaved edits question is showing
+} PatchWindow;
+
+typedef enum {
+    EDIT_INSERT,
+    EDIT_OVERWRITE,
+    EDIT_DELETE
+} EditKind;
+
+// What to do once unsaved edits may be discarded
+typedef enum {
+    DISCARD_OPEN,               // Choose another file
+    DISCARD_CLOSE,              // Close the patch window
+    DISCARD_CLOSE_PARENT        // Close the main window, which takes the patch window with it
+} DiscardAction;
+
+// Buttons of the unsaved edits question
+#define DISCARD_BUTTON_CANCEL 0
+#define DISCARD_BUTTON_DISCARD 1
+
+static void patch_window_free(gpointer data) {
+    PatchWindow *state = data;
+    if (state->parent != NULL) {
+        g_object_remove_weak_pointer(G_OBJECT(state->parent), (gpointer *)&state->parent);
+    }
+    piece_table_free(state->table);
+    g_free(state->path);
+    g_free(state);
+}
+
+// Function to read the offset entry (hex, 0x optional); an empty entry is offset 0
+static bool parse_offset(PatchWindow *state, gsize *offset) {
+    const char *text = gtk_editable_get_text(GTK_EDITABLE(state->offset_entry));
+    while (g_ascii_isspace(*text)) text++;
+    if (*text == '\0') {
+        *offset = 0;
+        return true;
+    }
+
+    char *end = NULL;
+    guint64 value = g_ascii_strtoull(text, &end, 16);
+    while (end != NULL && g_ascii_isspace(*end)) end++;
+    if (end == text || end == NULL || *end != '\0') return false;
+    *offset = (gsize)value;
+    return true;
+}
+
+// Function to read the bytes entry: hex digit pairs, spaces between pairs allowed
+static GByteArray* parse_bytes(PatchWindow *state) {
+    const char *text = gtk_editable_get_text(GTK_EDITABLE(state->bytes_entry));
+    GByteArray *bytes = g_byte_array_new();
+
+    int high = -1;
+    for (const char *p = text; *p != '\0'; p++) {
+        if (g_ascii_isspace(*p) && high < 0) continue;
+        int digit = g_ascii_xdigit_value(*p);
+        if (digit < 0 || bytes->len >= MAX_EDIT_BYTES) {
+            g_byte_array_free(bytes, TRUE);
+            return NULL;
+        }
+        if (high < 0) {
+            high = digit;
+        } else {
+            guint8 byte = (guint8)(high << 4 | digit);
+            g_byte_array_append(bytes, &byte, 1);
+            high = -1;
+        }
+    }
+
+    if (high >= 0) {
+        g_byte_array_free(bytes, TRUE);
+        return NULL;
+    }
+    return bytes;
+}
+
+// Function to show the contents, the status and which buttons apply
+static void update_view(PatchWindow *state) {
+    bool has_file = state->table != NULL;
+    gtk_widget_set_sensitive(state->save_button, has_file && piece_table_is_modified(state->table));
+    gtk_widget_set_sensitive(state->save_as_button, has_file);
+    gtk_widget_set_sensitive(state->insert_button, has_file);
+    gtk_widget_set_sensitive(state->overwrite_button, has_file);
+    gtk_widget_set_sensitive(state->delete_button, has_file);
+    gtk_widget_set_sensitive(state->undo_button, has_file && piece_table_can_undo(state->table));
+    gtk_widget_set_sensitive(state->redo_button, has_file && piece_table_can_redo(state->table));
+
+    // The side column shows the main window's text encoding
+    WindowData *data = state->parent != NULL ? g_object_get_data(G_OBJECT(state->parent), "window_data") : NULL;
+    EncodingType side_encoding = data != NULL ? gtk_drop_down_get_selected(data->bottom_encoding_dropdown) : ASCII;
+    hex_dump_view_set_piece_table(state->dump_view, state->table, VIEW_ROW_BYTES, side_encoding);
+    if (!has_file) return;
+
+    char *status = g_strdup_printf("%" G_GSIZE_FORMAT " bytes in %u pieces%s",
+                                   piece_table_get_length(state->table),
+                                   piece_table_get_piece_count(state->table),
+                                   piece_table_is_modified(state->table) ? ", modified" : "");
+    gtk_label_set_text(GTK_LABEL(state->status_label), status);
+    g_free(status);
+}
+
+// Function to scroll the view to the offset, as it scrolls to the top when the contents change
+static void show_offset(PatchWindow *state) {
+    gsize offset = 0;
+    if (state->table != NULL && parse_offset(state, &offset)) hex_dump_view_scroll_to(state->dump_view, offset);
+}
+
+// Function to apply the edit a button stands for at the offset
+static void apply_edit(PatchWindow *state, EditKind kind) {
+    if (state->table == NULL) return;
+
+    gsize offset = 0;
+    if (!parse_offset(state, &offset) || offset > piece_table_get_length(state->table)) {
+        gtk_label_set_text(GTK_LABEL(state->status_label), "The offset is not a hex number inside the file");
+        return;
+    }
+
+    if (kind == EDIT_DELETE) {
+        gsize count = (gsize)gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(state->delete_spin));
+        count = MIN(count, piece_table_get_length(state->table) - offset);
+        piece_table_delete(state->table, offset, count);
+    } else {
+        GByteArray *bytes = parse_bytes(state);
+        if (bytes == NULL) {
+            gtk_label_set_text(GTK_LABEL(state->status_label), "The bytes are not pairs of hex digits");
+            return;
+        }
+        if (kind == EDIT_INSERT) {
+            piece_table_insert(state->table, offset, bytes->data, bytes->len);
+        } else {
+            piece_table_overwrite(state->table, offset, bytes->data, bytes->len);
+        }
+        g_byte_array_free(bytes, TRUE);
+    }
+
+    update_view(state);
+    show_offset(state);
+}
+
+static void on_insert_clicked(GtkButton *button, gpointer user_data) {
+    apply_edit(user_data, EDIT_INSERT);
+}
+
+static void on_overwrite_clicked(GtkButton *button, gpointer user_data) {
+    apply_edit(user_data, EDIT_OVERWRITE);
+}
+
+static void on_delete_clicked(GtkButton *button, gpointer user_data) {
+    apply_edit(user_data, EDIT_DELETE);
+}
+
+static void on_undo_clicked(GtkButton *button, gpointer user_data) {
+    PatchWindow *state = user_data;
+    if (state->table != NULL) piece_table_undo(state->table);
+    update_view(state);
+    show_offset(state);
+}
+
+static void on_redo_clicked(GtkButton *button, gpointer user_data) {
+    PatchWindow *state = user_data;
+    if (state->table != NULL) piece_table_redo(state->table);
+    update_view(state);
+    show_offset(state);
+}
+
+// Callback for edits of the offset: scroll to the bytes there
+static void on_offset_changed(GtkEditable *editable, gpointer user_data) {
+    show_offset(user_data);
+}
+
+// Function to show the file name
+static void update_file_label(PatchWindow *state) {
+    char *basename = g_path_get_basename(state->path);
+    gtk_label_set_text(GTK_LABEL(state->file_label), basename);
+    g_free(basename);
+}
+
+// Function to save the contents to path; the file stays open under its new name
+static void save_to(PatchWindow *state, const char *path) {
+    char *error = NULL;
+    if (!piece_table_save(state->table, path, &error)) {
+        gtk_label_set_text(GTK_LABEL(state->status_label), error);
+        g_free(error);
+        return;
+    }
+
+    if (state->path != path) {
+        g_free(state->path);
+        state->path = g_strdup(path);
+        update_file_label(state);
+    }
+    update_view(state);
+}
+
+static void on_save_clicked(GtkButton *button, gpointer user_data) {
+    PatchWindow *state = user_data;
+    if (state->table != NULL) save_to(state, state->path);
+}
+
+// Callback for the save dialog
+static void on_save_as_chosen(GObject *source, GAsyncResult *result, gpointer user_data) {
+    GtkWidget *window = GTK_WIDGET(user_data);
+    PatchWindow *state = g_object_get_data(G_OBJECT(window), "patch_window");
+    GError *error = NULL;
+    GFile *file = gtk_file_dialog_save_finish(GTK_FILE_DIALOG(source), result, &error);
+
+    if (file == NULL || state == NULL || state->table == NULL) {
+        g_clear_error(&error);
+        if (file != NULL) g_object_unref(file);
+        g_object_unref(window);
+        return;
+    }
+
+    char *path = g_file_get_path(file);
+    if (path == NULL) {
+        gtk_label_set_text(GTK_LABEL(state->status_label), "Only local files can be saved");
+    } else {
+        save_to(state, path);
+    }
+
+    g_free(path);
+    g_object_unref(file);
+    g_object_unref(window);
+}
+
+static void on_save_as_clicked(GtkButton *button, gpointer user_data) {
+    PatchWindow *state = user_data;
+    GtkFileDialog *dialog = gtk_file_dialog_new();
+    gtk_file_dialog_set_title(dialog, "Save Patched File");
+    char *basename = g_path_get_basename(state->path);
+    gtk_file_dialog_set_initial_name(dialog, basename);
+    g_free(basename);
+    gtk_file_dialog_save(dialog, GTK_WINDOW(state->window), NULL, on_save_as_chosen, g_object_ref(state->window));
+    g_object_unref(dialog);
+}
+
+// Callback for the open dialog: map the file into a new piece table
+static void on_patch_file_chosen(GObject *source, GAsyncResult *result, gpointer user_data) {
+    GtkWidget *window = GTK_WIDGET(user_data);
+    PatchWindow *state = g_object_get_data(G_OBJECT(window), "patch_window");
+    GError *error = NULL;
+    GFile *file = gtk_file_dialog_open_finish(GTK_FILE_DIALOG(source), result, &error);
+
+    if (file == NULL || state == NULL) {
+        g_clear_error(&error);
+        if (file != NULL) g_object_unref(file);
+        g_object_unref(window);
+        return;
+    }
+
+    char *path = g_file_get_path(file);
+    char *message = NULL;
+    PieceTable *table = path != NULL ? piece_table_new_from_file(path, &message) : NULL;
+    if (table == NULL) {
+        char *status = g_strdup_printf("Could not open the file: %s", message != NULL ? message : "not a local file");
+        gtk_label_set_text(GTK_LABEL(state->status_label), status);
+        g_free(status);
+        g_free(message);
+    } else {
+        // The view reads the old table until it is shown the new one
+        PieceTable *old_table = state->table;
+        state->table = table;
+        g_free(state->path);
+        state->path = g_strdup(path);
+        update_file_label(state);
+        update_view(state);
+        piece_table_free(old_table);
+    }
+
+    g_free(path);
+    g_object_unref(file);
+    g_object_unref(window);
+}
+
+// Function to ask for the file to patch
+static void choose_patch_file(PatchWindow *state) {
+    GtkFileDialog *dialog = gtk_file_dialog_new();
+    gtk_file_dialog_set_title(dialog, "Patch File");
+    gtk_file_dialog_open(dialog, GTK_WINDOW(state->window), NULL, on_patch_file_chosen, g_object_ref(state->window));
+    g_object_unref(dialog);
+}
+
+// Function to carry out an action that drops the open file
+static void run_discard_action(PatchWindow *state, DiscardAction action) {
+    switch (action) {
+        case DISCARD_OPEN:
+            choose_patch_file(state);
+            break;
+        case DISCARD_CLOSE:
+            gtk_window_destroy(GTK_WINDOW(state->window));
+            break;
+        case DISCARD_CLOSE_PARENT:
+            if (state->parent != NULL) gtk_window_destroy(GTK_WINDOW(state->parent));
+            break;
+    }
+}
+
+// Callback for the unsaved edits question
+static void on_discard_chosen(GObject *source, GAsyncResult *result, gpointer user_data) {
+    GtkWidget *window = GTK_WIDGET(user_data);
+    PatchWindow *state = g_object_get_data(G_OBJECT(window), "patch_window");
+    DiscardAction action = GPOINTER_TO_INT(g_object_get_data(source, "discard_action"));
+    GError *error = NULL;
+    int button = gtk_alert_dialog_choose_finish(GTK_ALERT_DIALOG(source), result, &error);
+    g_clear_error(&error);
+
+    if (state != NULL) {
+        state->confirming = false;
+        if (button == DISCARD_BUTTON_DISCARD) run_discard_action(state, action);
+    }
+    g_object_unref(window);
+}
+
+// Function to carry out an action that drops the open file, asking first when it has unsaved edits
+static void confirm_discard(PatchWindow *state, DiscardAction action) {
+    if (state->table == NULL || !piece_table_is_modified(state->table)) {
+        run_discard_action(state, action);
+        return;
+    }
+    if (state->confirming) return;
+
+    static const char *buttons[] = { "Cancel", "Discard Changes", NULL };
+    char *basename = g_path_get_basename(state->path);
+    GtkAlertDialog *alert = gtk_alert_dialog_new("Discard the unsaved changes to %s?", basename);
+    g_free(basename);
+    gtk_alert_dialog_set_detail(alert, "The edits have not been saved and will be lost.");
+    gtk_alert_dialog_set_buttons(alert, buttons);
+    gtk_alert_dialog_set_cancel_button(alert, DISCARD_BUTTON_CANCEL);
+    gtk_alert_dialog_set_default_button(alert, DISCARD_BUTTON_CANCEL);
+    gtk_alert_dialog_set_modal(alert, TRUE);
+    g_object_set_data(G_OBJECT(alert), "discard_action", GINT_TO_POINTER(action));
+
+    state->confirming = true;
+    gtk_window_present(GTK_WINDOW(state->window));
+    gtk_alert_dialog_choose(alert, GTK_WINDOW(state->window), NULL, on_discard_chosen, g_object_ref(state->window));
+    g_object_unref(alert);
+}
+
+static void on_open_clicked(GtkButton *button, gpointer user_data) {
+    PatchWindow *state = user_data;
+    confirm_discard(state, DISCARD_OPEN);
+}
+
+// Callback for closing the window: unsaved edits are only dropped once confirmed
+static gboolean on_patch_window_close_request(GtkWindow *window, gpointer user_data) {
+    PatchWindow *state = user_data;
+    if (state->table == NULL || !piece_table_is_modified(state->table)) return FALSE;
+    confirm_discard(state, DISCARD_CLOSE);
+    return TRUE;
+}
+
+// Callback for closing the main window, which would destroy the patch window along with it
+static gboolean on_parent_close_request(GtkWindow *window, gpointer user_data) {
+    PatchWindow *state = g_object_get_data(G_OBJECT(user_data), "patch_window");
+    if (state == NULL || state->table == NULL || !piece_table_is_modified(state->table)) return FALSE;
+    confirm_discard(state, DISCARD_CLOSE_PARENT);
+    return TRUE;
+}
+
+// Callback for the window closing
+static void on_patch_window_destroy(GtkWidget *widget, gpointer user_data) {
+    PatchWindow *state = user_data;
+    // The view may outlive the table
+    hex_dump_view_set_piece_table(state->dump_view, NULL, VIEW_ROW_BYTES, ASCII);
+    if (state->parent != NULL) g_object_set_data(G_OBJECT(state->parent), "patch_window", NULL);
+}
+
+// Function to show the binary patcher for a main window (one per window)
+void show_patch_window(GtkWidget *parent_window) {
+    GtkWidget *existing = g_object_get_data(G_OBJECT(parent_window), "patch_window");
+    if (existing != NULL) {
+        gtk_window_present(GTK_WINDOW(existing));
+        return;
+    }
+
+    PatchWindow *state = g_new0(PatchWindow, 1);
+    state->parent = parent_window;
+    g_object_add_weak_pointer(G_OBJECT(parent_window), (gpointer *)&state->parent);
+
+    state->window = gtk_window_new();
+    gtk_window_set_title(GTK_WINDOW(state->window), "Patch File");
+    gtk_window_set_transient_for(GTK_WINDOW(state->window), GTK_WINDOW(parent_window));
+    gtk_window_set_destroy_with_parent(GTK_WINDOW(state->window), TRUE);
+    gtk_window_set_default_size(GTK_WINDOW(state->window), 700, 450);
+
+    GtkWidget *content_area = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
+    gtk_widget_set_margin_start(content_area, 10);
+    gtk_widget_set_margin_end(content_area, 10);
+    gtk_widget_set_margin_top(content_area, 10);
+    gtk_widget_set_margin_bottom(content_area, 10);
+    gtk_window_set_child(GTK_WINDOW(state->window), content_area);
+
+    // File and saving
+    GtkWidget *file_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+    state->open_button = gtk_button_new_with_label("Open File…");
+    state->file_label = gtk_label_new("No file");
+    gtk_label_set_ellipsize(GTK_LABEL(state->file_label), PANGO_ELLIPSIZE_MIDDLE);
+    gtk_label_set_xalign(GTK_LABEL(state->file_label), 0);
+    gtk_widget_set_hexpand(state->file_label, TRUE);
+    state->save_button = gtk_button_new_with_label("Save");
+    state->save_as_button = gtk_button_new_with_label("Save As…");
+    gtk_box_append(GTK_BOX(file_box), state->open_button);
+    gtk_box_append(GTK_BOX(file_box), state->file_label);
+    gtk_box_append(GTK_BOX(file_box), state->save_button);
+    gtk_box_append(GTK_BOX(file_box), state->save_as_button);
+
+    // Offset and bytes to write there
+    GtkWidget *edit_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+    state->offset_entry = gtk_entry_new();
+    gtk_entry_set_placeholder_text(GTK_ENTRY(state->offset_entry), "0");
+    gtk_widget_set_tooltip_text(state->offset_entry, "Offset in hex");
+    state->bytes_entry = gtk_entry_new();
+    gtk_entry_set_placeholder_text(GTK_ENTRY(state->bytes_entry), "Bytes in hex, e.g. 48 65 6C 6C 6F");
+    gtk_widget_set_hexpand(state->bytes_entry, TRUE);
+    state->insert_button = gtk_button_new_with_label("Insert");
+    state->overwrite_button = gtk_button_new_with_label("Overwrite");
+    gtk_box_append(GTK_BOX(edit_box), gtk_label_new("Offset:"));
+    gtk_box_append(GTK_BOX(edit_box), state->offset_entry);
+    gtk_box_append(GTK_BOX(edit_box), state->bytes_entry);
+    gtk_box_append(GTK_BOX(edit_box), state->insert_button);
+    gtk_box_append(GTK_BOX(edit_box), state->overwrite_button);
+
+    GtkWidget *history_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+    state->delete_spin = gtk_spin_button_new_with_range(1, G_MAXINT, 1);
+    state->delete_button = gtk_button_new_with_label("Delete Bytes");
+    state->undo_button = gtk_button_new_with_label("Undo");
+    state->redo_button = gtk_button_new_with_label("Redo");
+    gtk_box_append(GTK_BOX(history_box), state->delete_spin);
+    gtk_box_append(GTK_BOX(history_box), state->delete_button);
+    gtk_box_append(GTK_BOX(history_box), state->undo_button);
+    gtk_box_append(GTK_BOX(history_box), state->redo_button);
+
+    state->dump_view = hex_dump_view_new();
+
+    state->status_label = gtk_label_new("Open a file to patch");
+    gtk_widget_add_css_class(state->status_label, "dim-label");
+    gtk_widget_set_halign(state->status_label, GTK_ALIGN_START);
+
+    gtk_box_append(GTK_BOX(content_area), file_box);
+    gtk_box_append(GTK_BOX(content_area), edit_box);
+    gtk_box_append(GTK_BOX(content_area), history_box);
+    gtk_box_append(GTK_BOX(content_area), state->dump_view);
+    gtk_box_append(GTK_BOX(content_area), state->status_label);
+
+    g_signal_connect(state->open_button, "clicked", G_CALLBACK(on_open_clicked), state);
+    g_signal_connect(state->save_button, "clicked", G_CALLBACK(on_save_clicked), state);
+    g_signal_connect(state->save_as_button, "clicked", G_CALLBACK(on_save_as_clicked), state);
+    g_signal_connect(state->insert_button, "clicked", G_CALLBACK(on_insert_clicked), state);
+    g_signal_connect(state->overwrite_button, "clicked", G_CALLBACK(on_overwrite_clicked), state);
+    g_signal_connect(state->delete_button, "clicked", G_CALLBACK(on_delete_clicked), state);
+    g_signal_connect(state->undo_button, "clicked", G_CALLBACK(on_undo_clicked), state);
+    g_signal_connect(state->redo_button, "clicked", G_CALLBACK(on_redo_clicked), state);
+    g_signal_connect(state->offset_entry, "changed", G_CALLBACK(on_offset_changed), state);
+    g_signal_connect(state->window, "destroy", G_CALLBACK(on_patch_window_destroy), state);
+    g_signal_connect(state->window, "close-request", G_CALLBACK(on_patch_window_close_request), state);
+    g_signal_connect_object(parent_window, "close-request", G_CALLBACK(on_parent_close_request), state->window, 0);
+
+    g_object_set_data_full(G_OBJECT(state->window), "patch_window", state, patch_window_free);
+    g_object_set_data(G_OBJECT(parent_window), "patch_window", state->window);
+    update_view(state);
+    gtk_window_present(GTK_WINDOW(state->window));
+}
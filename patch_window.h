@@ -0,0 +1,12 @@
+#ifndef PATCH_WINDOW_H
+#define PATCH_WINDOW_H
+
+#include <gtk/gtk.h>
+
+// Function to show the binary patcher for a main window (one per window)
+// A file is memory-mapped into a piece table, so bytes can be inserted, overwritten and deleted
+// anywhere in files of any size without copying them; edits can be undone, and saving streams
+// the pieces out to the file.
+void show_patch_window(GtkWidget *parent_window);
+
+#endif /* PATCH_WINDOW_H */
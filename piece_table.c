@@ -0,0 +1,390 @@
+#include "piece_table.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Undo steps kept; the oldest is dropped past this
+#define MAX_UNDO_STEPS 1000
+
+typedef enum {
+    PIECE_ORIGINAL,
+    PIECE_ADDED
+} PieceSource;
+
+// A piece and the pieces before (left) and after (right) it
+// Nodes are shared between the trees of the undo history, so they are never changed once made.
+typedef struct PieceNode PieceNode;
+struct PieceNode {
+    gint ref_count;
+    guint32 priority;       // Random; a node is above those of lower priority, which keeps the tree balanced
+    PieceSource source;
+    gsize start;            // Offset in the source
+    gsize len;
+    gsize total;            // Bytes in this subtree
+    guint count;            // Pieces in this subtree
+    PieceNode *left;
+    PieceNode *right;
+};
+
+struct PieceTable {
+    GBytes *original;
+    GByteArray *added;      // Append-only, so pieces stay valid
+    PieceNode *root;
+    GPtrArray *undo;        // Roots before each edit, newest last
+    GPtrArray *redo;        // Roots undone, newest last
+    PieceNode *saved;       // Root when opened or last saved; held so its address can't be reused
+};
+
+typedef struct {
+    guint8 *buffer;
+    gsize copied;
+} ReadState;
+
+typedef struct {
+    int fd;
+    int saved_errno;
+} SaveState;
+
+static gsize subtree_total(const PieceNode *node) {
+    return node != NULL ? node->total : 0;
+}
+
+static guint subtree_count(const PieceNode *node) {
+    return node != NULL ? node->count : 0;
+}
+
+static PieceNode* node_ref(PieceNode *node) {
+    if (node != NULL) g_atomic_int_inc(&node->ref_count);
+    return node;
+}
+
+static void node_unref(gpointer data) {
+    PieceNode *node = data;
+    if (node == NULL || !g_atomic_int_dec_and_test(&node->ref_count)) return;
+    node_unref(node->left);
+    node_unref(node->right);
+    g_free(node);
+}
+
+// Function to make a node, taking the references to left and right
+static PieceNode* node_new(PieceSource source, gsize start, gsize len, guint32 priority,
+                           PieceNode *left, PieceNode *right) {
+    PieceNode *node = g_new(PieceNode, 1);
+    node->ref_count = 1;
+    node->priority = priority;
+    node->source = source;
+    node->start = start;
+    node->len = len;
+    node->left = left;
+    node->right = right;
+    node->total = subtree_total(left) + len + subtree_total(right);
+    node->count = subtree_count(left) + 1 + subtree_count(right);
+    return node;
+}
+
+// Function to copy a node with other children, taking the references to them
+static PieceNode* node_with_children(const PieceNode *node, PieceNode *left, PieceNode *right) {
+    return node_new(node->source, node->start, node->len, node->priority, left, right);
+}
+
+// Function to split a tree into its first pos bytes and the rest, sharing what it can
+// The tree is not changed; *left and *right are new references.
+static void split(PieceNode *node, gsize pos, PieceNode **left, PieceNode **right) {
+    if (pos == 0) {
+        *left = NULL;
+        *right = node_ref(node);
+        return;
+    }
+    if (pos >= subtree_total(node)) {
+        *left = node_ref(node);
+        *right = NULL;
+        return;
+    }
+
+    gsize left_total = subtree_total(node->left);
+    if (pos <= left_total) {
+        PieceNode *middle;
+        split(node->left, pos, left, &middle);
+        *right = node_with_children(node, middle, node_ref(node->right));
+    } else if (pos >= left_total + node->len) {
+        PieceNode *middle;
+        split(node->right, pos - left_total - node->len, &middle, right);
+        *left = node_with_children(node, node_ref(node->left), middle);
+    } else {
+        // The split falls inside this piece
+        gsize head = pos - left_total;
+        *left = node_new(node->source, node->start, head, node->priority, node_ref(node->left), NULL);
+        *right = node_new(node->source, node->start + head, node->len - head, node->priority,
+                          NULL, node_ref(node->right));
+    }
+}
+
+// Function to join two trees, taking the references to them
+static PieceNode* merge(PieceNode *left, PieceNode *right) {
+    if (left == NULL) return right;
+    if (right == NULL) return left;
+
+    PieceNode *node;
+    if (left->priority > right->priority) {
+        node = node_with_children(left, node_ref(left->left), merge(node_ref(left->right), right));
+        node_unref(left);
+    } else {
+        node = node_with_children(right, merge(left, node_ref(right->left)), node_ref(right->right));
+        node_unref(right);
+    }
+    return node;
+}
+
+static const guint8* piece_data(const PieceTable *table, const PieceNode *node) {
+    if (node->source == PIECE_ORIGINAL) {
+        return (const guint8 *)g_bytes_get_data(table->original, NULL) + node->start;
+    }
+    return table->added->data + node->start;
+}
+
+// Function to pass len bytes from pos of a subtree to func; returns false if func stopped
+static bool visit_range(const PieceTable *table, const PieceNode *node, gsize pos, gsize len,
+                        PieceTableFunc func, gpointer user_data) {
+    while (node != NULL && len > 0) {
+        gsize left_total = subtree_total(node->left);
+        if (pos < left_total) {
+            gsize n = MIN(len, left_total - pos);
+            if (!visit_range(table, node->left, pos, n, func, user_data)) return false;
+            pos += n;
+            len -= n;
+            if (len == 0) break;
+        }
+
+        gsize in_piece = pos - left_total;
+        if (in_piece < node->len) {
+            gsize n = MIN(len, node->len - in_piece);
+            if (!func(piece_data(table, node) + in_piece, n, user_data)) return false;
+            pos += n;
+            len -= n;
+        }
+
+        // Continue in the right subtree without recursing
+        pos -= left_total + node->len;
+        node = node->right;
+    }
+    return true;
+}
+
+// Function to create a table over original contents (takes a reference; NULL for none)
+PieceTable* piece_table_new(GBytes *original) {
+    PieceTable *table = g_new0(PieceTable, 1);
+    table->original = original != NULL ? g_bytes_ref(original) : g_bytes_new(NULL, 0);
+    table->added = g_byte_array_new();
+    table->undo = g_ptr_array_new_with_free_func(node_unref);
+    table->redo = g_ptr_array_new_with_free_func(node_unref);
+
+    gsize len = g_bytes_get_size(table->original);
+    if (len > 0) {
+        table->root = node_new(PIECE_ORIGINAL, 0, len, g_random_int(), NULL, NULL);
+    }
+    table->saved = node_ref(table->root);
+    return table;
+}
+
+// Function to create a table over a memory-mapped file
+PieceTable* piece_table_new_from_file(const char *path, char **error) {
+    GError *map_error = NULL;
+    GMappedFile *mapped = g_mapped_file_new(path, FALSE, &map_error);
+    if (mapped == NULL) {
+        fprintf(stderr, "ERROR: Could not map %s: %s\n", path, map_error->message);
+        if (error != NULL) *error = g_strdup(map_error->message);
+        g_error_free(map_error);
+        return NULL;
+    }
+
+    // The bytes keep the mapping alive
+    GBytes *bytes = g_mapped_file_get_bytes(mapped);
+    g_mapped_file_unref(mapped);
+    PieceTable *table = piece_table_new(bytes);
+    g_bytes_unref(bytes);
+    return table;
+}
+
+void piece_table_free(PieceTable *table) {
+    if (table == NULL) return;
+    node_unref(table->root);
+    node_unref(table->saved);
+    g_ptr_array_free(table->undo, TRUE);
+    g_ptr_array_free(table->redo, TRUE);
+    g_byte_array_free(table->added, TRUE);
+    g_bytes_unref(table->original);
+    g_free(table);
+}
+
+gsize piece_table_get_length(const PieceTable *table) {
+    return subtree_total(table->root);
+}
+
+guint piece_table_get_piece_count(const PieceTable *table) {
+    return subtree_count(table->root);
+}
+
+static bool copy_piece(const guint8 *data, size_t len, gpointer user_data) {
+    ReadState *read = user_data;
+    memcpy(read->buffer + read->copied, data, len);
+    read->copied += len;
+    return true;
+}
+
+// Function to copy up to len bytes from pos into buffer
+gsize piece_table_read(const PieceTable *table, gsize pos, guint8 *buffer, gsize len) {
+    gsize length = piece_table_get_length(table);
+    if (pos >= length) return 0;
+
+    ReadState read = { buffer, 0 };
+    visit_range(table, table->root, pos, MIN(len, length - pos), copy_piece, &read);
+    return read.copied;
+}
+
+// Function to pass len bytes from pos to func, a piece at a time
+void piece_table_foreach(const PieceTable *table, gsize pos, gsize len, PieceTableFunc func, gpointer user_data) {
+    visit_range(table, table->root, pos, len, func, user_data);
+}
+
+// Function to make the current tree root an undo step and use a new one
+static void commit_edit(PieceTable *table, PieceNode *root) {
+    g_ptr_array_add(table->undo, table->root);
+    if (table->undo->len > MAX_UNDO_STEPS) {
+        g_ptr_array_remove_index(table->undo, 0);
+    }
+    g_ptr_array_set_size(table->redo, 0);
+    table->root = root;
+}
+
+// Function to append bytes to the added buffer and make a piece of them
+static PieceNode* added_piece(PieceTable *table, const guint8 *data, gsize len) {
+    gsize start = table->added->len;
+    g_byte_array_append(table->added, data, (guint)len);
+    return node_new(PIECE_ADDED, start, len, g_random_int(), NULL, NULL);
+}
+
+// Function to insert bytes before pos
+bool piece_table_insert(PieceTable *table, gsize pos, const guint8 *data, gsize len) {
+    if (pos > piece_table_get_length(table) || len > G_MAXUINT) return false;
+    if (len == 0) return true;
+
+    PieceNode *left, *right;
+    split(table->root, pos, &left, &right);
+    commit_edit(table, merge(merge(left, added_piece(table, data, len)), right));
+    return true;
+}
+
+// Function to delete len bytes from pos
+bool piece_table_delete(PieceTable *table, gsize pos, gsize len) {
+    gsize length = piece_table_get_length(table);
+    if (pos > length || len > length - pos) return false;
+    if (len == 0) return true;
+
+    PieceNode *left, *rest, *deleted, *right;
+    split(table->root, pos, &left, &rest);
+    split(rest, len, &deleted, &right);
+    node_unref(rest);
+    node_unref(deleted);
+    commit_edit(table, merge(left, right));
+    return true;
+}
+
+// Function to replace the bytes from pos with data, extending the contents if it runs past the end
+bool piece_table_overwrite(PieceTable *table, gsize pos, const guint8 *data, gsize len) {
+    gsize length = piece_table_get_length(table);
+    if (pos > length || len > G_MAXUINT) return false;
+    if (len == 0) return true;
+
+    PieceNode *left, *rest, *replaced, *right;
+    split(table->root, pos, &left, &rest);
+    split(rest, MIN(len, length - pos), &replaced, &right);
+    node_unref(rest);
+    node_unref(replaced);
+    commit_edit(table, merge(merge(left, added_piece(table, data, len)), right));
+    return true;
+}
+
+bool piece_table_can_undo(const PieceTable *table) {
+    return table->undo->len > 0;
+}
+
+bool piece_table_can_redo(const PieceTable *table) {
+    return table->redo->len > 0;
+}
+
+bool piece_table_is_modified(const PieceTable *table) {
+    return table->root != table->saved;
+}
+
+bool piece_table_undo(PieceTable *table) {
+    if (table->undo->len == 0) return false;
+    g_ptr_array_add(table->redo, table->root);
+    table->root = g_ptr_array_steal_index(table->undo, table->undo->len - 1);
+    return true;
+}
+
+bool piece_table_redo(PieceTable *table) {
+    if (table->redo->len == 0) return false;
+    g_ptr_array_add(table->undo, table->root);
+    table->root = g_ptr_array_steal_index(table->redo, table->redo->len - 1);
+    return true;
+}
+
+static bool write_piece(const guint8 *data, size_t len, gpointer user_data) {
+    SaveState *save = user_data;
+    while (len > 0) {
+        ssize_t written = write(save->fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            save->saved_errno = errno;
+            return false;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return true;
+}
+
+// Function to write the contents to a file a piece at a time
+bool piece_table_save(PieceTable *table, const char *path, char **error) {
+    char *temp_path = g_strdup_printf("%s.XXXXXX", path);
+    SaveState save = { g_mkstemp(temp_path), 0 };
+    if (save.fd < 0) {
+        save.saved_errno = errno;
+    } else {
+        // Keep the permissions of the file being replaced
+        struct stat st;
+        if (stat(path, &st) == 0) fchmod(save.fd, st.st_mode & 07777);
+
+        // The data must be on disk before the rename, or a crash could leave an empty file in its place
+        visit_range(table, table->root, 0, piece_table_get_length(table), write_piece, &save);
+        if (save.saved_errno == 0 && fsync(save.fd) != 0) save.saved_errno = errno;
+        if (close(save.fd) != 0 && save.saved_errno == 0) save.saved_errno = errno;
+        if (save.saved_errno == 0 && rename(temp_path, path) != 0) save.saved_errno = errno;
+        if (save.saved_errno != 0) unlink(temp_path);
+    }
+
+    // Then the rename itself, through the directory it is in
+    if (save.saved_errno == 0) {
+        char *dir = g_path_get_dirname(path);
+        int dir_fd = open(dir, O_RDONLY);
+        if (dir_fd >= 0) {
+            if (fsync(dir_fd) != 0 && errno != EINVAL) save.saved_errno = errno;
+            close(dir_fd);
+        }
+        g_free(dir);
+    }
+
+    if (save.saved_errno == 0) {
+        node_unref(table->saved);
+        table->saved = node_ref(table->root);
+    } else {
+        fprintf(stderr, "ERROR: Could not save %s: %s\n", path, g_strerror(save.saved_errno));
+        if (error != NULL) *error = g_strdup_printf("Could not save %s: %s", path, g_strerror(save.saved_errno));
+    }
+    g_free(temp_path);
+    return save.saved_errno == 0;
+}
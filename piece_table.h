@@ -0,0 +1,58 @@
+#ifndef PIECE_TABLE_H
+#define PIECE_TABLE_H
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Editable bytes over unchanged original contents (a memory-mapped file, say) and an append-only
+// buffer of added bytes. The contents are a sequence of pieces of either, kept in a balanced
+// tree, so insert, overwrite, delete and reads at an offset take O(log n) in the number of pieces
+// and the original is never copied. Trees are never changed in place: an edit builds a new root
+// sharing all but the path it touched, so undo and redo just swap roots.
+typedef struct PieceTable PieceTable;
+
+// Called with the contents in order, a piece at a time; return false to stop
+typedef bool (*PieceTableFunc)(const guint8 *data, size_t len, gpointer user_data);
+
+// Function to create a table over original contents (takes a reference; NULL for none)
+PieceTable* piece_table_new(GBytes *original);
+
+// Function to create a table over a memory-mapped file; on failure returns NULL and sets error (may be NULL)
+PieceTable* piece_table_new_from_file(const char *path, char **error);
+
+// Function to free a table
+void piece_table_free(PieceTable *table);
+
+// Function to get the length of the contents and the number of pieces they are in
+gsize piece_table_get_length(const PieceTable *table);
+guint piece_table_get_piece_count(const PieceTable *table);
+
+// Function to copy up to len bytes from pos into buffer; returns how many were copied
+gsize piece_table_read(const PieceTable *table, gsize pos, guint8 *buffer, gsize len);
+
+// Function to pass len bytes from pos to func, a piece at a time, without copying them
+void piece_table_foreach(const PieceTable *table, gsize pos, gsize len, PieceTableFunc func, gpointer user_data);
+
+// Functions to edit the contents; each is one undo step. Positions past the end are an error
+// (false), as is deleting past it; overwriting past the end extends the contents.
+bool piece_table_insert(PieceTable *table, gsize pos, const guint8 *data, gsize len);
+bool piece_table_delete(PieceTable *table, gsize pos, gsize len);
+bool piece_table_overwrite(PieceTable *table, gsize pos, const guint8 *data, gsize len);
+
+// Functions to step through the edit history; undo and redo return false when there is nothing to do
+bool piece_table_can_undo(const PieceTable *table);
+bool piece_table_can_redo(const PieceTable *table);
+bool piece_table_undo(PieceTable *table);
+bool piece_table_redo(PieceTable *table);
+
+// Function to check whether the contents differ from when the table was made or last saved;
+// undoing back to that point makes them unmodified again
+bool piece_table_is_modified(const PieceTable *table);
+
+// Function to write the contents to a file a piece at a time, through a temporary file that
+// replaces it at the end (so the original file can be saved over while mapped); the data and
+// the rename are synced to disk first. On failure returns false and sets error (may be NULL)
+bool piece_table_save(PieceTable *table, const char *path, char **error);
+
+#endif /* PIECE_TABLE_H */
@@ -0,0 +1,166 @@
+// Checks of the piece table against a plain byte array: random edits, undo and redo through the
+// whole history, the modified flag and saving over the mapped file it was opened from
+// Exits with 1 and names the step on the first failure.
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include "piece_table.h"
+
+#define EDIT_COUNT 1500
+#define ORIGINAL_BYTES 4096
+// Steps the table keeps (MAX_UNDO_STEPS in piece_table.c); older ones are dropped
+#define UNDO_STEPS 1000
+
+// Function to check the contents read back in one go and at a random offset
+static bool same_contents(const PieceTable *table, const GByteArray *expected, GRand *rand) {
+    if (piece_table_get_length(table) != expected->len) return false;
+
+    guint8 *buffer = g_malloc(expected->len + 1);
+    gsize n = piece_table_read(table, 0, buffer, expected->len);
+    bool ok = n == expected->len && (n == 0 || memcmp(buffer, expected->data, n) == 0);
+
+    if (ok && expected->len > 0) {
+        gsize pos = (gsize)g_rand_int_range(rand, 0, (gint32)expected->len);
+        n = piece_table_read(table, pos, buffer, expected->len);
+        ok = n == expected->len - pos && memcmp(buffer, expected->data + pos, n) == 0;
+    }
+    g_free(buffer);
+    return ok;
+}
+
+// Function to make one random edit to both the table and the array; returns whether it was
+// made, or sets failed when the table refused it
+static bool random_edit(PieceTable *table, GByteArray *expected, GRand *rand, bool *failed) {
+    guint8 data[16];
+    gsize len = (gsize)g_rand_int_range(rand, 1, sizeof(data) + 1);
+    for (gsize i = 0; i < len; i++) data[i] = (guint8)g_rand_int(rand);
+    gsize pos = (gsize)g_rand_int_range(rand, 0, (gint32)expected->len + 1);
+    gsize old_len = expected->len;
+
+    switch (g_rand_int_range(rand, 0, 3)) {
+        case 0:
+            g_byte_array_set_size(expected, (guint)(old_len + len));
+            memmove(expected->data + pos + len, expected->data + pos, old_len - pos);
+            memcpy(expected->data + pos, data, len);
+            *failed = !piece_table_insert(table, pos, data, len);
+            return true;
+        case 1:
+            if (pos + len > old_len) g_byte_array_set_size(expected, (guint)(pos + len));
+            memcpy(expected->data + pos, data, len);
+            *failed = !piece_table_overwrite(table, pos, data, len);
+            return true;
+        default:
+            len = MIN(len, old_len - pos);
+            if (len == 0) return false;
+            g_byte_array_remove_range(expected, (guint)pos, (guint)len);
+            *failed = !piece_table_delete(table, pos, len);
+            return true;
+    }
+}
+
+int main(void) {
+    GRand *rand = g_rand_new_with_seed(4242);
+
+    char *dir = g_dir_make_tmp("hex2text-piece-table-XXXXXX", NULL);
+    if (dir == NULL) {
+        fprintf(stderr, "FAIL: no temporary directory\n");
+        return 1;
+    }
+    char *path = g_build_filename(dir, "original.bin", NULL);
+
+    guint8 original[ORIGINAL_BYTES];
+    for (gsize i = 0; i < sizeof(original); i++) original[i] = (guint8)g_rand_int(rand);
+    g_file_set_contents(path, (const char *)original, sizeof(original), NULL);
+
+    char *error = NULL;
+    PieceTable *table = piece_table_new_from_file(path, &error);
+    if (table == NULL) {
+        fprintf(stderr, "FAIL: opening the file: %s\n", error);
+        return 1;
+    }
+
+    // Every state, so undo and redo can be checked against each
+    GPtrArray *states = g_ptr_array_new_with_free_func((GDestroyNotify)g_byte_array_unref);
+    GByteArray *expected = g_byte_array_new();
+    g_byte_array_append(expected, original, sizeof(original));
+    g_ptr_array_add(states, g_byte_array_ref(expected));
+
+    if (piece_table_is_modified(table) || piece_table_can_undo(table)) {
+        fprintf(stderr, "FAIL: a new table is modified\n");
+        return 1;
+    }
+
+    for (guint i = 0; i < EDIT_COUNT; i++) {
+        GByteArray *next = g_byte_array_new();
+        g_byte_array_append(next, expected->data, expected->len);
+        g_byte_array_unref(expected);
+        expected = next;
+
+        bool failed = false;
+        bool edited = random_edit(table, expected, rand, &failed);
+        if (failed || !same_contents(table, expected, rand)) {
+            fprintf(stderr, "FAIL: edit %u\n", i);
+            return 1;
+        }
+        if (edited) g_ptr_array_add(states, g_byte_array_ref(expected));
+    }
+    g_byte_array_unref(expected);
+    printf("%u edits in %u pieces\n", states->len - 1, piece_table_get_piece_count(table));
+
+    // Step by step back as far as the history goes, then all the way forward again
+    guint oldest = states->len - 1 > UNDO_STEPS ? states->len - 1 - UNDO_STEPS : 0;
+    for (guint i = states->len - 1; i > oldest; i--) {
+        if (!piece_table_undo(table) || !same_contents(table, g_ptr_array_index(states, i - 1), rand)) {
+            fprintf(stderr, "FAIL: undoing back to state %u\n", i - 1);
+            return 1;
+        }
+    }
+    if (piece_table_can_undo(table) || piece_table_is_modified(table) != (oldest > 0)) {
+        fprintf(stderr, "FAIL: the oldest state kept has more to undo or the wrong modified flag\n");
+        return 1;
+    }
+    for (guint i = oldest + 1; i < states->len; i++) {
+        if (!piece_table_redo(table) || !same_contents(table, g_ptr_array_index(states, i), rand)) {
+            fprintf(stderr, "FAIL: redoing to state %u\n", i);
+            return 1;
+        }
+    }
+    if (piece_table_can_redo(table) || !piece_table_is_modified(table)) {
+        fprintf(stderr, "FAIL: the last edit is unmodified or has more to redo\n");
+        return 1;
+    }
+
+    // Saving over the mapped file keeps the contents and makes them the unmodified state
+    GByteArray *last = g_ptr_array_index(states, states->len - 1);
+    if (!piece_table_save(table, path, &error) || piece_table_is_modified(table) ||
+        !same_contents(table, last, rand)) {
+        fprintf(stderr, "FAIL: saving: %s\n", error != NULL ? error : "contents changed");
+        return 1;
+    }
+    char *saved = NULL;
+    gsize saved_len = 0;
+    if (!g_file_get_contents(path, &saved, &saved_len, NULL) || saved_len != last->len ||
+        memcmp(saved, last->data, saved_len) != 0) {
+        fprintf(stderr, "FAIL: the saved file differs\n");
+        return 1;
+    }
+    g_free(saved);
+
+    // An undo past the save is a change again, and redoing it comes back to the save
+    if (!piece_table_undo(table) || !piece_table_is_modified(table) ||
+        !piece_table_redo(table) || piece_table_is_modified(table)) {
+        fprintf(stderr, "FAIL: modified flag around the save\n");
+        return 1;
+    }
+
+    piece_table_free(table);
+    g_ptr_array_free(states, TRUE);
+    g_remove(path);
+    g_rmdir(dir);
+    g_free(path);
+    g_free(dir);
+    g_rand_free(rand);
+    printf("piece table checks passed\n");
+    return 0;
+}
@@ -0,0 +1,268 @@
+#include "pointer_scanner.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Pointer positions per chunk; chunks are scanned in parallel and their hits passed on in order
+#define POINTER_CHUNK_BYTES (4 * 1024 * 1024)
+// Low value bits the filter bitmap covers (2 MiB); it is exact for pointers up to 24 bits
+#define FILTER_MAX_BITS 24
+
+typedef struct {
+    guint32 value;
+    gsize target;
+} TargetValue;
+
+typedef struct {
+    PointerFormat format;
+    guint32 mask;           // Value bits of a pointer
+    guint32 filter_mask;    // Value bits the bitmap covers
+    guint8 *filter;         // Bit per low value: some target has it
+    TargetValue *values;    // Sorted by value, one per value
+    guint n_values;
+} PointerSpec;
+
+typedef struct PointerJob PointerJob;
+
+typedef struct {
+    PointerJob *job;
+    size_t start;    // First pointer position of the chunk
+    size_t limit;    // First pointer position of the next chunk
+    GArray *hits;    // PointerHit
+    bool done;
+} PointerChunk;
+
+struct PointerJob {
+    const PointerSpec *spec;
+    const guint8 *data;
+    size_t len;
+    gint *cancel;
+    GMutex mutex;
+    GCond chunk_done;
+};
+
+static GThreadPool *pointer_pool = NULL;
+
+static bool is_cancelled(gint *cancel) {
+    return cancel != NULL && g_atomic_int_get(cancel) != 0;
+}
+
+static int compare_values(const void *a, const void *b) {
+    const TargetValue *x = a;
+    const TargetValue *y = b;
+    if (x->value != y->value) return x->value < y->value ? -1 : 1;
+    return (x->target > y->target) - (x->target < y->target);
+}
+
+// Function to turn the targets into sorted pointer values and fill the filter
+static void init_spec(PointerSpec *spec, const PointerFormat *format, const gsize *targets, guint n_targets) {
+    memset(spec, 0, sizeof(*spec));
+    spec->format = *format;
+    spec->mask = format->width >= 4 ? 0xFFFFFFFFu : (1u << (format->width * 8)) - 1;
+    guint filter_bits = MIN(format->width * 8, FILTER_MAX_BITS);
+    spec->filter_mask = (1u << filter_bits) - 1;
+    spec->filter = g_malloc0(((gsize)spec->filter_mask + 1) / 8);
+
+    spec->values = g_new(TargetValue, MAX(n_targets, 1));
+    for (guint i = 0; i < n_targets; i++) {
+        spec->values[i].value = (guint32)(targets[i] + format->base) & spec->mask;
+        spec->values[i].target = targets[i];
+    }
+    qsort(spec->values, n_targets, sizeof(TargetValue), compare_values);
+
+    // Keep the lowest target of each value
+    for (guint i = 0; i < n_targets; i++) {
+        if (spec->n_values > 0 && spec->values[spec->n_values - 1].value == spec->values[i].value) continue;
+        spec->values[spec->n_values++] = spec->values[i];
+        guint32 low = spec->values[i].value & spec->filter_mask;
+        spec->filter[low >> 3] |= (guint8)(1u << (low & 7));
+    }
+}
+
+// Function to check a value against the targets and record a hit
+static inline void check_value(const PointerSpec *spec, guint32 value, size_t pos, GArray *hits) {
+    guint32 low = value & spec->filter_mask;
+    if (!(spec->filter[low >> 3] & (1u << (low & 7)))) return;
+
+    guint lo = 0, hi = spec->n_values;
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        if (spec->values[mid].value < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < spec->n_values && spec->values[lo].value == value) {
+        PointerHit hit = { pos, spec->values[lo].target };
+        g_array_append_val(hits, hit);
+    }
+}
+
+static guint32 read_value(const guint8 *p, guint width, bool big_endian) {
+    guint32 value = 0;
+    for (guint k = 0; k < width; k++) {
+        guint shift = big_endian ? (width - 1 - k) * 8 : k * 8;
+        value |= (guint32)p[k] << shift;
+    }
+    return value;
+}
+
+// Function to find pointers at positions from..to-1
+// Unaligned pointers are read a word at a time: one 8-byte load holds the values of 9 - width
+// neighbouring positions, which are shifted out of it.
+static void scan_range(const PointerSpec *spec, const guint8 *data, size_t len, size_t from, size_t to,
+                       GArray *hits) {
+    const PointerFormat *format = &spec->format;
+    guint width = format->width;
+    if (len < width) return;
+    to = MIN(to, len - width + 1);
+
+    if (format->aligned) {
+        for (size_t i = (from + width - 1) / width * width; i < to; i += width) {
+            check_value(spec, read_value(data + i, width, format->big_endian), i, hits);
+        }
+        return;
+    }
+
+    guint per_load = 9 - width;
+    size_t i = from;
+    for (; i + 8 <= len && i + per_load <= to; i += per_load) {
+        guint64 word;
+        memcpy(&word, data + i, sizeof(word));
+        if (format->big_endian) {
+            word = GUINT64_FROM_BE(word);
+            for (guint k = 0; k < per_load; k++) {
+                check_value(spec, (guint32)(word >> (64 - 8 * (k + width))) & spec->mask, i + k, hits);
+            }
+        } else {
+            word = GUINT64_FROM_LE(word);
+            for (guint k = 0; k < per_load; k++) {
+                check_value(spec, (guint32)(word >> (8 * k)) & spec->mask, i + k, hits);
+            }
+        }
+    }
+
+    for (; i < to; i++) {
+        check_value(spec, read_value(data + i, width, format->big_endian), i, hits);
+    }
+}
+
+// Thread pool worker: scan one chunk
+static void run_pointer_chunk(gpointer data, gpointer user_data) {
+    PointerChunk *chunk = data;
+    PointerJob *job = chunk->job;
+
+    if (!is_cancelled(job->cancel)) {
+        scan_range(job->spec, job->data, job->len, chunk->start, chunk->limit, chunk->hits);
+    }
+
+    g_mutex_lock(&job->mutex);
+    chunk->done = true;
+    g_cond_broadcast(&job->chunk_done);
+    g_mutex_unlock(&job->mutex);
+}
+
+// Function to scan chunks on the pool, passing their hits on in order as they finish
+static void scan_parallel(const PointerSpec *spec, const guint8 *data, size_t len,
+                          PointerScanFunc func, gpointer user_data, gint *cancel) {
+    static gsize initialized = 0;
+    if (g_once_init_enter(&initialized)) {
+        pointer_pool = g_thread_pool_new(run_pointer_chunk, NULL, (gint)g_get_num_processors(), FALSE, NULL);
+        g_once_init_leave(&initialized, 1);
+    }
+
+    PointerJob job = { 0 };
+    job.spec = spec;
+    job.data = data;
+    job.len = len;
+    job.cancel = cancel;
+    g_mutex_init(&job.mutex);
+    g_cond_init(&job.chunk_done);
+
+    guint count = (guint)((len + POINTER_CHUNK_BYTES - 1) / POINTER_CHUNK_BYTES);
+    PointerChunk *chunks = g_new0(PointerChunk, count);
+    for (guint i = 0; i < count; i++) {
+        chunks[i].job = &job;
+        chunks[i].start = (size_t)i * POINTER_CHUNK_BYTES;
+        chunks[i].limit = MIN(chunks[i].start + POINTER_CHUNK_BYTES, len);
+        chunks[i].hits = g_array_new(FALSE, FALSE, sizeof(PointerHit));
+        g_thread_pool_push(pointer_pool, &chunks[i], NULL);
+    }
+
+    for (guint i = 0; i < count; i++) {
+        g_mutex_lock(&job.mutex);
+        while (!chunks[i].done) {
+            g_cond_wait(&job.chunk_done, &job.mutex);
+        }
+        g_mutex_unlock(&job.mutex);
+
+        if (!is_cancelled(cancel)) {
+            func((PointerHit *)chunks[i].hits->data, chunks[i].hits->len, chunks[i].limit, user_data);
+        }
+        g_array_free(chunks[i].hits, TRUE);
+    }
+
+    g_free(chunks);
+    g_mutex_clear(&job.mutex);
+    g_cond_clear(&job.chunk_done);
+}
+
+// Function to find every pointer to one of the targets in data, split over all cores
+void pointer_scanner_scan(const guint8 *data, size_t len, const PointerFormat *format,
+                          const gsize *targets, guint n_targets,
+                          PointerScanFunc func, gpointer user_data, gint *cancel) {
+    g_return_if_fail(format->width >= 2 && format->width <= 4);
+    if (n_targets == 0) return;
+
+    PointerSpec spec;
+    init_spec(&spec, format, targets, n_targets);
+
+    if (len > POINTER_CHUNK_BYTES && g_get_num_processors() > 1) {
+        scan_parallel(&spec, data, len, func, user_data, cancel);
+    } else {
+        GArray *hits = g_array_new(FALSE, FALSE, sizeof(PointerHit));
+        for (size_t start = 0; start < len && !is_cancelled(cancel); start += POINTER_CHUNK_BYTES) {
+            size_t limit = MIN(start + POINTER_CHUNK_BYTES, len);
+            scan_range(&spec, data, len, start, limit, hits);
+            func((PointerHit *)hits->data, hits->len, limit, user_data);
+            g_array_set_size(hits, 0);
+        }
+        g_array_free(hits, TRUE);
+    }
+
+    g_free(spec.filter);
+    g_free(spec.values);
+}
+
+static int compare_tables(const void *a, const void *b) {
+    const PointerTable *x = a;
+    const PointerTable *y = b;
+    if (x->count != y->count) return x->count > y->count ? -1 : 1;
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+// Function to group hits into tables of at least min_count pointers, largest first
+GArray* pointer_scanner_find_tables(const PointerHit *hits, guint count, guint width, guint min_count) {
+    GArray *tables = g_array_new(FALSE, FALSE, sizeof(PointerTable));
+    PointerTable current = { 0 };
+
+    for (guint i = 0; i < count; i++) {
+        gsize offset = hits[i].offset;
+        if (current.count > 0 && offset < current.end) continue;
+
+        if (current.count > 0 && offset - (current.end - width) <= 2 * width) {
+            current.end = offset + width;
+            current.count++;
+            continue;
+        }
+
+        if (current.count >= min_count) g_array_append_val(tables, current);
+        current.offset = offset;
+        current.end = offset + width;
+        current.count = 1;
+    }
+    if (current.count >= min_count) g_array_append_val(tables, current);
+
+    qsort(tables->data, tables->len, sizeof(PointerTable), compare_tables);
+    return tables;
+}
@@ -0,0 +1,48 @@
+#ifndef POINTER_SCANNER_H
+#define POINTER_SCANNER_H
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Search of binary data for pointers to known offsets (strings found by a scan or search)
+// A pointer to offset t holds base + t, cut to its width, so bank-relative 16-bit pointers work with
+// a base that wraps. Every value is checked against a bitmap of the targets' low bits, and only
+// values that pass are looked up in the sorted target list.
+typedef struct {
+    guint width;        // 2, 3 or 4 bytes
+    bool big_endian;
+    bool aligned;       // Only at offsets that are a multiple of width
+    guint32 base;       // Value of a pointer to offset 0
+} PointerFormat;
+
+typedef struct {
+    gsize offset;       // Where the pointer is
+    gsize target;       // Offset it points to
+} PointerHit;
+
+// A run of pointers close together, likely a pointer table
+typedef struct {
+    gsize offset;       // First pointer
+    gsize end;          // End of the last pointer
+    guint count;        // Pointers in it
+} PointerTable;
+
+// Called from the scanning thread with each batch of hits in offset order (count may be 0, to
+// report progress); scanned is how many bytes are done
+typedef void (*PointerScanFunc)(const PointerHit *hits, guint count, gsize scanned, gpointer user_data);
+
+// Function to find every pointer to one of the targets in data, split over all cores
+// Blocks until the scan is done or *cancel (may be NULL) becomes non-zero. Targets need not be
+// sorted; when several give the same pointer value, hits name the lowest.
+void pointer_scanner_scan(const guint8 *data, size_t len, const PointerFormat *format,
+                          const gsize *targets, guint n_targets,
+                          PointerScanFunc func, gpointer user_data, gint *cancel);
+
+// Function to group hits (in offset order) into tables of at least min_count pointers
+// Pointers belong together when each starts within two widths of the one before, so tables whose
+// entries are interleaved with another field of the same size are found too; hits overlapping
+// the one before are skipped. Returns a GArray of PointerTable, largest first.
+GArray* pointer_scanner_find_tables(const PointerHit *hits, guint count, guint width, guint min_count);
+
+#endif /* POINTER_SCANNER_H */
@@ -0,0 +1,92 @@
+#include "record_file.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Function to append a field to the record being built in line
+void record_append_field(GString *line, const char *field) {
+    if (line->len > 0 && line->str[line->len - 1] != '\n') {
+        g_string_append_c(line, '\t');
+    }
+
+    for (const char *p = field; *p; p++) {
+        switch (*p) {
+            case '\\': g_string_append(line, "\\\\"); break;
+            case '\t': g_string_append(line, "\\t"); break;
+            case '\n': g_string_append(line, "\\n"); break;
+            case '\r': g_string_append(line, "\\r"); break;
+            default: g_string_append_c(line, *p); break;
+        }
+    }
+}
+
+// Unescape one field of length len
+static char* unescape_field(const char *field, size_t len) {
+    GString *out = g_string_sized_new(len);
+
+    for (size_t i = 0; i < len; i++) {
+        if (field[i] == '\\' && i + 1 < len) {
+            i++;
+            switch (field[i]) {
+                case 't': g_string_append_c(out, '\t'); break;
+                case 'n': g_string_append_c(out, '\n'); break;
+                case 'r': g_string_append_c(out, '\r'); break;
+                default: g_string_append_c(out, field[i]); break;
+            }
+        } else {
+            g_string_append_c(out, field[i]);
+        }
+    }
+
+    return g_string_free(out, FALSE);
+}
+
+// Function to split a record line into its unescaped fields
+gchar** record_split_fields(const char *line) {
+    GPtrArray *fields = g_ptr_array_new();
+    const char *start = line;
+
+    while (true) {
+        const char *tab = strchr(start, '\t');
+        size_t len = tab != NULL ? (size_t)(tab - start) : strlen(start);
+        g_ptr_array_add(fields, unescape_field(start, len));
+        if (tab == NULL) break;
+        start = tab + 1;
+    }
+
+    g_ptr_array_add(fields, NULL);
+    return (gchar **)g_ptr_array_free(fields, FALSE);
+}
+
+// Function to append complete record lines to a file
+bool record_file_append(const char *path, const char *data, gsize len, bool sync) {
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: Could not open %s for appending: %s\n", path, g_strerror(errno));
+        return false;
+    }
+
+    // O_APPEND keeps each write at the end even if another thread appended in between
+    bool ok = true;
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "ERROR: Could not append to %s: %s\n", path, g_strerror(errno));
+            ok = false;
+            break;
+        }
+        data += written;
+        len -= (gsize)written;
+    }
+
+    if (ok && sync && fdatasync(fd) != 0) {
+        fprintf(stderr, "ERROR: Could not flush %s: %s\n", path, g_strerror(errno));
+        ok = false;
+    }
+
+    close(fd);
+    return ok;
+}
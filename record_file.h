@@ -0,0 +1,21 @@
+#ifndef RECORD_FILE_H
+#define RECORD_FILE_H
+
+#include <glib.h>
+#include <stdbool.h>
+
+// Line-oriented record files under ~/.hex2text/
+// One record per line, fields separated by tabs; tabs, line breaks and backslashes inside
+// a field are backslash-escaped, so any text fits in a field.
+
+// Function to append a field to the record being built in line (adds the tab separator)
+void record_append_field(GString *line, const char *field);
+
+// Function to split a record line into its unescaped fields (free with g_strfreev)
+gchar** record_split_fields(const char *line);
+
+// Function to append complete record lines to a file, creating it if needed
+// With sync set, the data is on disk when this returns.
+bool record_file_append(const char *path, const char *data, gsize len, bool sync);
+
+#endif /* RECORD_FILE_H */
@@ -0,0 +1,167 @@
+#include "relative_search.h"
+#include <string.h>
+
+typedef struct {
+    gunichar first;
+    gunichar last;
+} Alphabet;
+
+// Runs of characters game character sets tend to keep in order
+static const Alphabet known_alphabets[] = {
+    { 'A', 'Z' },
+    { 'a', 'z' },
+    { '0', '9' },
+    { 0x3041, 0x3096 },   // Hiragana
+    { 0x30A1, 0x30FA },   // Katakana
+    { 0xFF21, 0xFF3A },   // Full-width A-Z
+    { 0xFF41, 0xFF5A },   // Full-width a-z
+    { 0xFF10, 0xFF19 },   // Full-width 0-9
+    { 0x0410, 0x044F },   // Cyrillic А-я
+};
+
+struct RelativeWord {
+    char *text;
+    gunichar *chars;
+    glong len;
+    int min_step;        // Smallest and largest code point distance from the first character
+    int max_step;
+    GArray *alphabets;   // Alphabet, in the order the word first uses them
+};
+
+// Function to find the alphabet a character belongs to (on its own if none)
+static Alphabet alphabet_of(gunichar ch) {
+    for (guint i = 0; i < G_N_ELEMENTS(known_alphabets); i++) {
+        if (ch >= known_alphabets[i].first && ch <= known_alphabets[i].last) return known_alphabets[i];
+    }
+    Alphabet single = { ch, ch };
+    return single;
+}
+
+// Function to prepare a word; on failure returns NULL and sets error (may be NULL)
+RelativeWord* relative_word_new(const char *text, char **error) {
+    glong len = 0;
+    gunichar *chars = g_utf8_to_ucs4(text, -1, NULL, &len, NULL);
+    const char *problem = NULL;
+
+    if (chars == NULL) {
+        problem = "The word is not valid text";
+    } else if (len < 3) {
+        problem = "Relative search needs a word of at least three characters";
+    }
+
+    int min_step = 0, max_step = 0;
+    bool all_same = true;
+    for (glong i = 1; problem == NULL && i < len; i++) {
+        int step = (int)chars[i] - (int)chars[0];
+        min_step = MIN(min_step, step);
+        max_step = MAX(max_step, step);
+        if (chars[i] != chars[i - 1]) all_same = false;
+    }
+    if (problem == NULL && max_step - min_step > 255) {
+        problem = "The word's characters are too far apart to be in one 8-bit character set";
+    } else if (problem == NULL && all_same) {
+        problem = "The word needs at least two different characters";
+    }
+
+    if (problem != NULL) {
+        if (error != NULL) *error = g_strdup(problem);
+        g_free(chars);
+        return NULL;
+    }
+
+    RelativeWord *word = g_new0(RelativeWord, 1);
+    word->text = g_strdup(text);
+    word->chars = chars;
+    word->len = len;
+    word->min_step = min_step;
+    word->max_step = max_step;
+    word->alphabets = g_array_new(FALSE, FALSE, sizeof(Alphabet));
+
+    for (glong i = 0; i < len; i++) {
+        Alphabet alphabet = alphabet_of(chars[i]);
+        bool seen = false;
+        for (guint k = 0; k < word->alphabets->len && !seen; k++) {
+            seen = g_array_index(word->alphabets, Alphabet, k).first == alphabet.first;
+        }
+        if (!seen) g_array_append_val(word->alphabets, alphabet);
+    }
+    return word;
+}
+
+// Function to free a word
+void relative_word_free(RelativeWord *word) {
+    if (word == NULL) return;
+    g_free(word->text);
+    g_free(word->chars);
+    g_array_free(word->alphabets, TRUE);
+    g_free(word);
+}
+
+const char* relative_word_get_text(const RelativeWord *word) {
+    return word->text;
+}
+
+// Function to create a relative search for the word's differences
+ByteSearch* relative_word_create_search(const RelativeWord *word) {
+    // Only the differences count, so the first character stands at 0
+    guint8 *pattern = g_malloc(word->len);
+    for (glong i = 0; i < word->len; i++) {
+        pattern[i] = (guint8)(word->chars[i] - word->chars[0]);
+    }
+
+    ByteSearch *search = byte_search_new_relative();
+    byte_search_add_pattern(search, pattern, word->len);
+    g_free(pattern);
+    return search;
+}
+
+// Function to check that a match starting with first_byte spells the word without wrapping
+bool relative_word_fits(const RelativeWord *word, guint8 first_byte) {
+    return first_byte + word->min_step >= 0 && first_byte + word->max_step <= 0xFF;
+}
+
+// Function to find the character a byte stands for under the mapping, or 0 if none of the word's alphabets
+static gunichar mapped_char(const RelativeWord *word, guint8 first_byte, guint8 byte) {
+    gint64 ch = (gint64)word->chars[0] + byte - first_byte;
+    for (guint k = 0; k < word->alphabets->len; k++) {
+        const Alphabet *alphabet = &g_array_index(word->alphabets, Alphabet, k);
+        if (ch >= alphabet->first && ch <= alphabet->last) return (gunichar)ch;
+    }
+    return 0;
+}
+
+// Function to decode bytes with the mapping a match starting with first_byte implies
+char* relative_word_decode(const RelativeWord *word, guint8 first_byte, const guint8 *data, size_t len) {
+    // Decide each byte value once
+    gunichar chars[256];
+    for (guint b = 0; b < 256; b++) {
+        chars[b] = mapped_char(word, first_byte, (guint8)b);
+    }
+
+    GString *text = g_string_sized_new(len);
+    for (size_t i = 0; i < len; i++) {
+        if (chars[data[i]] != 0) {
+            g_string_append_unichar(text, chars[data[i]]);
+        } else {
+            g_string_append(text, "·");
+        }
+    }
+    return g_string_free(text, FALSE);
+}
+
+// Function to write the draft .tbl a match starting with first_byte implies
+char* relative_word_draft_table(const RelativeWord *word, guint8 first_byte) {
+    GString *table = g_string_new(NULL);
+    g_string_append_printf(table, "# Draft table from a relative search for \"%s\" (%02X=", word->text, first_byte);
+    g_string_append_unichar(table, word->chars[0]);
+    g_string_append(table, ")\n");
+
+    for (guint b = 0; b < 256; b++) {
+        gunichar ch = mapped_char(word, first_byte, (guint8)b);
+        if (ch == 0) continue;
+        g_string_append_printf(table, "%02X=", b);
+        g_string_append_unichar(table, ch);
+        g_string_append_c(table, '\n');
+    }
+    return g_string_free(table, FALSE);
+}
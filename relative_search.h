@@ -0,0 +1,42 @@
+#ifndef RELATIVE_SEARCH_H
+#define RELATIVE_SEARCH_H
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "byte_search.h"
+
+// Relative search: finding a known word in a game's own character set
+// Game character sets usually keep letters in alphabet order, so a word's bytes differ from each
+// other as its letters do, whatever byte 'A' is. A match of the word's differences implies a
+// mapping for its first letter, and from it a draft table for the alphabets the word is in.
+// The alphabets known are A-Z, a-z, 0-9, hiragana, katakana, full-width A-Z/a-z/0-9 and Cyrillic;
+// other characters are mapped on their own. Mixed-case words assume ASCII spacing between cases.
+typedef struct RelativeWord RelativeWord;
+
+// Function to prepare a word (at least three characters whose code points differ by less than
+// 256, not all the same); on failure returns NULL and sets error (may be NULL)
+RelativeWord* relative_word_new(const char *text, char **error);
+
+// Function to free a word
+void relative_word_free(RelativeWord *word);
+
+// Function to get the word as typed
+const char* relative_word_get_text(const RelativeWord *word);
+
+// Function to create a relative search for the word's differences
+ByteSearch* relative_word_create_search(const RelativeWord *word);
+
+// Function to check that a match starting with first_byte spells the word without wrapping past
+// 00 or FF (the search only compares differences modulo 256)
+bool relative_word_fits(const RelativeWord *word, guint8 first_byte);
+
+// Function to decode bytes with the mapping a match starting with first_byte implies; bytes
+// outside the word's alphabets are shown as '·'
+char* relative_word_decode(const RelativeWord *word, guint8 first_byte, const guint8 *data, size_t len);
+
+// Function to write the draft .tbl a match starting with first_byte implies, one "XX=c" line for
+// every character of the word's alphabets that lands in 00..FF
+char* relative_word_draft_table(const RelativeWord *word, guint8 first_byte);
+
+#endif /* RELATIVE_SEARCH_H */
@@ -0,0 +1,101 @@
+#include "render_cache.h"
+
+typedef struct {
+    guint64 generation;
+    EncodingType encoding;
+    char *text;
+    gsize len;
+    gsize chars;
+} RenderEntry;
+
+struct RenderCache {
+    GQueue entries;      // RenderEntry, most recently used first
+    guint max_entries;
+    gsize max_bytes;
+    gsize bytes;         // Text held
+};
+
+static void render_entry_free(RenderEntry *entry) {
+    g_free(entry->text);
+    g_free(entry);
+}
+
+// Function to create a cache holding at most max_entries renderings and max_bytes of text
+RenderCache* render_cache_new(guint max_entries, gsize max_bytes) {
+    RenderCache *cache = g_new0(RenderCache, 1);
+    g_queue_init(&cache->entries);
+    cache->max_entries = MAX(max_entries, 1);
+    cache->max_bytes = max_bytes;
+    return cache;
+}
+
+void render_cache_free(RenderCache *cache) {
+    if (cache == NULL) return;
+    render_cache_clear(cache);
+    g_free(cache);
+}
+
+static void remove_link(RenderCache *cache, GList *link) {
+    RenderEntry *entry = link->data;
+    cache->bytes -= entry->len + 1;
+    render_entry_free(entry);
+    g_queue_delete_link(&cache->entries, link);
+}
+
+// Function to look up a rendering and mark it most recently used
+const char* render_cache_lookup(RenderCache *cache, guint64 generation, EncodingType encoding,
+                                gsize *len, gsize *chars) {
+    // A handful of entries: a list walk beats hashing
+    for (GList *link = cache->entries.head; link != NULL; link = link->next) {
+        RenderEntry *entry = link->data;
+        if (entry->generation != generation || entry->encoding != encoding) continue;
+
+        g_queue_unlink(&cache->entries, link);
+        g_queue_push_head_link(&cache->entries, link);
+        if (len != NULL) *len = entry->len;
+        if (chars != NULL) *chars = entry->chars;
+        return entry->text;
+    }
+    return NULL;
+}
+
+// Function to store a rendering (takes the text)
+void render_cache_store(RenderCache *cache, guint64 generation, EncodingType encoding,
+                        char *text, gsize len, gsize chars) {
+    if (len + 1 > cache->max_bytes) {
+        g_free(text);
+        return;
+    }
+
+    // Drop renderings of older contents, and any of the same key
+    GList *link = cache->entries.head;
+    while (link != NULL) {
+        GList *next = link->next;
+        RenderEntry *entry = link->data;
+        if (entry->generation < generation || (entry->generation == generation && entry->encoding == encoding)) {
+            remove_link(cache, link);
+        }
+        link = next;
+    }
+
+    RenderEntry *entry = g_new(RenderEntry, 1);
+    entry->generation = generation;
+    entry->encoding = encoding;
+    entry->text = text;
+    entry->len = len;
+    entry->chars = chars;
+    g_queue_push_head(&cache->entries, entry);
+    cache->bytes += len + 1;
+
+    // Evict from the least recently used end
+    while (cache->entries.length > cache->max_entries || cache->bytes > cache->max_bytes) {
+        remove_link(cache, cache->entries.tail);
+    }
+}
+
+// Function to drop every rendering
+void render_cache_clear(RenderCache *cache) {
+    while (cache->entries.head != NULL) {
+        remove_link(cache, cache->entries.head);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef RENDER_CACHE_H
+#define RENDER_CACHE_H
+
+#include <glib.h>
+#include <stddef.h>
+#include "common.h"
+
+// Least-recently-used cache of a document rendered in each encoding, with the text's size
+// Entries are keyed by document generation and encoding; storing a newer generation drops the
+// older ones, as documents only move forward. The oldest entries go when either cap is passed.
+typedef struct RenderCache RenderCache;
+
+// Function to create a cache holding at most max_entries renderings and max_bytes of text
+RenderCache* render_cache_new(guint max_entries, gsize max_bytes);
+
+// Function to free a cache
+void render_cache_free(RenderCache *cache);
+
+// Function to look up a rendering; returns the cached text (owned by the cache, valid until the
+// next store or clear) and its length in bytes and characters, or NULL
+const char* render_cache_lookup(RenderCache *cache, guint64 generation, EncodingType encoding,
+                                gsize *len, gsize *chars);
+
+// Function to store a rendering (takes the text); text over max_bytes isn't kept
+void render_cache_store(RenderCache *cache, guint64 generation, EncodingType encoding,
+                        char *text, gsize len, gsize chars);
+
+// Function to drop every rendering (e.g. when the character table changes)
+void render_cache_clear(RenderCache *cache);
+
+#endif /* RENDER_CACHE_H */
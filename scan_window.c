@@ -0,0 +1,1008 @@
+#include "scan_window.h"
+#include "common.h"
+#include "string_scanner.h"
+#include "byte_search.h"
+#include "relative_search.h"
+#include "pointer_scanner.h"
+#include "char_table.h"
+#include "text_decoder.h"
+#include "text_encoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern bool debug_mode;
+
+// Rows added to the list at a time; more are added when it is scrolled to the bottom
+#define ROWS_PER_PAGE 200
+// Characters of a hit shown in its row
+#define SNIPPET_CHARS 120
+// Bytes decoded for a row's snippet
+#define SNIPPET_BYTES 512
+// Bytes of a hit shown in the main window at most
+#define SHOW_MAX_BYTES (64 * 1024)
+// Bytes shown from a search match, so the text after it shows too
+#define MATCH_CONTEXT_BYTES 256
+// Hits kept at most; a scan or search stops when it has this many
+#define MAX_LISTED_HITS 1000000
+// Pointers a run needs to be reported as a table
+#define MIN_TABLE_POINTERS 4
+// Encodings offered: every EncodingType except HEX
+#define SCAN_FIRST ASCII
+#define SCAN_LAST TABLE_FILE
+
+typedef struct ScanRun ScanRun;
+
+typedef enum {
+    SCAN_STRINGS,   // Runs of text characters
+    SCAN_SEARCH,    // Matches of the search text
+    SCAN_RELATIVE,  // Matches of the search text's letter differences
+    SCAN_POINTERS   // Pointers to the strings or matches listed before
+} ScanMode;
+
+// A listed string or match
+typedef struct {
+    gsize offset;
+    gsize length;               // Length in bytes
+    gsize chars;                // Length in characters (strings only)
+    EncodingType encoding;      // Pointers: the encoding of the string pointed to
+    gsize target;               // Pointers: offset pointed to
+} ListedHit;
+
+// Window state, owned by the window
+typedef struct {
+    GtkWidget *window;
+    GtkWidget *parent;          // Main window hits are shown in; cleared when it closes
+    GtkWidget *file_label;
+    GtkWidget *open_button;
+    GtkDropDown *encoding_dropdown;
+    GtkWidget *min_length_spin;
+    GtkWidget *scan_button;
+    GtkWidget *search_entry;
+    GtkWidget *all_encodings_check;
+    GtkWidget *relative_check;
+    GtkWidget *find_button;
+    GtkWidget *save_table_button;
+    GtkDropDown *pointer_format_dropdown;
+    GtkWidget *base_entry;
+    GtkWidget *aligned_check;
+    GtkWidget *pointer_button;
+    GtkWidget *status_label;
+    GtkWidget *list;
+    GMappedFile *file;
+    char *file_name;
+    GArray *hits;               // ListedHit of the last scan or search
+    ScanMode hits_mode;
+    RelativeWord *relative_word;    // Word of the last relative search
+    guint first_byte_counts[256];   // Relative matches by the byte the word starts with
+    char *draft_table;              // Table text of the last relative match shown
+    GArray *pointer_targets;        // ListedHit pointers are searched for, by offset
+    GArray *pointer_tables;         // PointerTable of the last pointer scan, by offset
+    guint rows_shown;
+    guint rows_wanted;
+    ScanRun *run;               // Scan in progress, or NULL
+    bool closed;
+} ScanWindow;
+
+// A scan on its own thread; hits are handed to the main thread in batches
+struct ScanRun {
+    ScanWindow *state;
+    GtkWidget *window;          // Reference, so the state outlives the scan
+    GMappedFile *file;
+    GtkWidget *button;          // Button that started the run, and stops it
+    ScanMode mode;
+    EncodingType encoding;      // Strings: encoding scanned for
+    guint min_chars;
+    ByteSearch *search;         // Search: patterns, and the encoding each is in
+    GArray *pattern_encodings;
+    const RelativeWord *relative;   // Relative search: the word (owned by the window)
+    PointerFormat pointer_format;   // Pointer scan: format, and targets by offset
+    GArray *targets;
+    GArray *pointers;           // PointerHit found, for finding tables (running thread only)
+    GArray *tables;             // PointerTable, once finished
+    gint cancel;
+    gint64 started;
+    bool ok;
+    guint listed;               // Hits passed on, checked against MAX_LISTED_HITS (running thread only)
+    bool truncated;
+
+    GMutex mutex;               // Guards the fields below
+    GArray *pending;            // ListedHit not yet shown
+    gsize scanned;
+    bool flush_scheduled;
+    bool finished;
+};
+
+// Pointer formats offered: width and byte order
+static const struct {
+    const char *name;
+    guint width;
+    bool big_endian;
+} pointer_formats[] = {
+    { "16-bit LE", 2, false },
+    { "16-bit BE", 2, true },
+    { "24-bit LE", 3, false },
+    { "24-bit BE", 3, true },
+    { "32-bit LE", 4, false },
+    { "32-bit BE", 4, true },
+};
+
+static void scan_window_free(gpointer data) {
+    ScanWindow *state = data;
+    if (state->parent != NULL) {
+        g_object_remove_weak_pointer(G_OBJECT(state->parent), (gpointer *)&state->parent);
+    }
+    if (state->file != NULL) g_mapped_file_unref(state->file);
+    g_free(state->file_name);
+    relative_word_free(state->relative_word);
+    g_free(state->draft_table);
+    if (state->pointer_targets != NULL) g_array_free(state->pointer_targets, TRUE);
+    if (state->pointer_tables != NULL) g_array_free(state->pointer_tables, TRUE);
+    g_array_free(state->hits, TRUE);
+    g_free(state);
+}
+
+static const guint8* file_data(GMappedFile *file) {
+    return (const guint8 *)g_mapped_file_get_contents(file);
+}
+
+// Function to cut decoded text down to one line for a row
+static char* make_row_snippet(const char *text) {
+    GString *snippet = g_string_new(NULL);
+    guint chars = 0;
+
+    for (const char *p = text; *p != '\0' && chars < SNIPPET_CHARS; p = g_utf8_next_char(p), chars++) {
+        gunichar ch = g_utf8_get_char(p);
+        if (ch == '\n') {
+            g_string_append(snippet, "⏎");
+        } else if (ch < 0x20) {
+            g_string_append_c(snippet, ' ');
+        } else {
+            g_string_append_unichar(snippet, ch);
+        }
+    }
+
+    return g_string_free(snippet, FALSE);
+}
+
+// Function to find the pointer table a pointer is in, if any
+static const PointerTable* find_pointer_table(ScanWindow *state, gsize offset) {
+    if (state->pointer_tables == NULL) return NULL;
+
+    guint lo = 0, hi = state->pointer_tables->len;
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        const PointerTable *table = &g_array_index(state->pointer_tables, PointerTable, mid);
+        if (offset < table->offset) {
+            hi = mid;
+        } else if (offset >= table->end) {
+            lo = mid + 1;
+        } else {
+            return table;
+        }
+    }
+    return NULL;
+}
+
+// Function to add list rows for hits up to the number wanted
+static void add_hit_rows(ScanWindow *state) {
+    const guint8 *data = file_data(state->file);
+    gsize file_len = g_mapped_file_get_length(state->file);
+    guint target = MIN(state->rows_wanted, state->hits->len);
+
+    for (; state->rows_shown < target; state->rows_shown++) {
+        const ListedHit *hit = &g_array_index(state->hits, ListedHit, state->rows_shown);
+        char *row_text;
+
+        if (state->hits_mode == SCAN_STRINGS) {
+            char *text = text_decoder_decode(data + hit->offset, MIN(hit->length, SNIPPET_BYTES), hit->encoding, NULL);
+            char *snippet = make_row_snippet(text != NULL ? text : "");
+            row_text = g_strdup_printf("%010" G_GSIZE_MODIFIER "X  %6" G_GSIZE_FORMAT "  %s",
+                                       hit->offset, hit->chars, snippet);
+            g_free(snippet);
+            g_free(text);
+        } else if (state->hits_mode == SCAN_POINTERS) {
+            // The string pointed to, and the table the pointer is in
+            size_t len = MIN(file_len - hit->target, SNIPPET_BYTES);
+            char *text = text_decoder_decode(data + hit->target, len, hit->encoding, NULL);
+            char *snippet = make_row_snippet(text != NULL ? text : "");
+            const PointerTable *table = find_pointer_table(state, hit->offset);
+            char *tag = table != NULL ? g_strdup_printf("table %06" G_GSIZE_MODIFIER "X", table->offset) : g_strdup("");
+            row_text = g_strdup_printf("%010" G_GSIZE_MODIFIER "X  → %010" G_GSIZE_MODIFIER "X  %-12s  %s",
+                                       hit->offset, hit->target, tag, snippet);
+            g_free(tag);
+            g_free(snippet);
+            g_free(text);
+        } else if (state->hits_mode == SCAN_RELATIVE) {
+            // Decoded with the mapping the match implies, so text around it stands out
+            guint8 first_byte = data[hit->offset];
+            char *text = relative_word_decode(state->relative_word, first_byte, data + hit->offset,
+                                              MIN(file_len - hit->offset, SNIPPET_CHARS));
+            char *snippet = make_row_snippet(text);
+            row_text = g_strdup_printf("%010" G_GSIZE_MODIFIER "X  %02X  %s", hit->offset, first_byte, snippet);
+            g_free(snippet);
+            g_free(text);
+        } else {
+            // A match is shown with the text that follows it
+            size_t len = MIN(file_len - hit->offset, SNIPPET_BYTES);
+            char *text = text_decoder_decode(data + hit->offset, len, hit->encoding, NULL);
+            char *snippet = make_row_snippet(text != NULL ? text : "");
+            row_text = g_strdup_printf("%010" G_GSIZE_MODIFIER "X  %-11s  %s",
+                                       hit->offset, encoding_type_to_string(hit->encoding), snippet);
+            g_free(snippet);
+            g_free(text);
+        }
+        GtkWidget *label = gtk_label_new(row_text);
+        gtk_label_set_xalign(GTK_LABEL(label), 0);
+        gtk_label_set_single_line_mode(GTK_LABEL(label), TRUE);
+        gtk_label_set_ellipsize(GTK_LABEL(label), PANGO_ELLIPSIZE_END);
+        gtk_widget_add_css_class(label, "monospace");
+
+        GtkWidget *row = gtk_list_box_row_new();
+        gtk_list_box_row_set_child(GTK_LIST_BOX_ROW(row), label);
+        g_object_set_data(G_OBJECT(row), "hit_index", GUINT_TO_POINTER(state->rows_shown));
+        gtk_list_box_append(GTK_LIST_BOX(state->list), row);
+
+        g_free(row_text);
+    }
+}
+
+static void update_scan_status(ScanWindow *state, ScanRun *run, gsize scanned, bool finished) {
+    gsize total = g_mapped_file_get_length(run->file);
+    double seconds = (g_get_monotonic_time() - run->started) / (double)G_USEC_PER_SEC;
+    char *status;
+
+    const char *stopped = run->truncated ? "Stopped at the hit limit: "
+                        : g_atomic_int_get(&run->cancel) ? "Stopped: " : "";
+
+    if (!finished) {
+        status = g_strdup_printf("%s… %d%% · %u %s", run->mode == SCAN_SEARCH || run->mode == SCAN_RELATIVE ? "Searching" : "Scanning",
+                                 total > 0 ? (int)(scanned * 100 / total) : 100, state->hits->len,
+                                 run->mode == SCAN_STRINGS ? "strings" : run->mode == SCAN_POINTERS ? "pointers" : "matches");
+    } else if (!run->ok) {
+        status = g_strdup("No character table is loaded (Tools → Load Table File…)");
+    } else if (run->mode == SCAN_STRINGS) {
+        status = g_strdup_printf("%s%u strings of %u+ characters in %.2f s (%.0f MB/s)", stopped, state->hits->len,
+                                 run->min_chars, seconds, seconds > 0 ? scanned / seconds / 1e6 : 0);
+    } else if (run->mode == SCAN_POINTERS) {
+        // Tables come largest first
+        char *largest = run->tables->len > 0
+            ? g_strdup_printf(", the largest at 0x%" G_GSIZE_MODIFIER "X with %u pointers",
+                              g_array_index(run->tables, PointerTable, 0).offset,
+                              g_array_index(run->tables, PointerTable, 0).count)
+            : g_strdup("");
+        status = g_strdup_printf("%s%u pointers to %u targets in %.2f s; %u tables of %d+%s", stopped, state->hits->len,
+                                 run->targets->len, seconds, run->tables->len, MIN_TABLE_POINTERS, largest);
+        g_free(largest);
+    } else if (run->mode == SCAN_SEARCH) {
+        status = g_strdup_printf("%s%u matches of %u encoded forms in %.2f s (%.0f MB/s)", stopped, state->hits->len,
+                                 run->pattern_encodings->len, seconds, seconds > 0 ? scanned / seconds / 1e6 : 0);
+    } else {
+        // The mapping most matches agree on is the likely one
+        guint best = 0;
+        for (guint b = 1; b < 256; b++) {
+            if (state->first_byte_counts[b] > state->first_byte_counts[best]) best = b;
+        }
+        char *common = state->hits->len > 0
+            ? g_strdup_printf("; most start with %02X (%u), activate one to try its table", best, state->first_byte_counts[best])
+            : g_strdup("");
+        status = g_strdup_printf("%s%u relative matches for \"%s\" in %.2f s (%.0f MB/s)%s", stopped, state->hits->len,
+                                 relative_word_get_text(run->relative), seconds,
+                                 seconds > 0 ? scanned / seconds / 1e6 : 0, common);
+        g_free(common);
+    }
+    gtk_label_set_text(GTK_LABEL(state->status_label), status);
+    g_free(status);
+}
+
+static void scan_run_free(ScanRun *run) {
+    byte_search_free(run->search);
+    if (run->pattern_encodings != NULL) g_array_free(run->pattern_encodings, TRUE);
+    if (run->targets != NULL) g_array_free(run->targets, TRUE);
+    if (run->pointers != NULL) g_array_free(run->pointers, TRUE);
+    if (run->tables != NULL) g_array_free(run->tables, TRUE);
+    g_array_free(run->pending, TRUE);
+    g_mutex_clear(&run->mutex);
+    g_mapped_file_unref(run->file);
+    g_object_unref(run->window);
+    g_free(run);
+}
+
+static gint compare_tables_by_offset(gconstpointer a, gconstpointer b) {
+    const PointerTable *x = a;
+    const PointerTable *y = b;
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+// Function to move hits from the scanning thread into the list (main thread)
+static gboolean flush_scan_hits(gpointer user_data) {
+    ScanRun *run = user_data;
+    ScanWindow *state = run->state;
+
+    g_mutex_lock(&run->mutex);
+    GArray *batch = run->pending;
+    run->pending = g_array_new(FALSE, FALSE, sizeof(ListedHit));
+    gsize scanned = run->scanned;
+    bool finished = run->finished;
+    run->flush_scheduled = false;
+    g_mutex_unlock(&run->mutex);
+
+    if (!state->closed) {
+        if (state->hits_mode == SCAN_RELATIVE) {
+            const guint8 *data = file_data(state->file);
+            for (guint i = 0; i < batch->len; i++) {
+                state->first_byte_counts[data[g_array_index(batch, ListedHit, i).offset]]++;
+            }
+        }
+        if (finished && run->tables != NULL) {
+            // Rows look their table up by offset
+            GArray *tables = g_array_sized_new(FALSE, FALSE, sizeof(PointerTable), run->tables->len);
+            g_array_append_vals(tables, run->tables->data, run->tables->len);
+            g_array_sort(tables, compare_tables_by_offset);
+            if (state->pointer_tables != NULL) g_array_free(state->pointer_tables, TRUE);
+            state->pointer_tables = tables;
+
+            // Rows shown so far get their table too
+            gtk_list_box_remove_all(GTK_LIST_BOX(state->list));
+            state->rows_shown = 0;
+        }
+        g_array_append_vals(state->hits, batch->data, batch->len);
+        add_hit_rows(state);
+        update_scan_status(state, run, scanned, finished);
+        if (finished) {
+            gtk_button_set_label(GTK_BUTTON(state->scan_button), "Scan");
+            gtk_button_set_label(GTK_BUTTON(state->find_button), "Find");
+            gtk_button_set_label(GTK_BUTTON(state->pointer_button), "Find Pointers");
+            gtk_widget_set_sensitive(state->scan_button, TRUE);
+            gtk_widget_set_sensitive(state->find_button, TRUE);
+            gtk_widget_set_sensitive(state->pointer_button, TRUE);
+            gtk_widget_set_sensitive(state->open_button, TRUE);
+        }
+    }
+    g_array_free(batch, TRUE);
+
+    if (finished) {
+        if (state->run == run) state->run = NULL;
+        scan_run_free(run);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static void schedule_flush(ScanRun *run) {
+    bool schedule = !run->flush_scheduled;
+    run->flush_scheduled = true;
+    g_mutex_unlock(&run->mutex);
+    if (schedule) g_idle_add(flush_scan_hits, run);
+}
+
+// Function to cut a batch down to the hits still allowed, stopping the run at the limit
+static guint limit_batch(ScanRun *run, guint count) {
+    if (run->listed + count > MAX_LISTED_HITS) {
+        count = MAX_LISTED_HITS - run->listed;
+        run->truncated = true;
+        g_atomic_int_set(&run->cancel, 1);
+    }
+    run->listed += count;
+    return count;
+}
+
+// Called on the scanning thread with each batch of strings
+static void on_strings_found(const StringHit *hits, guint count, gsize scanned, gpointer user_data) {
+    ScanRun *run = user_data;
+    count = limit_batch(run, count);
+
+    g_mutex_lock(&run->mutex);
+    for (guint i = 0; i < count; i++) {
+        ListedHit hit = { hits[i].offset, hits[i].length, hits[i].chars, run->encoding, 0 };
+        g_array_append_val(run->pending, hit);
+    }
+    run->scanned = scanned;
+    schedule_flush(run);
+}
+
+// Called on the searching thread with each batch of matches
+static void on_matches_found(const SearchHit *hits, guint count, gsize scanned, gpointer user_data) {
+    ScanRun *run = user_data;
+    const guint8 *data = file_data(run->file);
+
+    g_mutex_lock(&run->mutex);
+    for (guint i = 0; i < count; i++) {
+        ListedHit hit = { hits[i].offset, byte_search_pattern_length(run->search, hits[i].pattern), 0, TABLE_FILE, 0 };
+        if (run->mode == SCAN_SEARCH) {
+            hit.encoding = g_array_index(run->pattern_encodings, EncodingType, hits[i].pattern);
+        } else if (!relative_word_fits(run->relative, data[hit.offset])) {
+            // The differences only match modulo 256
+            continue;
+        }
+        if (limit_batch(run, 1) == 0) break;
+        g_array_append_val(run->pending, hit);
+    }
+    run->scanned = scanned;
+    schedule_flush(run);
+}
+
+static int compare_target_offset(const void *key, const void *element) {
+    gsize offset = *(const gsize *)key;
+    const ListedHit *target = element;
+    return (offset > target->offset) - (offset < target->offset);
+}
+
+// Called on the scanning thread with each batch of pointers
+static void on_pointers_found(const PointerHit *hits, guint count, gsize scanned, gpointer user_data) {
+    ScanRun *run = user_data;
+    count = limit_batch(run, count);
+    g_array_append_vals(run->pointers, hits, count);
+
+    g_mutex_lock(&run->mutex);
+    for (guint i = 0; i < count; i++) {
+        const ListedHit *target = bsearch(&hits[i].target, run->targets->data, run->targets->len,
+                                          sizeof(ListedHit), compare_target_offset);
+        ListedHit hit = { hits[i].offset, run->pointer_format.width, 0, target->encoding, hits[i].target };
+        g_array_append_val(run->pending, hit);
+    }
+    run->scanned = scanned;
+    schedule_flush(run);
+}
+
+static gpointer scan_thread(gpointer user_data) {
+    ScanRun *run = user_data;
+    gsize len = g_mapped_file_get_length(run->file);
+
+    if (run->mode == SCAN_STRINGS) {
+        run->ok = string_scanner_scan(file_data(run->file), len, run->encoding, run->min_chars,
+                                      on_strings_found, run, &run->cancel);
+    } else if (run->mode == SCAN_POINTERS) {
+        gsize *offsets = g_new(gsize, run->targets->len);
+        for (guint i = 0; i < run->targets->len; i++) {
+            offsets[i] = g_array_index(run->targets, ListedHit, i).offset;
+        }
+        pointer_scanner_scan(file_data(run->file), len, &run->pointer_format, offsets, run->targets->len,
+                             on_pointers_found, run, &run->cancel);
+        g_free(offsets);
+        run->tables = pointer_scanner_find_tables((PointerHit *)run->pointers->data, run->pointers->len,
+                                                  run->pointer_format.width, MIN_TABLE_POINTERS);
+        run->ok = true;
+    } else {
+        byte_search_run(run->search, file_data(run->file), len, on_matches_found, run, &run->cancel);
+        run->ok = true;
+    }
+
+    g_mutex_lock(&run->mutex);
+    run->finished = true;
+    schedule_flush(run);
+    return NULL;
+}
+
+// Function to start a run over the open file; its button becomes Stop until it is done
+static void start_run(ScanWindow *state, ScanRun *run, GtkWidget *button) {
+    gtk_list_box_remove_all(GTK_LIST_BOX(state->list));
+    g_array_set_size(state->hits, 0);
+    state->rows_shown = 0;
+    state->rows_wanted = ROWS_PER_PAGE;
+    state->hits_mode = run->mode;
+    memset(state->first_byte_counts, 0, sizeof(state->first_byte_counts));
+
+    run->state = state;
+    run->window = g_object_ref(state->window);
+    run->file = g_mapped_file_ref(state->file);
+    run->button = button;
+    run->started = g_get_monotonic_time();
+    run->pending = g_array_new(FALSE, FALSE, sizeof(ListedHit));
+    g_mutex_init(&run->mutex);
+    state->run = run;
+
+    gtk_widget_set_sensitive(state->scan_button, button == state->scan_button);
+    gtk_widget_set_sensitive(state->find_button, button == state->find_button);
+    gtk_widget_set_sensitive(state->pointer_button, button == state->pointer_button);
+    gtk_button_set_label(GTK_BUTTON(button), "Stop");
+    gtk_widget_set_sensitive(state->open_button, FALSE);
+    gtk_label_set_text(GTK_LABEL(state->status_label),
+                       run->mode == SCAN_SEARCH || run->mode == SCAN_RELATIVE ? "Searching…" : "Scanning…");
+
+    GThread *thread = g_thread_new(run->mode == SCAN_STRINGS ? "string-scan"
+                                   : run->mode == SCAN_POINTERS ? "pointer-scan" : "byte-search", scan_thread, run);
+    g_thread_unref(thread);
+}
+
+// Function to start scanning the open file for strings with the current settings
+static void start_scan(ScanWindow *state) {
+    if (state->file == NULL) return;
+
+    ScanRun *run = g_new0(ScanRun, 1);
+    run->mode = SCAN_STRINGS;
+    run->encoding = (EncodingType)(gtk_drop_down_get_selected(state->encoding_dropdown) + SCAN_FIRST);
+    run->min_chars = (guint)gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(state->min_length_spin));
+    start_run(state, run, state->scan_button);
+}
+
+// Function to add the search text encoded in one encoding, unless an earlier encoding gave the same bytes
+static void add_encoded_pattern(ScanRun *run, GHashTable *seen, const char *text, EncodingType encoding) {
+    size_t len = 0;
+    guint8 *bytes = text_encoder_encode(text, strlen(text), encoding, &len);
+    if (bytes == NULL || len == 0) {
+        g_free(bytes);
+        return;
+    }
+
+    GBytes *key = g_bytes_new_take(bytes, len);
+    if (g_hash_table_contains(seen, key)) {
+        g_bytes_unref(key);
+        return;
+    }
+    byte_search_add_pattern(run->search, bytes, len);
+    g_array_append_val(run->pattern_encodings, encoding);
+    g_hash_table_add(seen, key);
+}
+
+// Function to start a relative search of the open file for a known word
+static void start_relative_search(ScanWindow *state, const char *text) {
+    char *error = NULL;
+    RelativeWord *word = relative_word_new(text, &error);
+    if (word == NULL) {
+        gtk_label_set_text(GTK_LABEL(state->status_label), error);
+        g_free(error);
+        return;
+    }
+
+    relative_word_free(state->relative_word);
+    state->relative_word = word;
+
+    ScanRun *run = g_new0(ScanRun, 1);
+    run->mode = SCAN_RELATIVE;
+    run->search = relative_word_create_search(word);
+    run->relative = word;
+    start_run(state, run, state->find_button);
+}
+
+// Function to start searching the open file for the search text, in the chosen encoding or all of them
+static void start_search(ScanWindow *state) {
+    const char *text = gtk_editable_get_text(GTK_EDITABLE(state->search_entry));
+    if (state->file == NULL || *text == '\0') return;
+    if (gtk_check_button_get_active(GTK_CHECK_BUTTON(state->relative_check))) {
+        start_relative_search(state, text);
+        return;
+    }
+
+    ScanRun *run = g_new0(ScanRun, 1);
+    run->mode = SCAN_SEARCH;
+    run->search = byte_search_new();
+    run->pattern_encodings = g_array_new(FALSE, FALSE, sizeof(EncodingType));
+
+    // The chosen encoding comes first, so it names matches other encodings share
+    GHashTable *seen = g_hash_table_new_full(g_bytes_hash, g_bytes_equal, (GDestroyNotify)g_bytes_unref, NULL);
+    EncodingType chosen = (EncodingType)(gtk_drop_down_get_selected(state->encoding_dropdown) + SCAN_FIRST);
+    add_encoded_pattern(run, seen, text, chosen);
+    if (gtk_check_button_get_active(GTK_CHECK_BUTTON(state->all_encodings_check))) {
+        for (guint i = SCAN_FIRST; i <= SCAN_LAST; i++) {
+            if ((EncodingType)i != chosen) add_encoded_pattern(run, seen, text, (EncodingType)i);
+        }
+    }
+    g_hash_table_destroy(seen);
+
+    if (run->pattern_encodings->len == 0) {
+        gtk_label_set_text(GTK_LABEL(state->status_label), "The text can't be written in the chosen encoding");
+        byte_search_free(run->search);
+        g_array_free(run->pattern_encodings, TRUE);
+        g_free(run);
+        return;
+    }
+
+    if (debug_mode) {
+        fprintf(stderr, "DEBUG: Searching for %u encoded forms of \"%s\"\n", run->pattern_encodings->len, text);
+    }
+    start_run(state, run, state->find_button);
+}
+
+// Function to start scanning the open file for pointers to the listed strings or matches
+// Run again from its own results, it searches for the same targets with the new settings.
+static void start_pointer_scan(ScanWindow *state) {
+    if (state->file == NULL) return;
+
+    PointerFormat format = { 0 };
+    guint selected = gtk_drop_down_get_selected(state->pointer_format_dropdown);
+    format.width = pointer_formats[selected].width;
+    format.big_endian = pointer_formats[selected].big_endian;
+    format.aligned = gtk_check_button_get_active(GTK_CHECK_BUTTON(state->aligned_check));
+
+    const char *base_text = gtk_editable_get_text(GTK_EDITABLE(state->base_entry));
+    char *end = NULL;
+    guint64 base = g_ascii_strtoull(base_text, &end, 16);
+    if (end == base_text && *base_text != '\0') {
+        gtk_label_set_text(GTK_LABEL(state->status_label), "The base address must be a hex number");
+        return;
+    }
+    format.base = (guint32)base;
+
+    if (state->hits_mode != SCAN_POINTERS) {
+        // Targets are the listed hits, one per offset (they are in offset order)
+        if (state->pointer_targets == NULL) state->pointer_targets = g_array_new(FALSE, FALSE, sizeof(ListedHit));
+        g_array_set_size(state->pointer_targets, 0);
+        for (guint i = 0; i < state->hits->len; i++) {
+            const ListedHit *hit = &g_array_index(state->hits, ListedHit, i);
+            guint last = state->pointer_targets->len;
+            if (last > 0 && g_array_index(state->pointer_targets, ListedHit, last - 1).offset == hit->offset) continue;
+            g_array_append_val(state->pointer_targets, *hit);
+        }
+    }
+    if (state->pointer_targets == NULL || state->pointer_targets->len == 0) {
+        gtk_label_set_text(GTK_LABEL(state->status_label), "Scan or search for strings first, then find pointers to them");
+        return;
+    }
+
+    ScanRun *run = g_new0(ScanRun, 1);
+    run->mode = SCAN_POINTERS;
+    run->pointer_format = format;
+    run->targets = g_array_sized_new(FALSE, FALSE, sizeof(ListedHit), state->pointer_targets->len);
+    g_array_append_vals(run->targets, state->pointer_targets->data, state->pointer_targets->len);
+    run->pointers = g_array_new(FALSE, FALSE, sizeof(PointerHit));
+
+    if (state->pointer_tables != NULL) {
+        g_array_free(state->pointer_tables, TRUE);
+        state->pointer_tables = NULL;
+    }
+    start_run(state, run, state->pointer_button);
+}
+
+// Callback for the Find Pointers/Stop button
+static void on_pointer_clicked(GtkButton *button, gpointer user_data) {
+    ScanWindow *state = user_data;
+    if (state->run != NULL) {
+        g_atomic_int_set(&state->run->cancel, 1);
+        return;
+    }
+    start_pointer_scan(state);
+}
+
+// Callback for the Scan/Stop button
+static void on_scan_clicked(GtkButton *button, gpointer user_data) {
+    ScanWindow *state = user_data;
+    if (state->run != NULL) {
+        g_atomic_int_set(&state->run->cancel, 1);
+        return;
+    }
+    start_scan(state);
+}
+
+// Callback for the Find/Stop button and for Enter in the search entry
+static void on_find_clicked(GtkWidget *widget, gpointer user_data) {
+    ScanWindow *state = user_data;
+    if (state->run != NULL) {
+        if (state->run->mode == SCAN_SEARCH || state->run->mode == SCAN_RELATIVE) g_atomic_int_set(&state->run->cancel, 1);
+        return;
+    }
+    start_search(state);
+}
+
+// Callback for the file dialog: map the file and scan it
+static void on_scan_file_chosen(GObject *source, GAsyncResult *result, gpointer user_data) {
+    GtkWidget *window = GTK_WIDGET(user_data);
+    ScanWindow *state = g_object_get_data(G_OBJECT(window), "scan_window");
+    GError *error = NULL;
+    GFile *file = gtk_file_dialog_open_finish(GTK_FILE_DIALOG(source), result, &error);
+
+    if (file == NULL || state == NULL || state->closed || state->run != NULL) {
+        g_clear_error(&error);
+        if (file != NULL) g_object_unref(file);
+        g_object_unref(window);
+        return;
+    }
+
+    char *path = g_file_get_path(file);
+    GMappedFile *mapped = path != NULL ? g_mapped_file_new(path, FALSE, &error) : NULL;
+    if (mapped == NULL) {
+        char *message = g_strdup_printf("Could not open the file: %s", error != NULL ? error->message : "not a local file");
+        fprintf(stderr, "ERROR: %s\n", message);
+        gtk_label_set_text(GTK_LABEL(state->status_label), message);
+        g_free(message);
+        g_clear_error(&error);
+    } else {
+        if (state->file != NULL) g_mapped_file_unref(state->file);
+        state->file = mapped;
+        g_free(state->file_name);
+        state->file_name = g_file_get_basename(file);
+
+        char *label = g_strdup_printf("%s (%" G_GSIZE_FORMAT " bytes)", state->file_name, g_mapped_file_get_length(mapped));
+        gtk_label_set_text(GTK_LABEL(state->file_label), label);
+        g_free(label);
+
+        gtk_widget_set_sensitive(state->scan_button, TRUE);
+        gtk_widget_set_sensitive(state->find_button, TRUE);
+        gtk_widget_set_sensitive(state->pointer_button, TRUE);
+        if (state->pointer_targets != NULL) g_array_set_size(state->pointer_targets, 0);
+        if (*gtk_editable_get_text(GTK_EDITABLE(state->search_entry)) != '\0') {
+            start_search(state);
+        } else {
+            start_scan(state);
+        }
+    }
+
+    g_free(path);
+    g_object_unref(file);
+    g_object_unref(window);
+}
+
+// Callback for the Open button
+static void on_open_clicked(GtkButton *button, gpointer user_data) {
+    ScanWindow *state = user_data;
+    GtkFileDialog *dialog = gtk_file_dialog_new();
+    gtk_file_dialog_set_title(dialog, "Scan File");
+    gtk_file_dialog_open(dialog, GTK_WINDOW(state->window), NULL, on_scan_file_chosen, g_object_ref(state->window));
+    g_object_unref(dialog);
+}
+
+// Callback for scrolling to the end of the list: add the next page of rows
+static void on_list_edge_reached(GtkScrolledWindow *scroll, GtkPositionType position, gpointer user_data) {
+    ScanWindow *state = user_data;
+    if (position != GTK_POS_BOTTOM || state->rows_shown >= state->hits->len) return;
+    state->rows_wanted = state->rows_shown + ROWS_PER_PAGE;
+    add_hit_rows(state);
+}
+
+// Function to make the table a relative match implies the "Table" encoding
+static bool use_draft_table(ScanWindow *state, guint8 first_byte) {
+    char *text = relative_word_draft_table(state->relative_word, first_byte);
+    char *name = g_strdup_printf("draft %02X", first_byte);
+    char *error = NULL;
+    CharTable *table = char_table_new_from_string(text, name, &error);
+    g_free(name);
+
+    if (table == NULL) {
+        fprintf(stderr, "ERROR: Draft table not usable: %s\n", error != NULL ? error : "");
+        gtk_label_set_text(GTK_LABEL(state->status_label), "The draft table could not be used");
+        g_free(error);
+        g_free(text);
+        return false;
+    }
+
+    char_table_set_active(table);
+    char_table_unref(table);
+    g_free(state->draft_table);
+    state->draft_table = text;
+    gtk_widget_set_sensitive(state->save_table_button, TRUE);
+    return true;
+}
+
+// Callback for the save dialog: write the draft table
+static void on_draft_table_saved(GObject *source, GAsyncResult *result, gpointer user_data) {
+    GtkWidget *window = GTK_WIDGET(user_data);
+    ScanWindow *state = g_object_get_data(G_OBJECT(window), "scan_window");
+    GError *error = NULL;
+    GFile *file = gtk_file_dialog_save_finish(GTK_FILE_DIALOG(source), result, &error);
+
+    if (file == NULL || state == NULL || state->closed || state->draft_table == NULL) {
+        g_clear_error(&error);
+        if (file != NULL) g_object_unref(file);
+        g_object_unref(window);
+        return;
+    }
+
+    char *path = g_file_get_path(file);
+    if (path == NULL || !g_file_set_contents(path, state->draft_table, -1, &error)) {
+        char *message = g_strdup_printf("Could not save the table: %s", error != NULL ? error->message : "not a local file");
+        fprintf(stderr, "ERROR: %s\n", message);
+        gtk_label_set_text(GTK_LABEL(state->status_label), message);
+        g_free(message);
+        g_clear_error(&error);
+    } else {
+        char *basename = g_file_get_basename(file);
+        char *message = g_strdup_printf("Saved the draft table as %s", basename);
+        gtk_label_set_text(GTK_LABEL(state->status_label), message);
+        g_free(message);
+        g_free(basename);
+    }
+
+    g_free(path);
+    g_object_unref(file);
+    g_object_unref(window);
+}
+
+// Callback for the Save Draft Table button
+static void on_save_table_clicked(GtkButton *button, gpointer user_data) {
+    ScanWindow *state = user_data;
+    GtkFileDialog *dialog = gtk_file_dialog_new();
+    gtk_file_dialog_set_title(dialog, "Save Draft Table");
+    gtk_file_dialog_set_initial_name(dialog, "draft.tbl");
+    gtk_file_dialog_save(dialog, GTK_WINDOW(state->window), NULL, on_draft_table_saved, g_object_ref(state->window));
+    g_object_unref(dialog);
+}
+
+// Function to show a hit's bytes in the main window, as hex on top and decoded below
+static void show_hit(ScanWindow *state, guint index) {
+    WindowData *data = state->parent != NULL ? g_object_get_data(G_OBJECT(state->parent), "window_data") : NULL;
+    if (data == NULL) {
+        gtk_label_set_text(GTK_LABEL(state->status_label), "The main window is closed");
+        return;
+    }
+
+    const ListedHit *hit = &g_array_index(state->hits, ListedHit, index);
+    gsize offset = state->hits_mode == SCAN_POINTERS ? hit->target : hit->offset;
+    const guint8 *bytes = file_data(state->file) + offset;
+    size_t len = MIN(hit->length, SHOW_MAX_BYTES);
+    bool truncated = len < hit->length;
+    if (state->hits_mode != SCAN_STRINGS) {
+        // Matches and the strings pointers point to, with what follows
+        len = MIN(g_mapped_file_get_length(state->file) - offset,
+                  state->hits_mode == SCAN_POINTERS ? MATCH_CONTEXT_BYTES : MAX(hit->length, MATCH_CONTEXT_BYTES));
+        truncated = false;
+    }
+    if (state->hits_mode == SCAN_RELATIVE && !use_draft_table(state, bytes[0])) return;
+
+    static const char hex_digits[] = "0123456789ABCDEF";
+    char *hex = g_malloc(len * 3 + 1);
+    for (size_t i = 0; i < len; i++) {
+        hex[i * 3] = hex_digits[bytes[i] >> 4];
+        hex[i * 3 + 1] = hex_digits[bytes[i] & 0xF];
+        hex[i * 3 + 2] = ' ';
+    }
+    hex[len > 0 ? len * 3 - 1 : 0] = '\0';
+
+    // Set both formats first, then the text, so it is converted once
+    data->is_updating = true;
+    gtk_drop_down_set_selected(data->top_encoding_dropdown, HEX);
+    gtk_drop_down_set_selected(data->bottom_encoding_dropdown, hit->encoding);
+    data->is_updating = false;
+    data->bottom_encoding_chosen = true;
+    gtk_text_buffer_set_text(data->top_buffer, hex, -1);
+    g_free(hex);
+
+    char *status = g_strdup_printf("Showing %" G_GSIZE_FORMAT " bytes at 0x%" G_GSIZE_MODIFIER "X%s", len, offset,
+                                   truncated ? " (truncated)"
+                                   : state->hits_mode == SCAN_RELATIVE ? " with its draft table" : "");
+    gtk_label_set_text(GTK_LABEL(state->status_label), status);
+    g_free(status);
+}
+
+// Callback for activating a hit
+static void on_hit_activated(GtkListBox *list, GtkListBoxRow *row, gpointer user_data) {
+    ScanWindow *state = user_data;
+    guint index = GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(row), "hit_index"));
+    if (index < state->hits->len) show_hit(state, index);
+}
+
+// Callback for closing the scanner: stop a scan in progress
+static void on_scan_window_destroy(GtkWidget *window, gpointer user_data) {
+    ScanWindow *state = user_data;
+    state->closed = true;
+    if (state->run != NULL) g_atomic_int_set(&state->run->cancel, 1);
+    if (state->parent != NULL) g_object_set_data(G_OBJECT(state->parent), "scan_window", NULL);
+}
+
+// Function to show the file scanner for a main window (one per window)
+void show_scan_window(GtkWidget *parent_window) {
+    GtkWidget *existing = g_object_get_data(G_OBJECT(parent_window), "scan_window");
+    if (existing != NULL) {
+        gtk_window_present(GTK_WINDOW(existing));
+        return;
+    }
+
+    ScanWindow *state = g_new0(ScanWindow, 1);
+    state->hits = g_array_new(FALSE, FALSE, sizeof(ListedHit));
+    state->parent = parent_window;
+    g_object_add_weak_pointer(G_OBJECT(parent_window), (gpointer *)&state->parent);
+
+    state->window = gtk_window_new();
+    gtk_window_set_title(GTK_WINDOW(state->window), "Scan File");
+    gtk_window_set_transient_for(GTK_WINDOW(state->window), GTK_WINDOW(parent_window));
+    gtk_window_set_destroy_with_parent(GTK_WINDOW(state->window), TRUE);
+    gtk_window_set_default_size(GTK_WINDOW(state->window), 800, 500);
+
+    GtkWidget *content_area = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
+    gtk_widget_set_margin_start(content_area, 10);
+    gtk_widget_set_margin_end(content_area, 10);
+    gtk_widget_set_margin_top(content_area, 10);
+    gtk_widget_set_margin_bottom(content_area, 10);
+    gtk_window_set_child(GTK_WINDOW(state->window), content_area);
+
+    // File row
+    GtkWidget *file_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+    state->open_button = gtk_button_new_with_label("Open File…");
+    state->file_label = gtk_label_new("No file");
+    gtk_label_set_ellipsize(GTK_LABEL(state->file_label), PANGO_ELLIPSIZE_MIDDLE);
+    gtk_label_set_xalign(GTK_LABEL(state->file_label), 0);
+    gtk_widget_set_hexpand(state->file_label, TRUE);
+    gtk_box_append(GTK_BOX(file_box), state->open_button);
+    gtk_box_append(GTK_BOX(file_box), state->file_label);
+
+    // Settings row: encoding, minimum length and the scan button
+    GtkWidget *settings_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+    const char *encoding_strings[SCAN_LAST - SCAN_FIRST + 2];
+    for (guint i = SCAN_FIRST; i <= SCAN_LAST; i++) {
+        encoding_strings[i - SCAN_FIRST] = encoding_type_to_string((EncodingType)i);
+    }
+    encoding_strings[SCAN_LAST - SCAN_FIRST + 1] = NULL;
+    GtkStringList *encodings = gtk_string_list_new(encoding_strings);
+    state->encoding_dropdown = GTK_DROP_DOWN(gtk_drop_down_new(G_LIST_MODEL(encodings), NULL));
+
+    // Start with the encoding the main window decodes to
+    WindowData *data = g_object_get_data(G_OBJECT(parent_window), "window_data");
+    guint selected = data != NULL ? gtk_drop_down_get_selected(data->bottom_encoding_dropdown) : UTF8;
+    if (selected < SCAN_FIRST || selected > SCAN_LAST) selected = UTF8;
+    gtk_drop_down_set_selected(state->encoding_dropdown, selected - SCAN_FIRST);
+
+    state->min_length_spin = gtk_spin_button_new_with_range(1, 1000, 1);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(state->min_length_spin), 4);
+
+    state->scan_button = gtk_button_new_with_label("Scan");
+    gtk_widget_set_sensitive(state->scan_button, FALSE);
+
+    gtk_box_append(GTK_BOX(settings_box), gtk_label_new("Encoding:"));
+    gtk_box_append(GTK_BOX(settings_box), GTK_WIDGET(state->encoding_dropdown));
+    gtk_box_append(GTK_BOX(settings_box), gtk_label_new("Minimum characters:"));
+    gtk_box_append(GTK_BOX(settings_box), state->min_length_spin);
+    gtk_box_append(GTK_BOX(settings_box), state->scan_button);
+
+    // Search row: text to find, encoded in the chosen encoding or in every one
+    GtkWidget *search_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+    state->search_entry = gtk_entry_new();
+    gtk_entry_set_placeholder_text(GTK_ENTRY(state->search_entry), "Text to find");
+    gtk_widget_set_hexpand(state->search_entry, TRUE);
+    state->all_encodings_check = gtk_check_button_new_with_label("All encodings");
+    state->relative_check = gtk_check_button_new_with_label("Relative");
+    gtk_widget_set_tooltip_text(state->relative_check,
+                                "Find the word in an unknown character set by the differences between its letters");
+    state->find_button = gtk_button_new_with_label("Find");
+    gtk_widget_set_sensitive(state->find_button, FALSE);
+    state->save_table_button = gtk_button_new_with_label("Save Draft Table…");
+    gtk_widget_set_sensitive(state->save_table_button, FALSE);
+
+    gtk_box_append(GTK_BOX(search_box), state->search_entry);
+    gtk_box_append(GTK_BOX(search_box), state->all_encodings_check);
+    gtk_box_append(GTK_BOX(search_box), state->relative_check);
+    gtk_box_append(GTK_BOX(search_box), state->find_button);
+    gtk_box_append(GTK_BOX(search_box), state->save_table_button);
+
+    // Pointer row: format and base address of pointers to the listed hits
+    GtkWidget *pointer_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+    const char *format_strings[G_N_ELEMENTS(pointer_formats) + 1];
+    for (guint i = 0; i < G_N_ELEMENTS(pointer_formats); i++) {
+        format_strings[i] = pointer_formats[i].name;
+    }
+    format_strings[G_N_ELEMENTS(pointer_formats)] = NULL;
+    GtkStringList *formats = gtk_string_list_new(format_strings);
+    state->pointer_format_dropdown = GTK_DROP_DOWN(gtk_drop_down_new(G_LIST_MODEL(formats), NULL));
+    state->base_entry = gtk_entry_new();
+    gtk_entry_set_placeholder_text(GTK_ENTRY(state->base_entry), "0");
+    gtk_widget_set_tooltip_text(state->base_entry, "Pointer value of file offset 0, in hex");
+    state->aligned_check = gtk_check_button_new_with_label("Aligned");
+    state->pointer_button = gtk_button_new_with_label("Find Pointers");
+    gtk_widget_set_sensitive(state->pointer_button, FALSE);
+
+    gtk_box_append(GTK_BOX(pointer_box), gtk_label_new("Pointers:"));
+    gtk_box_append(GTK_BOX(pointer_box), GTK_WIDGET(state->pointer_format_dropdown));
+    gtk_box_append(GTK_BOX(pointer_box), gtk_label_new("Base:"));
+    gtk_box_append(GTK_BOX(pointer_box), state->base_entry);
+    gtk_box_append(GTK_BOX(pointer_box), state->aligned_check);
+    gtk_box_append(GTK_BOX(pointer_box), state->pointer_button);
+
+    state->status_label = gtk_label_new("Open a file to scan");
+    gtk_widget_add_css_class(state->status_label, "dim-label");
+    gtk_widget_set_halign(state->status_label, GTK_ALIGN_START);
+
+    // Hits, a page of rows at a time
+    state->list = gtk_list_box_new();
+    gtk_list_box_set_selection_mode(GTK_LIST_BOX(state->list), GTK_SELECTION_SINGLE);
+    GtkWidget *scroll = gtk_scrolled_window_new();
+    gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scroll), state->list);
+    gtk_widget_set_vexpand(scroll, TRUE);
+
+    gtk_box_append(GTK_BOX(content_area), file_box);
+    gtk_box_append(GTK_BOX(content_area), settings_box);
+    gtk_box_append(GTK_BOX(content_area), search_box);
+    gtk_box_append(GTK_BOX(content_area), pointer_box);
+    gtk_box_append(GTK_BOX(content_area), state->status_label);
+    gtk_box_append(GTK_BOX(content_area), scroll);
+
+    g_signal_connect(state->open_button, "clicked", G_CALLBACK(on_open_clicked), state);
+    g_signal_connect(state->scan_button, "clicked", G_CALLBACK(on_scan_clicked), state);
+    g_signal_connect(state->find_button, "clicked", G_CALLBACK(on_find_clicked), state);
+    g_signal_connect(state->search_entry, "activate", G_CALLBACK(on_find_clicked), state);
+    g_signal_connect(state->save_table_button, "clicked", G_CALLBACK(on_save_table_clicked), state);
+    g_signal_connect(state->pointer_button, "clicked", G_CALLBACK(on_pointer_clicked), state);
+    g_signal_connect(scroll, "edge-reached", G_CALLBACK(on_list_edge_reached), state);
+    g_signal_connect(state->list, "row-activated", G_CALLBACK(on_hit_activated), state);
+    g_signal_connect(state->window, "destroy", G_CALLBACK(on_scan_window_destroy), state);
+
+    g_object_set_data_full(G_OBJECT(state->window), "scan_window", state, scan_window_free);
+    g_object_set_data(G_OBJECT(parent_window), "scan_window", state->window);
+    gtk_window_present(GTK_WINDOW(state->window));
+}
@@ -0,0 +1,12 @@
+#ifndef SCAN_WINDOW_H
+#define SCAN_WINDOW_H
+
+#include <gtk/gtk.h>
+
+// Function to show the file scanner for a main window (one per window)
+// A file is memory-mapped and scanned on worker threads for strings in the chosen encoding, or
+// for search text encoded in it (or in every encoding), and then for pointers to what was found;
+// hits are listed as they come in, and activating one shows its bytes in parent_window.
+void show_scan_window(GtkWidget *parent_window);
+
+#endif /* SCAN_WINDOW_H */
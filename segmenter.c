@@ -0,0 +1,151 @@
+#include "segmenter.h"
+#include <string.h>
+
+// Token cost of one character in quarter tokens: roughly four ASCII characters share a token,
+// while CJK and other non-ASCII characters usually cost about one token each
+static inline size_t char_cost_quarters(unsigned char lead) {
+    return lead < 0x80 ? 1 : 4;
+}
+
+// Length of the UTF-8 sequence starting with lead (invalid bytes count as one)
+static inline size_t utf8_char_length(unsigned char lead) {
+    if (lead < 0xC0) return 1;
+    if (lead < 0xE0) return 2;
+    if (lead < 0xF0) return 3;
+    if (lead < 0xF8) return 4;
+    return 1;
+}
+
+// Function to estimate the number of tokens in a UTF-8 string
+size_t segmenter_estimate_tokens(const char *text, gssize len) {
+    if (text == NULL) return 0;
+
+    size_t n = len < 0 ? strlen(text) : (size_t)len;
+    size_t quarters = 0;
+    size_t pos = 0;
+
+    while (pos < n) {
+        unsigned char lead = (unsigned char)text[pos];
+        quarters += char_cost_quarters(lead);
+        pos += utf8_char_length(lead);
+    }
+
+    return (quarters + 3) / 4;
+}
+
+// Function to split text into segments of at most budget_tokens each
+GArray* segment_text(const char *text, size_t budget_tokens) {
+    GArray *segments = g_array_new(FALSE, FALSE, sizeof(TextSegment));
+    if (text == NULL) return segments;
+
+    size_t len = strlen(text);
+    size_t budget_quarters = MAX(budget_tokens, 1) * 4;
+    size_t start = 0;
+
+    while (start < len) {
+        size_t pos = start;
+        size_t quarters = 0;
+        int code_depth = 0;
+
+        // Best cut candidates seen so far (exclusive end offsets), 0 when none
+        size_t last_line = 0;
+        size_t last_code = 0;
+        size_t last_space = 0;
+
+        while (pos < len) {
+            unsigned char c = (unsigned char)text[pos];
+            size_t char_len = MIN(utf8_char_length(c), len - pos);
+            size_t cost = char_cost_quarters(c);
+
+            if (quarters + cost > budget_quarters && pos > start) break;
+
+            quarters += cost;
+            pos += char_len;
+
+            switch (c) {
+                case '\n':
+                    last_line = pos;
+                    code_depth = 0;
+                    break;
+                case '<': case '[': case '{':
+                    code_depth++;
+                    break;
+                case '>': case ']': case '}':
+                    if (code_depth > 0) code_depth--;
+                    if (code_depth == 0) last_code = pos;
+                    break;
+                case ' ': case '\t':
+                    if (code_depth == 0) last_space = pos;
+                    break;
+            }
+        }
+
+        size_t end = pos;
+        if (pos < len) {
+            if (last_line > start) end = last_line;
+            else if (last_code > start) end = last_code;
+            else if (last_space > start) end = last_space;
+        }
+
+        TextSegment segment = { start, end - start };
+        g_array_append_val(segments, segment);
+        start = end;
+    }
+
+    return segments;
+}
+
+// Split one segment until every piece fits the budget according to count
+static void refine_segment(const char *text, TextSegment segment, size_t budget_tokens,
+                           SegmentCountFunc count, gpointer user_data, GArray *out) {
+    size_t tokens = count(text + segment.offset, segment.length, user_data);
+    if (tokens <= budget_tokens || segment.length <= 1) {
+        g_array_append_val(out, segment);
+        return;
+    }
+
+    // Scale the estimate-based budget by how far the estimate was off for this slice
+    size_t estimated = segmenter_estimate_tokens(text + segment.offset, segment.length);
+    size_t scaled = MAX(budget_tokens * estimated / tokens, 1);
+    char *slice = g_strndup(text + segment.offset, segment.length);
+
+    GArray *parts = segment_text(slice, scaled);
+    while (parts->len <= 1 && scaled > 1) {
+        g_array_free(parts, TRUE);
+        scaled /= 2;
+        parts = segment_text(slice, scaled);
+    }
+    g_free(slice);
+
+    for (guint i = 0; i < parts->len; i++) {
+        TextSegment part = g_array_index(parts, TextSegment, i);
+        part.offset += segment.offset;
+        if (parts->len == 1) {
+            g_array_append_val(out, part);
+        } else {
+            refine_segment(text, part, budget_tokens, count, user_data, out);
+        }
+    }
+    g_array_free(parts, TRUE);
+}
+
+// Function to split text into segments, checking each against an exact token counter
+GArray* segment_text_counted(const char *text, size_t budget_tokens, SegmentCountFunc count, gpointer user_data) {
+    if (text == NULL || count == NULL) return segment_text(text, budget_tokens);
+
+    // Calibrate the estimate on the whole text so cuts land close to the real budget
+    size_t len = strlen(text);
+    size_t estimated = segmenter_estimate_tokens(text, len);
+    size_t exact = count(text, len, user_data);
+    size_t scaled = exact > 0 ? MAX(budget_tokens * estimated / exact, 1) : budget_tokens;
+
+    GArray *segments = segment_text(text, scaled);
+    GArray *result = g_array_sized_new(FALSE, FALSE, sizeof(TextSegment), segments->len);
+
+    for (guint i = 0; i < segments->len; i++) {
+        refine_segment(text, g_array_index(segments, TextSegment, i), budget_tokens, count, user_data, result);
+    }
+    g_array_free(segments, TRUE);
+
+    return result;
+}
@@ -0,0 +1,30 @@
+#ifndef SEGMENTER_H
+#define SEGMENTER_H
+
+#include <glib.h>
+#include <stddef.h>
+
+// A slice of the source text
+typedef struct {
+    size_t offset; // Byte offset into the source text
+    size_t length; // Length in bytes
+} TextSegment;
+
+// Function to estimate the number of tokens in a UTF-8 string (len < 0 means NUL-terminated)
+size_t segmenter_estimate_tokens(const char *text, gssize len);
+
+// Function to split text into segments of at most budget_tokens each
+// Cuts are made after line breaks where possible, then after control codes (<...>, [...], {...}),
+// then at whitespace outside control codes, and only as a last resort between characters.
+// Returns a GArray of TextSegment covering the whole text in order.
+GArray* segment_text(const char *text, size_t budget_tokens);
+
+// Exact token counter for a slice of text
+typedef size_t (*SegmentCountFunc)(const char *text, size_t len, gpointer user_data);
+
+// Function to split text into segments, checking each against an exact token counter
+// Cut points are chosen as in segment_text(), with the character-based estimate calibrated
+// against count; any segment still over budget is split further.
+GArray* segment_text_counted(const char *text, size_t budget_tokens, SegmentCountFunc count, gpointer user_data);
+
+#endif /* SEGMENTER_H */
@@ -0,0 +1,362 @@
+#include "string_scanner.h"
+#include "char_table.h"
+#include "text_decoder.h"
+#include <string.h>
+
+// Bytes per chunk; chunks are scanned in parallel and their hits passed on in order
+#define SCAN_CHUNK_BYTES (4 * 1024 * 1024)
+
+// Sixty-four bit masks for classifying eight bytes at a time
+#define HIGH_BITS 0x8080808080808080ULL
+#define LOW_BITS 0x7F7F7F7F7F7F7F7FULL
+#define ONE_BYTES 0x0101010101010101ULL
+
+enum {
+    CHAR_NONE,   // Not text: ends a run
+    CHAR_TEXT,   // Printable: starts or continues a run
+    CHAR_SPACE   // Tab or line break: continues a run
+};
+
+typedef struct {
+    EncodingType encoding;
+    guint min_chars;
+    CharTable *table;
+    guint8 byte_class[256];  // Class of single bytes (ASCII in every encoding)
+    bool swar;               // Printable ASCII bytes are always whole characters
+    bool high_may_start;     // Bytes from 0x80 up may start a character
+} ScanSpec;
+
+typedef struct ScanJob ScanJob;
+
+typedef struct {
+    ScanJob *job;
+    size_t start;     // First position the chunk owns
+    size_t limit;     // First position the next chunk owns
+    GArray *hits;     // StringHit
+    size_t scan_end;  // Where scanning stopped: at or past limit, after the last run
+    bool done;
+} ScanChunk;
+
+struct ScanJob {
+    const ScanSpec *spec;
+    const guint8 *data;
+    size_t len;
+    gint *cancel;
+    GMutex mutex;
+    GCond chunk_done;
+};
+
+static GThreadPool *scan_pool = NULL;
+
+static bool is_cancelled(gint *cancel) {
+    return cancel != NULL && g_atomic_int_get(cancel) != 0;
+}
+
+static void init_spec(ScanSpec *spec, EncodingType encoding, guint min_chars, CharTable *table) {
+    memset(spec, 0, sizeof(*spec));
+    spec->encoding = encoding;
+    spec->min_chars = MAX(min_chars, 1);
+    spec->table = table;
+
+    for (guint b = 0x20; b <= 0x7E; b++) spec->byte_class[b] = CHAR_TEXT;
+    spec->byte_class['\t'] = CHAR_SPACE;
+    spec->byte_class['\n'] = CHAR_SPACE;
+    spec->byte_class['\r'] = CHAR_SPACE;
+
+    switch (encoding) {
+        case ISO8859_1:
+        case ISO8859_15:
+            for (guint b = 0xA0; b <= 0xFF; b++) spec->byte_class[b] = CHAR_TEXT;
+            break;
+        case KOI8_R:
+            // Letters only; the box drawing half of the high range is mostly noise in binaries
+            for (guint b = 0xC0; b <= 0xFF; b++) spec->byte_class[b] = CHAR_TEXT;
+            spec->byte_class[0xA3] = CHAR_TEXT;
+            spec->byte_class[0xB3] = CHAR_TEXT;
+            break;
+        default:
+            break;
+    }
+
+    spec->swar = encoding == ASCII || encoding == ISO8859_1 || encoding == ISO8859_15 ||
+                 encoding == KOI8_R || encoding == UTF8 || encoding == SHIFT_JIS || encoding == EUC_JP;
+    spec->high_may_start = encoding != ASCII;
+}
+
+// Class of a decoded character
+static int unichar_class(const ScanSpec *spec, gunichar ch) {
+    if (ch < 0x80) return spec->byte_class[ch];
+    if (ch >= 0xE000 && ch <= 0xF8FF) return CHAR_NONE;  // Private use
+    if ((ch >= 0xFDD0 && ch <= 0xFDEF) || (ch & 0xFFFE) == 0xFFFE) return CHAR_NONE;  // Noncharacters
+    return g_unichar_isprint(ch) ? CHAR_TEXT : CHAR_NONE;
+}
+
+static guint32 read_unit(const guint8 *p, size_t size, bool big_endian) {
+    if (size == 2) return big_endian ? (p[0] << 8) | p[1] : p[0] | (p[1] << 8);
+    return big_endian ? ((guint32)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]
+                      : p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32)p[3] << 24);
+}
+
+// Function to classify the character at p; char_len gets the bytes it takes (one byte when
+// nothing valid starts there, so a UTF-16 or UTF-32 string at any offset can still be found)
+static int classify_char(const ScanSpec *spec, const guint8 *p, size_t avail, size_t *char_len) {
+    guint8 b = p[0];
+    *char_len = 1;
+
+    switch (spec->encoding) {
+        case UTF8: {
+            if (b < 0x80) return spec->byte_class[b];
+            gunichar ch = g_utf8_get_char_validated((const char *)p, MIN(avail, 4));
+            if (ch == (gunichar)-1 || ch == (gunichar)-2) return CHAR_NONE;
+            *char_len = g_utf8_skip[b];
+            return unichar_class(spec, ch);
+        }
+
+        case UTF16LE:
+        case UTF16BE: {
+            bool big_endian = spec->encoding == UTF16BE;
+            if (avail < 2) return CHAR_NONE;
+            guint32 unit = read_unit(p, 2, big_endian);
+            if (unit >= 0xD800 && unit <= 0xDBFF) {
+                guint32 low = avail >= 4 ? read_unit(p + 2, 2, big_endian) : 0;
+                if (low < 0xDC00 || low > 0xDFFF) return CHAR_NONE;
+                *char_len = 4;
+                return unichar_class(spec, 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00));
+            }
+            if (unit >= 0xDC00 && unit <= 0xDFFF) return CHAR_NONE;
+            *char_len = 2;
+            return unichar_class(spec, unit);
+        }
+
+        case UTF32LE:
+        case UTF32BE: {
+            if (avail < 4) return CHAR_NONE;
+            guint32 ch = read_unit(p, 4, spec->encoding == UTF32BE);
+            if (ch > 0x10FFFF || (ch >= 0xD800 && ch <= 0xDFFF)) return CHAR_NONE;
+            *char_len = 4;
+            return unichar_class(spec, ch);
+        }
+
+        case SHIFT_JIS: {
+            if (b < 0x80) return spec->byte_class[b];
+            if (b >= 0xA1 && b <= 0xDF) return CHAR_TEXT;  // Half-width katakana
+            bool lead = (b >= 0x81 && b <= 0x9F) || (b >= 0xE0 && b <= 0xFC);
+            if (!lead || avail < 2) return CHAR_NONE;
+            guint8 trail = p[1];
+            if (trail < 0x40 || trail == 0x7F || trail > 0xFC) return CHAR_NONE;
+            *char_len = 2;
+            // Rows with no characters in JIS X 0208 or the CP932 extensions
+            if (b == 0x85 || b == 0x86 || (b >= 0xEB && b <= 0xEC) || (b >= 0xEF && b <= 0xF9)) return CHAR_NONE;
+            return CHAR_TEXT;
+        }
+
+        case EUC_JP: {
+            if (b < 0x80) return spec->byte_class[b];
+            if (b == 0x8E) {
+                // Half-width katakana
+                if (avail < 2 || p[1] < 0xA1 || p[1] > 0xDF) return CHAR_NONE;
+                *char_len = 2;
+                return CHAR_TEXT;
+            }
+            if (b == 0x8F) {
+                // JIS X 0212
+                if (avail < 3 || p[1] < 0xA1 || p[1] > 0xFE || p[2] < 0xA1 || p[2] > 0xFE) return CHAR_NONE;
+                *char_len = 3;
+                return CHAR_TEXT;
+            }
+            if (b < 0xA1 || b > 0xFE || avail < 2 || p[1] < 0xA1 || p[1] > 0xFE) return CHAR_NONE;
+            *char_len = 2;
+            // JIS X 0208 rows 1-8, 13 (NEC specials) and 16-84
+            if ((b >= 0xA9 && b <= 0xAC) || (b >= 0xAE && b <= 0xAF) || b > 0xF4) return CHAR_NONE;
+            return CHAR_TEXT;
+        }
+
+        case TABLE_FILE: {
+            size_t token = char_table_match(spec->table, p, avail);
+            if (token == 0) return CHAR_NONE;
+            *char_len = token;
+            return CHAR_TEXT;
+        }
+
+        default:
+            // Single-byte encodings
+            return spec->byte_class[b];
+    }
+}
+
+// Function to scan from pos (a character boundary) until the first position at or past limit
+// that is not inside a run; scan_end gets that position
+static void scan_range(const ScanSpec *spec, const guint8 *data, size_t len, size_t pos, size_t limit,
+                       GArray *hits, size_t *scan_end, gint *cancel) {
+    bool in_run = false;
+    size_t run_start = 0;
+    size_t run_end = 0;       // After the last printable character
+    gsize run_chars = 0;
+    gsize chars_at_end = 0;
+    size_t next_check = pos;
+
+    while (pos < len && (pos < limit || in_run)) {
+        if (pos >= next_check) {
+            if (is_cancelled(cancel)) break;
+            next_check = pos + 1024 * 1024;
+        }
+
+        // Eight bytes at a time: skip stretches with nothing that can start a character, and
+        // take stretches of printable ASCII whole
+        if (spec->swar && pos + 8 <= len) {
+            guint64 word;
+            memcpy(&word, data + pos, sizeof(word));
+            guint64 high = word & HIGH_BITS;
+            guint64 low = word & LOW_BITS;
+            guint64 at_least_space = (low + 0x6060606060606060ULL) & HIGH_BITS;
+            guint64 below_delete = ~(low + ONE_BYTES) & HIGH_BITS;
+            guint64 printable = at_least_space & below_delete & ~high;
+
+            if (in_run && printable == HIGH_BITS) {
+                pos += 8;
+                run_chars += 8;
+                run_end = pos;
+                chars_at_end = run_chars;
+                continue;
+            }
+            if (!in_run && (printable | (spec->high_may_start ? high : 0)) == 0) {
+                pos += 8;
+                continue;
+            }
+        }
+
+        size_t char_len;
+        int char_class = classify_char(spec, data + pos, len - pos, &char_len);
+        if (char_class == CHAR_TEXT) {
+            if (!in_run) {
+                in_run = true;
+                run_start = pos;
+                run_chars = 0;
+            }
+            pos += char_len;
+            run_chars++;
+            run_end = pos;
+            chars_at_end = run_chars;
+        } else if (char_class == CHAR_SPACE && in_run) {
+            pos += char_len;
+            run_chars++;
+        } else {
+            if (in_run && chars_at_end >= spec->min_chars) {
+                StringHit hit = { run_start, run_end - run_start, chars_at_end };
+                g_array_append_val(hits, hit);
+            }
+            in_run = false;
+            pos += char_len;
+        }
+    }
+
+    if (in_run && chars_at_end >= spec->min_chars) {
+        StringHit hit = { run_start, run_end - run_start, chars_at_end };
+        g_array_append_val(hits, hit);
+    }
+    *scan_end = pos;
+}
+
+// Thread pool worker: scan one chunk
+static void run_scan_chunk(gpointer data, gpointer user_data) {
+    ScanChunk *chunk = data;
+    ScanJob *job = chunk->job;
+
+    if (!is_cancelled(job->cancel)) {
+        scan_range(job->spec, job->data, job->len, chunk->start, chunk->limit, chunk->hits,
+                   &chunk->scan_end, job->cancel);
+    }
+
+    g_mutex_lock(&job->mutex);
+    chunk->done = true;
+    g_cond_broadcast(&job->chunk_done);
+    g_mutex_unlock(&job->mutex);
+}
+
+// Function to scan chunks on the pool, passing their hits on in order as they finish
+// Each chunk starts at a resynchronisation point and runs on past its end to finish a run it
+// started; hits a chunk reports from inside the previous chunk's last run are dropped.
+static void scan_parallel(const ScanSpec *spec, const guint8 *data, size_t len,
+                          StringScanFunc func, gpointer user_data, gint *cancel) {
+    static gsize initialized = 0;
+    if (g_once_init_enter(&initialized)) {
+        scan_pool = g_thread_pool_new(run_scan_chunk, NULL, (gint)g_get_num_processors(), FALSE, NULL);
+        g_once_init_leave(&initialized, 1);
+    }
+
+    ScanJob job = { 0 };
+    job.spec = spec;
+    job.data = data;
+    job.len = len;
+    job.cancel = cancel;
+    g_mutex_init(&job.mutex);
+    g_cond_init(&job.chunk_done);
+
+    guint count = (guint)((len + SCAN_CHUNK_BYTES - 1) / SCAN_CHUNK_BYTES);
+    ScanChunk *chunks = g_new0(ScanChunk, count);
+    for (guint i = 0; i < count; i++) {
+        chunks[i].job = &job;
+        chunks[i].start = i == 0 ? 0 : text_decoder_resync_point(data, (size_t)i * SCAN_CHUNK_BYTES, len, spec->encoding);
+        chunks[i].hits = g_array_new(FALSE, FALSE, sizeof(StringHit));
+    }
+    for (guint i = 0; i < count; i++) {
+        chunks[i].limit = i + 1 < count ? MAX(chunks[i + 1].start, chunks[i].start) : len;
+        g_thread_pool_push(scan_pool, &chunks[i], NULL);
+    }
+
+    size_t cutoff = 0;
+    for (guint i = 0; i < count; i++) {
+        g_mutex_lock(&job.mutex);
+        while (!chunks[i].done) {
+            g_cond_wait(&job.chunk_done, &job.mutex);
+        }
+        g_mutex_unlock(&job.mutex);
+
+        if (!is_cancelled(cancel)) {
+            StringHit *hits = (StringHit *)chunks[i].hits->data;
+            guint first = 0;
+            while (first < chunks[i].hits->len && hits[first].offset < cutoff) first++;
+            func(hits + first, chunks[i].hits->len - first, chunks[i].limit, user_data);
+            cutoff = MAX(cutoff, chunks[i].scan_end);
+        }
+        g_array_free(chunks[i].hits, TRUE);
+    }
+
+    g_free(chunks);
+    g_mutex_clear(&job.mutex);
+    g_cond_clear(&job.chunk_done);
+}
+
+// Function to find every run of at least min_chars characters in data, split over all cores
+bool string_scanner_scan(const guint8 *data, size_t len, EncodingType encoding, guint min_chars,
+                         StringScanFunc func, gpointer user_data, gint *cancel) {
+    if (encoding_is_byte_format(encoding)) return false;
+
+    CharTable *table = NULL;
+    if (encoding == TABLE_FILE) {
+        table = char_table_get_active();
+        if (table == NULL) return false;
+    }
+
+    ScanSpec spec;
+    init_spec(&spec, encoding, min_chars, table);
+
+    if (len > SCAN_CHUNK_BYTES && encoding != TABLE_FILE && g_get_num_processors() > 1) {
+        scan_parallel(&spec, data, len, func, user_data, cancel);
+    } else {
+        // One chunk after the other on this thread, each carrying on where the last stopped
+        // (table tokens have no resynchronisation points)
+        GArray *hits = g_array_new(FALSE, FALSE, sizeof(StringHit));
+        size_t pos = 0;
+        for (size_t limit = MIN(SCAN_CHUNK_BYTES, len); pos < len && !is_cancelled(cancel);
+             limit = MIN(limit + SCAN_CHUNK_BYTES, len)) {
+            scan_range(&spec, data, len, pos, limit, hits, &pos, cancel);
+            if (!is_cancelled(cancel)) func((StringHit *)hits->data, hits->len, pos, user_data);
+            g_array_set_size(hits, 0);
+        }
+        g_array_free(hits, TRUE);
+    }
+
+    if (table != NULL) char_table_unref(table);
+    return true;
+}
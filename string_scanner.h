@@ -0,0 +1,29 @@
+#ifndef STRING_SCANNER_H
+#define STRING_SCANNER_H
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// "strings" for any encoding: finds runs of text characters in binary data
+// Printable characters of the encoding make up a run; tabs and line breaks may continue one but
+// don't start it, and are trimmed from its end. UTF-16 and UTF-32 runs are aligned to their unit
+// size from the start of the data. TABLE_FILE counts every token the active table maps.
+typedef struct {
+    gsize offset;   // Byte offset of the run
+    gsize length;   // Length in bytes
+    gsize chars;    // Length in characters
+} StringHit;
+
+// Called from the scanning thread with each batch of hits in offset order (count may be 0, to
+// report progress); scanned is how many bytes are done
+typedef void (*StringScanFunc)(const StringHit *hits, guint count, gsize scanned, gpointer user_data);
+
+// Function to find every run of at least min_chars characters in data, split over all cores
+// Blocks until the scan is done or *cancel (may be NULL) becomes non-zero. Returns false for HEX
+// and the other byte formats, or for TABLE_FILE when no table is loaded.
+bool string_scanner_scan(const guint8 *data, size_t len, EncodingType encoding, guint min_chars,
+                         StringScanFunc func, gpointer user_data, gint *cancel);
+
+#endif /* STRING_SCANNER_H */
@@ -0,0 +1,424 @@
+#include "text_decoder.h"
+#include "char_table.h"
+#include <errno.h>
+#include <string.h>
+
+// KOI8-R bytes 0x80-0xFF as Unicode
+static const guint16 koi8r_high[128] = {
+    0x2500, 0x2502, 0x250C, 0x2510, 0x2514, 0x2518, 0x251C, 0x2524, 0x252C, 0x2534, 0x253C, 0x2580, 0x2584, 0x2588, 0x258C, 0x2590,
+    0x2591, 0x2592, 0x2593, 0x2320, 0x25A0, 0x2219, 0x221A, 0x2248, 0x2264, 0x2265, 0x00A0, 0x2321, 0x00B0, 0x00B2, 0x00B7, 0x00F7,
+    0x2550, 0x2551, 0x2552, 0x0451, 0x2553, 0x2554, 0x2555, 0x2556, 0x2557, 0x2558, 0x2559, 0x255A, 0x255B, 0x255C, 0x255D, 0x255E,
+    0x255F, 0x2560, 0x2561, 0x0401, 0x2562, 0x2563, 0x2564, 0x2565, 0x2566, 0x2567, 0x2568, 0x2569, 0x256A, 0x256B, 0x256C, 0x00A9,
+    0x044E, 0x0430, 0x0431, 0x0446, 0x0434, 0x0435, 0x0444, 0x0433, 0x0445, 0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E,
+    0x043F, 0x044F, 0x0440, 0x0441, 0x0442, 0x0443, 0x0436, 0x0432, 0x044C, 0x044B, 0x0437, 0x0448, 0x044D, 0x0449, 0x0447, 0x044A,
+    0x042E, 0x0410, 0x0411, 0x0426, 0x0414, 0x0415, 0x0424, 0x0413, 0x0425, 0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E,
+    0x041F, 0x042F, 0x0420, 0x0421, 0x0422, 0x0423, 0x0416, 0x0412, 0x042C, 0x042B, 0x0417, 0x0428, 0x042D, 0x0429, 0x0427, 0x042A,
+};
+
+// ISO-8859-15 differs from ISO-8859-1 in eight positions
+static gunichar latin9_char(guint8 byte) {
+    switch (byte) {
+        case 0xA4: return 0x20AC;
+        case 0xA6: return 0x0160;
+        case 0xA8: return 0x0161;
+        case 0xB4: return 0x017D;
+        case 0xB8: return 0x017E;
+        case 0xBC: return 0x0152;
+        case 0xBD: return 0x0153;
+        case 0xBE: return 0x0178;
+        default: return byte;
+    }
+}
+
+static void append_invalid(GString *result, size_t *invalid) {
+    g_string_append(result, TEXT_DECODER_REPLACEMENT);
+    (*invalid)++;
+}
+
+// UTF-16 in either byte order
+static void decode_utf16(GString *result, const guint8 *data, size_t len, bool big_endian, size_t *invalid) {
+    for (size_t i = 0; i < len; i += 2) {
+        if (i + 1 >= len) {
+            // Odd trailing byte
+            append_invalid(result, invalid);
+            break;
+        }
+
+        guint16 code_unit = big_endian ? (data[i] << 8) | data[i + 1] : data[i] | (data[i + 1] << 8);
+
+        if (code_unit >= 0xD800 && code_unit <= 0xDBFF) {
+            // High surrogate: needs a low surrogate next
+            if (i + 3 >= len) {
+                append_invalid(result, invalid);
+                break;
+            }
+
+            guint16 low_surrogate = big_endian ? (data[i + 2] << 8) | data[i + 3] : data[i + 2] | (data[i + 3] << 8);
+            if (low_surrogate >= 0xDC00 && low_surrogate <= 0xDFFF) {
+                gunichar ch = 0x10000 + ((code_unit - 0xD800) << 10) + (low_surrogate - 0xDC00);
+                g_string_append_unichar(result, ch);
+                i += 2;
+            } else {
+                append_invalid(result, invalid);
+            }
+        } else if (code_unit >= 0xDC00 && code_unit <= 0xDFFF) {
+            // Unexpected low surrogate
+            append_invalid(result, invalid);
+        } else {
+            g_string_append_unichar(result, code_unit);
+        }
+    }
+}
+
+// UTF-32 in either byte order
+static void decode_utf32(GString *result, const guint8 *data, size_t len, bool big_endian, size_t *invalid) {
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        guint32 ch = big_endian
+            ? ((guint32)data[i] << 24) | (data[i + 1] << 16) | (data[i + 2] << 8) | data[i + 3]
+            : data[i] | (data[i + 1] << 8) | (data[i + 2] << 16) | ((guint32)data[i + 3] << 24);
+
+        if (ch > 0x10FFFF || (ch >= 0xD800 && ch <= 0xDFFF)) {
+            append_invalid(result, invalid);
+        } else {
+            g_string_append_unichar(result, ch);
+        }
+    }
+
+    if (i < len) append_invalid(result, invalid);
+}
+
+// Multi-byte legacy encodings through iconv; an invalid byte is replaced and skipped
+static bool decode_with_iconv(GString *result, const guint8 *data, size_t len,
+                              const char * const *charsets, size_t *invalid) {
+    GIConv converter = (GIConv)-1;
+    for (guint i = 0; charsets[i] != NULL && converter == (GIConv)-1; i++) {
+        converter = g_iconv_open("UTF-8", charsets[i]);
+    }
+    if (converter == (GIConv)-1) return false;
+
+    gchar *in = (gchar *)data;
+    gsize in_left = len;
+    char buffer[4096];
+
+    while (in_left > 0) {
+        gchar *out = buffer;
+        gsize out_left = sizeof(buffer);
+        gsize status = g_iconv(converter, &in, &in_left, &out, &out_left);
+        g_string_append_len(result, buffer, out - buffer);
+
+        if (status == (gsize)-1 && errno != E2BIG) {
+            // EILSEQ, or EINVAL for a sequence cut off at the end
+            append_invalid(result, invalid);
+            in++;
+            in_left--;
+            g_iconv(converter, NULL, NULL, NULL, NULL);
+        }
+    }
+
+    g_iconv_close(converter);
+    return true;
+}
+
+// Decode one stretch of input on the calling thread; text_len gets the output length, which
+// counts any NULs decoded from the input
+static char* decode_serial(const guint8 *data, size_t len, EncodingType encoding,
+                           size_t *invalid, size_t *text_len) {
+    size_t invalid_count = 0;
+    GString *result = g_string_sized_new(len + len / 2 + 1);
+
+    switch (encoding) {
+        case ASCII:
+            // Non-printable bytes become '?'
+            for (size_t i = 0; i < len; i++) {
+                bool printable = data[i] >= 32 && data[i] <= 126;
+                g_string_append_c(result, printable ? (char)data[i] : '?');
+                if (data[i] > 127) invalid_count++;
+            }
+            break;
+
+        case UTF8: {
+            const char *p = (const char *)data;
+            const char *end = p + len;
+
+            while (p < end) {
+                gunichar ch = g_utf8_get_char_validated(p, end - p);
+                if (ch == (gunichar)-1 || ch == (gunichar)-2) {
+                    // Invalid or truncated sequence: replace one byte and resynchronise
+                    append_invalid(result, &invalid_count);
+                    p++;
+                } else {
+                    g_string_append_unichar(result, ch);
+                    p = g_utf8_next_char(p);
+                }
+            }
+            break;
+        }
+
+        case UTF16LE:
+        case UTF16BE:
+            decode_utf16(result, data, len, encoding == UTF16BE, &invalid_count);
+            break;
+
+        case UTF32LE:
+        case UTF32BE:
+            decode_utf32(result, data, len, encoding == UTF32BE, &invalid_count);
+            break;
+
+        case ISO8859_1:
+            for (size_t i = 0; i < len; i++) {
+                g_string_append_unichar(result, data[i]);
+                if (data[i] >= 0x80 && data[i] <= 0x9F) invalid_count++;
+            }
+            break;
+
+        case ISO8859_15:
+            for (size_t i = 0; i < len; i++) {
+                g_string_append_unichar(result, latin9_char(data[i]));
+                if (data[i] >= 0x80 && data[i] <= 0x9F) invalid_count++;
+            }
+            break;
+
+        case KOI8_R:
+            for (size_t i = 0; i < len; i++) {
+                g_string_append_unichar(result, data[i] < 0x80 ? data[i] : koi8r_high[data[i] - 0x80]);
+            }
+            break;
+
+        case SHIFT_JIS: {
+            // CP932 is the Shift-JIS variant most game text uses (NEC/IBM extensions)
+            static const char * const charsets[] = { "CP932", "SHIFT_JIS", NULL };
+            if (!decode_with_iconv(result, data, len, charsets, &invalid_count)) {
+                g_string_free(result, TRUE);
+                return NULL;
+            }
+            break;
+        }
+
+        case EUC_JP: {
+            static const char * const charsets[] = { "EUC-JP-MS", "EUC-JP", NULL };
+            if (!decode_with_iconv(result, data, len, charsets, &invalid_count)) {
+                g_string_free(result, TRUE);
+                return NULL;
+            }
+            break;
+        }
+
+        case TABLE_FILE: {
+            g_string_free(result, TRUE);
+            CharTable *table = char_table_get_active();
+            if (table == NULL) return NULL;
+
+            char *text = char_table_decode(table, data, len, invalid);
+            char_table_unref(table);
+            if (text_len != NULL) *text_len = strlen(text);
+            return text;
+        }
+
+        default:
+            g_string_free(result, TRUE);
+            return NULL;
+    }
+
+    if (invalid != NULL) *invalid = invalid_count;
+    if (text_len != NULL) *text_len = result->len;
+    return g_string_free(result, FALSE);
+}
+
+// Inputs from this size up are split into chunks and decoded on all cores
+#define PARALLEL_MIN_BYTES (8 * 1024 * 1024)
+#define PARALLEL_CHUNK_BYTES (2 * 1024 * 1024)
+
+typedef struct ParallelDecode ParallelDecode;
+
+// One chunk: decoded into its own buffer, then copied to its offset in the result
+typedef struct {
+    ParallelDecode *job;
+    const guint8 *data;
+    size_t len;
+    char *text;
+    size_t text_len;
+    size_t invalid;
+    size_t offset;
+} DecodeChunk;
+
+struct ParallelDecode {
+    EncodingType encoding;
+    char *output;
+    gint failed;
+    guint pending;
+    GMutex mutex;
+    GCond done;
+};
+
+static GThreadPool *decode_pool = NULL;
+
+// Whether the encoding's decoder can restart in the middle of the input
+static bool can_split(EncodingType encoding) {
+    switch (encoding) {
+        case ASCII:
+        case UTF8:
+        case UTF16LE:
+        case UTF16BE:
+        case UTF32LE:
+        case UTF32BE:
+        case ISO8859_1:
+        case ISO8859_15:
+        case KOI8_R:
+        case SHIFT_JIS:
+        case EUC_JP:
+            return true;
+        default:
+            // Table files can map multi-byte keys that may start at any byte
+            return false;
+    }
+}
+
+// Function to move a split position to the nearest safe one at or after it
+size_t text_decoder_resync_point(const guint8 *data, size_t pos, size_t end, EncodingType encoding) {
+    switch (encoding) {
+        case UTF8: {
+            // A sequence is at most four bytes, so the split is safe at a byte that is not a
+            // continuation byte, or after three continuation bytes in a row
+            for (size_t i = 0; i < 3 && pos < end && (data[pos] & 0xC0) == 0x80; i++) pos++;
+            return pos;
+        }
+
+        case UTF16LE:
+        case UTF16BE: {
+            bool big_endian = encoding == UTF16BE;
+            pos = (pos + 1) & ~(size_t)1;
+            if (pos + 2 > end) return end;
+            guint16 previous = big_endian ? (data[pos - 2] << 8) | data[pos - 1] : data[pos - 2] | (data[pos - 1] << 8);
+            guint16 current = big_endian ? (data[pos] << 8) | data[pos + 1] : data[pos] | (data[pos + 1] << 8);
+            // Don't split a surrogate pair
+            if (previous >= 0xD800 && previous <= 0xDBFF && current >= 0xDC00 && current <= 0xDFFF) pos += 2;
+            return pos < end ? pos : end;
+        }
+
+        case UTF32LE:
+        case UTF32BE:
+            pos = (pos + 3) & ~(size_t)3;
+            return pos < end ? pos : end;
+
+        case SHIFT_JIS:
+        case EUC_JP: {
+            // A lead byte can't be told from a trail byte without decoding from the start, but
+            // bytes below 0x40 (Shift-JIS) or 0x80 (EUC-JP) are never part of a pair, so the
+            // character after one always starts fresh. Text has line breaks and spaces often.
+            guint8 single_below = encoding == SHIFT_JIS ? 0x40 : 0x80;
+            for (size_t i = pos; i < end; i++) {
+                if (data[i] < single_below) return i + 1;
+            }
+            return end;
+        }
+
+        default:
+            // Single-byte encodings can split anywhere
+            return pos;
+    }
+}
+
+static void finish_chunk(ParallelDecode *job) {
+    g_mutex_lock(&job->mutex);
+    if (--job->pending == 0) g_cond_signal(&job->done);
+    g_mutex_unlock(&job->mutex);
+}
+
+// Thread pool worker: decode a chunk, or copy a decoded chunk into the result once the
+// output offsets are known
+static void run_chunk(gpointer data, gpointer user_data) {
+    DecodeChunk *chunk = data;
+    ParallelDecode *job = chunk->job;
+
+    if (job->output == NULL) {
+        chunk->text = decode_serial(chunk->data, chunk->len, job->encoding, &chunk->invalid, &chunk->text_len);
+        if (chunk->text == NULL) g_atomic_int_set(&job->failed, 1);
+    } else {
+        memcpy(job->output + chunk->offset, chunk->text, chunk->text_len);
+        g_free(chunk->text);
+        chunk->text = NULL;
+    }
+
+    finish_chunk(job);
+}
+
+// Push every chunk to the pool and wait for all of them
+static void run_chunks(ParallelDecode *job, DecodeChunk *chunks, guint count) {
+    job->pending = count;
+    for (guint i = 0; i < count; i++) {
+        g_thread_pool_push(decode_pool, &chunks[i], NULL);
+    }
+
+    g_mutex_lock(&job->mutex);
+    while (job->pending > 0) {
+        g_cond_wait(&job->done, &job->mutex);
+    }
+    g_mutex_unlock(&job->mutex);
+}
+
+// Decode a large input on the shared pool. Chunks are small compared to the input, so idle
+// workers keep taking the next one and uneven chunks balance out.
+static char* decode_parallel(const guint8 *data, size_t len, EncodingType encoding, size_t *invalid) {
+    static gsize initialized = 0;
+    if (g_once_init_enter(&initialized)) {
+        decode_pool = g_thread_pool_new(run_chunk, NULL, (gint)g_get_num_processors(), FALSE, NULL);
+        g_once_init_leave(&initialized, 1);
+    }
+
+    // Split at resynchronisation points near every nominal boundary
+    GArray *chunks = g_array_new(FALSE, TRUE, sizeof(DecodeChunk));
+    ParallelDecode job = { 0 };
+    job.encoding = encoding;
+    g_mutex_init(&job.mutex);
+    g_cond_init(&job.done);
+
+    size_t start = 0;
+    while (start < len) {
+        size_t end = len - start > PARALLEL_CHUNK_BYTES ? text_decoder_resync_point(data, start + PARALLEL_CHUNK_BYTES, len, encoding) : len;
+        DecodeChunk chunk = { 0 };
+        chunk.job = &job;
+        chunk.data = data + start;
+        chunk.len = end - start;
+        g_array_append_val(chunks, chunk);
+        start = end;
+    }
+
+    DecodeChunk *list = (DecodeChunk *)chunks->data;
+    run_chunks(&job, list, chunks->len);
+
+    char *result = NULL;
+    if (!job.failed) {
+        // Concatenate: every chunk's output offset is known now, so the copies run in parallel too
+        size_t total = 0;
+        size_t invalid_count = 0;
+        for (guint i = 0; i < chunks->len; i++) {
+            list[i].offset = total;
+            total += list[i].text_len;
+            invalid_count += list[i].invalid;
+        }
+
+        result = g_malloc(total + 1);
+        result[total] = '\0';
+        job.output = result;
+        run_chunks(&job, list, chunks->len);
+        if (invalid != NULL) *invalid = invalid_count;
+    } else {
+        for (guint i = 0; i < chunks->len; i++) {
+            g_free(list[i].text);
+        }
+    }
+
+    g_array_free(chunks, TRUE);
+    g_mutex_clear(&job.mutex);
+    g_cond_clear(&job.done);
+    return result;
+}
+
+// Function to decode binary data in a text encoding to UTF-8
+char* text_decoder_decode(const guint8 *data, size_t len, EncodingType encoding, size_t *invalid) {
+    if (len >= PARALLEL_MIN_BYTES && can_split(encoding) && g_get_num_processors() > 1) {
+        return decode_parallel(data, len, encoding, invalid);
+    }
+    return decode_serial(data, len, encoding, invalid, NULL);
+}
@@ -0,0 +1,26 @@
+#ifndef TEXT_DECODER_H
+#define TEXT_DECODER_H
+
+#include <glib.h>
+#include <stddef.h>
+#include "common.h"
+
+// Replacement shown for bytes that are not valid in the chosen encoding
+#define TEXT_DECODER_REPLACEMENT "⍰"
+
+// Function to decode binary data in a text encoding to UTF-8
+// Invalid or truncated sequences are replaced (one replacement per skipped unit) and counted in
+// invalid (may be NULL). ASCII shows every non-printable byte as '?'. ISO-8859 C1 control bytes
+// are kept but counted, as they almost never occur in real text. TABLE_FILE uses the active
+// character table. Large inputs are split at safe points and decoded on all cores, with the
+// same result as decoding them in one go. Returns NULL for byte formats (HEX, Base64, ...), or
+// for TABLE_FILE when no table is loaded.
+char* text_decoder_decode(const guint8 *data, size_t len, EncodingType encoding, size_t *invalid);
+
+// Function to move a split position to the nearest safe one at or after it
+// Decoding from a safe position gives the same characters as decoding straight through from
+// the start (Shift-JIS and EUC-JP resume after a byte that is never part of a pair). pos must be
+// past the start of data and not past end; returns end when no safe position is left.
+size_t text_decoder_resync_point(const guint8 *data, size_t pos, size_t end, EncodingType encoding);
+
+#endif /* TEXT_DECODER_H */
@@ -0,0 +1,114 @@
+#include "text_encoder.h"
+#include "char_table.h"
+#include <stdio.h>
+#include <string.h>
+
+extern bool debug_mode;
+
+// Legacy and UTF-16/32 encodings through g_convert, trying each charset name in turn
+static guint8* encode_with_charsets(const char *text, size_t len, const char * const *charsets, size_t *out_len) {
+    for (guint i = 0; charsets[i] != NULL; i++) {
+        GError *error = NULL;
+        gsize bytes_written = 0;
+        char *converted = g_convert(text, len, charsets[i], "UTF-8", NULL, &bytes_written, &error);
+        if (converted != NULL) {
+            *out_len = bytes_written;
+            return (guint8 *)converted;
+        }
+
+        // Only a charset the system doesn't know is worth another name
+        bool unsupported = g_error_matches(error, G_CONVERT_ERROR, G_CONVERT_ERROR_NO_CONVERSION);
+        g_error_free(error);
+        if (!unsupported) break;
+    }
+
+    *out_len = 0;
+    return NULL;
+}
+
+// Function to encode UTF-8 text in a text encoding
+guint8* text_encoder_encode(const char *text, size_t len, EncodingType encoding, size_t *out_len) {
+    *out_len = 0;
+
+    switch (encoding) {
+        case ASCII:
+            // Copied as is
+            *out_len = len;
+            return g_memdup2(text, MAX(len, 1));
+
+        case UTF8:
+            if (!g_utf8_validate(text, len, NULL)) return NULL;
+            *out_len = len;
+            return g_memdup2(text, MAX(len, 1));
+
+        case UTF16LE: {
+            static const char * const charsets[] = { "UTF-16LE", NULL };
+            return encode_with_charsets(text, len, charsets, out_len);
+        }
+
+        case UTF16BE: {
+            static const char * const charsets[] = { "UTF-16BE", NULL };
+            return encode_with_charsets(text, len, charsets, out_len);
+        }
+
+        case UTF32LE: {
+            static const char * const charsets[] = { "UTF-32LE", NULL };
+            return encode_with_charsets(text, len, charsets, out_len);
+        }
+
+        case UTF32BE: {
+            static const char * const charsets[] = { "UTF-32BE", NULL };
+            return encode_with_charsets(text, len, charsets, out_len);
+        }
+
+        case ISO8859_1: {
+            static const char * const charsets[] = { "ISO-8859-1", NULL };
+            return encode_with_charsets(text, len, charsets, out_len);
+        }
+
+        case ISO8859_15: {
+            static const char * const charsets[] = { "ISO-8859-15", NULL };
+            return encode_with_charsets(text, len, charsets, out_len);
+        }
+
+        case SHIFT_JIS: {
+            // Same variants as decoding
+            static const char * const charsets[] = { "CP932", "SHIFT_JIS", NULL };
+            return encode_with_charsets(text, len, charsets, out_len);
+        }
+
+        case EUC_JP: {
+            static const char * const charsets[] = { "EUC-JP-MS", "EUC-JP", NULL };
+            return encode_with_charsets(text, len, charsets, out_len);
+        }
+
+        case KOI8_R: {
+            static const char * const charsets[] = { "KOI8-R", NULL };
+            return encode_with_charsets(text, len, charsets, out_len);
+        }
+
+        case TABLE_FILE: {
+            // Encode with the loaded character table; text it can't produce is an error
+            CharTable *table = char_table_get_active();
+            if (table == NULL) return NULL;
+
+            char *copy = g_strndup(text, len);
+            size_t unmapped = 0;
+            guint8 *bin_data = char_table_encode(table, copy, out_len, &unmapped);
+            char_table_unref(table);
+            g_free(copy);
+            if (unmapped > 0) {
+                if (debug_mode) {
+                    fprintf(stderr, "DEBUG: %zu characters are not in the table\n", unmapped);
+                }
+                g_free(bin_data);
+                *out_len = 0;
+                return NULL;
+            }
+            return bin_data;
+        }
+
+        default:
+            return NULL;
+    }
+}
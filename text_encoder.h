@@ -0,0 +1,14 @@
+#ifndef TEXT_ENCODER_H
+#define TEXT_ENCODER_H
+
+#include <glib.h>
+#include <stddef.h>
+#include "common.h"
+
+// Function to encode UTF-8 text in a text encoding
+// ASCII copies the bytes as they are. Returns NULL (with out_len 0) for byte formats (HEX,
+// Base64, ...), for text that is not valid UTF-8, for characters the encoding can't represent,
+// and for TABLE_FILE when no table is loaded.
+guint8* text_encoder_encode(const char *text, size_t len, EncodingType encoding, size_t *out_len);
+
+#endif /* TEXT_ENCODER_H */
@@ -0,0 +1,363 @@
+#include "tokenizer.h"
+#include "segmenter.h"
+#include <stdio.h>
+#include <string.h>
+
+// Pieces longer than this are counted in slices, which bounds the quadratic merge loop
+// (long runs of CJK letters have no spaces and would otherwise form a single piece)
+#define MAX_PIECE_BYTES 512
+
+#define NO_RANK G_MAXUINT32
+
+struct Tokenizer {
+    guint8 *bytes;       // Decoded token bytes, back to back
+    guint32 *offsets;    // Per entry: offset into bytes
+    guint32 *lengths;    // Per entry: length in bytes
+    guint32 *ranks;      // Per entry: merge rank
+    guint32 count;
+    guint32 *slots;      // Open-addressing table of entry index + 1, 0 = empty
+    guint32 slot_mask;
+};
+
+// Character classes used to split text into pieces before merging
+typedef enum {
+    CHAR_LETTER,
+    CHAR_NUMBER,
+    CHAR_NEWLINE,
+    CHAR_SPACE,
+    CHAR_OTHER
+} CharClass;
+
+static inline guint32 hash_bytes(const guint8 *data, size_t len) {
+    guint32 hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Look up the rank of a byte string, NO_RANK if it is not in the vocabulary
+static guint32 lookup_rank(const Tokenizer *tokenizer, const guint8 *data, size_t len) {
+    guint32 slot = hash_bytes(data, len) & tokenizer->slot_mask;
+
+    while (tokenizer->slots[slot] != 0) {
+        guint32 entry = tokenizer->slots[slot] - 1;
+        if (tokenizer->lengths[entry] == len &&
+            memcmp(tokenizer->bytes + tokenizer->offsets[entry], data, len) == 0) {
+            return tokenizer->ranks[entry];
+        }
+        slot = (slot + 1) & tokenizer->slot_mask;
+    }
+
+    return NO_RANK;
+}
+
+// Function to load a vocabulary file
+Tokenizer* tokenizer_load(const char *path) {
+    GError *error = NULL;
+    GMappedFile *file = g_mapped_file_new(path, FALSE, &error);
+    if (file == NULL) {
+        fprintf(stderr, "DEBUG: Could not map vocabulary %s: %s\n", path, error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    const char *data = g_mapped_file_get_contents(file);
+    size_t size = g_mapped_file_get_length(file);
+    if (data == NULL || size == 0) {
+        g_mapped_file_unref(file);
+        return NULL;
+    }
+
+    guint32 capacity = 1;
+    for (const char *p = data; (p = memchr(p, '\n', size - (p - data))) != NULL; p++) {
+        capacity++;
+    }
+
+    Tokenizer *tokenizer = g_new0(Tokenizer, 1);
+    tokenizer->bytes = g_malloc(size / 4 * 3 + 3);
+    tokenizer->offsets = g_new(guint32, capacity);
+    tokenizer->lengths = g_new(guint32, capacity);
+    tokenizer->ranks = g_new(guint32, capacity);
+
+    // Parse "<base64> <rank>" lines straight out of the mapping
+    size_t used = 0;
+    size_t pos = 0;
+    while (pos < size) {
+        const char *line = data + pos;
+        const char *line_end = memchr(line, '\n', size - pos);
+        size_t line_len = line_end != NULL ? (size_t)(line_end - line) : size - pos;
+        pos += line_len + 1;
+
+        const char *space = memchr(line, ' ', line_len);
+        if (space == NULL || space == line) continue;
+
+        guint64 rank = 0;
+        const char *digit = space + 1;
+        while (digit < line + line_len && *digit >= '0' && *digit <= '9') {
+            rank = rank * 10 + (guint64)(*digit - '0');
+            digit++;
+        }
+        if (digit == space + 1 || rank >= NO_RANK) continue;
+
+        gint state = 0;
+        guint save = 0;
+        gsize decoded = g_base64_decode_step(line, space - line, tokenizer->bytes + used, &state, &save);
+        if (decoded == 0) continue;
+
+        tokenizer->offsets[tokenizer->count] = (guint32)used;
+        tokenizer->lengths[tokenizer->count] = (guint32)decoded;
+        tokenizer->ranks[tokenizer->count] = (guint32)rank;
+        tokenizer->count++;
+        used += decoded;
+    }
+    g_mapped_file_unref(file);
+
+    if (tokenizer->count == 0) {
+        fprintf(stderr, "DEBUG: Vocabulary %s has no entries\n", path);
+        tokenizer_free(tokenizer);
+        return NULL;
+    }
+
+    // Hash table at most half full
+    guint32 slot_count = 1;
+    while (slot_count < tokenizer->count * 2) slot_count <<= 1;
+    tokenizer->slots = g_new0(guint32, slot_count);
+    tokenizer->slot_mask = slot_count - 1;
+
+    for (guint32 i = 0; i < tokenizer->count; i++) {
+        const guint8 *token = tokenizer->bytes + tokenizer->offsets[i];
+        if (lookup_rank(tokenizer, token, tokenizer->lengths[i]) != NO_RANK) continue;
+
+        guint32 slot = hash_bytes(token, tokenizer->lengths[i]) & tokenizer->slot_mask;
+        while (tokenizer->slots[slot] != 0) {
+            slot = (slot + 1) & tokenizer->slot_mask;
+        }
+        tokenizer->slots[slot] = i + 1;
+    }
+
+    fprintf(stderr, "DEBUG: Loaded vocabulary %s with %u tokens\n", path, tokenizer->count);
+    return tokenizer;
+}
+
+// Vocabularies that can be shared between callers
+static const char *vocabulary_names[] = { "cl100k_base", "o200k_base" };
+static Tokenizer *shared_tokenizers[G_N_ELEMENTS(vocabulary_names)];
+G_LOCK_DEFINE_STATIC(shared_tokenizers);
+
+// Function to get the vocabulary name used for a model
+// Gemini's tokenizer is not published; cl100k_base gives counts in the same range.
+const char* tokenizer_vocabulary_for_model(const char *model) {
+    static const char *o200k_prefixes[] = { "gpt-4o", "chatgpt-4o", "gpt-4.1", "gpt-5", "o1", "o3", "o4" };
+
+    if (model != NULL) {
+        for (size_t i = 0; i < G_N_ELEMENTS(o200k_prefixes); i++) {
+            if (g_str_has_prefix(model, o200k_prefixes[i])) return "o200k_base";
+        }
+    }
+    return "cl100k_base";
+}
+
+// Function to get the shared tokenizer for a model
+Tokenizer* tokenizer_for_model(const char *config_dir, const char *model) {
+    const char *name = tokenizer_vocabulary_for_model(model);
+    size_t index = 0;
+    while (strcmp(vocabulary_names[index], name) != 0) index++;
+
+    G_LOCK(shared_tokenizers);
+    if (shared_tokenizers[index] == NULL) {
+        // Retried on every call until the file shows up, so it can be installed while running
+        char *file_name = g_strconcat(name, ".tiktoken", NULL);
+        char *path = g_build_filename(config_dir, file_name, NULL);
+        if (g_file_test(path, G_FILE_TEST_IS_REGULAR)) {
+            shared_tokenizers[index] = tokenizer_load(path);
+        }
+        g_free(path);
+        g_free(file_name);
+    }
+    Tokenizer *tokenizer = shared_tokenizers[index];
+    G_UNLOCK(shared_tokenizers);
+
+    return tokenizer;
+}
+
+// Classify the character at p and report its length in bytes
+static CharClass classify_char(const char *p, const char *end, size_t *char_len) {
+    unsigned char lead = (unsigned char)*p;
+
+    if (lead < 0x80) {
+        *char_len = 1;
+        if (g_ascii_isalpha(lead)) return CHAR_LETTER;
+        if (g_ascii_isdigit(lead)) return CHAR_NUMBER;
+        if (lead == '\r' || lead == '\n') return CHAR_NEWLINE;
+        if (g_ascii_isspace(lead)) return CHAR_SPACE;
+        return CHAR_OTHER;
+    }
+
+    gunichar c = g_utf8_get_char_validated(p, end - p);
+    if (c == (gunichar)-1 || c == (gunichar)-2) {
+        *char_len = 1;
+        return CHAR_OTHER;
+    }
+    *char_len = g_utf8_next_char(p) - p;
+
+    if (g_unichar_isalpha(c)) return CHAR_LETTER;
+    switch (g_unichar_type(c)) {
+        case G_UNICODE_DECIMAL_NUMBER:
+        case G_UNICODE_LETTER_NUMBER:
+        case G_UNICODE_OTHER_NUMBER:
+            return CHAR_NUMBER;
+        default:
+            break;
+    }
+    if (g_unichar_isspace(c)) return CHAR_SPACE;
+    return CHAR_OTHER;
+}
+
+// Length of the run of characters of one class starting at pos (at most max_chars characters)
+static size_t class_run(const char *text, size_t pos, size_t len, CharClass wanted, size_t max_chars) {
+    size_t start = pos;
+    size_t chars = 0;
+
+    while (pos < len && chars < max_chars) {
+        size_t char_len;
+        if (classify_char(text + pos, text + len, &char_len) != wanted) break;
+        pos += char_len;
+        chars++;
+    }
+
+    return pos - start;
+}
+
+// Length of the next pre-tokenization piece at pos
+// Hand-written equivalent of the cl100k_base split pattern:
+//   's|'t|'re|'ve|'m|'ll|'d | [^\r\n\p{L}\p{N}]?\p{L}+ | \p{N}{1,3} | ?[^\s\p{L}\p{N}]+[\r\n]*
+//   | \s*[\r\n] | \s+(?!\S) | \s+
+// o200k_base splits some mixed-case words differently, which shifts counts only slightly.
+static size_t next_piece(const char *text, size_t pos, size_t len) {
+    size_t char_len;
+    CharClass first = classify_char(text + pos, text + len, &char_len);
+
+    // Contractions
+    if (text[pos] == '\'' && pos + 1 < len) {
+        char a = g_ascii_tolower(text[pos + 1]);
+        char b = pos + 2 < len ? g_ascii_tolower(text[pos + 2]) : '\0';
+        if ((a == 'l' && b == 'l') || (a == 'v' && b == 'e') || (a == 'r' && b == 'e')) return 3;
+        if (a == 's' || a == 't' || a == 'm' || a == 'd') return 2;
+    }
+
+    // Letters, optionally led by one character that is not a letter, digit or line break
+    size_t letters_at = pos;
+    if (first != CHAR_LETTER && first != CHAR_NUMBER && first != CHAR_NEWLINE) {
+        letters_at = pos + char_len;
+    }
+    size_t letters = letters_at < len ? class_run(text, letters_at, len, CHAR_LETTER, SIZE_MAX) : 0;
+    if (letters > 0) return letters_at + letters - pos;
+
+    // Up to three digits
+    if (first == CHAR_NUMBER) return class_run(text, pos, len, CHAR_NUMBER, 3);
+
+    // Punctuation, optionally led by a space, followed by any line breaks
+    size_t other_at = (text[pos] == ' ' && pos + 1 < len) ? pos + 1 : pos;
+    size_t other = class_run(text, other_at, len, CHAR_OTHER, SIZE_MAX);
+    if (other > 0) {
+        size_t end = other_at + other;
+        while (end < len && (text[end] == '\r' || text[end] == '\n')) end++;
+        return end - pos;
+    }
+
+    // Whitespace: up to the last line break in the run, else leave the final space to the next word
+    size_t end = pos;
+    size_t last_break = 0;
+    size_t last_char = pos;
+    while (end < len) {
+        CharClass cls = classify_char(text + end, text + len, &char_len);
+        if (cls != CHAR_SPACE && cls != CHAR_NEWLINE) break;
+        last_char = end;
+        end += char_len;
+        if (cls == CHAR_NEWLINE) last_break = end;
+    }
+
+    if (last_break > 0) return last_break - pos;
+    if (end == len || last_char == pos) return MAX(end - pos, 1);
+    return last_char - pos;
+}
+
+// Count the tokens of one piece by applying byte-pair merges in rank order
+static size_t count_piece(const Tokenizer *tokenizer, const guint8 *piece, size_t len) {
+    if (len <= 1) return len;
+    if (lookup_rank(tokenizer, piece, len) != NO_RANK) return 1;
+
+    // bounds[i] is where part i starts; ranks[i] is the rank of merging parts i and i + 1
+    size_t bounds[MAX_PIECE_BYTES + 1];
+    guint32 ranks[MAX_PIECE_BYTES];
+    size_t parts = len;
+
+    for (size_t i = 0; i <= len; i++) bounds[i] = i;
+    for (size_t i = 0; i + 1 < parts; i++) {
+        ranks[i] = lookup_rank(tokenizer, piece + i, 2);
+    }
+
+    while (parts > 1) {
+        size_t best = 0;
+        guint32 best_rank = NO_RANK;
+        for (size_t i = 0; i + 1 < parts; i++) {
+            if (ranks[i] < best_rank) {
+                best_rank = ranks[i];
+                best = i;
+            }
+        }
+        if (best_rank == NO_RANK) break;
+
+        // Merge parts best and best + 1
+        memmove(&bounds[best + 1], &bounds[best + 2], (parts - best - 1) * sizeof(bounds[0]));
+        memmove(&ranks[best + 1], &ranks[best + 2], (parts >= best + 3 ? parts - best - 3 : 0) * sizeof(ranks[0]));
+        parts--;
+
+        if (best + 1 < parts) {
+            ranks[best] = lookup_rank(tokenizer, piece + bounds[best], bounds[best + 2] - bounds[best]);
+        }
+        if (best > 0) {
+            ranks[best - 1] = lookup_rank(tokenizer, piece + bounds[best - 1], bounds[best + 1] - bounds[best - 1]);
+        }
+    }
+
+    return parts;
+}
+
+// Function to count the tokens in a UTF-8 string
+size_t tokenizer_count(const Tokenizer *tokenizer, const char *text, gssize len) {
+    if (text == NULL) return 0;
+    if (tokenizer == NULL) return segmenter_estimate_tokens(text, len);
+
+    size_t n = len < 0 ? strlen(text) : (size_t)len;
+    size_t tokens = 0;
+    size_t pos = 0;
+
+    while (pos < n) {
+        size_t piece_len = next_piece(text, pos, n);
+        size_t end = pos + piece_len;
+
+        while (pos < end) {
+            size_t slice = MIN(end - pos, MAX_PIECE_BYTES);
+            // Keep slices on character boundaries
+            while (slice < end - pos && slice > 1 && ((unsigned char)text[pos + slice] & 0xC0) == 0x80) slice--;
+            tokens += count_piece(tokenizer, (const guint8 *)text + pos, slice);
+            pos += slice;
+        }
+    }
+
+    return tokens;
+}
+
+// Function to free a tokenizer
+void tokenizer_free(Tokenizer *tokenizer) {
+    if (tokenizer == NULL) return;
+
+    g_free(tokenizer->bytes);
+    g_free(tokenizer->offsets);
+    g_free(tokenizer->lengths);
+    g_free(tokenizer->ranks);
+    g_free(tokenizer->slots);
+    g_free(tokenizer);
+}
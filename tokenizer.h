@@ -0,0 +1,31 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Local byte-pair-encoding token counter
+// Vocabularies use the tiktoken file format (one "<base64 token> <rank>" per line), e.g.
+// cl100k_base.tiktoken or o200k_base.tiktoken placed in the config directory. A loaded
+// tokenizer is read-only and can be shared between threads.
+typedef struct Tokenizer Tokenizer;
+
+// Function to load a vocabulary file; returns NULL if it is missing or malformed
+Tokenizer* tokenizer_load(const char *path);
+
+// Function to get the shared tokenizer for a model, with its vocabulary file in config_dir
+// Returns NULL when the matching vocabulary file is not installed; the result must not be freed.
+Tokenizer* tokenizer_for_model(const char *config_dir, const char *model);
+
+// Function to get the vocabulary name used for a model ("cl100k_base" or "o200k_base")
+const char* tokenizer_vocabulary_for_model(const char *model);
+
+// Function to count the tokens in a UTF-8 string (len < 0 means NUL-terminated)
+// With a NULL tokenizer the count is a character-based estimate.
+size_t tokenizer_count(const Tokenizer *tokenizer, const char *text, gssize len);
+
+// Function to free a tokenizer
+void tokenizer_free(Tokenizer *tokenizer);
+
+#endif /* TOKENIZER_H */
@@ -0,0 +1,420 @@
+#include "translation_memory.h"
+#include "record_file.h"
+#include <stdio.h>
+#include <string.h>
+
+// Character n-gram length used for candidate filtering
+#define GRAM_SIZE 3
+// Padding character placed before and after the text so short texts still have grams
+#define GRAM_PAD 0
+
+typedef struct {
+    char *key;         // Context and source, as looked up exactly
+    char *context;     // Settings the translation was made under
+    char *source;
+    char *translation;
+    gunichar *chars;   // Source as code points
+    glong length;      // Number of code points
+} MemoryEntry;
+
+struct TranslationMemory {
+    GMutex mutex;
+    char *path;
+    GPtrArray *entries;   // MemoryEntry*, index is the entry id
+    GHashTable *ids;      // entry key -> entry id + 1
+    GHashTable *postings; // gram key -> GArray of entry ids containing the gram
+};
+
+// Bit masks of the positions of each character in a pattern, 64 positions per block
+typedef struct {
+    guint blocks;
+    gint ascii_rows[128];  // Row of an ASCII character, -1 if absent
+    GHashTable *rows;      // Other characters -> row + 1
+    guint64 *masks;        // rows * blocks
+} PatternMasks;
+
+static void memory_entry_free(gpointer data) {
+    MemoryEntry *entry = data;
+    g_free(entry->key);
+    g_free(entry->context);
+    g_free(entry->source);
+    g_free(entry->translation);
+    g_free(entry->chars);
+    g_free(entry);
+}
+
+static void postings_free(gpointer data) {
+    g_array_free(data, TRUE);
+}
+
+static inline guint32 gram_key(gunichar a, gunichar b, gunichar c) {
+    return ((a * 0x9E3779B1u) ^ (b * 0x85EBCA77u) ^ (c * 0xC2B2AE3Du)) + (a << 7) + c;
+}
+
+static int compare_keys(const void *a, const void *b) {
+    guint32 x = *(const guint32 *)a, y = *(const guint32 *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Collect the distinct padded n-grams of a text
+static GArray* collect_grams(const gunichar *chars, glong length) {
+    GArray *keys = g_array_sized_new(FALSE, FALSE, sizeof(guint32), length + GRAM_SIZE);
+
+    for (glong i = -(GRAM_SIZE - 1); i < length; i++) {
+        gunichar g[GRAM_SIZE];
+        for (glong k = 0; k < GRAM_SIZE; k++) {
+            glong pos = i + k;
+            g[k] = (pos >= 0 && pos < length) ? chars[pos] : GRAM_PAD;
+        }
+        guint32 key = gram_key(g[0], g[1], g[2]);
+        g_array_append_val(keys, key);
+    }
+
+    g_array_sort(keys, compare_keys);
+
+    guint unique = 0;
+    for (guint i = 0; i < keys->len; i++) {
+        if (i == 0 || g_array_index(keys, guint32, i) != g_array_index(keys, guint32, unique - 1)) {
+            g_array_index(keys, guint32, unique++) = g_array_index(keys, guint32, i);
+        }
+    }
+    g_array_set_size(keys, unique);
+
+    return keys;
+}
+
+static void pattern_masks_init(PatternMasks *pm, const gunichar *pattern, glong length) {
+    pm->blocks = (guint)MAX((length + 63) / 64, 1);
+    pm->rows = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (int i = 0; i < 128; i++) pm->ascii_rows[i] = -1;
+
+    // Assign a row to each distinct character
+    guint row_count = 0;
+    gint *row_of = g_new(gint, MAX(length, 1));
+    for (glong i = 0; i < length; i++) {
+        gunichar c = pattern[i];
+        gint row;
+        if (c < 128) {
+            if (pm->ascii_rows[c] < 0) pm->ascii_rows[c] = row_count++;
+            row = pm->ascii_rows[c];
+        } else {
+            gpointer found = g_hash_table_lookup(pm->rows, GUINT_TO_POINTER(c));
+            if (found == NULL) {
+                found = GUINT_TO_POINTER(++row_count);
+                g_hash_table_insert(pm->rows, GUINT_TO_POINTER(c), found);
+            }
+            row = GPOINTER_TO_INT(found) - 1;
+        }
+        row_of[i] = row;
+    }
+
+    pm->masks = g_new0(guint64, (gsize)MAX(row_count, 1) * pm->blocks);
+    for (glong i = 0; i < length; i++) {
+        pm->masks[(gsize)row_of[i] * pm->blocks + i / 64] |= 1ULL << (i % 64);
+    }
+    g_free(row_of);
+}
+
+static void pattern_masks_clear(PatternMasks *pm) {
+    g_hash_table_destroy(pm->rows);
+    g_free(pm->masks);
+}
+
+// Mask row of a text character, NULL if it does not occur in the pattern
+static inline const guint64 *pattern_row(const PatternMasks *pm, gunichar c) {
+    if (c < 128) {
+        gint row = pm->ascii_rows[c];
+        return row >= 0 ? pm->masks + (gsize)row * pm->blocks : NULL;
+    }
+    gpointer found = g_hash_table_lookup(pm->rows, GUINT_TO_POINTER(c));
+    return found != NULL ? pm->masks + (gsize)(GPOINTER_TO_INT(found) - 1) * pm->blocks : NULL;
+}
+
+// Advance one 64-row block of Myers' algorithm by one text character
+// hin is the score change entering the block's top row; returns the change leaving row out_bit.
+static inline int advance_block(guint64 *pv_io, guint64 *mv_io, guint64 eq, int hin, guint out_bit) {
+    guint64 pv = *pv_io;
+    guint64 mv = *mv_io;
+    guint64 xv = eq | mv;
+    if (hin < 0) eq |= 1;
+    guint64 xh = (((eq & pv) + pv) ^ pv) | eq;
+    guint64 ph = mv | ~(xh | pv);
+    guint64 mh = pv & xh;
+
+    int hout = 0;
+    guint64 out_mask = 1ULL << out_bit;
+    if (ph & out_mask) hout = 1;
+    else if (mh & out_mask) hout = -1;
+
+    ph <<= 1;
+    mh <<= 1;
+    if (hin < 0) mh |= 1;
+    else if (hin > 0) ph |= 1;
+
+    *pv_io = mh | ~(xv | ph);
+    *mv_io = ph & xv;
+    return hout;
+}
+
+// Edit distance between the pattern and text, or max_distance + 1 once it must exceed it
+static guint myers_distance(const PatternMasks *pm, glong m, const gunichar *text, glong n, guint max_distance) {
+    if (m == 0) return (guint)MIN(n, (glong)max_distance + 1);
+
+    guint blocks = pm->blocks;
+    guint64 *pv = g_new(guint64, blocks);
+    guint64 *mv = g_new0(guint64, blocks);
+    for (guint b = 0; b < blocks; b++) pv[b] = ~0ULL;
+
+    glong score = m;
+    guint last_bit = (guint)((m - 1) % 64);
+
+    for (glong j = 0; j < n; j++) {
+        const guint64 *row = pattern_row(pm, text[j]);
+
+        // Global alignment: the score above the first row grows by one per column
+        int carry = 1;
+        for (guint b = 0; b < blocks; b++) {
+            carry = advance_block(&pv[b], &mv[b], row != NULL ? row[b] : 0, carry, b + 1 == blocks ? last_bit : 63);
+        }
+        score += carry;
+
+        // Each remaining column can lower the score by at most one
+        if (score - (n - j - 1) > (glong)max_distance) {
+            score = (glong)max_distance + 1;
+            break;
+        }
+    }
+
+    g_free(pv);
+    g_free(mv);
+    return (guint)MIN(score, (glong)max_distance + 1);
+}
+
+// Function to compute the edit distance between two UTF-8 strings in characters
+guint translation_memory_edit_distance(const char *a, const char *b, guint max_distance) {
+    glong m = 0, n = 0;
+    gunichar *pattern = g_utf8_to_ucs4_fast(a, -1, &m);
+    gunichar *text = g_utf8_to_ucs4_fast(b, -1, &n);
+
+    PatternMasks pm;
+    pattern_masks_init(&pm, pattern, m);
+    guint distance = myers_distance(&pm, m, text, n, max_distance);
+    pattern_masks_clear(&pm);
+
+    g_free(pattern);
+    g_free(text);
+    return distance;
+}
+
+// Exact-match key of a source under a context; the separator can't occur in settings
+static char* entry_key(const char *context, const char *source) {
+    return g_strconcat(context, "\x1f", source, NULL);
+}
+
+// Add an entry, or replace the translation of an existing one; requires the lock
+static void add_entry_locked(TranslationMemory *memory, const char *context, const char *source,
+                             const char *translation) {
+    char *key = entry_key(context, source);
+    gpointer existing = g_hash_table_lookup(memory->ids, key);
+    if (existing != NULL) {
+        MemoryEntry *entry = g_ptr_array_index(memory->entries, GPOINTER_TO_UINT(existing) - 1);
+        g_free(entry->translation);
+        entry->translation = g_strdup(translation);
+        g_free(key);
+        return;
+    }
+
+    MemoryEntry *entry = g_new0(MemoryEntry, 1);
+    entry->key = key;
+    entry->context = g_strdup(context);
+    entry->source = g_strdup(source);
+    entry->translation = g_strdup(translation);
+    entry->chars = g_utf8_to_ucs4_fast(source, -1, &entry->length);
+
+    guint32 id = memory->entries->len;
+    g_ptr_array_add(memory->entries, entry);
+    g_hash_table_insert(memory->ids, entry->key, GUINT_TO_POINTER(id + 1));
+
+    GArray *grams = collect_grams(entry->chars, entry->length);
+    for (guint i = 0; i < grams->len; i++) {
+        gpointer key = GUINT_TO_POINTER(g_array_index(grams, guint32, i));
+        GArray *ids = g_hash_table_lookup(memory->postings, key);
+        if (ids == NULL) {
+            ids = g_array_new(FALSE, FALSE, sizeof(guint32));
+            g_hash_table_insert(memory->postings, key, ids);
+        }
+        g_array_append_val(ids, id);
+    }
+    g_array_free(grams, TRUE);
+}
+
+// Function to open a translation memory backed by a file
+TranslationMemory* translation_memory_open(const char *path) {
+    TranslationMemory *memory = g_new0(TranslationMemory, 1);
+    g_mutex_init(&memory->mutex);
+    memory->path = g_strdup(path);
+    memory->entries = g_ptr_array_new_with_free_func(memory_entry_free);
+    memory->ids = g_hash_table_new(g_str_hash, g_str_equal);
+    memory->postings = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, postings_free);
+
+    char *contents = NULL;
+    if (path != NULL && g_file_get_contents(path, &contents, NULL, NULL)) {
+        // One "context<TAB>source<TAB>translation" per line, later lines replace earlier ones.
+        // Lines from before entries had a context (two fields) can't be matched to any settings,
+        // so they are skipped.
+        gchar **lines = g_strsplit(contents, "\n", -1);
+        for (guint i = 0; lines[i] != NULL; i++) {
+            if (lines[i][0] == '\0') continue;
+
+            gchar **fields = record_split_fields(lines[i]);
+            if (g_strv_length(fields) >= 3 && fields[1][0] != '\0') {
+                add_entry_locked(memory, fields[0], fields[1], fields[2]);
+            }
+            g_strfreev(fields);
+        }
+        g_strfreev(lines);
+        g_free(contents);
+    }
+
+    fprintf(stderr, "DEBUG: Translation memory has %u entries\n", memory->entries->len);
+    return memory;
+}
+
+// Function to get the number of entries
+guint translation_memory_size(TranslationMemory *memory) {
+    if (memory == NULL) return 0;
+
+    g_mutex_lock(&memory->mutex);
+    guint size = memory->entries->len;
+    g_mutex_unlock(&memory->mutex);
+    return size;
+}
+
+// Function to add (or replace) the translation of a source segment
+void translation_memory_add(TranslationMemory *memory, const char *context, const char *source,
+                            const char *translation) {
+    if (memory == NULL || context == NULL || source == NULL || *source == '\0' || translation == NULL) return;
+
+    g_mutex_lock(&memory->mutex);
+    add_entry_locked(memory, context, source, translation);
+
+    if (memory->path != NULL) {
+        GString *line = g_string_new(NULL);
+        record_append_field(line, context);
+        record_append_field(line, source);
+        record_append_field(line, translation);
+        g_string_append_c(line, '\n');
+        record_file_append(memory->path, line->str, line->len, false);
+        g_string_free(line, TRUE);
+    }
+    g_mutex_unlock(&memory->mutex);
+}
+
+// Function to find the closest entry with at least min_similarity
+bool translation_memory_lookup(TranslationMemory *memory, const char *context, const char *text,
+                               double min_similarity, TranslationMemoryMatch *match) {
+    if (memory == NULL || context == NULL || text == NULL || *text == '\0' || match == NULL) return false;
+    min_similarity = CLAMP(min_similarity, 0.01, 1.0);
+
+    g_mutex_lock(&memory->mutex);
+
+    // Exact match
+    char *key = entry_key(context, text);
+    gpointer exact = g_hash_table_lookup(memory->ids, key);
+    g_free(key);
+    if (exact != NULL) {
+        MemoryEntry *entry = g_ptr_array_index(memory->entries, GPOINTER_TO_UINT(exact) - 1);
+        match->source = g_strdup(entry->source);
+        match->translation = g_strdup(entry->translation);
+        match->distance = 0;
+        match->similarity = 1.0;
+        g_mutex_unlock(&memory->mutex);
+        return true;
+    }
+
+    glong m = 0;
+    gunichar *chars = g_utf8_to_ucs4_fast(text, -1, &m);
+
+    // similarity >= s allows at most (1 - s) * max(m, n) edits, and max(m, n) <= m + edits
+    guint max_distance = (guint)((1.0 - min_similarity) * m / min_similarity);
+
+    // q-gram lemma: each edit destroys at most GRAM_SIZE of the query's distinct grams
+    GArray *grams = collect_grams(chars, m);
+    gint threshold = (gint)grams->len - (gint)(max_distance * GRAM_SIZE);
+
+    GArray *candidates = g_array_new(FALSE, FALSE, sizeof(guint32));
+    if (threshold <= 0) {
+        for (guint32 id = 0; id < memory->entries->len; id++) g_array_append_val(candidates, id);
+    } else {
+        guint32 *counts = g_new0(guint32, MAX(memory->entries->len, 1));
+        for (guint i = 0; i < grams->len; i++) {
+            GArray *ids = g_hash_table_lookup(memory->postings, GUINT_TO_POINTER(g_array_index(grams, guint32, i)));
+            if (ids == NULL) continue;
+            for (guint k = 0; k < ids->len; k++) {
+                guint32 id = g_array_index(ids, guint32, k);
+                if (++counts[id] == (guint32)threshold) g_array_append_val(candidates, id);
+            }
+        }
+        g_free(counts);
+    }
+    g_array_free(grams, TRUE);
+
+    // Verify the candidates, keeping the most similar
+    PatternMasks pm;
+    pattern_masks_init(&pm, chars, m);
+
+    MemoryEntry *best = NULL;
+    guint best_distance = 0;
+    double best_similarity = 0;
+
+    for (guint i = 0; i < candidates->len; i++) {
+        MemoryEntry *entry = g_ptr_array_index(memory->entries, g_array_index(candidates, guint32, i));
+        if ((guint)ABS(entry->length - m) > max_distance || strcmp(entry->context, context) != 0) continue;
+
+        guint distance = myers_distance(&pm, m, entry->chars, entry->length, max_distance);
+        if (distance > max_distance) continue;
+
+        double similarity = 1.0 - (double)distance / MAX(m, entry->length);
+        if (similarity >= min_similarity && similarity >= best_similarity) {
+            best = entry;
+            best_distance = distance;
+            best_similarity = similarity;
+        }
+    }
+
+    pattern_masks_clear(&pm);
+    g_array_free(candidates, TRUE);
+    g_free(chars);
+
+    if (best != NULL) {
+        match->source = g_strdup(best->source);
+        match->translation = g_strdup(best->translation);
+        match->distance = best_distance;
+        match->similarity = best_similarity;
+    }
+
+    g_mutex_unlock(&memory->mutex);
+    return best != NULL;
+}
+
+// Function to free the strings of a match
+void translation_memory_match_clear(TranslationMemoryMatch *match) {
+    if (match == NULL) return;
+
+    g_free(match->source);
+    g_free(match->translation);
+    match->source = NULL;
+    match->translation = NULL;
+}
+
+// Function to free a translation memory
+void translation_memory_free(TranslationMemory *memory) {
+    if (memory == NULL) return;
+
+    g_hash_table_destroy(memory->postings);
+    g_hash_table_destroy(memory->ids);
+    g_ptr_array_unref(memory->entries);
+    g_mutex_clear(&memory->mutex);
+    g_free(memory->path);
+    g_free(memory);
+}
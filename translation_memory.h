@@ -0,0 +1,47 @@
+#ifndef TRANSLATION_MEMORY_H
+#define TRANSLATION_MEMORY_H
+
+#include <glib.h>
+#include <stdbool.h>
+
+// Fuzzy translation memory of previously translated segments
+// Lookups filter candidates by shared character trigrams and verify them with a bit-parallel
+// edit distance. The memory is internally locked, so entries can be added from worker threads.
+// Each entry has a context, the settings it was translated under (target language, formats);
+// lookups only match entries of the same context.
+typedef struct TranslationMemory TranslationMemory;
+
+// Best match for a lookup; strings are copies owned by the caller (free with translation_memory_match_clear)
+typedef struct {
+    char *source;
+    char *translation;
+    guint distance;    // Edit distance in characters
+    double similarity; // 1 - distance / length of the longer text
+} TranslationMemoryMatch;
+
+// Function to open a translation memory backed by a file (loaded now, appended to on every add)
+// A missing file is fine; path may be NULL for an in-memory only memory.
+TranslationMemory* translation_memory_open(const char *path);
+
+// Function to get the number of entries
+guint translation_memory_size(TranslationMemory *memory);
+
+// Function to add (or replace) the translation of a source segment under a context
+void translation_memory_add(TranslationMemory *memory, const char *context, const char *source,
+                            const char *translation);
+
+// Function to find the closest entry of the context with at least min_similarity (0..1)
+bool translation_memory_lookup(TranslationMemory *memory, const char *context, const char *text,
+                               double min_similarity, TranslationMemoryMatch *match);
+
+// Function to free the strings of a match
+void translation_memory_match_clear(TranslationMemoryMatch *match);
+
+// Function to compute the edit distance between two UTF-8 strings in characters
+// Returns max_distance + 1 as soon as the distance is known to exceed max_distance.
+guint translation_memory_edit_distance(const char *a, const char *b, guint max_distance);
+
+// Function to free a translation memory
+void translation_memory_free(TranslationMemory *memory);
+
+#endif /* TRANSLATION_MEMORY_H */